@@ -0,0 +1,178 @@
+#include "benchmarks.h"
+#include "scan_matrix.h"
+
+// =============================================
+// БЕНЧМАРК САМОКАЛИБРОВКИ ТАЙМИНГОВ
+// Слабые ячейки (столбец 2 и строка 2) медленно отпускают прежнюю антенну
+// и долго активируют метку - ради них подобраны консервативные SCAN_DELAY_MS,
+// PN532_TIMEOUT_MS и MUX_SETTLE_TIME_US. Сравниваем проход до и после
+// обучения (метки гуляют по доске), проверяем отсутствие ложных событий
+// и загрузку профилей после перезагрузки. Поле на переключении - в режиме
+// AUTO: он не должен лишать обучение паузы образцов (пауза ниже стартовой)
+// =============================================
+
+extern ScanMatrix scanMatrix;
+
+// Модель слабых ячеек (пауза переключения - параметр бенчмарка)
+static const uint32_t WEAK_SETTLE_US = 2500;
+static const uint32_t WEAK_ACTIVATION_US = 14000;
+static const uint32_t WEAK_JITTER_US = 8000;
+
+struct CycleStats {
+    uint32_t cycles;
+    unsigned long meanMs;
+    unsigned long maxMs;
+    uint32_t events;        // Добавления/удаления/замены карт за замер
+};
+
+static bool isWeakCell(int cellIndex) {
+    return cellIndex % MATRIX_COLS == 2 || cellIndex / MATRIX_COLS == 2;
+}
+
+static void configureWeakCells(BoardModel& board, uint32_t settleUs) {
+    for (int i = 0; i < MATRIX_TOTAL_CELLS; i++) {
+        if (isWeakCell(i)) {
+            board.setCellRf(i, settleUs, WEAK_ACTIVATION_US, WEAK_JITTER_US);
+        }
+    }
+}
+
+static uint32_t totalEvents() {
+    return scanMatrix.getCardsDetected() + scanMatrix.getCardsRemoved() + scanMatrix.getCardChanges();
+}
+
+// Ждет начала прохода, затем замеряет cycles полных проходов
+static CycleStats measureCycles(uint32_t cycles) {
+    CycleStats stats;
+    memset(&stats, 0, sizeof(stats));
+
+    unsigned long cycleStart = scanMatrix.getCycleStartTime();
+    while (scanMatrix.getCycleStartTime() == cycleStart) {
+        loop();
+    }
+
+    uint32_t eventsBefore = totalEvents();
+    unsigned long totalMs = 0;
+
+    while (stats.cycles < cycles) {
+        cycleStart = scanMatrix.getCycleStartTime();
+        while (scanMatrix.getCycleStartTime() == cycleStart) {
+            loop();
+        }
+        unsigned long ms = scanMatrix.getLastCycleTime();
+        totalMs += ms;
+        if (ms > stats.maxMs) stats.maxMs = ms;
+        stats.cycles++;
+    }
+
+    stats.meanMs = totalMs / stats.cycles;
+    stats.events = totalEvents() - eventsBefore;
+    return stats;
+}
+
+static bool cacheMatchesBoard(BenchEnvironment& env) {
+    for (int i = 0; i < MATRIX_TOTAL_CELLS; i++) {
+        const CardInfo& info = scanMatrix.getCardInfo(i);
+        const EmulatedTag& tag = env.board.tagAt(i);
+        if (info.present != tag.present) return false;
+        if (info.present && (info.uidLength != tag.uidLength ||
+                             memcmp(info.uid, tag.uid, tag.uidLength) != 0)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void printCycles(const char* name, const CycleStats& s) {
+    printf("\"%s\":{\"cycles\":%u,\"mean_cycle_ms\":%lu,\"max_cycle_ms\":%lu,\"events\":%u},",
+           name, (unsigned)s.cycles, s.meanMs, s.maxMs, (unsigned)s.events);
+}
+
+int runCalibrationBench(int argc, char** argv) {
+    unsigned long learnMs = (argc > 0) ? (unsigned long)atol(argv[0]) * 1000UL : 1200000UL;
+    uint32_t weakSettleUs = (argc > 1) ? (uint32_t)atol(argv[1]) : WEAK_SETTLE_US;
+
+    BenchEnvironment env;
+    env.attach();
+    hostsim::eraseFlash();
+    configureWeakCells(env.board, weakSettleUs);
+    placeReferenceTags(env.board);
+
+    setup();
+    scanMatrix.getFieldGate().setMode(RF_GATING_AUTO);
+
+    // До обучения: все ячейки на консервативном профиле (первый проход - обнаружение)
+    measureCycles(1);
+    CycleStats before = measureCycles(3);
+
+    // Обучение: метки переставляют по доске, каждая ячейка успевает побыть занятой
+    for (unsigned long t = 0; t < learnMs; t += 3000) {
+        int from;
+        do {
+            from = (int)env.randomRange(0, MATRIX_TOTAL_CELLS - 1);
+        } while (!env.board.hasTag(from));
+        int to;
+        do {
+            to = (int)env.randomRange(0, MATRIX_TOTAL_CELLS - 1);
+        } while (env.board.hasTag(to));
+        env.board.moveTag(from, to);
+        env.runFor(3000);
+    }
+
+    // Обратно в эталонную расстановку, один проход на обновление кэша
+    env.board.clear();
+    placeReferenceTags(env.board);
+    measureCycles(1);
+
+    CellCalibrator& calibrator = scanMatrix.getCalibrator();
+    CycleStats after = measureCycles(3);
+    bool matchesAfter = cacheMatchesBoard(env);
+    int calibrated = calibrator.getCalibratedCount();
+    unsigned long meanTimeoutMs = calibrator.getMeanTimeoutMs();
+
+    // Средние профили слабых и обычных ячеек
+    unsigned long timeoutSum[2] = {0, 0}, settleSum[2] = {0, 0};
+    int counted[2] = {0, 0};
+    int settleLearned = 0;
+    for (int i = 0; i < MATRIX_TOTAL_CELLS; i++) {
+        const CellTimingProfile& p = calibrator.getProfile(i);
+        if (!p.calibrated) continue;
+        int k = isWeakCell(i) ? 1 : 0;
+        timeoutSum[k] += p.timeoutMs;
+        settleSum[k] += p.settleUs;
+        counted[k]++;
+        if (p.settleUs < CALIBRATION_MAX_SETTLE_US) {
+            settleLearned++;
+        }
+    }
+
+    calibrator.save();
+    uint32_t misses = calibrator.getTotalMisses();
+    uint32_t crosstalk = calibrator.getTotalCrosstalk();
+    uint32_t confirmReads = scanMatrix.getConfirmReads();
+
+    // Перезагрузка: профили из NVS применяются с первого прохода
+    rebootFirmware(env);
+    setup();
+    int loaded = scanMatrix.getCalibrator().getCalibratedCount();
+    CycleStats rebooted = measureCycles(2);
+    bool matchesRebooted = cacheMatchesBoard(env);
+
+    printf("{\"bench\":\"calibration\",\"learn_s\":%lu,\"weak_settle_us\":%u,",
+           learnMs / 1000, (unsigned)weakSettleUs);
+    printCycles("before", before);
+    printCycles("after", after);
+    printCycles("after_reboot", rebooted);
+    printf("\"calibrated_cells\":%d,\"loaded_after_reboot\":%d,\"mean_timeout_ms\":%lu,",
+           calibrated, loaded, meanTimeoutMs);
+    const char* kinds[2] = {"normal", "weak"};
+    for (int k = 0; k < 2; k++) {
+        printf("\"%s\":{\"cells\":%d,\"timeout_ms\":%lu,\"settle_us\":%lu},", kinds[k], counted[k],
+               counted[k] ? timeoutSum[k] / counted[k] : 0, counted[k] ? settleSum[k] / counted[k] : 0);
+    }
+    printf("\"settle_below_max_cells\":%d,\"misses\":%u,\"crosstalk\":%u,\"confirm_reads\":%u,"
+           "\"matches_board\":%s,\"matches_board_after_reboot\":%s}\n",
+           settleLearned, (unsigned)misses, (unsigned)crosstalk, (unsigned)confirmReads,
+           matchesAfter ? "true" : "false", matchesRebooted ? "true" : "false");
+    return settleLearned > 0 ? 0 : 1;
+}
@@ -0,0 +1,244 @@
+#include "benchmarks.h"
+#include "scan_matrix.h"
+#include "serial_console.h"
+#include "crc32.h"
+#include <chrono>
+#include <string>
+#include <vector>
+
+// =============================================
+// БЕНЧМАРК КОНСОЛИ SERIAL
+// Прошивка на эмуляторе получает команды через поток-заглушку вместо UART.
+// Проверяем бюджет (байт ввода и команд за loop()), влияние потока запросов
+// на время прохода, ответы кадрами 'A' на кадры 'C' (и отброс кадра с
+// плохой CRC), изменение задержки на ходу и ее сохранение в NVS через
+// перезагрузку. Цена команды на CPU - реальное время хоста
+// =============================================
+
+extern ScanMatrix scanMatrix;
+extern SerialConsole serialConsole;
+
+static const int CPU_TIMING_RUNS = 2000;
+
+// Запросы оператора: только чтение, настройки не меняются
+static const char* const QUERY_SCRIPT[] = {
+    "status", "board", "cell 14", "cells", "get", "metrics", "get delay", "cell 2 5", "metrics snap",
+};
+static const int QUERY_COUNT = sizeof(QUERY_SCRIPT) / sizeof(QUERY_SCRIPT[0]);
+
+// UART консоли: ввод из бенчмарка, вывод копится для разбора
+class ConsolePipe : public Stream {
+public:
+    std::string input;
+    size_t inputPos;
+    std::vector<uint8_t> output;
+    int readsThisLoop;
+
+    ConsolePipe() : inputPos(0), readsThisLoop(0) {}
+
+    int available() override { return (int)(input.size() - inputPos); }
+    int read() override {
+        if (inputPos >= input.size()) return -1;
+        readsThisLoop++;
+        return (uint8_t)input[inputPos++];
+    }
+    int peek() override { return inputPos < input.size() ? (uint8_t)input[inputPos] : -1; }
+    size_t write(uint8_t c) override {
+        output.push_back(c);
+        return 1;
+    }
+    size_t write(const uint8_t* buffer, size_t size) override {
+        output.insert(output.end(), buffer, buffer + size);
+        return size;
+    }
+    using Print::write;
+
+    void send(const std::string& bytes) { input += bytes; }
+};
+
+struct ConsoleReply {
+    uint8_t id;
+    uint8_t flags;
+    std::string text;
+};
+
+// Бюджет консоли за проход loop()
+struct LoopBudget {
+    int maxBytesPerLoop;
+    uint32_t maxCommandsPerLoop;
+};
+
+static std::string commandFrame(uint8_t id, const char* text, bool corrupt = false) {
+    std::string frame;
+    size_t payload = 1 + strlen(text);
+    frame += (char)0xA5;
+    frame += (char)0x5A;
+    frame += (char)CONSOLE_FRAME_COMMAND;
+    frame += (char)(payload & 0xFF);
+    frame += (char)(payload >> 8);
+    frame += (char)id;
+    frame += text;
+    uint32_t crc = ~crc32Update(0xFFFFFFFF, (const uint8_t*)frame.data() + 2, 3 + payload);
+    if (corrupt) crc ^= 1;
+    for (int i = 0; i < 4; i++) {
+        frame += (char)((crc >> (8 * i)) & 0xFF);
+    }
+    return frame;
+}
+
+// Кадры 'A' из вывода; части одного ответа склеиваются до флага LAST
+static std::vector<ConsoleReply> parseReplies(const std::vector<uint8_t>& out, uint32_t& badFrames) {
+    std::vector<ConsoleReply> replies;
+    std::string partial;
+    size_t i = 0;
+    while (i + 9 <= out.size()) {
+        if (out[i] != 0xA5 || out[i + 1] != 0x5A || out[i + 2] != CONSOLE_FRAME_REPLY) {
+            i++;
+            continue;
+        }
+        size_t payload = out[i + 3] | (out[i + 4] << 8);
+        if (payload < 2 || i + 9 + payload > out.size()) {
+            i++;
+            continue;
+        }
+        uint32_t crc = ~crc32Update(0xFFFFFFFF, &out[i + 2], 3 + payload);
+        const uint8_t* tail = &out[i + 5 + payload];
+        if (crc != ((uint32_t)tail[0] | ((uint32_t)tail[1] << 8) | ((uint32_t)tail[2] << 16) | ((uint32_t)tail[3] << 24))) {
+            badFrames++;
+            i++;
+            continue;
+        }
+        partial.append((const char*)&out[i + 7], payload - 2);
+        if (out[i + 6] & CONSOLE_REPLY_LAST) {
+            ConsoleReply reply;
+            reply.id = out[i + 5];
+            reply.flags = out[i + 6];
+            reply.text = partial;
+            replies.push_back(reply);
+            partial.clear();
+        }
+        i += 9 + payload;
+    }
+    return replies;
+}
+
+static void stepLoop(ConsolePipe& pipe, LoopBudget& budget) {
+    pipe.readsThisLoop = 0;
+    uint32_t commandsBefore = serialConsole.getCommandCount();
+    loop();
+    budget.maxBytesPerLoop = max(budget.maxBytesPerLoop, pipe.readsThisLoop);
+    budget.maxCommandsPerLoop = max(budget.maxCommandsPerLoop, serialConsole.getCommandCount() - commandsBefore);
+}
+
+// Средний проход за cycles полных проходов; с periodMs > 0 - запрос из сценария
+// каждые periodMs виртуального времени
+static unsigned long measureCycles(ConsolePipe& pipe, LoopBudget& budget, uint32_t cycles,
+                                   unsigned long periodMs, uint32_t& sent) {
+    unsigned long cycleStart = scanMatrix.getCycleStartTime();
+    while (scanMatrix.getCycleStartTime() == cycleStart) {
+        stepLoop(pipe, budget);
+    }
+    uint64_t nextCommand = hostsim::nowMicros();
+    unsigned long totalMs = 0;
+    for (uint32_t c = 0; c < cycles; c++) {
+        cycleStart = scanMatrix.getCycleStartTime();
+        while (scanMatrix.getCycleStartTime() == cycleStart) {
+            if (periodMs > 0 && hostsim::nowMicros() >= nextCommand) {
+                pipe.send(std::string(QUERY_SCRIPT[sent++ % QUERY_COUNT]) + "\r\n");
+                nextCommand += (uint64_t)periodMs * 1000ULL;
+            }
+            stepLoop(pipe, budget);
+        }
+        totalMs += scanMatrix.getLastCycleTime();
+    }
+    return totalMs / cycles;
+}
+
+static void runUntilIdle(ConsolePipe& pipe, LoopBudget& budget) {
+    while (pipe.available() > 0 || serialConsole.isReportPending()) {
+        stepLoop(pipe, budget);
+    }
+    stepLoop(pipe, budget);
+}
+
+int runConsoleBench(int argc, char** argv) {
+    uint32_t cycles = (argc > 0) ? (uint32_t)atol(argv[0]) : 5;
+    unsigned long periodMs = (argc > 1) ? (unsigned long)atol(argv[1]) : 200UL;
+
+    BenchEnvironment env;
+    env.attach();
+    placeReferenceTags(env.board);
+    rebootFirmware(env);
+    hostsim::eraseFlash();
+
+    ConsolePipe pipe;
+    serialConsole.setPort(&pipe);
+    setup();
+
+    LoopBudget budget = {0, 0};
+    uint32_t sent = 0;
+
+    // Проход без консоли и под потоком запросов
+    measureCycles(pipe, budget, 1, 0, sent);
+    unsigned long idleCycleMs = measureCycles(pipe, budget, cycles, 0, sent);
+    uint32_t commandsBefore = serialConsole.getCommandCount();
+    unsigned long queriedCycleMs = measureCycles(pipe, budget, cycles, periodMs, sent);
+    runUntilIdle(pipe, budget);
+    uint32_t queriesExecuted = serialConsole.getCommandCount() - commandsBefore;
+
+    // Кадры: запрос, длинная таблица частями, кадр с плохой CRC без ответа
+    pipe.output.clear();
+    uint32_t badBefore = serialConsole.getBadFrames();
+    pipe.send(commandFrame(7, "get delay"));
+    pipe.send(commandFrame(8, "cells"));
+    pipe.send(commandFrame(9, "get timeout", true));
+    pipe.send(commandFrame(10, "set nothing 1"));
+    runUntilIdle(pipe, budget);
+    uint32_t replyBadFrames = 0;
+    std::vector<ConsoleReply> replies = parseReplies(pipe.output, replyBadFrames);
+    bool framesOk = replies.size() == 3 && replyBadFrames == 0 &&
+                    replies[0].id == 7 && replies[0].text.find("delay=20") == 0 &&
+                    replies[1].id == 8 && replies[1].text.size() > CONSOLE_REPLY_CHUNK_BYTES &&
+                    replies[2].id == 10 && (replies[2].flags & CONSOLE_REPLY_ERROR) &&
+                    serialConsole.getBadFrames() == badBefore + 1;
+
+    // Задержка на ходу и через перезагрузку (NVS сохраняется)
+    pipe.send("set delay 0\r\nsave\r\n");
+    runUntilIdle(pipe, budget);
+    unsigned long tunedCycleMs = measureCycles(pipe, budget, cycles, 0, sent);
+
+    rebootFirmware(env);
+    serialConsole.setPort(&pipe);
+    setup();
+    bool persisted = scanMatrix.getScanDelay() == 0;
+    measureCycles(pipe, budget, 1, 0, sent);
+    unsigned long rebootedCycleMs = measureCycles(pipe, budget, cycles, 0, sent);
+    pipe.send("defaults\r\nsave\r\n");
+    runUntilIdle(pipe, budget);
+    bool restored = scanMatrix.getScanDelay() == SCAN_DELAY_MS;
+
+    printf("{\"bench\":\"console\",\"cycles\":%u,\"query_period_ms\":%lu,\"idle_cycle_ms\":%lu,"
+           "\"queried_cycle_ms\":%lu,\"queries_sent\":%u,\"queries_executed\":%u,"
+           "\"max_bytes_per_loop\":%d,\"max_commands_per_loop\":%u,\"frames_ok\":%s,"
+           "\"tuned_delay0_cycle_ms\":%lu,\"rebooted_cycle_ms\":%lu,\"persisted\":%s,\"restored\":%s,\"ns_per_command\":{",
+           (unsigned)cycles, periodMs, idleCycleMs, queriedCycleMs, (unsigned)sent, (unsigned)queriesExecuted,
+           budget.maxBytesPerLoop, (unsigned)budget.maxCommandsPerLoop, framesOk ? "true" : "false",
+           tunedCycleMs, rebootedCycleMs, persisted ? "true" : "false", restored ? "true" : "false");
+    // Цена команд на CPU хоста (таблица - до последнего ряда)
+    for (int q = 0; q < QUERY_COUNT; q++) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < CPU_TIMING_RUNS; i++) {
+            serialConsole.execute(QUERY_SCRIPT[q]);
+            while (serialConsole.isReportPending()) {
+                serialConsole.poll();
+            }
+        }
+        double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - start).count() / CPU_TIMING_RUNS;
+        pipe.output.clear();
+        printf("%s\"%s\":%.0f", q ? "," : "", QUERY_SCRIPT[q], ns);
+    }
+    printf("}}\n");
+    serialConsole.setPort(&Serial);
+    return (framesOk && persisted && restored) ? 0 : 1;
+}
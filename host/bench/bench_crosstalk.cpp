@@ -0,0 +1,152 @@
+#include "benchmarks.h"
+#include "scan_matrix.h"
+
+// =============================================
+// БЕНЧМАРК ПЕРЕКРЕСТНЫХ ЧТЕНИЙ (модель связи антенн)
+// Каждая антенна слышит метки соседей в радиусе 2 шагов: слабая постоянная
+// связь плюс хвост прежней антенны после переключения мультиплексора при
+// включенном поле; сравнимые по силе ответы срывают антиколлизию. Столбец 2 и
+// [2,1]/[2,2] связаны сильнее (мерцание и перекрестные чтения из лога).
+// Доска неподвижна - любое событие после первого прохода ложное. Сравниваются
+// режимы MaxTg и выключение поля на переключение - по скорости и по ошибкам
+// =============================================
+
+extern ScanMatrix scanMatrix;
+
+// Столбец 2 (ряды 0-7) и [2,0]-[2,2]
+static const int STRONG_CELLS[] = {2, 14, 26, 38, 50, 62, 74, 86, 24, 25};
+static const int STRONG_COUNT = sizeof(STRONG_CELLS) / sizeof(STRONG_CELLS[0]);
+
+// Плотная группа в столбце 2 дополнительно к эталонной расстановке
+static const int EXTRA_TAG_CELLS[] = {38, 50, 62, 51};
+static const int EXTRA_TAG_COUNT = sizeof(EXTRA_TAG_CELLS) / sizeof(EXTRA_TAG_CELLS[0]);
+
+static const uint32_t TRANSIENT_HALF_LIFE_US = 2500;
+static const uint8_t COLLISION_PERCENT = 40;
+
+struct CrosstalkResult {
+    uint32_t cycles;
+    unsigned long meanCycleMs;
+    uint32_t learnEvents;       // Ложные события за обучение (после первого прохода)
+    uint32_t events;            // ...за замер
+    uint32_t flicker;
+    uint32_t crosstalkResponses;
+    uint32_t collisionFailures;
+    uint32_t calibrationCrosstalk;
+    bool matchesBoard;
+};
+
+static uint32_t totalEvents() {
+    return scanMatrix.getCardsDetected() + scanMatrix.getCardsRemoved() + scanMatrix.getCardChanges();
+}
+
+static void waitCycleStart() {
+    unsigned long cycleStart = scanMatrix.getCycleStartTime();
+    while (scanMatrix.getCycleStartTime() == cycleStart) {
+        loop();
+    }
+}
+
+static bool cacheMatchesBoard(BenchEnvironment& env) {
+    for (int i = 0; i < MATRIX_TOTAL_CELLS; i++) {
+        const CardInfo& info = scanMatrix.getCardInfo(i);
+        const EmulatedTag& tag = env.board.tagAt(i);
+        if (info.present != tag.present) return false;
+        if (info.present && (info.uidLength != tag.uidLength || memcmp(info.uid, tag.uid, tag.uidLength) != 0)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static CrosstalkResult runMode(BenchEnvironment& env, MultiTargetMode multiTarget, RfGatingMode gating,
+                               unsigned long learnMs, uint32_t cycles) {
+    CrosstalkResult r;
+    memset(&r, 0, sizeof(r));
+
+    rebootFirmware(env);
+    hostsim::eraseFlash();
+    setup();
+    scanMatrix.setMultiTargetMode(multiTarget);
+    scanMatrix.getFieldGate().setMode(gating);
+
+    // Первый проход наполняет кэш, дальше доска не меняется
+    waitCycleStart();
+    waitCycleStart();
+    uint32_t eventsBefore = totalEvents();
+    env.runFor(learnMs);
+    waitCycleStart();
+    r.learnEvents = totalEvents() - eventsBefore;
+
+    CellCalibrator& calibrator = scanMatrix.getCalibrator();
+    eventsBefore = totalEvents();
+    uint32_t flickerBefore = scanMatrix.getFlickerEvents();
+    uint32_t responsesBefore = env.board.getCrosstalkResponses();
+    uint32_t collisionsBefore = env.board.getCollisionFailures();
+    uint32_t calibrationBefore = calibrator.getTotalCrosstalk();
+    unsigned long totalMs = 0;
+
+    while (r.cycles < cycles) {
+        waitCycleStart();
+        totalMs += scanMatrix.getLastCycleTime();
+        r.cycles++;
+    }
+
+    r.meanCycleMs = totalMs / r.cycles;
+    r.events = totalEvents() - eventsBefore;
+    r.flicker = scanMatrix.getFlickerEvents() - flickerBefore;
+    r.crosstalkResponses = env.board.getCrosstalkResponses() - responsesBefore;
+    r.collisionFailures = env.board.getCollisionFailures() - collisionsBefore;
+    r.calibrationCrosstalk = calibrator.getTotalCrosstalk() - calibrationBefore;
+    r.matchesBoard = cacheMatchesBoard(env);
+    return r;
+}
+
+int runCrosstalkBench(int argc, char** argv) {
+    uint32_t cycles = (argc > 0) ? (uint32_t)atol(argv[0]) : 20;
+    unsigned long learnMs = (argc > 1) ? (unsigned long)atol(argv[1]) * 1000UL : 300000UL;
+    uint8_t steadyPercent = (argc > 2) ? (uint8_t)atoi(argv[2]) : 2;
+    uint8_t transientPercent = (argc > 3) ? (uint8_t)atoi(argv[3]) : 60;
+    if (cycles == 0) cycles = 1;
+
+    BenchEnvironment env;
+    env.attach();
+    placeReferenceTags(env.board);
+    for (int i = 0; i < EXTRA_TAG_COUNT; i++) {
+        uint8_t uid[7] = {0x04, 0x7C, (uint8_t)EXTRA_TAG_CELLS[i], 0x52, 0x1A, 0x6B, 0x80};
+        env.board.placeTag(EXTRA_TAG_CELLS[i], uid, 7);
+    }
+
+    CellCouplingModel weak = {steadyPercent, transientPercent, TRANSIENT_HALF_LIFE_US, COLLISION_PERCENT};
+    CellCouplingModel strong = {(uint8_t)min(steadyPercent * 4, 100), (uint8_t)min(transientPercent * 3 / 2, 100),
+                                TRANSIENT_HALF_LIFE_US * 2, COLLISION_PERCENT};
+    env.board.setCoupling(weak);
+    for (int i = 0; i < STRONG_COUNT; i++) {
+        env.board.setCellCoupling(STRONG_CELLS[i], strong);
+    }
+
+    const MultiTargetMode multiTargetModes[] = {MULTI_TARGET_OFF, MULTI_TARGET_ADAPTIVE, MULTI_TARGET_ALWAYS};
+    const char* multiTargetNames[] = {"maxtg1", "adaptive", "maxtg2"};
+    const RfGatingMode gatingModes[] = {RF_GATING_OFF, RF_GATING_ALWAYS, RF_GATING_AUTO};
+    const char* gatingNames[] = {"settle", "gated", "gate_auto"};
+
+    printf("{\"bench\":\"crosstalk\",\"cycles\":%u,\"learn_s\":%lu,\"coupling\":{\"steady_pct\":%u,"
+           "\"transient_pct\":%u,\"half_life_us\":%u,\"collision_pct\":%u},\"tags\":%d,\"modes\":[",
+           (unsigned)cycles, learnMs / 1000, (unsigned)steadyPercent, (unsigned)transientPercent,
+           (unsigned)TRANSIENT_HALF_LIFE_US, (unsigned)COLLISION_PERCENT, 6 + EXTRA_TAG_COUNT);
+    for (int m = 0; m < 3; m++) {
+        for (int g = 0; g < 3; g++) {
+            CrosstalkResult r = runMode(env, multiTargetModes[m], gatingModes[g], learnMs, cycles);
+            double minutes = (double)r.meanCycleMs * r.cycles / 60000.0;
+            printf("%s{\"multi_target\":\"%s\",\"switch\":\"%s\",\"mean_cycle_ms\":%lu,\"learn_events\":%u,"
+                   "\"false_events\":%u,\"false_per_min\":%.2f,\"flicker\":%u,\"neighbour_responses\":%u,"
+                   "\"collision_failures\":%u,\"calibration_crosstalk\":%u,\"matches_board\":%s}",
+                   (m || g) ? "," : "", multiTargetNames[m], gatingNames[g], r.meanCycleMs,
+                   (unsigned)r.learnEvents, (unsigned)r.events, minutes > 0 ? r.events / minutes : 0.0,
+                   (unsigned)r.flicker, (unsigned)r.crosstalkResponses, (unsigned)r.collisionFailures,
+                   (unsigned)r.calibrationCrosstalk, r.matchesBoard ? "true" : "false");
+        }
+    }
+    printf("]}\n");
+    return 0;
+}
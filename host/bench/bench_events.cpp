@@ -0,0 +1,177 @@
+#include "benchmarks.h"
+#include "scan_matrix.h"
+#include <vector>
+#include <algorithm>
+
+// =============================================
+// БЕНЧМАРК ПРЕДВАРИТЕЛЬНЫХ СОБЫТИЙ КАРТ
+// Снятие фигуры с откалиброванной ячейки: первое пустое чтение дает
+// предварительное событие, повторы по профилю и контрольное чтение - подтверждение.
+// Слабые антенны [1,0] и [2,0] (профили RF выключены) иногда пропускают метку -
+// это предварительные события, которые фильтр отзывает. Исправная доска против
+// доски со слабыми антеннами; время - от снятия/установки метки
+// =============================================
+
+extern ScanMatrix scanMatrix;
+
+static const int LIFT_CELLS[] = {2, 12, 14, 24, 25, 26};
+static const int LIFT_CELL_COUNT = 6;
+static const int WEAK_CELLS[] = {12, 24};
+static const unsigned long TRIAL_LIMIT_MS = 30000;
+
+struct EventProbe {
+    int cellIndex;
+    CardEventKind kind;
+    uint64_t provisionalUs;     // 0 = еще не было
+    uint64_t confirmedUs;
+    uint32_t provisionalId;
+    bool idMatched;             // Подтверждение пришло с id предварительного
+};
+
+static EventProbe probe;
+
+static void onCardEvent(const CardEvent& event, void* context) {
+    EventProbe* p = (EventProbe*)context;
+    if (event.cellIndex != p->cellIndex || event.kind != p->kind) {
+        return;
+    }
+    if (event.tier == CARD_EVENT_PROVISIONAL && p->provisionalUs == 0) {
+        p->provisionalUs = hostsim::nowMicros();
+        p->provisionalId = event.id;
+    } else if (event.tier == CARD_EVENT_CONFIRMED && p->confirmedUs == 0) {
+        p->confirmedUs = hostsim::nowMicros();
+        p->idMatched = (event.id == p->provisionalId);
+    }
+}
+
+static double percentileMs(std::vector<uint64_t> values, double pct) {
+    if (values.empty()) return 0.0;
+    std::sort(values.begin(), values.end());
+    size_t index = (size_t)(pct / 100.0 * (values.size() - 1) + 0.5);
+    return values[index] / 1000.0;
+}
+
+static void printLatency(const char* name, const std::vector<uint64_t>& values, bool comma) {
+    printf("%s\"%s\":{\"p50_ms\":%.1f,\"p95_ms\":%.1f,\"p99_ms\":%.1f}", comma ? "," : "", name,
+           percentileMs(values, 50), percentileMs(values, 95), percentileMs(values, 99));
+}
+
+// Крутит loop(), пока проба не получит подтверждение или не истечет лимит
+static bool waitConfirmed() {
+    unsigned long start = millis();
+    while (probe.confirmedUs == 0 && millis() - start < TRIAL_LIMIT_MS) {
+        loop();
+    }
+    return probe.confirmedUs != 0;
+}
+
+struct EventsModeResult {
+    std::vector<uint64_t> toProvisional;
+    std::vector<uint64_t> toConfirmed;
+    std::vector<uint64_t> provisionalToConfirm;
+    std::vector<uint64_t> arrivals;
+    int noProvisional;
+    int lost;
+    int idMismatch;
+    unsigned long runMs;
+};
+
+static void runMode(BenchEnvironment& env, bool weak, int trials, unsigned long learnMs, EventsModeResult& r) {
+    r.noProvisional = 0;
+    r.lost = 0;
+    r.idMismatch = 0;
+
+    for (int i = 0; i < 2; i++) {
+        if (weak) {
+            env.board.setCellAnalog(WEAK_CELLS[i], 7, 7, 0x08);
+        } else {
+            env.board.setCellAnalog(WEAK_CELLS[i], 0, 6, 0x3F);
+        }
+    }
+
+    rebootFirmware(env);
+    hostsim::eraseFlash();
+    setup();
+    scanMatrix.getCalibrator().setRfProfilesEnabled(false);
+    CardEventTracker& events = scanMatrix.getCardEvents();
+    events.setCallback(onCardEvent, &probe);
+
+    // Обучение: профили ячеек, без них фильтра пропусков нет
+    env.runFor(learnMs);
+    events.resetStatistics();
+    unsigned long runStart = millis();
+
+    for (int t = 0; t < trials; t++) {
+        int cell = LIFT_CELLS[t % LIFT_CELL_COUNT];
+        EmulatedTag tag = env.board.tagAt(cell);
+
+        // Снятие в случайный момент прохода
+        env.runFor(env.randomRange(0, 10000));
+        memset(&probe, 0, sizeof(probe));
+        probe.cellIndex = cell;
+        probe.kind = CARD_EVENT_REMOVED;
+        uint64_t liftUs = hostsim::nowMicros();
+        env.board.removeTag(cell);
+
+        if (!waitConfirmed()) {
+            r.lost++;
+        } else if (probe.provisionalUs == 0) {
+            r.noProvisional++;
+            r.toConfirmed.push_back(probe.confirmedUs - liftUs);
+        } else {
+            r.toProvisional.push_back(probe.provisionalUs - liftUs);
+            r.toConfirmed.push_back(probe.confirmedUs - liftUs);
+            r.provisionalToConfirm.push_back(probe.confirmedUs - probe.provisionalUs);
+            if (!probe.idMatched) r.idMismatch++;
+        }
+
+        // Фигуру ставят обратно: появление подтверждается без фильтра
+        memset(&probe, 0, sizeof(probe));
+        probe.cellIndex = cell;
+        probe.kind = CARD_EVENT_ADDED;
+        uint64_t placeUs = hostsim::nowMicros();
+        env.board.placeTag(cell, tag.uid, tag.uidLength);
+        if (waitConfirmed()) {
+            r.arrivals.push_back(probe.confirmedUs - placeUs);
+        } else {
+            r.lost++;
+        }
+    }
+
+    r.runMs = millis() - runStart;
+    events.setCallback(nullptr, nullptr);
+}
+
+int runEventsBench(int argc, char** argv) {
+    int trials = (argc > 0) ? atoi(argv[0]) : 60;
+    unsigned long learnMs = (argc > 1) ? (unsigned long)atol(argv[1]) * 1000UL : 600000UL;
+
+    BenchEnvironment env;
+    env.attach();
+    placeReferenceTags(env.board);
+
+    const char* names[] = {"healthy", "weak_antennas"};
+
+    printf("{\"bench\":\"events\",\"trials\":%d,\"learn_s\":%lu,\"modes\":[", trials, learnMs / 1000);
+    for (int m = 0; m < 2; m++) {
+        EventsModeResult r;
+        runMode(env, m == 1, trials, learnMs, r);
+        const CardEventTracker& events = scanMatrix.getCardEvents();
+
+        printf("%s{\"mode\":\"%s\",\"lift\":{", m ? "," : "", names[m]);
+        printLatency("to_provisional", r.toProvisional, false);
+        printLatency("to_confirmed", r.toConfirmed, true);
+        printLatency("provisional_to_confirm", r.provisionalToConfirm, true);
+        printf(",\"without_provisional\":%d,\"id_mismatch\":%d},\"place\":{", r.noProvisional, r.idMismatch);
+        printLatency("to_confirmed", r.arrivals, false);
+        printf("},\"lost\":%d,\"provisional\":%u,\"confirmed\":%u,\"retracted\":%u,\"direct\":%u,"
+               "\"retraction_pct\":%.1f,\"retractions_per_min\":%.2f,\"mean_confirm_us\":%lu,"
+               "\"mean_retract_us\":%lu}",
+               r.lost, (unsigned)events.getProvisionalCount(), (unsigned)events.getConfirmedCount(),
+               (unsigned)events.getRetractedCount(), (unsigned)events.getDirectCount(),
+               events.getRetractionRate(), r.runMs ? events.getRetractedCount() * 60000.0 / r.runMs : 0.0,
+               events.getMeanConfirmUs(), events.getMeanRetractUs());
+    }
+    printf("]}\n");
+    return 0;
+}
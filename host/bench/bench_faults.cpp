@@ -0,0 +1,376 @@
+#include "benchmarks.h"
+#include "rfid_manager.h"
+#include "scan_matrix.h"
+#include "state_manager.h"
+#include "i2c_fault_injector.h"
+#include <vector>
+#include <algorithm>
+
+// =============================================
+// БЕНЧМАРК СБОЕВ ШИНЫ И PN532 (I2CFaultInjector)
+// Для каждого класса сбоя:
+//   - время восстановления: одиночный сбой в случайный момент, от сбоя до
+//     первого чистого кадра ответа при STATE_SCANNING и живой связи;
+//   - устойчивая нагрузка: сбой в среднем раз в интервал, метки снимаются и
+//     переставляются рукой; потеря скорости сканирования (ячеек прохода в секунду
+//     против прогона без сбоев), потерянные и фантомные события карт.
+// Смешанный прогон - вероятностный режим: NACK, короткие чтения, пропуски ACK и
+// искажения кадров на заданную долю транзакций одновременно.
+// Сброс по watchdog: прошивка стоит WATCHDOG_TIMEOUT_MS, затем перезагрузка
+// с сохраненной NVS (как после сброса ESP32).
+// Фантомное событие при любом сбое - ошибка бенчмарка: искаженный кадр драйвер
+// отбрасывает по LCS/DCS и заголовку, RFIDManager повторяет транзакцию
+// =============================================
+
+extern StateManager stateManager;
+extern RFIDManager rfidManager;
+extern ScanMatrix scanMatrix;
+extern I2CFaultInjector i2cFaultInjector;
+
+static const unsigned long WARMUP_MS = 20000;
+static const unsigned long RECOVERY_DEADLINE_MS = 30000;
+static const unsigned long WATCHDOG_TIMEOUT_MS = 5000;     // Task WDT ESP-IDF по умолчанию
+static const unsigned long DRAIN_MS = 30000;
+
+// Ячейки, на которых рука снимает и ставит метки (ряды 3-4)
+static const int HAND_CELL_FIRST = 36;
+static const int HAND_CELL_COUNT = 24;
+static const unsigned long HAND_CELL_IDLE_MS = 45000;
+
+struct FaultCellOp {
+    bool present;
+    uint8_t uid[7];
+};
+
+struct FaultProbe {
+    BenchEnvironment* env;
+    bool watchdogPending;
+    uint64_t watchdogMicros;
+    uint32_t reboots;
+
+    std::vector<FaultCellOp> ops[MATRIX_TOTAL_CELLS];
+    size_t cursor[MATRIX_TOTAL_CELLS];
+    uint64_t lastOpUs[MATRIX_TOTAL_CELLS];
+    uint32_t phantom;
+    uint32_t repeated;
+
+    // Продвижение прохода: ячейка с ошибкой чтения остается текущей
+    int lastCell;
+    uint32_t cellsScanned;
+
+    // Счетчик RFIDManager до перезагрузок (объект создается заново)
+    uint32_t bankedRecoveries;
+};
+
+static FaultProbe probe;
+
+static void onWatchdog(void* context) {
+    FaultProbe* p = (FaultProbe*)context;
+    p->watchdogPending = true;
+    p->watchdogMicros = hostsim::nowMicros();
+}
+
+static void onCardEvent(const CardEvent& event, void* context) {
+    FaultProbe* p = (FaultProbe*)context;
+    if (event.tier != CARD_EVENT_CONFIRMED) {
+        return;
+    }
+    int cell = event.cellIndex;
+    bool present = event.kind != CARD_EVENT_REMOVED;
+    std::vector<FaultCellOp>& ops = p->ops[cell];
+    for (size_t k = p->cursor[cell]; k < ops.size(); k++) {
+        if (ops[k].present == present && (!present || memcmp(ops[k].uid, event.uid, 7) == 0)) {
+            p->cursor[cell] = k + 1;
+            return;
+        }
+    }
+    // Повтор уже известного состояния (перезагрузка, восстановленный снимок) - не фантом
+    BoardModel& board = p->env->board;
+    bool matchesBoard = present ? (board.hasTag(cell) && memcmp(board.tagAt(cell).uid, event.uid, 7) == 0)
+                                : !board.hasTag(cell);
+    if (matchesBoard) {
+        p->repeated++;
+    } else {
+        p->phantom++;
+    }
+}
+
+static uint32_t recoveriesNow() {
+    return rfidManager.getRecoveryCount(RECOVERY_RETRY) + rfidManager.getRecoveryCount(RECOVERY_BUS_CLEAR) +
+           rfidManager.getRecoveryCount(RECOVERY_HARD_RESET);
+}
+
+static uint32_t totalRecoveries() {
+    return probe.bankedRecoveries + recoveriesNow();
+}
+
+// Один loop(); отложенный сброс по watchdog - после выхода из него
+static void step() {
+    loop();
+    if (scanMatrix.getCurrentCellIndex() != probe.lastCell) {
+        probe.lastCell = scanMatrix.getCurrentCellIndex();
+        probe.cellsScanned++;
+    }
+    if (!probe.watchdogPending) {
+        return;
+    }
+    probe.watchdogPending = false;
+    hostsim::advanceMicros((uint64_t)WATCHDOG_TIMEOUT_MS * 1000ULL);
+    probe.bankedRecoveries += recoveriesNow();
+    rebootFirmware(*probe.env);
+    setup();
+    scanMatrix.getCardEvents().setCallback(onCardEvent, &probe);
+    probe.reboots++;
+}
+
+static void runSteps(unsigned long durationMs) {
+    uint64_t end = hostsim::nowMicros() + (uint64_t)durationMs * 1000ULL;
+    while (hostsim::nowMicros() < end) {
+        step();
+    }
+}
+
+static void recordOp(int cell, bool present, const uint8_t* uid) {
+    FaultCellOp op;
+    op.present = present;
+    memset(op.uid, 0, sizeof(op.uid));
+    if (present) {
+        memcpy(op.uid, uid, 7);
+    }
+    probe.ops[cell].push_back(op);
+    probe.lastOpUs[cell] = hostsim::nowMicros();
+}
+
+// Ячейку не трогают чаще полного прохода - иначе снятие и установку между
+// двумя чтениями не увидит и прошивка без сбоев
+static bool isHandCellIdle(int cell) {
+    return hostsim::nowMicros() - probe.lastOpUs[cell] >= (uint64_t)HAND_CELL_IDLE_MS * 1000ULL;
+}
+
+// Рука переставляет метку на свободную ячейку: число меток, а с ним и
+// скорость прохода, остаются прежними
+static void handOp(BenchEnvironment& env) {
+    int from = -1, to = -1;
+    for (int attempt = 0; attempt < 32 && (from < 0 || to < 0); attempt++) {
+        int cell = HAND_CELL_FIRST + env.randomRange(0, HAND_CELL_COUNT - 1);
+        if (!isHandCellIdle(cell)) {
+            continue;
+        }
+        if (env.board.hasTag(cell) && from < 0) {
+            from = cell;
+        } else if (!env.board.hasTag(cell) && to < 0) {
+            to = cell;
+        }
+    }
+    if (from < 0 || to < 0) {
+        return;
+    }
+    EmulatedTag tag = env.board.tagAt(from);
+    env.board.removeTag(from);
+    recordOp(from, false, nullptr);
+    env.board.placeTag(to, tag.uid, tag.uidLength);
+    recordOp(to, true, tag.uid);
+}
+
+static bool isRecovered(uint32_t cleanAtFault) {
+    return i2cFaultInjector.getCleanFrames() > cleanAtFault && !i2cFaultInjector.isHung() &&
+           rfidManager.getConnected() && stateManager.getCurrentState() == STATE_SCANNING;
+}
+
+struct RecoveryResult {
+    uint32_t trials;
+    uint32_t fired;
+    uint32_t recovered;
+    std::vector<uint64_t> ttrUs;
+};
+
+// Одиночные сбои по расписанию
+static void measureRecovery(BenchEnvironment& env, I2CFaultClass faultClass, uint32_t trials, RecoveryResult& r) {
+    r.trials = trials;
+    r.fired = 0;
+    r.recovered = 0;
+    for (uint32_t t = 0; t < trials; t++) {
+        runSteps(env.randomRange(200, 3000));
+
+        uint32_t injectedBefore = i2cFaultInjector.getInjected(faultClass);
+        i2cFaultInjector.scheduleFault(faultClass, millis());
+        uint64_t deadline = hostsim::nowMicros() + (uint64_t)RECOVERY_DEADLINE_MS * 1000ULL;
+        uint32_t rebootsBefore = probe.reboots;
+        while (i2cFaultInjector.getInjected(faultClass) == injectedBefore && hostsim::nowMicros() < deadline) {
+            step();
+        }
+        if (i2cFaultInjector.getInjected(faultClass) == injectedBefore) {
+            i2cFaultInjector.clear();   // Подходящей транзакции не нашлось
+            continue;
+        }
+        r.fired++;
+
+        uint64_t faultAt = (probe.reboots != rebootsBefore)
+                               ? probe.watchdogMicros
+                               : hostsim::getPowerOnMicros() + i2cFaultInjector.getLastFaultMicros();
+        uint32_t cleanAtFault = i2cFaultInjector.getCleanFrames();
+        deadline = faultAt + (uint64_t)RECOVERY_DEADLINE_MS * 1000ULL;
+        while (hostsim::nowMicros() < deadline && !isRecovered(cleanAtFault)) {
+            step();
+        }
+        if (isRecovered(cleanAtFault)) {
+            uint64_t recoveredAt = hostsim::getPowerOnMicros() + i2cFaultInjector.getLastCleanFrameMicros();
+            r.recovered++;
+            r.ttrUs.push_back(recoveredAt > faultAt ? recoveredAt - faultAt : 0);
+        } else {
+            i2cFaultInjector.clear();
+            runSteps(RECOVERY_DEADLINE_MS);
+        }
+    }
+}
+
+struct LoadResult {
+    double cellsPerSec;
+    uint32_t injected;
+    uint32_t ops;
+    uint32_t lost;
+    uint32_t phantom;
+    uint32_t repeated;
+    uint32_t recoveries;
+    uint32_t reboots;
+};
+
+// Нагрузка рукой: scheduledClass (-1 - нет) вносится в среднем раз в intervalMs,
+// вероятности (setRate) задаются до вызова
+static void measureLoad(BenchEnvironment& env, int scheduledClass, unsigned long intervalMs, unsigned long durationMs,
+                        LoadResult& r) {
+    for (int cell = 0; cell < MATRIX_TOTAL_CELLS; cell++) {
+        probe.ops[cell].clear();
+        probe.cursor[cell] = 0;
+    }
+    probe.phantom = 0;
+    probe.repeated = 0;
+    uint32_t cellsBefore = probe.cellsScanned;
+    uint32_t recoveriesBefore = totalRecoveries();
+    uint32_t rebootsBefore = probe.reboots;
+    uint32_t injectedBefore = i2cFaultInjector.getTotalInjected();
+    uint64_t start = hostsim::nowMicros();
+    uint64_t end = start + (uint64_t)durationMs * 1000ULL;
+
+    uint64_t nextOp = start + (uint64_t)env.randomRange(2000, 6000) * 1000ULL;
+    uint64_t nextFault = start + (uint64_t)env.randomRange(intervalMs / 2, intervalMs * 3 / 2) * 1000ULL;
+    while (hostsim::nowMicros() < end) {
+        step();
+        uint64_t now = hostsim::nowMicros();
+        if (now >= nextOp) {
+            handOp(env);
+            nextOp = now + (uint64_t)env.randomRange(4000, 12000) * 1000ULL;
+        }
+        if (scheduledClass >= 0 && now >= nextFault) {
+            i2cFaultInjector.scheduleFault((I2CFaultClass)scheduledClass, millis());
+            nextFault = now + (uint64_t)env.randomRange(intervalMs / 2, intervalMs * 3 / 2) * 1000ULL;
+        }
+    }
+    uint64_t elapsedUs = hostsim::nowMicros() - start;
+    r.cellsPerSec = (probe.cellsScanned - cellsBefore) * 1e6 / elapsedUs;
+    r.injected = i2cFaultInjector.getTotalInjected() - injectedBefore;
+
+    // Без сбоев: прошивка дочитывает последние изменения
+    i2cFaultInjector.clear();
+    runSteps(DRAIN_MS);
+
+    r.ops = 0;
+    r.lost = 0;
+    for (int cell = 0; cell < MATRIX_TOTAL_CELLS; cell++) {
+        r.ops += probe.ops[cell].size();
+        r.lost += probe.ops[cell].size() - probe.cursor[cell];
+    }
+    r.phantom = probe.phantom;
+    r.repeated = probe.repeated;
+    r.recoveries = totalRecoveries() - recoveriesBefore;
+    r.reboots = probe.reboots - rebootsBefore;
+}
+
+static double percentileMs(std::vector<uint64_t> values, double pct) {
+    if (values.empty()) return 0.0;
+    std::sort(values.begin(), values.end());
+    size_t index = (size_t)(pct / 100.0 * (values.size() - 1) + 0.5);
+    return values[index] / 1000.0;
+}
+
+static void printLoad(const LoadResult& r, double baselineRate) {
+    double loss = baselineRate > 0 ? 100.0 * (1.0 - r.cellsPerSec / baselineRate) : 0.0;
+    printf("{\"injected\":%u,\"cells_per_s\":%.1f,\"scan_rate_loss_pct\":%.1f,\"ops\":%u,\"lost_events\":%u,"
+           "\"phantom_events\":%u,\"repeated_events\":%u,\"recoveries\":%u,\"reboots\":%u}",
+           (unsigned)r.injected, r.cellsPerSec, loss, (unsigned)r.ops, (unsigned)r.lost, (unsigned)r.phantom,
+           (unsigned)r.repeated, (unsigned)r.recoveries, (unsigned)r.reboots);
+}
+
+int runFaultsBench(int argc, char** argv) {
+    uint32_t trials = (argc > 0) ? (uint32_t)atoi(argv[0]) : 20;
+    unsigned long loadMs = (argc > 1) ? (unsigned long)atol(argv[1]) * 1000UL : 180000UL;
+    unsigned long intervalMs = (argc > 2) ? (unsigned long)atol(argv[2]) * 1000UL : 10000UL;
+    uint32_t ratePerMillion = (argc > 3) ? (uint32_t)atol(argv[3]) : 2000;
+    if (trials == 0) trials = 1;
+    if (intervalMs < 1000) intervalMs = 1000;
+
+    BenchEnvironment env;
+    env.attach();
+    placeReferenceTags(env.board);
+    for (int i = 0; i < HAND_CELL_COUNT; i += 2) {
+        uint8_t uid[7] = {0x04, 0x5A, (uint8_t)i, 0x10, 0x22, 0x31, 0x80};
+        env.board.placeTag(HAND_CELL_FIRST + i, uid, 7);
+    }
+
+    memset(probe.cursor, 0, sizeof(probe.cursor));
+    probe.env = &env;
+    probe.watchdogPending = false;
+    probe.reboots = 0;
+    memset(probe.lastOpUs, 0, sizeof(probe.lastOpUs));
+    probe.lastCell = -1;
+    probe.cellsScanned = 0;
+    probe.bankedRecoveries = 0;
+    i2cFaultInjector.clear();
+    i2cFaultInjector.resetStatistics();
+    i2cFaultInjector.setWatchdogHandler(onWatchdog, &probe);
+
+    setup();
+    scanMatrix.getCardEvents().setCallback(onCardEvent, &probe);
+    runSteps(WARMUP_MS);
+
+    LoadResult baseline;
+    measureLoad(env, -1, intervalMs, loadMs, baseline);
+    uint32_t phantomTotal = baseline.phantom;
+
+    printf("{\"bench\":\"faults\",\"trials\":%u,\"load_s\":%lu,\"fault_interval_s\":%lu,\"baseline\":", (unsigned)trials,
+           loadMs / 1000, intervalMs / 1000);
+    printLoad(baseline, baseline.cellsPerSec);
+    printf(",\"faults\":[");
+    for (int c = 0; c < I2C_FAULT_CLASS_COUNT; c++) {
+        I2CFaultClass faultClass = (I2CFaultClass)c;
+        RecoveryResult rec;
+        measureRecovery(env, faultClass, trials, rec);
+        LoadResult load;
+        measureLoad(env, c, intervalMs, loadMs, load);
+
+        printf("%s{\"fault\":\"%s\",\"fired\":%u,\"recovered\":%u,\"ttr\":{\"p50_ms\":%.1f,\"p95_ms\":%.1f,"
+               "\"max_ms\":%.1f},\"load\":",
+               c ? "," : "", I2CFaultInjector::getFaultName(faultClass), (unsigned)rec.fired, (unsigned)rec.recovered,
+               percentileMs(rec.ttrUs, 50), percentileMs(rec.ttrUs, 95), percentileMs(rec.ttrUs, 100));
+        printLoad(load, baseline.cellsPerSec);
+        printf("}");
+        phantomTotal += load.phantom;
+    }
+
+    // Вероятностный режим: мелкие сбои всех видов одновременно
+    i2cFaultInjector.setRate(I2C_FAULT_NACK, ratePerMillion);
+    i2cFaultInjector.setRate(I2C_FAULT_SHORT_READ, ratePerMillion);
+    i2cFaultInjector.setRate(I2C_FAULT_MISSING_ACK, ratePerMillion);
+    i2cFaultInjector.setRate(I2C_FAULT_CORRUPT_FRAME, ratePerMillion);
+    LoadResult mixed;
+    measureLoad(env, -1, intervalMs, loadMs, mixed);
+    printf("],\"mixed\":{\"rate_per_million\":%u,\"load\":", (unsigned)ratePerMillion);
+    printLoad(mixed, baseline.cellsPerSec);
+    phantomTotal += mixed.phantom;
+    printf("},\"transactions\":%u,\"chip_resets\":%u,\"phantom_total\":%u}\n",
+           (unsigned)i2cFaultInjector.getTransactions(), (unsigned)i2cFaultInjector.getChipResets(),
+           (unsigned)phantomTotal);
+
+    i2cFaultInjector.setWatchdogHandler(nullptr, nullptr);
+    return phantomTotal == 0 ? 0 : 1;
+}
@@ -0,0 +1,280 @@
+#include "benchmarks.h"
+#include "multiplexer.h"
+#include "mux_tree_model.h"
+#include <chrono>
+
+// =============================================
+// БЕНЧМАРК ГЕОМЕТРИЙ ДОСКИ
+// Каждая геометрия config.h (8×12, 10×10, 16×16, каскад 32×32) поднимает
+// свой BasicMultiplexerManager. Проход по порядку и случайный доступ:
+// после каждого выбора эталонный декодер (host/emulator/mux_tree_model)
+// читает уровни пинов и должен назвать ту же ячейку; два LOW на ступени
+// INH при включенном EN - перекрытие. Считаются записи пинов и виртуальные
+// паузы стабилизации. Рядом - копия прежнего Multiplexer (8×12, все S на каждую
+// смену) для сравнения записей и нс на selectCell (CPU хоста)
+// =============================================
+
+static const int DEFAULT_TIMING_PASSES = 20000;
+static const int RANDOM_SELECTS_PER_CELL = 4;
+
+// Прежняя реализация: адрес мультиплексора - все S заново, номер
+// мультиплексора проверяется при каждой смене
+class LegacyMultiplexer {
+private:
+    int muxNumber;
+    int s0Pin, s1Pin, s2Pin, s3Pin;
+    int currentAddress;
+    unsigned long settleUs;
+
+public:
+    explicit LegacyMultiplexer(int muxNum) : muxNumber(muxNum), currentAddress(0), settleUs(MUX_SETTLE_TIME_US) {
+        if (muxNumber == 1) {
+            s0Pin = MUX1_S0_PIN; s1Pin = MUX1_S1_PIN; s2Pin = MUX1_S2_PIN; s3Pin = -1;
+        } else {
+            s0Pin = MUX2_S0_PIN; s1Pin = MUX2_S1_PIN; s2Pin = MUX2_S2_PIN; s3Pin = MUX2_S3_PIN;
+        }
+    }
+
+    void initialize() {
+        pinMode(s0Pin, OUTPUT);
+        pinMode(s1Pin, OUTPUT);
+        pinMode(s2Pin, OUTPUT);
+        if (muxNumber == 2 && s3Pin >= 0) pinMode(s3Pin, OUTPUT);
+        setAddress(0);
+    }
+
+    bool isValidAddress(int address) const {
+        if (muxNumber == 1) return address >= 0 && address < 8;
+        if (muxNumber == 2) return address >= 0 && address < 12;
+        return false;
+    }
+
+    void setAddress(int address) {
+        if (!isValidAddress(address)) return;
+        if (address != currentAddress) {
+            digitalWrite(s0Pin, (address & 0x01) ? HIGH : LOW);
+            digitalWrite(s1Pin, (address & 0x02) ? HIGH : LOW);
+            digitalWrite(s2Pin, (address & 0x04) ? HIGH : LOW);
+            if (muxNumber == 2 && s3Pin >= 0) digitalWrite(s3Pin, (address & 0x08) ? HIGH : LOW);
+            delayMicroseconds(settleUs);
+            currentAddress = address;
+        }
+    }
+};
+
+class LegacyMultiplexerManager {
+private:
+    LegacyMultiplexer mux1;
+    LegacyMultiplexer mux2;
+    int currentRow;
+    int currentCol;
+    int previousCellIndex;
+    unsigned long lastSwitchMicros;
+
+public:
+    static const int TOTAL_CELLS = 96;
+
+    LegacyMultiplexerManager() : mux1(1), mux2(2), currentRow(0), currentCol(0),
+                                 previousCellIndex(-1), lastSwitchMicros(0) {}
+
+    void initialize() {
+        mux1.initialize();
+        mux2.initialize();
+        pinMode(MUX_COMMON_EN_PIN, OUTPUT);
+        disableAll();
+        selectCell(0, 0);
+    }
+
+    void selectCell(int row, int col) {
+        if (row < 0 || row >= 8 || col < 0 || col >= 12) return;
+        if (row != currentRow || col != currentCol) {
+            previousCellIndex = currentRow * 12 + currentCol;
+            lastSwitchMicros = micros();
+        }
+        if (row != currentRow) {
+            mux1.setAddress(row);
+            currentRow = row;
+        }
+        if (col != currentCol) {
+            mux2.setAddress(col);
+            currentCol = col;
+        }
+        digitalWrite(MUX_COMMON_EN_PIN, LOW);
+    }
+
+    void selectCellByIndex(int cellIndex) {
+        if (cellIndex < 0 || cellIndex >= TOTAL_CELLS) return;
+        selectCell(cellIndex / 12, cellIndex % 12);
+    }
+
+    void disableAll() { digitalWrite(MUX_COMMON_EN_PIN, HIGH); }
+};
+
+// Записи пинов и перекрытия INH: два мультиплексора ступени на общем выходе
+// при включенном EN
+class GeometryProbe : public hostsim::PinListener {
+public:
+    const BoardGeometry& geometry;
+    uint64_t writes;
+    uint32_t overlaps;
+
+    explicit GeometryProbe(const BoardGeometry& layout) : geometry(layout), writes(0), overlaps(0) {}
+
+    void onPinWrite(uint8_t pin, uint8_t level) override {
+        (void)pin;
+        writes++;
+        if (level == LOW && hostsim::getPinLevel(geometry.enablePin) == LOW &&
+            (inhibitOverlap(geometry.rowAxis) || inhibitOverlap(geometry.colAxis))) {
+            overlaps++;
+        }
+    }
+
+private:
+    static bool inhibitOverlap(const MuxAxis& axis) {
+        for (int s = 0; s < axis.stageCount; s++) {
+            const MuxStage& stage = axis.stages[s];
+            int low = 0;
+            for (int i = 0; i < stage.inhibitCount; i++) {
+                if (hostsim::getPinLevel(stage.inhibitPins[i]) == LOW) low++;
+            }
+            if (low > 1) return true;
+        }
+        return false;
+    }
+};
+
+struct GeometryResult {
+    const char* name;
+    int rows;
+    int cols;
+    int rowPins;
+    int colPins;
+    size_t tableBytes;
+    bool initOk;
+    bool disableOk;
+    uint32_t scanMismatched;
+    uint32_t randomMismatched;
+    uint32_t overlaps;
+    uint64_t writesPerScan;
+    double writesPerRandomSelect;
+    uint64_t settleUsPerScan;
+    double nsPerSelect;
+};
+
+// Проверка и замер одного менеджера: Manager - BasicMultiplexerManager<G>
+// или прежний; декодер читает пины по layout
+template <typename Manager>
+static void runManager(Manager& mux, int totalCells, const BoardGeometry& layout, int timingPasses,
+                       GeometryResult& result) {
+    GeometryProbe probe(layout);
+    hostsim::addPinListener(&probe);
+    mux.initialize();
+    result.initOk = decodeMuxCell(layout) == 0;
+
+    // Проход по порядку - как цикл сканирования, с возвратом на 0
+    probe.writes = 0;
+    uint64_t startUs = hostsim::nowMicros();
+    for (int i = 1; i <= totalCells; i++) {
+        int cell = i % totalCells;
+        mux.selectCellByIndex(cell);
+        if (decodeMuxCell(layout) != cell) result.scanMismatched++;
+    }
+    result.writesPerScan = probe.writes;
+    result.settleUsPerScan = hostsim::nowMicros() - startUs;
+
+    // Случайный доступ (повторная проверка, перекалибровка)
+    uint32_t rng = 12345;
+    int selects = totalCells * RANDOM_SELECTS_PER_CELL;
+    probe.writes = 0;
+    for (int k = 0; k < selects; k++) {
+        rng = rng * 1664525UL + 1013904223UL;
+        int cell = (int)((rng >> 8) % (uint32_t)totalCells);
+        mux.selectCellByIndex(cell);
+        if (decodeMuxCell(layout) != cell) result.randomMismatched++;
+    }
+    result.writesPerRandomSelect = (double)probe.writes / selects;
+    result.overlaps = probe.overlaps;
+
+    mux.disableAll();
+    result.disableOk = decodeMuxCell(layout) < 0;
+    hostsim::removePinListener(&probe);
+
+    // CPU хоста: паузы стабилизации - виртуальные, в замер не входят
+    auto t0 = std::chrono::steady_clock::now();
+    for (int p = 0; p < timingPasses; p++) {
+        for (int i = 0; i < totalCells; i++) {
+            mux.selectCellByIndex(i);
+        }
+    }
+    double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - t0).count();
+    result.nsPerSelect = ns / ((double)timingPasses * totalCells);
+}
+
+template <typename Geometry>
+static GeometryResult runGeometry(int timingPasses) {
+    typedef BasicMultiplexerManager<Geometry> Manager;
+    GeometryResult result = {};
+    result.name = Geometry::layout.name;
+    result.rows = Manager::ROWS;
+    result.cols = Manager::COLS;
+    result.rowPins = Manager::RowCodec::PINS;
+    result.colPins = Manager::ColCodec::PINS;
+    result.tableBytes = sizeof(Manager::RowCodec::table) + sizeof(Manager::ColCodec::table);
+
+    Manager mux;
+    runManager(mux, Manager::TOTAL_CELLS, Geometry::layout, timingPasses, result);
+    return result;
+}
+
+static void printResult(const GeometryResult& r, bool first) {
+    printf("%s{\"name\":\"%s\",\"rows\":%d,\"cols\":%d,\"row_pins\":%d,\"col_pins\":%d,\"table_bytes\":%zu,"
+           "\"init_ok\":%s,\"disable_ok\":%s,\"scan_mismatched\":%u,\"random_mismatched\":%u,\"inh_overlaps\":%u,"
+           "\"writes_per_scan\":%llu,\"writes_per_random_select\":%.2f,\"settle_us_per_scan\":%llu,"
+           "\"ns_per_select\":%.1f}",
+           first ? "" : ",", r.name, r.rows, r.cols, r.rowPins, r.colPins, r.tableBytes,
+           r.initOk ? "true" : "false", r.disableOk ? "true" : "false", (unsigned)r.scanMismatched,
+           (unsigned)r.randomMismatched, (unsigned)r.overlaps, (unsigned long long)r.writesPerScan,
+           r.writesPerRandomSelect, (unsigned long long)r.settleUsPerScan, r.nsPerSelect);
+}
+
+static bool resultOk(const GeometryResult& r) {
+    return r.initOk && r.disableOk && r.scanMismatched == 0 && r.randomMismatched == 0 && r.overlaps == 0;
+}
+
+int runGeometryBench(int argc, char** argv) {
+    int timingPasses = (argc > 0) ? max(1, atoi(argv[0])) : DEFAULT_TIMING_PASSES;
+
+    // Прежний менеджер - первым, пока пины в исходном LOW (он их не выставлял)
+    GeometryResult legacy = {};
+    legacy.name = "legacy_8x12";
+    legacy.rows = 8;
+    legacy.cols = 12;
+    legacy.rowPins = 3;
+    legacy.colPins = 4;
+    LegacyMultiplexerManager legacyMux;
+    runManager(legacyMux, LegacyMultiplexerManager::TOTAL_CELLS, Geometry8x12::layout, timingPasses, legacy);
+
+    GeometryResult results[] = {
+        runGeometry<Geometry8x12>(timingPasses),
+        runGeometry<Geometry10x10>(timingPasses),
+        runGeometry<Geometry16x16>(timingPasses),
+        runGeometry<Geometry32x32>(timingPasses),
+    };
+    const int count = sizeof(results) / sizeof(results[0]);
+
+    bool allOk = resultOk(legacy);
+    printf("{\"bench\":\"geometry\",\"timing_passes\":%d,\"active\":\"%s\",\"legacy\":", timingPasses,
+           ActiveGeometry::layout.name);
+    printResult(legacy, true);
+    printf(",\"geometries\":[");
+    for (int i = 0; i < count; i++) {
+        printResult(results[i], i == 0);
+        allOk = allOk && resultOk(results[i]);
+    }
+    printf("],\"writes_saved_8x12\":%lld,\"speedup_8x12\":%.2f,\"all_ok\":%s}\n",
+           (long long)legacy.writesPerScan - (long long)results[0].writesPerScan,
+           results[0].nsPerSelect > 0 ? legacy.nsPerSelect / results[0].nsPerSelect : 0.0,
+           allOk ? "true" : "false");
+    return allOk ? 0 : 1;
+}
@@ -0,0 +1,127 @@
+#include "benchmarks.h"
+#include "rfid_manager.h"
+#include "scan_matrix.h"
+
+// =============================================
+// БЕНЧМАРК ОЖИДАНИЯ ОТВЕТА PN532: IRQ ПРОТИВ ОПРОСА RDY
+// Опрос читает байт RDY с шагом 1-10 мс: ответ забирается с опозданием
+// до шага, каждое чтение занимает шину. IRQ будит ожидание на спаде линии.
+// Меряем чтение пустой и занятой ячейки, чтения RDY и время шины на них,
+// проход целиком; отдельно - откат на опрос, если провод IRQ не распаян
+// =============================================
+
+extern ScanMatrix scanMatrix;
+extern RFIDManager rfidManager;
+
+static const int EMPTY_CELL = MATRIX_TOTAL_CELLS - 1;
+static const int OCCUPIED_CELL = 14;
+
+struct ReadCost {
+    uint64_t totalUs;
+    uint32_t statusReads;
+    uint32_t samples;
+};
+
+struct IrqModeResult {
+    ReadCost empty;
+    ReadCost occupied;
+    unsigned long meanCycleMs;
+    uint32_t passStatusReads;
+    bool matchesBoard;
+};
+
+static void measureRead(BenchEnvironment& env, int cell, ReadCost& cost) {
+    uint64_t start = hostsim::nowMicros();
+    uint32_t reads = env.pn532.getStatusReads();
+    scanMatrix.scanCell(cell);
+    cost.totalUs += hostsim::nowMicros() - start;
+    cost.statusReads += env.pn532.getStatusReads() - reads;
+    cost.samples++;
+}
+
+static void waitCycleStart() {
+    unsigned long cycleStart = scanMatrix.getCycleStartTime();
+    while (scanMatrix.getCycleStartTime() == cycleStart) {
+        loop();
+    }
+}
+
+static bool cacheMatchesBoard(BenchEnvironment& env) {
+    for (int i = 0; i < MATRIX_TOTAL_CELLS; i++) {
+        const CardInfo& info = scanMatrix.getCardInfo(i);
+        if (info.present != env.board.tagAt(i).present) return false;
+    }
+    return true;
+}
+
+static IrqModeResult runMode(BenchEnvironment& env, bool irq, int rounds, uint32_t cycles) {
+    IrqModeResult r;
+    memset(&r, 0, sizeof(r));
+
+    rebootFirmware(env);
+    hostsim::eraseFlash();
+    setup();
+    rfidManager.setIrqWait(irq);
+
+    // Проход наполняет кэш, затем замер проходов
+    waitCycleStart();
+    uint32_t readsBefore = env.pn532.getStatusReads();
+    unsigned long totalMs = 0;
+    for (uint32_t c = 0; c < cycles; c++) {
+        waitCycleStart();
+        totalMs += scanMatrix.getLastCycleTime();
+    }
+    r.meanCycleMs = totalMs / cycles;
+    r.passStatusReads = (env.pn532.getStatusReads() - readsBefore) / cycles;
+    r.matchesBoard = cacheMatchesBoard(env);
+
+    for (int i = 0; i < rounds; i++) {
+        measureRead(env, EMPTY_CELL, r.empty);
+        measureRead(env, OCCUPIED_CELL, r.occupied);
+    }
+    return r;
+}
+
+static void printCost(const char* name, const ReadCost& c) {
+    printf("\"%s\":{\"mean_us\":%lu,\"status_reads\":%.1f},", name,
+           c.samples ? (unsigned long)(c.totalUs / c.samples) : 0,
+           c.samples ? (double)c.statusReads / c.samples : 0.0);
+}
+
+int runIrqBench(int argc, char** argv) {
+    int rounds = (argc > 0) ? atoi(argv[0]) : 50;
+    uint32_t cycles = (argc > 1) ? (uint32_t)atol(argv[1]) : 3;
+
+    BenchEnvironment env;
+    env.attach();
+    placeReferenceTags(env.board);
+
+    printf("{\"bench\":\"irq\",\"rounds\":%d,\"cycles\":%u,\"modes\":[", rounds, (unsigned)cycles);
+    for (int m = 0; m < 2; m++) {
+        bool irq = (m == 1);
+        IrqModeResult r = runMode(env, irq, rounds, cycles);
+        // Чтение RDY: адрес + байт, 9 бит на байт
+        unsigned long busUs = (unsigned long)r.passStatusReads * 2 * hostsim::byteTimeMicros();
+        printf("%s{\"mode\":\"%s\",", m ? "," : "", irq ? "irq" : "poll");
+        printCost("empty_cell", r.empty);
+        printCost("occupied_cell", r.occupied);
+        printf("\"mean_cycle_ms\":%lu,\"status_reads_per_pass\":%u,\"rdy_bus_ms_per_pass\":%.1f,"
+               "\"matches_board\":%s}",
+               r.meanCycleMs, (unsigned)r.passStatusReads, busUs / 1000.0,
+               r.matchesBoard ? "true" : "false");
+    }
+
+    // Провод IRQ не распаян: инициализация откатывается на опрос RDY
+    rebootFirmware(env);
+    env.pn532.setIrqWired(false);
+    setup();
+    while (!scanMatrix.isBoardValid() && millis() < 60000) {
+        loop();
+    }
+    printf("],\"unwired\":{\"irq_active\":%s,\"first_valid_board_ms\":%lu,\"matches_board\":%s}}\n",
+           rfidManager.getIrqWait() ? "true" : "false",
+           scanMatrix.isBoardValid() ? scanMatrix.getFirstValidBoardTime() : 0,
+           cacheMatchesBoard(env) ? "true" : "false");
+    env.pn532.setIrqWired(true);
+    return 0;
+}
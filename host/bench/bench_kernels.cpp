@@ -0,0 +1,256 @@
+#include "benchmarks.h"
+#include "rfid_manager.h"
+#include "multiplexer.h"
+#include "scan_matrix.h"
+#include <Adafruit_PN532.h>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+
+// =============================================
+// МИКРОБЕНЧМАРКИ ЯДЕР ПРОХОДА (CPU, без шины)
+// То, что выполняется на каждой из 96 ячеек прохода: сборка кадра команды,
+// разбор ответа InListPassiveTarget, scanCardFast со сравнением UID, запись
+// в кэш и событие карты, выбор ячейки, подсчет карт. PN532 заменен отводом
+// шины с готовыми ответами (ACK, RDY, кадр с меткой), эмулятор снят.
+// Время - реальное (steady_clock), не виртуальное: число итераций
+// подбирается до минимального времени замера, затем повторы; в отчет -
+// медиана, минимум и максимум нс на операцию по повторам
+// =============================================
+
+extern RFIDManager rfidManager;
+extern MultiplexerManager muxManager;
+extern ScanMatrix scanMatrix;
+
+static const unsigned long DEFAULT_MIN_TIME_MS = 200;
+static const int DEFAULT_REPETITIONS = 5;
+static const uint64_t MAX_ITERATIONS = 1ULL << 30;
+
+// Доступ к закрытым ядрам (friend в Adafruit_PN532 и ScanMatrix при HOST_BUILD)
+class HostKernelAccess {
+public:
+    static void writecommand(Adafruit_PN532& nfc, uint8_t* cmd, uint8_t cmdlen) {
+        nfc.writecommand(cmd, cmdlen);
+    }
+    static void updateCardCache(ScanMatrix& matrix, int cellIndex, ScanResult result) {
+        matrix.updateCardCache(cellIndex, result);
+    }
+};
+
+// PN532 на отводе: после записи команды - ACK, затем кадр ответа
+// InListPassiveTarget с targets метками; чтение 1 байта - RDY
+class CannedPN532 : public Adafruit_I2CInterceptor {
+public:
+    uint8_t uid[7];
+    uint8_t uidLength;
+    uint8_t targets;
+    uint32_t writes;
+
+    CannedPN532() : uidLength(7), targets(1), writes(0), ackPending(false) {
+        static const uint8_t defaultUid[7] = {0x1D, 0xA8, 0x94, 0xF5, 0x0A, 0x10, 0x80};
+        memcpy(uid, defaultUid, sizeof(uid));
+    }
+
+    bool write(Adafruit_I2CDevice* dev, const uint8_t* buffer, size_t len, bool stop,
+               const uint8_t* prefixBuffer, size_t prefixLen) override {
+        writes++;
+        ackPending = len > 0;
+        return true;
+    }
+
+    bool read(Adafruit_I2CDevice* dev, uint8_t* buffer, size_t len, bool stop) override {
+        static const uint8_t ack[7] = {0x01, 0x00, 0x00, 0xFF, 0x00, 0xFF, 0x00};
+        if (len <= 1) {
+            if (len == 1) buffer[0] = 0x01;
+            return true;
+        }
+        if (ackPending) {
+            ackPending = false;
+            memcpy(buffer, ack, min(len, sizeof(ack)));
+            return true;
+        }
+        uint8_t frame[64] = {0x01, 0x00, 0x00, 0xFF};
+        uint8_t* p = frame + 1;
+        size_t payload = 3;
+        p[5] = 0xD5;
+        p[6] = 0x4B;
+        p[7] = targets;
+        for (uint8_t t = 0; t < targets; t++) {
+            uint8_t* target = &p[8 + t * (5 + uidLength)];
+            target[0] = t + 1;
+            target[1] = 0x00;
+            target[2] = 0x44;
+            target[3] = 0x00;
+            target[4] = uidLength;
+            memcpy(target + 5, uid, uidLength);
+            payload += 5 + uidLength;
+        }
+        p[3] = payload;
+        p[4] = ~payload + 1;
+        uint8_t sum = 0;
+        for (size_t i = 0; i < payload; i++) {
+            sum += p[5 + i];
+        }
+        p[5 + payload] = ~sum + 1;      // DCS - драйвер проверяет кадр
+        memcpy(buffer, frame, min(len, sizeof(frame)));
+        return true;
+    }
+
+    void deviceReset(Adafruit_I2CDevice* dev) override {}
+
+private:
+    bool ackPending;
+};
+
+struct KernelResult {
+    const char* name;
+    uint64_t iterations;
+    double nsMedian;
+    double nsMin;
+    double nsMax;
+};
+
+static volatile uint32_t kernelSink;
+
+template <typename Body> static double timeBatch(Body& body, uint64_t iterations) {
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < iterations; i++) {
+        body(i);
+    }
+    auto end = std::chrono::steady_clock::now();
+    return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+}
+
+// Как в Google Benchmark: итерации растут, пока замер короче минимального
+// времени (с запасом 1.4 от прогноза, но не больше чем в 10 раз за шаг)
+template <typename Body>
+static KernelResult runKernel(const char* name, Body body, unsigned long minTimeMs, int repetitions) {
+    double minTimeNs = minTimeMs * 1e6;
+    uint64_t iterations = 1;
+    for (;;) {
+        double ns = timeBatch(body, iterations);
+        if (ns >= minTimeNs || iterations >= MAX_ITERATIONS) {
+            break;
+        }
+        double multiplier = (ns > minTimeNs / 10) ? minTimeNs * 1.4 / ns : 10.0;
+        iterations = std::min(MAX_ITERATIONS, (uint64_t)(iterations * multiplier) + 1);
+    }
+
+    std::vector<double> perOp;
+    for (int r = 0; r < repetitions; r++) {
+        perOp.push_back(timeBatch(body, iterations) / iterations);
+    }
+    std::sort(perOp.begin(), perOp.end());
+
+    KernelResult result;
+    result.name = name;
+    result.iterations = iterations;
+    result.nsMedian = perOp[perOp.size() / 2];
+    result.nsMin = perOp.front();
+    result.nsMax = perOp.back();
+    return result;
+}
+
+int runKernelsBench(int argc, char** argv) {
+    unsigned long minTimeMs = (argc > 0) ? (unsigned long)atol(argv[0]) : DEFAULT_MIN_TIME_MS;
+    int repetitions = (argc > 1) ? max(1, atoi(argv[1])) : DEFAULT_REPETITIONS;
+    const char* filter = (argc > 2) ? argv[2] : nullptr;
+
+    // Прошивка поднимается на эмуляторе, затем PN532 - только отвод
+    BenchEnvironment env;
+    env.attach();
+    placeReferenceTags(env.board);
+    rebootFirmware(env);
+    hostsim::eraseFlash();
+    setup();
+    env.board.detach();
+    env.pn532.detach();
+
+    // Отвод не ведет линию IRQ: ожидание ответа - опросом RDY
+    CannedPN532 canned;
+    Adafruit_I2CDevice::setTap(&canned);
+    rfidManager.setIrqWait(false);
+    Adafruit_PN532 nfc(PN532_IRQ_PIN, PN532_RESET_PIN);
+
+    std::vector<KernelResult> results;
+    auto add = [&](const char* name, auto body) {
+        if (filter == nullptr || strstr(name, filter) != nullptr) {
+            results.push_back(runKernel(name, body, minTimeMs, repetitions));
+        }
+    };
+
+    // Кадр команды: преамбула, длина, контрольные суммы; запись - на отвод
+    uint8_t inList[3] = {PN532_COMMAND_INLISTPASSIVETARGET, 1, PN532_MIFARE_ISO14443A};
+    add("pn532_writecommand/3", [&](uint64_t i) {
+        HostKernelAccess::writecommand(nfc, inList, sizeof(inList));
+    });
+    uint8_t longCommand[16] = {PN532_COMMAND_INDATAEXCHANGE, 1, 0x30};
+    add("pn532_writecommand/16", [&](uint64_t i) {
+        longCommand[3] = (uint8_t)i;
+        HostKernelAccess::writecommand(nfc, longCommand, sizeof(longCommand));
+    });
+
+    // Разбор ответа: кадр уже готов, чтение - копия из отвода
+    uint8_t uid[7];
+    uint8_t uidLength;
+    nfc.startPassiveTargetIDDetection(PN532_MIFARE_ISO14443A);
+    if (!nfc.readDetectedPassiveTargetID(uid, &uidLength) || uidLength != canned.uidLength) {
+        Adafruit_I2CDevice::setTap(nullptr);
+        printf("{\"bench\":\"kernels\",\"error\":\"кадр отвода не принят драйвером\"}\n");
+        return 1;
+    }
+    add("pn532_read_detected_target", [&](uint64_t i) {
+        kernelSink += nfc.readDetectedPassiveTargetID(uid, &uidLength);
+    });
+
+    // Транзакция InListPassiveTarget целиком: команда, RDY, ACK, ответ
+    uint8_t uids[2][7];
+    uint8_t uidLengths[2];
+    uint8_t targetCount;
+    add("pn532_inlist_transaction", [&](uint64_t i) {
+        kernelSink += nfc.readPassiveTargetIDs(PN532_MIFARE_ISO14443A, 1, uids, uidLengths, &targetCount, 50);
+    });
+
+    // scanCardFast: та же метка (сравнение UID до конца) и смена метки
+    add("rfid_scan_card_fast/same", [&](uint64_t i) {
+        kernelSink += rfidManager.scanCardFast();
+    });
+    add("rfid_scan_card_fast/changed", [&](uint64_t i) {
+        canned.uid[6] = (uint8_t)i;
+        kernelSink += rfidManager.scanCardFast();
+    });
+    canned.targets = 0;
+    add("rfid_scan_card_fast/empty", [&](uint64_t i) {
+        kernelSink += rfidManager.scanCardFast();
+    });
+    canned.targets = 1;
+    canned.uid[6] = 0x80;
+    rfidManager.scanCardFast();
+
+    // Кэш: чтение без изменений (основной случай прохода) и событие
+    // добавления/удаления с processCardEvent
+    add("matrix_update_cache/unchanged", [&](uint64_t i) {
+        HostKernelAccess::updateCardCache(scanMatrix, 40 + (int)(i % 8), SCAN_CARD_FOUND);
+    });
+    add("matrix_update_cache/event", [&](uint64_t i) {
+        HostKernelAccess::updateCardCache(scanMatrix, 48, (i & 1) ? SCAN_NO_CARD : SCAN_CARD_FOUND);
+    });
+
+    add("mux_select_cell", [&](uint64_t i) {
+        muxManager.selectCellByIndex((int)(i % MATRIX_TOTAL_CELLS));
+    });
+    add("matrix_find_cards", [&](uint64_t i) {
+        kernelSink += scanMatrix.findCardsInMatrix();
+    });
+
+    Adafruit_I2CDevice::setTap(nullptr);
+
+    printf("{\"bench\":\"kernels\",\"min_time_ms\":%lu,\"repetitions\":%d,\"kernels\":[", minTimeMs, repetitions);
+    for (size_t k = 0; k < results.size(); k++) {
+        const KernelResult& r = results[k];
+        printf("%s{\"name\":\"%s\",\"iterations\":%llu,\"ns_per_op\":%.1f,\"ns_min\":%.1f,\"ns_max\":%.1f}",
+               k ? "," : "", r.name, (unsigned long long)r.iterations, r.nsMedian, r.nsMin, r.nsMax);
+    }
+    printf("]}\n");
+    return 0;
+}
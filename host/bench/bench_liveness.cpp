@@ -0,0 +1,35 @@
+#include "benchmarks.h"
+#include <Adafruit_PN532.h>
+
+// =============================================
+// БЕНЧМАРК ПРОВЕРОК ЖИВОСТИ
+// Сколько служебных команд уходит в PN532 при штатном сканировании
+// (раньше - getFirmwareVersion() не реже раза в 10-20 секунд из двух таймеров)
+// =============================================
+
+int runLivenessBench(int argc, char** argv) {
+    unsigned long durationMs = (argc > 0) ? (unsigned long)atol(argv[0]) : 60000;
+
+    BenchEnvironment env;
+    env.attach();
+    placeReferenceTags(env.board);
+
+    setup();
+
+    uint32_t fwBefore = env.pn532.getCommandCount(PN532_COMMAND_GETFIRMWAREVERSION);
+    uint32_t statusBefore = env.pn532.getCommandCount(PN532_COMMAND_GETGENERALSTATUS);
+    uint32_t scansBefore = env.pn532.getCommandCount(PN532_COMMAND_INLISTPASSIVETARGET);
+
+    env.runFor(durationMs);
+
+    uint32_t fw = env.pn532.getCommandCount(PN532_COMMAND_GETFIRMWAREVERSION) - fwBefore;
+    uint32_t status = env.pn532.getCommandCount(PN532_COMMAND_GETGENERALSTATUS) - statusBefore;
+    uint32_t scans = env.pn532.getCommandCount(PN532_COMMAND_INLISTPASSIVETARGET) - scansBefore;
+
+    printf("{\"bench\":\"liveness\",\"duration_ms\":%lu,\"scan_commands\":%u,"
+           "\"firmware_version_probes\":%u,\"general_status_probes\":%u,"
+           "\"probes_per_minute\":%.2f}\n",
+           durationMs, (unsigned)scans, (unsigned)fw, (unsigned)status,
+           (fw + status) * 60000.0 / durationMs);
+    return 0;
+}
@@ -0,0 +1,124 @@
+#include "benchmarks.h"
+#include <new>
+#include "state_manager.h"
+#include "rfid_manager.h"
+#include "multiplexer.h"
+#include "scan_matrix.h"
+#include "display_manager.h"
+#include "metrics.h"
+#include "serial_console.h"
+#include "memory_monitor.h"
+
+// =============================================
+// ДИСПЕТЧЕР ХОСТ-БЕНЧМАРКОВ
+// =============================================
+
+struct BenchEntry {
+    const char* name;
+    int (*run)(int argc, char** argv);
+    const char* description;
+};
+
+static const BenchEntry BENCHMARKS[] = {
+    {"recovery", runRecoveryBench, "время восстановления после сбоев шины/PN532"},
+    {"liveness", runLivenessBench, "служебные пробы PN532 при штатном сканировании"},
+    {"queue",    runQueueBench,    "очередь команд: ожидание, дедлайны, бюджет устаревания"},
+    {"warmboot", runWarmBootBench, "время до первой достоверной доски: холодный/теплый старт"},
+    {"calibration", runCalibrationBench, "самокалибровка таймингов ячеек: проход до/после обучения"},
+    {"verify",   runVerifyBench,   "быстрая проверка известной карты против полной антиколлизии"},
+    {"multitarget", runMultiTargetBench, "две метки в поле антенны: мерцание при MaxTg=1 и MaxTg=2"},
+    {"watch",    runWatchBench,    "наблюдение за ячейкой после снятия фигуры (InAutoPoll)"},
+    {"irq",      runIrqBench,      "ожидание ответа PN532: линия IRQ против опроса RDY"},
+    {"rfprofile", runRfProfileBench, "профили аналогового тракта PN532 по ячейкам: штатный против выбора"},
+    {"rfgate",   runRfGateBench,   "поле на переключении мультиплексора: пауза, выключение, выбор по ячейке"},
+    {"quarantine", runQuarantineBench, "неисправная антенна: проход без карантина и с карантином, возврат"},
+    {"events",   runEventsBench,   "предварительные события карт: задержка подтверждения, доля отзывов"},
+    {"moves",    runMovesBench,    "распознавание ходов по записанным партиям: точность, задержка хода"},
+    {"pgn",      runPgnBench,      "нагрузка из PGN: задержка событий и ходов, фантомы, пропуски, время прохода"},
+    {"faults",   runFaultsBench,   "инъекция сбоев I2C/PN532: время восстановления, потеря скорости и событий"},
+    {"crosstalk", runCrosstalkBench, "связь антенн с соседями: ложные события и скорость по режимам MaxTg и поля"},
+    {"replay",   runReplayBench,   "запись трассы I2C и повтор без эмулятора: совпадение событий и таймингов"},
+    {"kernels",  runKernelsBench,  "микробенчмарки ядер прохода на CPU: кадр команды, разбор, кэш, выбор ячейки"},
+    {"metrics",  runMetricsBench,  "реестр метрик: кадры-приращения в Serial, скорости и квантили на хосте"},
+    {"console",  runConsoleBench,  "консоль Serial: бюджет за loop(), проход под запросами, кадры, настройки в NVS"},
+    {"states",   runStatesBench,   "профиль состояний под зависаниями PN532: доступность, восстановления, переходы"},
+    {"memory",   runMemoryBench,   "куча и стек задачи loop(): выделения после setup(), запас стека, повторная инициализация PN532"},
+    {"geometry", runGeometryBench, "геометрии доски: выбор ячеек по таблицам осей, эталонный декодер, записи пинов против прежнего"},
+};
+
+static const int BENCHMARK_COUNT = sizeof(BENCHMARKS) / sizeof(BENCHMARKS[0]);
+
+// Глобальные объекты прошивки (src/main.cpp)
+extern StateManager stateManager;
+extern RFIDManager rfidManager;
+extern MultiplexerManager muxManager;
+extern ScanMatrix scanMatrix;
+extern DisplayManager displayManager;
+extern SerialConsole serialConsole;
+extern int pn532InitAttempts;
+extern unsigned long lastInitAttempt;
+
+template <typename T> static void reconstruct(T& object) {
+    object.~T();
+    new (&object) T();
+}
+
+void rebootFirmware(BenchEnvironment& env) {
+    reconstruct(metrics);
+    reconstruct(stateManager);
+    reconstruct(rfidManager);
+    reconstruct(muxManager);
+    scanMatrix.~ScanMatrix();
+    new (&scanMatrix) ScanMatrix(&muxManager, &rfidManager);
+    displayManager.~DisplayManager();
+    new (&displayManager) DisplayManager(&stateManager, &rfidManager, &scanMatrix, &muxManager);
+    serialConsole.~SerialConsole();
+    new (&serialConsole) SerialConsole(&stateManager, &rfidManager, &muxManager, &scanMatrix, &displayManager);
+    reconstruct(memoryMonitor);
+    serialDebugEnabled = true;
+    pn532InitAttempts = 0;
+    lastInitAttempt = 0;
+
+    hostsim::powerOn();
+    env.board.powerCycle();
+    env.pn532.powerCycle();
+}
+
+void placeReferenceTags(BoardModel& board) {
+    // Ячейки и UID из лога стенда: [0,2] [1,0] [1,2] [2,0] [2,1] [2,2]
+    static const int cells[] = {2, 12, 14, 24, 25, 26};
+    static const uint8_t uids[][7] = {
+        {0x1D, 0xA8, 0x94, 0xF5, 0x0A, 0x10, 0x80},
+        {0x1D, 0xAB, 0x94, 0xF5, 0x0A, 0x10, 0x80},
+        {0x1D, 0xA9, 0x94, 0xF5, 0x0A, 0x10, 0x80},
+        {0x1D, 0xAC, 0x94, 0xF5, 0x0A, 0x10, 0x80},
+        {0x1D, 0xD0, 0x95, 0xF5, 0x0A, 0x10, 0x80},
+        {0x1D, 0xAD, 0x94, 0xF5, 0x0A, 0x10, 0x80},
+    };
+    for (int i = 0; i < 6; i++) {
+        board.placeTag(cells[i], uids[i], 7);
+    }
+}
+
+static void printUsage() {
+    printf("Использование: program <бенчмарк> [параметры]\n");
+    for (int i = 0; i < BENCHMARK_COUNT; i++) {
+        printf("  %-12s %s\n", BENCHMARKS[i].name, BENCHMARKS[i].description);
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        printUsage();
+        return 1;
+    }
+
+    for (int i = 0; i < BENCHMARK_COUNT; i++) {
+        if (strcmp(argv[1], BENCHMARKS[i].name) == 0) {
+            return BENCHMARKS[i].run(argc - 2, argv + 2);
+        }
+    }
+
+    printUsage();
+    return 1;
+}
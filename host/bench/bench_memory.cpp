@@ -0,0 +1,144 @@
+#include "benchmarks.h"
+#include "rfid_manager.h"
+#include "memory_monitor.h"
+#include "freertos/task.h"
+#include <chrono>
+
+// =============================================
+// БЕНЧМАРК ПАМЯТИ
+// setup() и loop() исполняются на отдельном стеке, заполненном образцом, как
+// задача loop() на ESP32. Куча хоста считается operator new. После setup()
+// прошивка работает под зависаниями PN532, перестановками фигур и запросами
+// консоли; проверяем, что кучу никто не берет (ни выделений, ни роста блоков),
+// что повторная инициализация PN532 обходится без кучи и что монитор видит
+// то же, что и стенд. Стек хоста (x86-64) - ориентир, кадры Xtensa другие
+// =============================================
+
+extern RFIDManager rfidManager;
+
+static const int REINIT_RUNS = 20;
+static const int SAMPLE_TIMING_RUNS = 20000;
+static const unsigned long CONSOLE_PERIOD_MS = 2000;
+
+static const char* const CONSOLE_SCRIPT[] = {"mem\r\n", "status\r\n", "cells\r\n", "board\r\n", "metrics\r\n"};
+static const int CONSOLE_SCRIPT_COUNT = sizeof(CONSOLE_SCRIPT) / sizeof(CONSOLE_SCRIPT[0]);
+
+struct MemoryRun {
+    BenchEnvironment* env;
+    unsigned long durationMs;
+    unsigned long faultIntervalMs;
+    uint32_t faults;
+    uint32_t moves;
+    uint32_t commands;
+    uint32_t reinitOk;
+    TaskHandle_t loopTask;
+};
+
+static void setupBody(void* context) {
+    MemoryRun& run = *(MemoryRun*)context;
+    run.loopTask = xTaskGetCurrentTaskHandle();
+    setup();
+}
+
+static void loopBody(void* context) {
+    MemoryRun& run = *(MemoryRun*)context;
+    BenchEnvironment& env = *run.env;
+    uint64_t end = hostsim::nowMicros() + (uint64_t)run.durationMs * 1000ULL;
+    uint64_t nextFault = hostsim::nowMicros() + (uint64_t)run.faultIntervalMs * 1000ULL;
+    uint64_t nextMove = hostsim::nowMicros() + 5000000ULL;
+    uint64_t nextCommand = hostsim::nowMicros() + (uint64_t)CONSOLE_PERIOD_MS * 1000ULL;
+    // Метка ходит между ячейками 2 и 40
+    int tagCell = 2;
+    while (hostsim::nowMicros() < end) {
+        loop();
+        uint64_t now = hostsim::nowMicros();
+        if (now >= nextFault) {
+            env.pn532.injectFault(EMU_FAULT_HANG);
+            run.faults++;
+            nextFault = now + (uint64_t)env.randomRange(run.faultIntervalMs / 2, run.faultIntervalMs) * 1000ULL;
+        }
+        if (now >= nextMove) {
+            int target = (tagCell == 2) ? 40 : 2;
+            env.board.moveTag(tagCell, target);
+            tagCell = target;
+            run.moves++;
+            nextMove = now + (uint64_t)env.randomRange(3000, 8000) * 1000ULL;
+        }
+        if (now >= nextCommand) {
+            hostsim::feedSerialInput(CONSOLE_SCRIPT[run.commands++ % CONSOLE_SCRIPT_COUNT]);
+            nextCommand = now + (uint64_t)CONSOLE_PERIOD_MS * 1000ULL;
+        }
+    }
+}
+
+static void reinitBody(void* context) {
+    MemoryRun& run = *(MemoryRun*)context;
+    for (int i = 0; i < REINIT_RUNS; i++) {
+        if (rfidManager.initialize()) run.reinitOk++;
+    }
+}
+
+int runMemoryBench(int argc, char** argv) {
+    unsigned long durationMs = (argc > 0) ? (unsigned long)atol(argv[0]) * 1000UL : 300000UL;
+    unsigned long faultIntervalMs = (argc > 1) ? (unsigned long)atol(argv[1]) * 1000UL : 30000UL;
+    if (faultIntervalMs == 0) faultIntervalMs = 30000UL;
+
+    BenchEnvironment env;
+    env.attach();
+    placeReferenceTags(env.board);
+    rebootFirmware(env);
+    hostsim::eraseFlash();
+
+    MemoryRun run = {&env, durationMs, faultIntervalMs, 0, 0, 0, 0, nullptr};
+
+    // setup(): выделения допустимы, стек - отдельно от работы
+    hostsim::HeapStats beforeSetup = hostsim::getHeapStats();
+    hostsim::paintTaskStack();
+    hostsim::runOnTaskStack(setupBody, &run);
+    hostsim::HeapStats afterSetup = hostsim::getHeapStats();
+    size_t setupStack = hostsim::TASK_STACK_BYTES - uxTaskGetStackHighWaterMark(run.loopTask);
+
+    // Работа: ни одного выделения
+    hostsim::paintTaskStack();
+    hostsim::runOnTaskStack(loopBody, &run);
+    hostsim::HeapStats afterLoop = hostsim::getHeapStats();
+    size_t loopStack = hostsim::TASK_STACK_BYTES - uxTaskGetStackHighWaterMark(run.loopTask);
+    memoryMonitor.sample();
+    uint32_t monitorStackFree = memoryMonitor.getLoopStackFree();
+
+    // Повторная инициализация PN532 (прежде - new на каждую, I2C-устройство терялось)
+    hostsim::runOnTaskStack(reinitBody, &run);
+    hostsim::HeapStats afterReinit = hostsim::getHeapStats();
+
+    // Цена снимка монитора на CPU хоста (стек задачи обходится целиком)
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < SAMPLE_TIMING_RUNS; i++) {
+        memoryMonitor.sample();
+    }
+    double nsPerSample = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                             std::chrono::steady_clock::now() - t0).count() / SAMPLE_TIMING_RUNS;
+
+    uint64_t loopAllocations = afterLoop.allocations - afterSetup.allocations;
+    uint64_t reinitAllocations = afterReinit.allocations - afterLoop.allocations;
+    long liveBlocksGrown = (long)afterLoop.liveBlocks - (long)afterSetup.liveBlocks;
+    bool monitorAgrees = memoryMonitor.isBaselineTaken() && memoryMonitor.getMaxBlocksGrown() == 0 &&
+                         monitorStackFree == hostsim::TASK_STACK_BYTES - loopStack;
+    bool heapFree = loopAllocations == 0 && liveBlocksGrown == 0 && reinitAllocations == 0 &&
+                    run.reinitOk == REINIT_RUNS;
+
+    printf("{\"bench\":\"memory\",\"seconds\":%lu,\"faults\":%u,\"moves\":%u,\"console_commands\":%u,"
+           "\"setup_allocations\":%llu,\"setup_live_bytes\":%lld,\"setup_stack_bytes\":%zu,"
+           "\"loop_allocations\":%llu,\"loop_live_blocks_grown\":%ld,\"loop_stack_bytes\":%zu,"
+           "\"task_stack_bytes\":%zu,\"reinit_runs\":%d,\"reinit_ok\":%u,\"reinit_allocations\":%llu,"
+           "\"monitor_samples\":%u,\"monitor_alerts\":%u,\"monitor_heap_free\":%u,\"monitor_stack_free\":%u,"
+           "\"monitor_agrees\":%s,\"heap_free_after_setup\":%s,\"ns_per_sample\":%.0f}\n",
+           durationMs / 1000, (unsigned)run.faults, (unsigned)run.moves, (unsigned)run.commands,
+           (unsigned long long)(afterSetup.allocations - beforeSetup.allocations),
+           (long long)afterSetup.liveBytes - (long long)beforeSetup.liveBytes, setupStack,
+           (unsigned long long)loopAllocations, liveBlocksGrown, loopStack,
+           hostsim::TASK_STACK_BYTES, REINIT_RUNS, (unsigned)run.reinitOk, (unsigned long long)reinitAllocations,
+           (unsigned)memoryMonitor.getSampleCount(), (unsigned)memoryMonitor.getAlertCount(),
+           (unsigned)memoryMonitor.getLastSample().freeBytes, (unsigned)monitorStackFree,
+           monitorAgrees ? "true" : "false", heapFree ? "true" : "false", nsPerSample);
+    return (heapFree && monitorAgrees) ? 0 : 1;
+}
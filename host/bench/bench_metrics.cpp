@@ -0,0 +1,145 @@
+#include "benchmarks.h"
+#include "metrics.h"
+#include "metrics_decoder.h"
+#include <chrono>
+
+// =============================================
+// БЕНЧМАРК РЕЕСТРА МЕТРИК
+// Прошивка на эмуляторе шлет кадры-приращения MetricsRegistry с заданным
+// периодом (рука переставляет метки); хост разбирает поток и сам считает
+// скорости счетчиков, средние и квантили гистограмм. Проверка: сумма
+// приращений равна итоговым значениям. Цена для прошивки - байты кадра
+// и реальное время CPU на снимок
+// =============================================
+
+static const unsigned long HAND_PERIOD_MS = 5000;
+static const int SNAPSHOT_TIMING_RUNS = 20000;
+
+int runMetricsBench(int argc, char** argv) {
+    unsigned long durationMs = (argc > 0) ? (unsigned long)atol(argv[0]) * 1000UL : 120000UL;
+    unsigned long periodMs = (argc > 1) ? (unsigned long)atol(argv[1]) : 1000UL;
+
+    BenchEnvironment env;
+    env.attach();
+    placeReferenceTags(env.board);
+    rebootFirmware(env);
+    hostsim::eraseFlash();
+
+    MetricsDecoder decoder;
+    metrics.setOutput(&decoder);
+    metrics.setStreamInterval(periodMs);
+    setup();
+
+    // Рука: метка переезжает в случайную свободную ячейку рядов 3-5
+    uint64_t end = hostsim::nowMicros() + (uint64_t)durationMs * 1000ULL;
+    uint64_t nextMove = hostsim::nowMicros() + (uint64_t)HAND_PERIOD_MS * 1000ULL;
+    static const int handCells[] = {2, 12, 14, 24, 25, 26};
+    int tagCell[6];
+    memcpy(tagCell, handCells, sizeof(tagCell));
+    int moveIndex = 0;
+    while (hostsim::nowMicros() < end) {
+        loop();
+        if (hostsim::nowMicros() >= nextMove) {
+            int tag = moveIndex++ % 6;
+            int target;
+            do {
+                target = 36 + env.randomRange(0, 35);
+            } while (env.board.hasTag(target));
+            env.board.moveTag(tagCell[tag], target);
+            tagCell[tag] = target;
+            nextMove += (uint64_t)HAND_PERIOD_MS * 1000ULL;
+        }
+    }
+
+    // Последнее приращение и сразу итог - между ними прошивка не работает
+    metrics.sendSnapshot(true);
+    uint8_t buffer[1024];
+    size_t absoluteBytes = metrics.writeSnapshot(buffer, sizeof(buffer), false);
+    MetricsSnapshot absolute;
+    bool absoluteOk = decoder.decodeSnapshot(buffer, absoluteBytes, absolute);
+
+    // Цена снимка на CPU хоста
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < SNAPSHOT_TIMING_RUNS; i++) {
+        metrics.writeSnapshot(buffer, sizeof(buffer), false);
+    }
+    double nsPerSnapshot = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                               std::chrono::steady_clock::now() - start).count() / SNAPSHOT_TIMING_RUNS;
+    metrics.setOutput(&Serial);
+
+    const std::vector<MetricInfo>& schema = decoder.getSchema();
+    const std::vector<MetricsSnapshot>& snapshots = decoder.getSnapshots();
+    if (snapshots.empty() || !absoluteOk) {
+        printf("{\"bench\":\"metrics\",\"error\":\"нет снимков\",\"bad_frames\":%u,\"unknown_schema\":%u}\n",
+               (unsigned)decoder.getBadFrames(), (unsigned)decoder.getUnknownSchema());
+        return 1;
+    }
+
+    // Суммы приращений, максимум за интервал, сводные корзины
+    size_t count = schema.size();
+    std::vector<uint64_t> totals(count, 0);
+    std::vector<uint32_t> maxPerInterval(count, 0);
+    std::vector<std::vector<uint32_t> > bucketTotals(count);
+    bool consistent = true;
+    for (size_t m = 0; m < count; m++) {
+        bucketTotals[m].assign(schema[m].bounds.size() + (schema[m].type == METRIC_HISTOGRAM ? 1 : 0), 0);
+    }
+    for (size_t s = 0; s < snapshots.size(); s++) {
+        for (size_t m = 0; m < count; m++) {
+            uint32_t value = snapshots[s].values[m];
+            totals[m] += value;
+            maxPerInterval[m] = max(maxPerInterval[m], value);
+            for (size_t b = 0; b < snapshots[s].buckets[m].size(); b++) {
+                bucketTotals[m][b] += snapshots[s].buckets[m][b];
+            }
+        }
+    }
+    for (size_t m = 0; m < count; m++) {
+        if (schema[m].type != METRIC_GAUGE && totals[m] != absolute.values[m]) {
+            consistent = false;
+        }
+    }
+
+    double seconds = (snapshots.back().millis - snapshots.front().millis) / 1000.0 + periodMs / 1000.0;
+    size_t streamBytes = snapshots.size() * (metrics.getSnapshotBytes() + 9) + metrics.getSchemaBytes() + 9;
+    printf("{\"bench\":\"metrics\",\"seconds\":%lu,\"period_ms\":%lu,\"metrics\":%u,\"schema_bytes\":%u,"
+           "\"snapshot_bytes\":%u,\"snapshots\":%u,\"stream_bytes_per_s\":%.0f,\"ns_per_snapshot\":%.0f,"
+           "\"bad_frames\":%u,\"unknown_schema\":%u,\"deltas_consistent\":%s",
+           durationMs / 1000, periodMs, (unsigned)count, (unsigned)metrics.getSchemaBytes(),
+           (unsigned)metrics.getSnapshotBytes(), (unsigned)snapshots.size(), streamBytes / seconds, nsPerSnapshot,
+           (unsigned)decoder.getBadFrames(), (unsigned)decoder.getUnknownSchema(), consistent ? "true" : "false");
+
+    printf(",\"counters\":{");
+    bool first = true;
+    for (size_t m = 0; m < count; m++) {
+        if (schema[m].type != METRIC_COUNTER) continue;
+        printf("%s\"%s\":{\"total\":%llu,\"per_s\":%.2f,\"max_per_interval\":%u}", first ? "" : ",",
+               schema[m].name.c_str(), (unsigned long long)totals[m], totals[m] / seconds,
+               (unsigned)maxPerInterval[m]);
+        first = false;
+    }
+    printf("},\"gauges\":{");
+    first = true;
+    for (size_t m = 0; m < count; m++) {
+        if (schema[m].type != METRIC_GAUGE) continue;
+        printf("%s\"%s\":%d", first ? "" : ",", schema[m].name.c_str(), (int32_t)absolute.values[m]);
+        first = false;
+    }
+    printf("},\"histograms\":{");
+    first = true;
+    for (size_t m = 0; m < count; m++) {
+        if (schema[m].type != METRIC_HISTOGRAM) continue;
+        uint64_t observations = 0;
+        for (size_t b = 0; b < bucketTotals[m].size(); b++) {
+            observations += bucketTotals[m][b];
+        }
+        printf("%s\"%s\":{\"count\":%llu,\"mean\":%llu,\"p50_le\":%u,\"p95_le\":%u}", first ? "" : ",",
+               schema[m].name.c_str(), (unsigned long long)observations,
+               (unsigned long long)(observations ? totals[m] / observations : 0),
+               MetricsDecoder::bucketQuantile(schema[m], bucketTotals[m], 0.5),
+               MetricsDecoder::bucketQuantile(schema[m], bucketTotals[m], 0.95));
+        first = false;
+    }
+    printf("}}\n");
+    return 0;
+}
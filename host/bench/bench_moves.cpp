@@ -0,0 +1,262 @@
+#include "benchmarks.h"
+#include "scan_matrix.h"
+#include "chess_workload.h"
+#include <vector>
+#include <string>
+#include <algorithm>
+
+// =============================================
+// БЕНЧМАРК РАСПОЗНАВАНИЯ ХОДОВ
+// Записанные партии (UCI) разыгрываются руками на эмулируемой доске: 32 метки
+// на столбцах 2..9, битые фигуры уходят в лотки (столбцы 0-1 и 10-11), там же
+// запасные ферзи. Порядок действий случайный: взятая фигура до или после хода,
+// ладья до или после короля, пешка на проходе до или после, превращение той же
+// меткой или ферзем из лотка, касания фигур (снята и поставлена обратно).
+// Сравнивается поток ходов прошивки с записью; задержка - от установки
+// сходившей фигуры на эмуляторе до выдачи хода, с разбивкой на ожидание
+// прохода (до первого чтения) и распознаватель (от чтения до хода).
+// Граница: последнее действие хода видно за самый долгий проход, задержанный
+// ход - еще через MOVE_HOLD_MS; выход за нее - ошибка бенчмарка
+// =============================================
+
+extern ScanMatrix scanMatrix;
+
+struct RecordedGame {
+    const char* name;
+    const char* moves;
+};
+
+static const RecordedGame GAMES[] = {
+    // Морфи - герцог Брауншвейгский и граф Изуар, Париж 1858 (длинная рокировка)
+    {"opera", "e2e4 e7e5 g1f3 d7d6 d2d4 c8g4 d4e5 g4f3 d1f3 d6e5 f1c4 g8f6 f3b3 d8e7 b1c3 c7c6 "
+              "c1g5 b7b5 c3b5 c6b5 c4b5 b8d7 e1c1 a8d8 d1d7 d8d7 h1d1 e7e6 b5d7 f6d7 b3b8 d7b8 d1d8"},
+    // Короткие рокировки и взятия на проходе обеими сторонами
+    {"passant", "e2e4 a7a6 e4e5 f7f5 e5f6 g8f6 g1f3 e7e6 f1e2 f8e7 e1g1 e8g8 d2d4 c7c5 c1g5 c5c4 "
+                "b2b4 c4b3 a2b3 d7d5 b1d2 b8c6 c2c4 d5c4 b3c4 d8d6 d1b3 c6d4 f3d4 d6d4 g5f6 e7f6 "
+                "a1d1 d4b6 b3b6"},
+    // Превращения со взятием у обеих сторон, размен ферзей
+    {"promotion", "a2a4 h7h5 a4a5 h5h4 a5a6 h4h3 a6b7 h3g2 b7a8q g2h1q a8b8 h1g1 b8c8 g1f1 e1f1 d8c8"},
+};
+static const int GAME_COUNT = sizeof(GAMES) / sizeof(GAMES[0]);
+
+static const unsigned long START_LIMIT_MS = 300000;
+static const unsigned long DRAIN_LIMIT_MS = 180000;
+
+struct MoveProbe {
+    std::vector<std::string> emitted;
+    std::vector<uint64_t> emittedUs;
+    std::vector<uint64_t> readUs;       // Первое чтение последнего изменения доски
+    unsigned long cycleStart;
+    unsigned long longestPassMs;
+};
+
+static MoveProbe probe;
+
+static void onChessEvent(const ChessEvent& event, void* context) {
+    MoveProbe* p = (MoveProbe*)context;
+    if (event.ply == 0) {
+        return;     // Снятия/установки
+    }
+    p->emitted.push_back(event.uci);
+    p->emittedUs.push_back(hostsim::nowMicros());
+    p->readUs.push_back(hostsim::getPowerOnMicros() + (uint64_t)event.physicalTime * 1000ULL);
+}
+
+// Самый долгий полный проход: проверяется после каждого loop() и действия руки
+static void notePass() {
+    if (scanMatrix.getCycleStartTime() != probe.cycleStart) {
+        probe.cycleStart = scanMatrix.getCycleStartTime();
+        probe.longestPassMs = std::max(probe.longestPassMs, scanMatrix.getLastCycleTime());
+    }
+}
+
+static void onHandOp(int, bool, const uint8_t*, void*) {
+    notePass();
+}
+
+static void runTracked(unsigned long durationMs) {
+    uint64_t end = hostsim::nowMicros() + (uint64_t)durationMs * 1000ULL;
+    while (hostsim::nowMicros() < end) {
+        loop();
+        notePass();
+    }
+}
+
+static double percentileMs(std::vector<uint64_t> values, double pct) {
+    if (values.empty()) return 0.0;
+    std::sort(values.begin(), values.end());
+    size_t index = (size_t)(pct / 100.0 * (values.size() - 1) + 0.5);
+    return values[index] / 1000.0;
+}
+
+static void printLatency(const char* name, const std::vector<uint64_t>& values) {
+    printf(",\"%s\":{\"p50_ms\":%.1f,\"p95_ms\":%.1f,\"p99_ms\":%.1f,\"max_ms\":%.1f}", name,
+           percentileMs(values, 50), percentileMs(values, 95), percentileMs(values, 99), percentileMs(values, 100));
+}
+
+struct MoveLatencies {
+    std::vector<uint64_t> placeToMove;
+    std::vector<uint64_t> placeToRead;
+    std::vector<uint64_t> readToMove;
+    std::vector<int64_t> afterLastOp;   // От последнего действия хода (захват в лоток бывает позже)
+};
+
+struct GameResult {
+    int plies;
+    int correct;
+    int wrong;
+    int missed;
+    int extra;
+    bool started;
+};
+
+static void runGame(BenchEnvironment& env, const RecordedGame& game, unsigned long thinkMinMs,
+                    unsigned long thinkMaxMs, MoveLatencies& latencies, GameResult& r) {
+    PlayedBoard played;
+    setUpChessBoard(env, played);
+
+    rebootFirmware(env);
+    hostsim::eraseFlash();
+    setup();
+    MoveRecognizer& recognizer = scanMatrix.getMoveRecognizer();
+    probe.emitted.clear();
+    probe.emittedUs.clear();
+    probe.readUs.clear();
+    probe.cycleStart = scanMatrix.getCycleStartTime();
+    recognizer.setCallback(onChessEvent, &probe);
+
+    // Партия начинается сама, когда проход увидит начальную расстановку
+    unsigned long start = millis();
+    while (!recognizer.isActive() && millis() - start < START_LIMIT_MS) {
+        loop();
+    }
+    memset(&r, 0, sizeof(r));
+    r.started = recognizer.isActive();
+
+    std::vector<std::string> expected;
+    std::vector<uint64_t> decisiveUs;
+    std::vector<uint64_t> lastOpUs;
+    Hand hand = {env, played, 200, 1200, 20, onHandOp, nullptr};
+    std::string moves = game.moves;
+    size_t pos = 0;
+    while (r.started && pos < moves.size()) {
+        size_t end = moves.find(' ', pos);
+        if (end == std::string::npos) end = moves.size();
+        std::string uci = moves.substr(pos, end - pos);
+        pos = end + 1;
+
+        runTracked(env.randomRange(thinkMinMs, thinkMaxMs));
+        uint64_t placedUs = playChessMove(hand, uci.c_str(), expected.size() % 2 == 0);
+        if (placedUs == 0) {
+            break;      // Запись не сходится с доской - ошибка в партии
+        }
+        expected.push_back(uci);
+        decisiveUs.push_back(placedUs);
+        lastOpUs.push_back(hostsim::nowMicros());
+    }
+
+    // Досканирование последнего хода
+    start = millis();
+    while (probe.emitted.size() < expected.size() && millis() - start < DRAIN_LIMIT_MS) {
+        loop();
+        notePass();
+    }
+    runTracked(5000);
+
+    // Сопоставление с записью: пропущенный ход не сдвигает оценку остальных
+    r.plies = expected.size();
+    size_t i = 0, j = 0;
+    while (i < expected.size() && j < probe.emitted.size()) {
+        if (probe.emitted[j] == expected[i]) {
+            r.correct++;
+            // Первое чтение - в мс прошивки: не раньше установки и не позже хода
+            uint64_t readUs = std::min(std::max(probe.readUs[j], decisiveUs[i]), probe.emittedUs[j]);
+            latencies.placeToMove.push_back(probe.emittedUs[j] - decisiveUs[i]);
+            latencies.placeToRead.push_back(readUs - decisiveUs[i]);
+            latencies.readToMove.push_back(probe.emittedUs[j] - readUs);
+            latencies.afterLastOp.push_back((int64_t)probe.emittedUs[j] - (int64_t)lastOpUs[i]);
+            i++;
+            j++;
+        } else if (i + 1 < expected.size() && probe.emitted[j] == expected[i + 1]) {
+            r.missed++;
+            i++;
+        } else if (j + 1 < probe.emitted.size() && probe.emitted[j + 1] == expected[i]) {
+            r.extra++;
+            j++;
+        } else {
+            r.wrong++;
+            i++;
+            j++;
+        }
+    }
+    r.missed += expected.size() - i;
+    r.extra += probe.emitted.size() - j;
+    recognizer.setCallback(nullptr, nullptr);
+}
+
+int runMovesBench(int argc, char** argv) {
+    unsigned long thinkMinMs = (argc > 0) ? (unsigned long)atol(argv[0]) * 1000UL : 40000UL;
+    unsigned long thinkMaxMs = (argc > 1) ? (unsigned long)atol(argv[1]) * 1000UL : 90000UL;
+    int rounds = (argc > 2) ? atoi(argv[2]) : 2;
+
+    BenchEnvironment env;
+    env.attach();
+
+    MoveLatencies latencies;
+    probe.longestPassMs = 0;
+    int plies = 0, correct = 0, wrong = 0, missed = 0, extra = 0;
+    uint32_t outOfOrder = 0, held = 0, inferred = 0, followUps = 0, castling = 0, enPassant = 0, promotions = 0, captures = 0;
+
+    printf("{\"bench\":\"moves\",\"think_s\":[%lu,%lu],\"rounds\":%d,\"games\":[", thinkMinMs / 1000,
+           thinkMaxMs / 1000, rounds);
+    for (int round = 0; round < rounds; round++) {
+        for (int g = 0; g < GAME_COUNT; g++) {
+            GameResult r;
+            runGame(env, GAMES[g], thinkMinMs, thinkMaxMs, latencies, r);
+            const MoveRecognizer& recognizer = scanMatrix.getMoveRecognizer();
+
+            printf("%s{\"game\":\"%s\",\"started\":%s,\"plies\":%d,\"correct\":%d,\"wrong\":%d,"
+                   "\"missed\":%d,\"extra\":%d}",
+                   (round || g) ? "," : "", GAMES[g].name, r.started ? "true" : "false", r.plies, r.correct,
+                   r.wrong, r.missed, r.extra);
+
+            plies += r.plies;
+            correct += r.correct;
+            wrong += r.wrong;
+            missed += r.missed;
+            extra += r.extra;
+            outOfOrder += recognizer.getOutOfOrder();
+            held += recognizer.getHeldMoves();
+            inferred += recognizer.getInferredMoves();
+            followUps += recognizer.getFollowUps();
+            castling += recognizer.getEventCount(CHESS_EVENT_CASTLING);
+            enPassant += recognizer.getEventCount(CHESS_EVENT_EN_PASSANT);
+            promotions += recognizer.getEventCount(CHESS_EVENT_PROMOTION);
+            captures += recognizer.getEventCount(CHESS_EVENT_CAPTURE);
+        }
+    }
+
+    // Граница задержки: самый долгий проход плюс ожидание задержанного хода
+    uint64_t boundUs = ((uint64_t)probe.longestPassMs + MOVE_HOLD_MS) * 1000ULL;
+    int overBound = 0;
+    int64_t worstUs = 0;
+    for (size_t k = 0; k < latencies.afterLastOp.size(); k++) {
+        worstUs = std::max(worstUs, latencies.afterLastOp[k]);
+        if (latencies.afterLastOp[k] > (int64_t)boundUs) {
+            overBound++;
+        }
+    }
+
+    printf("],\"plies\":%d,\"correct\":%d,\"wrong\":%d,\"missed\":%d,\"extra\":%d", plies, correct, wrong,
+           missed, extra);
+    printLatency("place_to_move", latencies.placeToMove);
+    printLatency("place_to_read", latencies.placeToRead);
+    printLatency("read_to_move", latencies.readToMove);
+    printf(",\"longest_pass_ms\":%lu,\"bound_ms\":%llu,\"worst_after_last_op_ms\":%.1f,\"over_bound\":%d",
+           probe.longestPassMs, (unsigned long long)(boundUs / 1000), worstUs / 1000.0, overBound);
+    printf(",\"recognizer\":{\"out_of_order\":%u,\"held\":%u,\"inferred\":%u,\"follow_ups\":%u,\"captures\":%u,"
+           "\"castling\":%u,\"en_passant\":%u,\"promotions\":%u}}\n",
+           (unsigned)outOfOrder, (unsigned)held, (unsigned)inferred, (unsigned)followUps, (unsigned)captures,
+           (unsigned)castling, (unsigned)enPassant, (unsigned)promotions);
+    return (overBound == 0 && !latencies.placeToMove.empty()) ? 0 : 1;
+}
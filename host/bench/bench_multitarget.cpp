@@ -0,0 +1,121 @@
+#include "benchmarks.h"
+#include "scan_matrix.h"
+
+// =============================================
+// БЕНЧМАРК ДВУХ МЕТОК В ПОЛЕ АНТЕННЫ
+// Мерцание [2,1]/[2,2] из лога: метка соседней ячейки отвечает на чужую
+// антенну, и при MaxTg=1 антиколлизия выбирает то свою, то чужую.
+// Доска неподвижна - любое событие после первого прохода ложное.
+// Сравниваем MaxTg=1, MaxTg=2 на ячейках с UID соседа и MaxTg=2 везде
+// =============================================
+
+extern ScanMatrix scanMatrix;
+
+// [2,0] -> [2,1], [2,1] -> [2,2]
+static const int BLEED_CELLS[][2] = {{25, 24}, {26, 25}};
+static const int BLEED_COUNT = 2;
+
+struct ModeResult {
+    uint32_t cycles;
+    unsigned long meanCycleMs;
+    uint32_t events;            // Добавления/удаления/замены карт за замер
+    uint32_t flicker;
+    uint32_t multiTargetReads;
+    uint32_t ownerByNeighbour;
+    uint32_t ownerAmbiguous;
+    int multiTargetCells;
+    bool matchesBoard;
+};
+
+static uint32_t totalEvents() {
+    return scanMatrix.getCardsDetected() + scanMatrix.getCardsRemoved() + scanMatrix.getCardChanges();
+}
+
+static void waitCycleStart() {
+    unsigned long cycleStart = scanMatrix.getCycleStartTime();
+    while (scanMatrix.getCycleStartTime() == cycleStart) {
+        loop();
+    }
+}
+
+static bool cacheMatchesBoard(BenchEnvironment& env) {
+    for (int i = 0; i < MATRIX_TOTAL_CELLS; i++) {
+        const CardInfo& info = scanMatrix.getCardInfo(i);
+        const EmulatedTag& tag = env.board.tagAt(i);
+        if (info.present != tag.present) return false;
+        if (info.present && (info.uidLength != tag.uidLength ||
+                             memcmp(info.uid, tag.uid, tag.uidLength) != 0)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static ModeResult runMode(BenchEnvironment& env, MultiTargetMode mode, uint32_t cycles) {
+    ModeResult r;
+    memset(&r, 0, sizeof(r));
+
+    rebootFirmware(env);
+    hostsim::eraseFlash();
+    setup();
+    scanMatrix.setMultiTargetMode(mode);
+
+    // Первый проход наполняет кэш
+    waitCycleStart();
+    waitCycleStart();
+
+    uint32_t eventsBefore = totalEvents();
+    uint32_t flickerBefore = scanMatrix.getFlickerEvents();
+    uint32_t readsBefore = scanMatrix.getMultiTargetReads();
+    uint32_t ownerBefore = scanMatrix.getOwnerByNeighbour();
+    uint32_t ambiguousBefore = scanMatrix.getOwnerAmbiguous();
+    unsigned long totalMs = 0;
+
+    while (r.cycles < cycles) {
+        waitCycleStart();
+        totalMs += scanMatrix.getLastCycleTime();
+        r.cycles++;
+    }
+
+    r.meanCycleMs = totalMs / r.cycles;
+    r.events = totalEvents() - eventsBefore;
+    r.flicker = scanMatrix.getFlickerEvents() - flickerBefore;
+    r.multiTargetReads = scanMatrix.getMultiTargetReads() - readsBefore;
+    r.ownerByNeighbour = scanMatrix.getOwnerByNeighbour() - ownerBefore;
+    r.ownerAmbiguous = scanMatrix.getOwnerAmbiguous() - ambiguousBefore;
+    r.multiTargetCells = scanMatrix.getMultiTargetCellCount();
+    r.matchesBoard = cacheMatchesBoard(env);
+    return r;
+}
+
+int runMultiTargetBench(int argc, char** argv) {
+    uint32_t cycles = (argc > 0) ? (uint32_t)atol(argv[0]) : 20;
+    uint8_t bleedPercent = (argc > 1) ? (uint8_t)atoi(argv[1]) : 50;
+
+    BenchEnvironment env;
+    env.attach();
+    placeReferenceTags(env.board);
+    for (int i = 0; i < BLEED_COUNT; i++) {
+        env.board.setCellBleed(BLEED_CELLS[i][0], BLEED_CELLS[i][1], bleedPercent);
+    }
+
+    const MultiTargetMode modes[] = {MULTI_TARGET_OFF, MULTI_TARGET_ADAPTIVE, MULTI_TARGET_ALWAYS};
+    const char* names[] = {"off", "adaptive", "always"};
+
+    printf("{\"bench\":\"multitarget\",\"cycles\":%u,\"bleed_percent\":%u,\"modes\":[",
+           (unsigned)cycles, (unsigned)bleedPercent);
+    for (int m = 0; m < 3; m++) {
+        ModeResult r = runMode(env, modes[m], cycles);
+        // Мерцаний в минуту сканирования
+        double minutes = (double)r.meanCycleMs * r.cycles / 60000.0;
+        printf("%s{\"mode\":\"%s\",\"mean_cycle_ms\":%lu,\"events\":%u,\"flicker\":%u,"
+               "\"flicker_per_min\":%.2f,\"two_target_reads\":%u,\"owner_by_neighbour\":%u,"
+               "\"owner_ambiguous\":%u,\"maxtg2_cells\":%d,\"matches_board\":%s}",
+               m ? "," : "", names[m], r.meanCycleMs, (unsigned)r.events, (unsigned)r.flicker,
+               minutes > 0 ? r.flicker / minutes : 0.0, (unsigned)r.multiTargetReads,
+               (unsigned)r.ownerByNeighbour, (unsigned)r.ownerAmbiguous, r.multiTargetCells,
+               r.matchesBoard ? "true" : "false");
+    }
+    printf("]}\n");
+    return 0;
+}
@@ -0,0 +1,325 @@
+#include "benchmarks.h"
+#include "scan_matrix.h"
+#include "chess_workload.h"
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+// =============================================
+// БЕНЧМАРК СКАНЕРА НА ШАХМАТНОЙ НАГРУЗКЕ
+// Партии из PGN разыгрываются рукой (chess_workload): всплески снятий и
+// установок на нескольких полях, битые фигуры в лотки, долгие раздумья (по
+// часам [%clk] или случайные). Каждое подтвержденное событие карты сопоставляется
+// с физическим действием на той же ячейке:
+//   - задержка действия - от действия до события;
+//   - промежуточные состояния, которые проход не застал (касание, снятие перед
+//     заменой) - не пропуск, считаются отдельно;
+//   - событие без действия - фантом; ячейка, расходящаяся с доской в конце, - пропуск.
+// Задержка хода - от последнего действия до совпадения кэша на всех его ячейках;
+// ход, ячейки которого тронул следующий ход раньше, - "обогнан".
+// Задержки определяет стоянка на занятой ячейке (CARD_DWELL_MS на каждую
+// фигуру за проход): в отчете ее доля в полном проходе и проход без нее
+// =============================================
+
+extern ScanMatrix scanMatrix;
+
+static const char BUILTIN_PGN[] = R"PGN(
+[Event "Paris"]
+[White "Morphy"]
+[Black "Duke Karl / Count Isouard"]
+[Result "1-0"]
+
+1. e4 e5 2. Nf3 d6 3. d4 Bg4 4. dxe5 Bxf3 5. Qxf3 dxe5 6. Bc4 Nf6 7. Qb3 Qe7
+8. Nc3 c6 9. Bg5 b5 10. Nxb5! cxb5 11. Bxb5+ Nbd7 12. O-O-O $1 Rd8
+13. Rxd7! (13. Bxd7+ Rxd7) Rxd7 14. Rd1 Qe6 15. Bxd7+ Nxd7 16. Qb8+ Nxb8 17. Rd8# 1-0
+
+[Event "En passant"]
+[White "White"]
+[Black "Black"]
+[Result "*"]
+
+1. e4 a6 2. e5 f5 3. exf6 Nxf6 4. Nf3 e6 5. Be2 Be7 6. O-O O-O 7. d4 c5 8. Bg5 c4
+9. b4 cxb3 10. axb3 d5 11. Nbd2 Nc6 12. c4 dxc4 13. bxc4 Qd6 14. Qb3 Nxd4
+15. Nxd4 Qxd4 16. Bxf6 Bxf6 17. Rad1 Qb6 18. Qxb6 *
+
+[Event "Promotion race"]
+[White "White"]
+[Black "Black"]
+[Result "0-1"]
+
+1. a4 {[%clk 0:05:00]} h5 {[%clk 0:05:00]} 2. a5 {[%clk 0:04:52]} h4 {[%clk 0:04:55]}
+3. a6 {[%clk 0:04:41]} h3 {[%clk 0:04:49]} 4. axb7 {[%clk 0:04:20]} hxg2 {[%clk 0:04:37]}
+5. bxa8=Q {[%clk 0:04:14]} gxh1=Q {[%clk 0:04:30]} 6. Qxb8 {[%clk 0:03:58]} Qxg1 {[%clk 0:04:21]}
+7. Qxc8 {[%clk 0:03:40]} Qxf1+ {[%clk 0:04:02]} 8. Kxf1 {[%clk 0:03:37]} Qxc8 {[%clk 0:03:59]} 0-1
+)PGN";
+
+static const unsigned long START_LIMIT_MS = 300000;
+static const unsigned long DRAIN_LIMIT_MS = 180000;
+
+struct CellOp {
+    bool present;
+    uint8_t uid[7];
+    uint64_t us;
+};
+
+struct PendingMove {
+    std::vector<int> cells;
+    uint64_t lastOpUs;
+    bool done;                  // Все действия хода выполнены
+};
+
+struct WorkloadTracker {
+    std::vector<CellOp> ops[MATRIX_TOTAL_CELLS];
+    size_t cursor[MATRIX_TOTAL_CELLS];
+    std::vector<PendingMove> pending;
+    BenchEnvironment* env;
+
+    std::vector<uint64_t> opLatencies;
+    std::vector<uint64_t> moveLatencies;
+    std::vector<unsigned long> refreshMs;
+    std::vector<unsigned long> dwellMs;     // Стоянка на занятых ячейках за проход
+    uint32_t totalOps;
+    uint32_t transientUnseen;
+    uint32_t phantom;
+    uint32_t overtaken;
+};
+
+static WorkloadTracker tracker;
+
+static bool cellMatchesBoard(BenchEnvironment& env, int cell) {
+    const CardInfo& info = scanMatrix.getCardInfo(cell);
+    if (!env.board.hasTag(cell)) {
+        return !info.present;
+    }
+    const EmulatedTag& tag = env.board.tagAt(cell);
+    return info.present && info.uidLength == tag.uidLength && memcmp(info.uid, tag.uid, tag.uidLength) == 0;
+}
+
+// Ходы, все ячейки которых кэш уже видит как на доске
+static void completeMoves() {
+    for (size_t i = 0; i < tracker.pending.size();) {
+        PendingMove& move = tracker.pending[i];
+        bool seen = move.done;
+        for (size_t c = 0; c < move.cells.size() && seen; c++) {
+            seen = cellMatchesBoard(*tracker.env, move.cells[c]);
+        }
+        if (seen) {
+            tracker.moveLatencies.push_back(hostsim::nowMicros() - move.lastOpUs);
+            tracker.pending.erase(tracker.pending.begin() + i);
+        } else {
+            i++;
+        }
+    }
+}
+
+static void onHandOp(int cellIndex, bool present, const uint8_t* uid, void*) {
+    CellOp op;
+    op.present = present;
+    memset(op.uid, 0, sizeof(op.uid));
+    if (present) {
+        memcpy(op.uid, uid, sizeof(op.uid));
+    }
+    op.us = hostsim::nowMicros();
+    tracker.ops[cellIndex].push_back(op);
+    tracker.totalOps++;
+
+    // Ход, чью ячейку трогают до того, как проход ее увидел, - обогнан.
+    // Текущий (последний) ход берется после удаления: erase сдвигает вектор
+    for (size_t i = 0; i + 1 < tracker.pending.size();) {
+        std::vector<int>& cells = tracker.pending[i].cells;
+        if (std::find(cells.begin(), cells.end(), cellIndex) != cells.end()) {
+            tracker.overtaken++;
+            tracker.pending.erase(tracker.pending.begin() + i);
+        } else {
+            i++;
+        }
+    }
+    PendingMove& current = tracker.pending.back();
+    if (std::find(current.cells.begin(), current.cells.end(), cellIndex) == current.cells.end()) {
+        current.cells.push_back(cellIndex);
+    }
+}
+
+static void onCardEvent(const CardEvent& event, void*) {
+    if (event.tier != CARD_EVENT_CONFIRMED) {
+        return;
+    }
+    int cell = event.cellIndex;
+    bool present = event.kind != CARD_EVENT_REMOVED;
+    std::vector<CellOp>& ops = tracker.ops[cell];
+
+    for (size_t k = tracker.cursor[cell]; k < ops.size(); k++) {
+        if (ops[k].present == present && (!present || memcmp(ops[k].uid, event.uid, 7) == 0)) {
+            tracker.opLatencies.push_back(hostsim::nowMicros() - ops[k].us);
+            tracker.transientUnseen += k - tracker.cursor[cell];
+            tracker.cursor[cell] = k + 1;
+            completeMoves();
+            return;
+        }
+    }
+    tracker.phantom++;
+}
+
+// loop() с замером времени полного прохода
+static void runTracked(unsigned long durationMs) {
+    uint64_t end = hostsim::nowMicros() + (uint64_t)durationMs * 1000ULL;
+    unsigned long cycleStart = scanMatrix.getCycleStartTime();
+    while (hostsim::nowMicros() < end) {
+        loop();
+        if (scanMatrix.getCycleStartTime() != cycleStart) {
+            cycleStart = scanMatrix.getCycleStartTime();
+            tracker.refreshMs.push_back(scanMatrix.getLastCycleTime());
+            tracker.dwellMs.push_back((unsigned long)scanMatrix.findCardsInMatrix() * CARD_DWELL_MS);
+        }
+    }
+}
+
+static double percentileMs(std::vector<uint64_t> values, double pct) {
+    if (values.empty()) return 0.0;
+    std::sort(values.begin(), values.end());
+    size_t index = (size_t)(pct / 100.0 * (values.size() - 1) + 0.5);
+    return values[index] / 1000.0;
+}
+
+static void printLatency(const char* name, const std::vector<uint64_t>& values) {
+    printf(",\"%s\":{\"p50_ms\":%.1f,\"p95_ms\":%.1f,\"p99_ms\":%.1f}", name, percentileMs(values, 50),
+           percentileMs(values, 95), percentileMs(values, 99));
+}
+
+struct PgnGameResult {
+    int plies;
+    int missed;
+    int undetected;
+    bool started;
+    unsigned long idleMs;
+};
+
+static void runGame(BenchEnvironment& env, const WorkloadGame& game, unsigned long maxThinkMs, PgnGameResult& r) {
+    memset(&r, 0, sizeof(r));
+    PlayedBoard played;
+    setUpChessBoard(env, played);
+
+    rebootFirmware(env);
+    hostsim::eraseFlash();
+    setup();
+
+    unsigned long start = millis();
+    while (!scanMatrix.isBoardValid() && millis() - start < START_LIMIT_MS) {
+        loop();
+    }
+    r.started = scanMatrix.isBoardValid();
+    if (!r.started) {
+        return;
+    }
+
+    for (int cell = 0; cell < MATRIX_TOTAL_CELLS; cell++) {
+        tracker.ops[cell].clear();
+        tracker.cursor[cell] = 0;
+    }
+    tracker.pending.clear();
+    CardEventTracker& events = scanMatrix.getCardEvents();
+    events.setCallback(onCardEvent, &tracker);
+
+    Hand hand = {env, played, 200, 1200, 15, onHandOp, &tracker};
+    for (size_t ply = 0; ply < game.moves.size(); ply++) {
+        unsigned long think = thinkTimeMs(env, game, ply, maxThinkMs);
+        r.idleMs += think;
+        runTracked(think);
+
+        tracker.pending.push_back(PendingMove());
+        tracker.pending.back().done = false;
+        if (playChessMove(hand, game.moves[ply].uci.c_str(), ply % 2 == 0) == 0) {
+            tracker.pending.pop_back();
+            break;
+        }
+        tracker.pending.back().done = true;
+        tracker.pending.back().lastOpUs = hostsim::nowMicros();
+        r.plies++;
+    }
+
+    // Досканирование: пока кэш не догонит доску
+    start = millis();
+    while (!tracker.pending.empty() && millis() - start < DRAIN_LIMIT_MS) {
+        runTracked(100);
+    }
+    r.undetected = tracker.pending.size();
+    for (int cell = 0; cell < MATRIX_TOTAL_CELLS; cell++) {
+        if (!cellMatchesBoard(env, cell)) {
+            r.missed++;
+        }
+    }
+    events.setCallback(nullptr, nullptr);
+}
+
+int runPgnBench(int argc, char** argv) {
+    const char* path = (argc > 0 && strcmp(argv[0], "-") != 0) ? argv[0] : nullptr;
+    int maxGames = (argc > 1) ? atoi(argv[1]) : 0;
+    unsigned long maxThinkMs = (argc > 2) ? (unsigned long)atol(argv[2]) * 1000UL : 300000UL;
+
+    std::string text = BUILTIN_PGN;
+    if (path != nullptr) {
+        std::ifstream file(path);
+        if (!file) {
+            printf("{\"bench\":\"pgn\",\"error\":\"не удалось открыть %s\"}\n", path);
+            return 1;
+        }
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        text = buffer.str();
+    }
+
+    std::vector<WorkloadGame> games;
+    std::string parseError;
+    parsePgn(text, games, &parseError);
+    if (maxGames > 0 && (int)games.size() > maxGames) {
+        games.resize(maxGames);
+    }
+
+    BenchEnvironment env;
+    env.attach();
+    memset(&tracker.totalOps, 0, sizeof(uint32_t) * 4);
+    tracker.env = &env;
+
+    int plies = 0, missed = 0, undetected = 0;
+    unsigned long idleMs = 0;
+
+    printf("{\"bench\":\"pgn\",\"source\":\"%s\",\"parse_error\":\"%s\",\"max_think_s\":%lu,\"games\":[",
+           path ? path : "builtin", parseError.c_str(), maxThinkMs / 1000);
+    for (size_t g = 0; g < games.size(); g++) {
+        PgnGameResult r;
+        runGame(env, games[g], maxThinkMs, r);
+        printf("%s{\"index\":%zu,\"game\":\"%s\",\"started\":%s,\"plies\":%d,\"idle_s\":%lu,\"undetected_moves\":%d,"
+               "\"missed_cells\":%d}",
+               g ? "," : "", g, games[g].name.c_str(), r.started ? "true" : "false", r.plies, r.idleMs / 1000,
+               r.undetected, r.missed);
+        plies += r.plies;
+        missed += r.missed;
+        undetected += r.undetected;
+        idleMs += r.idleMs;
+    }
+
+    std::vector<uint64_t> refresh(tracker.refreshMs.begin(), tracker.refreshMs.end());
+    std::vector<uint64_t> refreshNoDwell(refresh.size());
+    uint64_t refreshTotalMs = 0, dwellTotalMs = 0;
+    for (size_t i = 0; i < refresh.size(); i++) {
+        unsigned long dwell = min(tracker.dwellMs[i], tracker.refreshMs[i]);
+        refreshTotalMs += refresh[i];
+        dwellTotalMs += dwell;
+        refreshNoDwell[i] = (refresh[i] - dwell) * 1000;
+        refresh[i] *= 1000;     // percentileMs ожидает мкс
+    }
+    printf("],\"plies\":%d,\"ops\":%u,\"idle_s\":%lu", plies, (unsigned)tracker.totalOps, idleMs / 1000);
+    printLatency("op_detect", tracker.opLatencies);
+    printLatency("move_detect", tracker.moveLatencies);
+    printf(",\"moves_overtaken\":%u,\"undetected_moves\":%d,\"transient_unseen\":%u,\"phantom\":%u,"
+           "\"missed_cells\":%d",
+           (unsigned)tracker.overtaken, undetected, (unsigned)tracker.transientUnseen, (unsigned)tracker.phantom,
+           missed);
+    printLatency("full_refresh", refresh);
+    printLatency("full_refresh_without_dwell", refreshNoDwell);
+    printf(",\"card_dwell_ms\":%d,\"dwell_share_of_refresh\":%.2f}\n", CARD_DWELL_MS,
+           refreshTotalMs ? (double)dwellTotalMs / refreshTotalMs : 0.0);
+    return 0;
+}
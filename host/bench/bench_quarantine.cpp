@@ -0,0 +1,123 @@
+#include "benchmarks.h"
+#include "rfid_manager.h"
+#include "scan_matrix.h"
+
+// =============================================
+// БЕНЧМАРК КАРАНТИНА НЕИСПРАВНОЙ ЯЧЕЙКИ
+// Антенна [3,4] с КЗ: InListPassiveTarget на ней теряется без ACK - таймаут
+// транзакции, повтор, проба живости и строка ошибки на каждом проходе.
+// Сравниваем исправную доску, неисправную ячейку без карантина и с карантином;
+// затем КЗ устраняется - время до возврата ячейки в проход
+// =============================================
+
+extern ScanMatrix scanMatrix;
+extern RFIDManager rfidManager;
+
+static const int BAD_CELL = 40;
+static const unsigned long REINSTATE_LIMIT_MS = 120000;
+
+struct QuarantineModeResult {
+    uint32_t cycles;
+    unsigned long meanCycleMs;
+    unsigned long maxCycleMs;
+    uint32_t cellErrors;
+    uint32_t livenessProbes;
+    uint32_t backgroundProbes;
+    int quarantined;
+    bool matchesBoard;
+    long reinstateMs;       // -1 = не вернулась (или не была в карантине)
+};
+
+static void waitCycleStart() {
+    unsigned long cycleStart = scanMatrix.getCycleStartTime();
+    while (scanMatrix.getCycleStartTime() == cycleStart) {
+        loop();
+    }
+}
+
+static bool cacheMatchesBoard(BenchEnvironment& env) {
+    for (int i = 0; i < MATRIX_TOTAL_CELLS; i++) {
+        if (scanMatrix.getCardInfo(i).present != env.board.tagAt(i).present) return false;
+    }
+    return true;
+}
+
+static QuarantineModeResult runMode(BenchEnvironment& env, bool fault, bool quarantineOn,
+                                    unsigned long learnMs, uint32_t cycles) {
+    QuarantineModeResult r;
+    memset(&r, 0, sizeof(r));
+    r.reinstateMs = -1;
+
+    env.board.setCellShorted(BAD_CELL, fault);
+    rebootFirmware(env);
+    hostsim::eraseFlash();
+    setup();
+    CellQuarantine& quarantine = scanMatrix.getQuarantine();
+    quarantine.setEnabled(quarantineOn);
+
+    // Обучение таймингов; неисправная ячейка успевает набрать ошибки
+    env.runFor(learnMs);
+    waitCycleStart();
+
+    uint32_t errorsBefore = quarantine.getTotalFailures();
+    uint32_t livenessBefore = rfidManager.getLivenessProbes();
+    uint32_t probesBefore = quarantine.getProbes();
+    unsigned long totalMs = 0;
+
+    while (r.cycles < cycles) {
+        waitCycleStart();
+        unsigned long cycleMs = scanMatrix.getLastCycleTime();
+        totalMs += cycleMs;
+        if (cycleMs > r.maxCycleMs) r.maxCycleMs = cycleMs;
+        r.cycles++;
+    }
+
+    r.meanCycleMs = totalMs / r.cycles;
+    r.cellErrors = quarantine.getTotalFailures() - errorsBefore;
+    r.livenessProbes = rfidManager.getLivenessProbes() - livenessBefore;
+    r.backgroundProbes = quarantine.getProbes() - probesBefore;
+    r.quarantined = quarantine.getQuarantinedCount();
+    r.matchesBoard = cacheMatchesBoard(env);
+
+    // Антенну починили: ячейку должна вернуть фоновая проверка
+    if (fault && quarantine.isQuarantined(BAD_CELL)) {
+        env.board.setCellShorted(BAD_CELL, false);
+        unsigned long start = millis();
+        while (quarantine.isQuarantined(BAD_CELL) && millis() - start < REINSTATE_LIMIT_MS) {
+            loop();
+        }
+        if (!quarantine.isQuarantined(BAD_CELL)) {
+            r.reinstateMs = millis() - start;
+        }
+    }
+    env.board.setCellShorted(BAD_CELL, false);
+    return r;
+}
+
+int runQuarantineBench(int argc, char** argv) {
+    unsigned long learnMs = (argc > 0) ? (unsigned long)atol(argv[0]) * 1000UL : 300000UL;
+    uint32_t cycles = (argc > 1) ? (uint32_t)atol(argv[1]) : 10;
+
+    BenchEnvironment env;
+    env.attach();
+    placeReferenceTags(env.board);
+
+    const bool faults[] = {false, true, true};
+    const bool quarantineOn[] = {true, false, true};
+    const char* names[] = {"healthy", "fault_no_quarantine", "fault_quarantine"};
+
+    printf("{\"bench\":\"quarantine\",\"learn_s\":%lu,\"cycles\":%u,\"bad_cell\":%d,"
+           "\"probe_interval_ms\":%d,\"modes\":[",
+           learnMs / 1000, (unsigned)cycles, BAD_CELL, CELL_PROBE_INTERVAL_MS);
+    for (int m = 0; m < 3; m++) {
+        QuarantineModeResult r = runMode(env, faults[m], quarantineOn[m], learnMs, cycles);
+        printf("%s{\"mode\":\"%s\",\"mean_cycle_ms\":%lu,\"max_cycle_ms\":%lu,\"cell_errors\":%u,"
+               "\"liveness_probes\":%u,\"background_probes\":%u,\"quarantined\":%d,"
+               "\"matches_board\":%s,\"reinstate_ms\":%ld}",
+               m ? "," : "", names[m], r.meanCycleMs, r.maxCycleMs, (unsigned)r.cellErrors,
+               (unsigned)r.livenessProbes, (unsigned)r.backgroundProbes, r.quarantined,
+               r.matchesBoard ? "true" : "false", r.reinstateMs);
+    }
+    printf("]}\n");
+    return 0;
+}
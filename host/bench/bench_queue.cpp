@@ -0,0 +1,110 @@
+#include "benchmarks.h"
+#include "rfid_manager.h"
+#include "scan_matrix.h"
+
+// =============================================
+// БЕНЧМАРК ОЧЕРЕДИ КОМАНД
+// На фоне штатного сканирования: интерактивные чтения NTAG с дедлайном
+// и непрерывный поток фоновых чтений. Проверяем ожидание, пропуски
+// дедлайнов, корректность данных и длительность прохода против бюджета
+// =============================================
+
+extern RFIDManager rfidManager;
+extern ScanMatrix scanMatrix;
+
+static const int QUEUE_BENCH_CELLS[] = {2, 12, 14, 24, 25, 26};
+static const int QUEUE_BENCH_CELL_COUNT = 6;
+
+struct QueueBenchState {
+    BenchEnvironment* env;
+    uint32_t verified;
+    uint32_t corrupted;
+};
+
+static void onReadComplete(const PN532Command& command, void* context) {
+    QueueBenchState* state = (QueueBenchState*)context;
+    if (!command.success) {
+        return;
+    }
+    const EmulatedTag& tag = state->env->board.tagAt(command.cellIndex);
+    if (memcmp(command.data, &tag.memory[command.page * 4], 16) == 0) {
+        state->verified++;
+    } else {
+        state->corrupted++;
+    }
+}
+
+static void printClass(const CommandQueue& queue, CommandPriority priority, bool last) {
+    const CommandClassMetrics& m = queue.getMetrics(priority);
+    printf("\"%s\":{\"submitted\":%u,\"rejected\":%u,\"completed\":%u,\"failed\":%u,"
+           "\"deadline_misses\":%u,\"mean_wait_ms\":%lu,\"max_wait_ms\":%lu}%s",
+           CommandQueue::getPriorityName(priority), (unsigned)m.submitted, (unsigned)m.rejected,
+           (unsigned)m.completed, (unsigned)m.failed, (unsigned)m.deadlineMisses,
+           queue.getMeanWaitMs(priority), m.maxWaitMs, last ? "" : ",");
+}
+
+int runQueueBench(int argc, char** argv) {
+    unsigned long durationMs = (argc > 0) ? (unsigned long)atol(argv[0]) : 120000;
+    unsigned long interactiveDeadlineMs = (argc > 1) ? (unsigned long)atol(argv[1]) : 250;
+
+    BenchEnvironment env;
+    env.attach();
+    placeReferenceTags(env.board);
+
+    setup();
+    env.runFor(15000);
+
+    QueueBenchState state = {&env, 0, 0};
+
+    PN532Command command;
+    memset(&command, 0, sizeof(command));
+    command.type = CMD_NTAG_READ_PAGES;
+    command.onComplete = onReadComplete;
+    command.context = &state;
+
+    uint64_t end = hostsim::nowMicros() + (uint64_t)durationMs * 1000ULL;
+    uint64_t nextInteractive = hostsim::nowMicros();
+    unsigned long maxCycleMs = 0;
+    unsigned long lastSeenCycle = scanMatrix.getLastCycleTime();
+    uint32_t cycles = 0;
+
+    while (hostsim::nowMicros() < end) {
+        uint64_t now = hostsim::nowMicros();
+
+        if (now >= nextInteractive) {
+            command.priority = PRIORITY_INTERACTIVE;
+            command.cellIndex = QUEUE_BENCH_CELLS[env.randomRange(0, QUEUE_BENCH_CELL_COUNT - 1)];
+            command.page = (uint8_t)env.randomRange(4, 39);
+            rfidManager.submitCommand(command, interactiveDeadlineMs);
+            nextInteractive = now + env.randomRange(200, 800) * 1000ULL;
+        }
+
+        // Фоновый поток держит очередь непустой
+        if (rfidManager.getCommandQueue().size() < COMMAND_QUEUE_SIZE / 2) {
+            command.priority = PRIORITY_BACKGROUND;
+            command.cellIndex = QUEUE_BENCH_CELLS[env.randomRange(0, QUEUE_BENCH_CELL_COUNT - 1)];
+            command.page = (uint8_t)env.randomRange(4, 39);
+            rfidManager.submitCommand(command);
+        }
+
+        loop();
+
+        if (scanMatrix.getLastCycleTime() != lastSeenCycle) {
+            lastSeenCycle = scanMatrix.getLastCycleTime();
+            cycles++;
+            if (lastSeenCycle > maxCycleMs) maxCycleMs = lastSeenCycle;
+        }
+    }
+
+    const CommandQueue& queue = rfidManager.getCommandQueue();
+    printf("{\"bench\":\"queue\",\"duration_ms\":%lu,\"interactive_deadline_ms\":%lu,"
+           "\"staleness_budget_ms\":%d,\"cycles\":%u,\"max_cycle_ms\":%lu,"
+           "\"verified_reads\":%u,\"corrupted_reads\":%u,\"spurious_removals\":%u,\"classes\":{",
+           durationMs, interactiveDeadlineMs, SCAN_STALENESS_BUDGET_MS, (unsigned)cycles, maxCycleMs,
+           (unsigned)state.verified, (unsigned)state.corrupted, (unsigned)scanMatrix.getCardsRemoved());
+    printClass(queue, PRIORITY_SCAN, false);
+    printClass(queue, PRIORITY_INTERACTIVE, false);
+    printClass(queue, PRIORITY_BACKGROUND, true);
+    printf("}}\n");
+    return 0;
+}
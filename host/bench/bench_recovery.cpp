@@ -0,0 +1,126 @@
+#include "benchmarks.h"
+#include "rfid_manager.h"
+#include "scan_matrix.h"
+#include "state_manager.h"
+
+// =============================================
+// БЕНЧМАРК ВОССТАНОВЛЕНИЯ ПОСЛЕ СБОЕВ
+// Сбой вносится в случайный момент сканирования, время восстановления -
+// от внесения сбоя до первой команды, принятой PN532, после которой
+// прошивка снова в STATE_SCANNING с активным подключением
+// =============================================
+
+extern StateManager stateManager;
+extern RFIDManager rfidManager;
+extern ScanMatrix scanMatrix;
+
+enum BenchFault {
+    BENCH_FAULT_NACK,        // однократный NACK транзакции
+    BENCH_FAULT_BUS_STUCK,   // ведомый держит SDA
+    BENCH_FAULT_HANG,        // PN532 не отвечает до сброса
+    BENCH_FAULT_COUNT
+};
+
+static const char* BENCH_FAULT_NAMES[BENCH_FAULT_COUNT] = {"nack_once", "bus_stuck", "pn532_hang"};
+
+static const unsigned long RECOVERY_DEADLINE_MS = 30000;
+
+struct FaultResult {
+    uint32_t trials;
+    uint32_t recovered;
+    uint64_t totalUs;
+    uint64_t maxUs;
+    uint32_t spuriousRemovals;
+};
+
+static void injectBenchFault(BenchEnvironment& env, BenchFault fault) {
+    switch (fault) {
+        case BENCH_FAULT_NACK:
+            env.pn532.injectFault(EMU_FAULT_NACK_ONCE);
+            break;
+        case BENCH_FAULT_BUS_STUCK:
+            hostsim::holdSdaLow((uint8_t)env.randomRange(1, 9));
+            break;
+        case BENCH_FAULT_HANG:
+            env.pn532.injectFault(EMU_FAULT_HANG);
+            break;
+        default:
+            break;
+    }
+}
+
+static bool isRecovered(BenchEnvironment& env, uint32_t framesBefore) {
+    return env.pn532.getFramesReceived() > framesBefore &&
+           !env.pn532.isHung() && !hostsim::isSdaStuck() &&
+           rfidManager.getConnected() &&
+           stateManager.getCurrentState() == STATE_SCANNING;
+}
+
+int runRecoveryBench(int argc, char** argv) {
+    uint32_t trials = (argc > 0) ? (uint32_t)atoi(argv[0]) : 50;
+    if (trials == 0) trials = 1;
+
+    BenchEnvironment env;
+    env.attach();
+    placeReferenceTags(env.board);
+
+    setup();
+    env.runFor(15000);   // прогрев: полный проход заполняет кэш
+
+    FaultResult results[BENCH_FAULT_COUNT];
+    memset(results, 0, sizeof(results));
+
+    for (int f = 0; f < BENCH_FAULT_COUNT; f++) {
+        FaultResult& r = results[f];
+
+        for (uint32_t t = 0; t < trials; t++) {
+            env.runFor(env.randomRange(50, 500));
+
+            uint32_t removalsBefore = scanMatrix.getCardsRemoved();
+            uint32_t framesBefore = env.pn532.getFramesReceived();
+            uint64_t faultAt = hostsim::nowMicros();
+            injectBenchFault(env, (BenchFault)f);
+            r.trials++;
+
+            uint64_t deadline = faultAt + (uint64_t)RECOVERY_DEADLINE_MS * 1000ULL;
+            while (hostsim::nowMicros() < deadline && !isRecovered(env, framesBefore)) {
+                loop();
+            }
+
+            if (isRecovered(env, framesBefore)) {
+                // Точный момент - первая команда, принятая PN532 после сбоя
+                uint64_t us = env.pn532.getLastFrameMicros() - faultAt;
+                r.recovered++;
+                r.totalUs += us;
+                if (us > r.maxUs) r.maxUs = us;
+            } else {
+                // Не восстановились - снимаем сбой, чтобы не влиять на следующие прогоны
+                env.pn532.injectFault(EMU_FAULT_NONE);
+                hostsim::holdSdaLow(0);
+                while (hostsim::isSdaStuck()) {
+                    digitalWrite(PN532_SCL_PIN, LOW);
+                    digitalWrite(PN532_SCL_PIN, HIGH);
+                }
+            }
+
+            r.spuriousRemovals += scanMatrix.getCardsRemoved() - removalsBefore;
+        }
+    }
+
+    printf("{\"bench\":\"recovery\",\"trials_per_fault\":%u,\"faults\":[", (unsigned)trials);
+    for (int f = 0; f < BENCH_FAULT_COUNT; f++) {
+        const FaultResult& r = results[f];
+        double meanMs = r.recovered ? (double)r.totalUs / r.recovered / 1000.0 : 0.0;
+        printf("%s{\"fault\":\"%s\",\"recovered\":%u,\"mttr_ms\":%.2f,\"max_ms\":%.2f,\"spurious_removals\":%u}",
+               f ? "," : "", BENCH_FAULT_NAMES[f], (unsigned)r.recovered, meanMs,
+               r.maxUs / 1000.0, (unsigned)r.spuriousRemovals);
+    }
+    printf("],\"recoveries\":{\"retry\":%u,\"bus_clear\":%u,\"hard_reset\":%u,\"failed\":%u},"
+           "\"cards_in_cache\":%d}\n",
+           (unsigned)rfidManager.getRecoveryCount(RECOVERY_RETRY),
+           (unsigned)rfidManager.getRecoveryCount(RECOVERY_BUS_CLEAR),
+           (unsigned)rfidManager.getRecoveryCount(RECOVERY_HARD_RESET),
+           (unsigned)rfidManager.getRecoveryFailures(),
+           scanMatrix.findCardsInMatrix());
+    return 0;
+}
@@ -0,0 +1,253 @@
+#include "benchmarks.h"
+#include "scan_matrix.h"
+#include "i2c_fault_injector.h"
+#include "i2c_trace.h"
+#include "i2c_trace_replay.h"
+#include <Adafruit_PN532.h>
+#include <vector>
+
+// =============================================
+// БЕНЧМАРК ЗАПИСИ И ПОВТОРА ТРАССЫ I2C
+// Запись: прошивка на эмуляторе, рука переставляет метки, два сбоя PN532
+// (NACK и зависание до сброса); I2CTraceRecorder шлет кадры в память вместо
+// Serial. Повтор: эмулятор снят, прошивка с нуля получает ответы из трассы.
+// Повтор должен дать те же подтвержденные события в те же моменты millis()
+// и тот же кэш доски; второй повтор - то же самое (детерминизм).
+// С файлом: разбор дампа Serial с поля и повтор последней загрузки
+// =============================================
+
+extern ScanMatrix scanMatrix;
+extern I2CFaultInjector i2cFaultInjector;
+extern I2CTraceRecorder i2cTrace;
+
+static const unsigned long HAND_PERIOD_MS = 7000;
+static const unsigned long REPLAY_TAIL_MS = 5000;      // После конца трассы - до таймаутов прошивки
+
+struct LoggedEvent {
+    int cell;
+    CardEventKind kind;
+    uint8_t uid[UID_BUFFER_SIZE];
+    unsigned long decidedTime;
+};
+
+struct RunResult {
+    std::vector<LoggedEvent> events;
+    CardInfo cache[MATRIX_TOTAL_CELLS];
+    uint32_t cycles;
+    unsigned long cycleMsTotal;
+};
+
+static void onCardEvent(const CardEvent& event, void* context) {
+    if (event.tier != CARD_EVENT_CONFIRMED) {
+        return;
+    }
+    LoggedEvent logged;
+    logged.cell = event.cellIndex;
+    logged.kind = event.kind;
+    memcpy(logged.uid, event.uid, UID_BUFFER_SIZE);
+    logged.decidedTime = event.decidedTime;
+    ((RunResult*)context)->events.push_back(logged);
+}
+
+// Один loop() с учетом законченных проходов
+static void step(RunResult& result) {
+    unsigned long cycleStart = scanMatrix.getCycleStartTime();
+    loop();
+    if (scanMatrix.getCycleStartTime() != cycleStart && scanMatrix.getLastCycleTime() > 0) {
+        result.cycles++;
+        result.cycleMsTotal += scanMatrix.getLastCycleTime();
+    }
+}
+
+static void finishRun(RunResult& result) {
+    for (int i = 0; i < MATRIX_TOTAL_CELLS; i++) {
+        result.cache[i] = scanMatrix.getCardInfo(i);
+    }
+    scanMatrix.getCardEvents().setCallback(nullptr, nullptr);
+}
+
+static void capture(BenchEnvironment& env, unsigned long durationMs, I2CTraceCapture& sink, RunResult& result) {
+    i2cTrace.setEnabled(true);
+    i2cTrace.setStreaming(true);
+    i2cTrace.setOutput(&sink);
+
+    rebootFirmware(env);
+    hostsim::eraseFlash();
+    setup();
+    scanMatrix.getCardEvents().setCallback(onCardEvent, &result);
+
+    // Сбои на трети и двух третях записи: повтор проходит и восстановление
+    i2cFaultInjector.clear();
+    i2cFaultInjector.scheduleFault(I2C_FAULT_NACK, millis() + durationMs / 3);
+    i2cFaultInjector.scheduleFault(I2C_FAULT_HANG, millis() + durationMs * 2 / 3);
+
+    // Рука: метка переезжает в случайную свободную ячейку рядов 3-5
+    uint64_t end = hostsim::nowMicros() + (uint64_t)durationMs * 1000ULL;
+    uint64_t nextMove = hostsim::nowMicros() + (uint64_t)HAND_PERIOD_MS * 1000ULL;
+    static const int handCells[] = {2, 12, 14, 24, 25, 26};
+    int tagCell[6];
+    memcpy(tagCell, handCells, sizeof(tagCell));
+    int moveIndex = 0;
+    while (hostsim::nowMicros() < end) {
+        step(result);
+        if (hostsim::nowMicros() >= nextMove) {
+            int tag = moveIndex++ % 6;
+            int target;
+            do {
+                target = 36 + env.randomRange(0, 35);
+            } while (env.board.hasTag(target));
+            env.board.moveTag(tagCell[tag], target);
+            tagCell[tag] = target;
+            nextMove += (uint64_t)HAND_PERIOD_MS * 1000ULL;
+        }
+    }
+
+    // Остаток кольца - в поток
+    while (i2cTrace.getFramesSent() < i2cTrace.getTotalRecords() + 1) {
+        uint32_t before = i2cTrace.getFramesSent();
+        i2cTrace.poll();
+        if (i2cTrace.getFramesSent() == before) {
+            break;
+        }
+    }
+    i2cFaultInjector.clear();
+    finishRun(result);
+}
+
+static void replay(BenchEnvironment& env, const std::vector<I2CTraceRecord>& trace, I2CTraceReplayer& replayer,
+                   RunResult& result) {
+    i2cTrace.setEnabled(false);
+    i2cTrace.setStreaming(false);
+
+    rebootFirmware(env);
+    hostsim::eraseFlash();
+    replayer.load(trace);
+    replayer.attach();
+    setup();
+    scanMatrix.getCardEvents().setCallback(onCardEvent, &result);
+
+    while (!replayer.isFinished() && hostsim::nowMicros() < replayer.getEndMicros() + REPLAY_TAIL_MS * 1000ULL) {
+        step(result);
+    }
+    finishRun(result);
+    replayer.detach();
+}
+
+static bool sameEvents(const RunResult& a, const RunResult& b, unsigned long& maxTimeDiffMs) {
+    maxTimeDiffMs = 0;
+    if (a.events.size() != b.events.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.events.size(); i++) {
+        const LoggedEvent& x = a.events[i];
+        const LoggedEvent& y = b.events[i];
+        if (x.cell != y.cell || x.kind != y.kind || memcmp(x.uid, y.uid, UID_BUFFER_SIZE) != 0) {
+            return false;
+        }
+        unsigned long diff = (x.decidedTime > y.decidedTime) ? x.decidedTime - y.decidedTime
+                                                              : y.decidedTime - x.decidedTime;
+        maxTimeDiffMs = max(maxTimeDiffMs, diff);
+    }
+    return true;
+}
+
+static bool sameCache(const RunResult& a, const RunResult& b) {
+    for (int i = 0; i < MATRIX_TOTAL_CELLS; i++) {
+        const CardInfo& x = a.cache[i];
+        const CardInfo& y = b.cache[i];
+        if (x.present != y.present) return false;
+        if (x.present && (x.uidLength != y.uidLength || memcmp(x.uid, y.uid, x.uidLength) != 0)) return false;
+    }
+    return true;
+}
+
+static void printReplay(const char* name, const I2CTraceReplayer& replayer, const RunResult& run,
+                        const RunResult* reference) {
+    printf("{\"run\":\"%s\",\"records\":%u,\"replayed\":%u,\"mismatched\":%u,\"skipped\":%u,\"unmatched\":%u,"
+           "\"after_end\":%u,\"raw_probes\":%u,\"first_divergence\":%ld,\"warped_ms\":%.1f,\"max_lag_us\":%llu,"
+           "\"events\":%u,\"mean_cycle_ms\":%lu",
+           name, (unsigned)replayer.getRecordCount(), (unsigned)replayer.getReplayed(),
+           (unsigned)replayer.getMismatched(), (unsigned)replayer.getSkipped(), (unsigned)replayer.getUnmatched(),
+           (unsigned)replayer.getAfterEnd(), (unsigned)replayer.getRawProbes(), replayer.getFirstDivergence(),
+           replayer.getWarpedMicros() / 1000.0, (unsigned long long)replayer.getMaxLagMicros(),
+           (unsigned)run.events.size(), run.cycles ? run.cycleMsTotal / run.cycles : 0UL);
+    if (reference != nullptr) {
+        unsigned long maxDiffMs = 0;
+        bool eventsMatch = sameEvents(*reference, run, maxDiffMs);
+        printf(",\"events_match\":%s,\"event_time_max_diff_ms\":%lu,\"cache_matches\":%s",
+               eventsMatch ? "true" : "false", maxDiffMs, sameCache(*reference, run) ? "true" : "false");
+    }
+    printf("}");
+}
+
+static int replayFile(BenchEnvironment& env, const char* path) {
+    I2CTraceDecoder decoder;
+    if (!decoder.loadFile(path)) {
+        printf("{\"bench\":\"replay\",\"error\":\"не удалось открыть %s\"}\n", path);
+        return 1;
+    }
+    const I2CTraceSession* session = decoder.lastLiveSession();
+    printf("{\"bench\":\"replay\",\"file\":\"%s\",\"decode\":{\"sessions\":%u,\"bad_frames\":%u,\"text_bytes\":%u",
+           path, (unsigned)decoder.getSessions().size(), (unsigned)decoder.getBadFrames(),
+           (unsigned)decoder.getSkippedBytes());
+    if (session == nullptr) {
+        printf("},\"error\":\"в дампе нет записей\"}\n");
+        return 1;
+    }
+    printf(",\"records\":%u,\"gaps\":%u},\"replay\":", (unsigned)session->records.size(), (unsigned)session->gaps);
+
+    I2CTraceReplayer replayer(PN532_I2C_ADDRESS);
+    RunResult run = {};
+    replay(env, session->records, replayer, run);
+    printReplay("file", replayer, run, nullptr);
+    printf("}\n");
+    return 0;
+}
+
+int runReplayBench(int argc, char** argv) {
+    unsigned long captureMs = (argc > 0) ? (unsigned long)atol(argv[0]) * 1000UL : 120000UL;
+    const char* path = (argc > 1) ? argv[1] : nullptr;
+
+    BenchEnvironment env;
+    env.attach();
+    placeReferenceTags(env.board);
+
+    if (path != nullptr) {
+        env.board.detach();
+        env.pn532.detach();
+        return replayFile(env, path);
+    }
+
+    I2CTraceCapture sink;
+    RunResult recorded = {};
+    capture(env, captureMs, sink, recorded);
+
+    I2CTraceDecoder decoder;
+    decoder.feed(sink.bytes.data(), sink.bytes.size());
+    const I2CTraceSession* session = decoder.lastLiveSession();
+    printf("{\"bench\":\"replay\",\"capture_s\":%lu,\"capture\":{\"records\":%u,\"stream_bytes\":%u,"
+           "\"stream_dropped\":%u,\"ring_evicted\":%u,\"events\":%u,\"mean_cycle_ms\":%lu},"
+           "\"decode\":{\"sessions\":%u,\"records\":%u,\"gaps\":%u,\"bad_frames\":%u},\"replays\":[",
+           captureMs / 1000, (unsigned)i2cTrace.getTotalRecords(), (unsigned)sink.bytes.size(),
+           (unsigned)i2cTrace.getStreamDropped(), (unsigned)i2cTrace.getEvicted(), (unsigned)recorded.events.size(),
+           recorded.cycles ? recorded.cycleMsTotal / recorded.cycles : 0UL, (unsigned)decoder.getSessions().size(),
+           session ? (unsigned)session->records.size() : 0, session ? (unsigned)session->gaps : 0,
+           (unsigned)decoder.getBadFrames());
+    if (session == nullptr) {
+        printf("]}\n");
+        return 1;
+    }
+
+    // Эмулятор снят: все ответы - из трассы
+    env.board.detach();
+    env.pn532.detach();
+    for (int r = 0; r < 2; r++) {
+        I2CTraceReplayer replayer(PN532_I2C_ADDRESS);
+        RunResult run = {};
+        replay(env, session->records, replayer, run);
+        printReplay(r == 0 ? "replay" : "replay_again", replayer, run, &recorded);
+        printf(r == 0 ? "," : "");
+    }
+    printf("]}\n");
+    return 0;
+}
@@ -0,0 +1,130 @@
+#include "benchmarks.h"
+#include "scan_matrix.h"
+
+// =============================================
+// БЕНЧМАРК ВЫКЛЮЧЕНИЯ ПОЛЯ НА ПЕРЕКЛЮЧЕНИЕ МУЛЬТИПЛЕКСОРА
+// Пока поле включено, прежняя антенна успокаивается и наводит метку на новую:
+// [2,2] - дольше всех (мерцание из лога), остальная строка 2 - умеренно.
+// Выключение поля убирает паузу, но стоит двух команд RFConfiguration и запитки
+// метки. Часть паузы и так скрыта задержкой loop() между шагами. Сравниваем паузу
+// везде, выключение везде и выбор по ячейке; цены - на ячейках после занятых
+// =============================================
+
+extern ScanMatrix scanMatrix;
+
+static const int SLOW_CELL = 26;
+static const uint32_t SLOW_SETTLE_US = 18000;
+static const uint32_t ROW2_SETTLE_US = 2500;
+
+// Ячейки, на которые построчный проход переходит с занятой: 2->3, 12->13,
+// 14->15, 24->25, 25->26, 26->27
+static const int TARGET_CELLS[] = {3, 13, 15, 25, 26, 27};
+static const int TARGET_COUNT = 6;
+
+struct GateModeResult {
+    uint32_t cycles;
+    unsigned long meanCycleMs;
+    uint32_t events;
+    uint32_t crosstalk;
+    uint32_t confirmReads;
+    uint32_t settleSwitches;
+    uint32_t gatedSwitches;
+    uint32_t settleCostUs[TARGET_COUNT];
+    uint32_t gatedCostUs[TARGET_COUNT];
+    bool gated[TARGET_COUNT];
+    bool matchesBoard;
+};
+
+static uint32_t totalEvents() {
+    return scanMatrix.getCardsDetected() + scanMatrix.getCardsRemoved() + scanMatrix.getCardChanges();
+}
+
+static void waitCycleStart() {
+    unsigned long cycleStart = scanMatrix.getCycleStartTime();
+    while (scanMatrix.getCycleStartTime() == cycleStart) {
+        loop();
+    }
+}
+
+static bool cacheMatchesBoard(BenchEnvironment& env) {
+    for (int i = 0; i < MATRIX_TOTAL_CELLS; i++) {
+        if (scanMatrix.getCardInfo(i).present != env.board.tagAt(i).present) return false;
+    }
+    return true;
+}
+
+static GateModeResult runMode(BenchEnvironment& env, RfGatingMode mode, unsigned long learnMs, uint32_t cycles) {
+    GateModeResult r;
+    memset(&r, 0, sizeof(r));
+
+    rebootFirmware(env);
+    hostsim::eraseFlash();
+    setup();
+    FieldGatePlanner& gate = scanMatrix.getFieldGate();
+    gate.setMode(mode);
+
+    // Обучение: калибровка таймингов, пауз и цен стратегий
+    env.runFor(learnMs);
+    waitCycleStart();
+
+    CellCalibrator& calibrator = scanMatrix.getCalibrator();
+    uint32_t eventsBefore = totalEvents();
+    uint32_t crosstalkBefore = calibrator.getTotalCrosstalk();
+    uint32_t confirmBefore = scanMatrix.getConfirmReads();
+    uint32_t settleBefore = gate.getSettleSwitches();
+    uint32_t gatedBefore = gate.getGatedSwitches();
+    unsigned long totalMs = 0;
+
+    while (r.cycles < cycles) {
+        waitCycleStart();
+        totalMs += scanMatrix.getLastCycleTime();
+        r.cycles++;
+    }
+
+    r.meanCycleMs = totalMs / r.cycles;
+    r.events = totalEvents() - eventsBefore;
+    r.crosstalk = calibrator.getTotalCrosstalk() - crosstalkBefore;
+    r.confirmReads = scanMatrix.getConfirmReads() - confirmBefore;
+    r.settleSwitches = gate.getSettleSwitches() - settleBefore;
+    r.gatedSwitches = gate.getGatedSwitches() - gatedBefore;
+    for (int i = 0; i < TARGET_COUNT; i++) {
+        r.settleCostUs[i] = gate.getSettleCostUs(TARGET_CELLS[i]);
+        r.gatedCostUs[i] = gate.getGatedCostUs(TARGET_CELLS[i]);
+        r.gated[i] = gate.prefersGating(TARGET_CELLS[i]);
+    }
+    r.matchesBoard = cacheMatchesBoard(env);
+    return r;
+}
+
+int runRfGateBench(int argc, char** argv) {
+    unsigned long learnMs = (argc > 0) ? (unsigned long)atol(argv[0]) * 1000UL : 1200000UL;
+    uint32_t cycles = (argc > 1) ? (uint32_t)atol(argv[1]) : 10;
+
+    BenchEnvironment env;
+    env.attach();
+    placeReferenceTags(env.board);
+    for (int i = 2 * MATRIX_COLS; i < 3 * MATRIX_COLS; i++) {
+        env.board.setCellRf(i, i == SLOW_CELL ? SLOW_SETTLE_US : ROW2_SETTLE_US, 0, 0);
+    }
+
+    const RfGatingMode modes[] = {RF_GATING_OFF, RF_GATING_ALWAYS, RF_GATING_AUTO};
+    const char* names[] = {"settle", "gated", "auto"};
+
+    printf("{\"bench\":\"rfgate\",\"learn_s\":%lu,\"cycles\":%u,\"guard_us\":%d,\"modes\":[",
+           learnMs / 1000, (unsigned)cycles, RF_FIELD_GUARD_US);
+    for (int m = 0; m < 3; m++) {
+        GateModeResult r = runMode(env, modes[m], learnMs, cycles);
+        printf("%s{\"mode\":\"%s\",\"mean_cycle_ms\":%lu,\"events\":%u,\"crosstalk\":%u,"
+               "\"confirm_reads\":%u,\"settle_switches\":%u,\"gated_switches\":%u,\"cells\":[",
+               m ? "," : "", names[m], r.meanCycleMs, (unsigned)r.events, (unsigned)r.crosstalk,
+               (unsigned)r.confirmReads, (unsigned)r.settleSwitches, (unsigned)r.gatedSwitches);
+        for (int i = 0; i < TARGET_COUNT; i++) {
+            printf("%s{\"cell\":%d,\"settle_cost_us\":%u,\"gated_cost_us\":%u,\"strategy\":\"%s\"}",
+                   i ? "," : "", TARGET_CELLS[i], (unsigned)r.settleCostUs[i], (unsigned)r.gatedCostUs[i],
+                   r.gated[i] ? "gated" : "settle");
+        }
+        printf("],\"matches_board\":%s}", r.matchesBoard ? "true" : "false");
+    }
+    printf("]}\n");
+    return 0;
+}
@@ -0,0 +1,136 @@
+#include "benchmarks.h"
+#include "rfid_manager.h"
+#include "scan_matrix.h"
+
+// =============================================
+// БЕНЧМАРК ПРОФИЛЕЙ АНАЛОГОВОГО ТРАКТА PN532
+// Слабым антеннам не хватает штатного RxGain 38 дБ: каждая попытка активации
+// удается с вероятностью 1/2 на шаг усиления мимо окна, PN532 повторяет ее
+// ~4 мс, пока не истечет таймаут чтения - пропуск, повторы, контрольное чтение.
+// Максимальное усиление насыщает обычные ячейки, поэтому профиль - по ячейке.
+// Сравниваем штатный профиль везде и выбор калибровкой после обучения
+// =============================================
+
+extern ScanMatrix scanMatrix;
+extern RFIDManager rfidManager;
+
+// Ячейка, окно RxGain, наибольший ModGsP: [1,0] и [2,0] нужен максимальный
+// профиль, [1,2] - хотя бы усиленный
+static const int WEAK_CELLS[][4] = {{12, 7, 7, 0x08}, {24, 7, 7, 0x08}, {14, 6, 7, 0x3F}};
+static const int WEAK_COUNT = 3;
+
+struct RfModeResult {
+    uint32_t cycles;
+    unsigned long meanCycleMs;
+    uint32_t events;
+    uint32_t misses;
+    uint32_t confirmReads;
+    uint32_t switchesPerPass;
+    uint32_t reads[RF_PROFILE_COUNT];
+    uint32_t missesByProfile[RF_PROFILE_COUNT];
+    int weakProfile[WEAK_COUNT];
+    uint32_t profileChanges;
+    bool matchesBoard;
+};
+
+static uint32_t totalEvents() {
+    return scanMatrix.getCardsDetected() + scanMatrix.getCardsRemoved() + scanMatrix.getCardChanges();
+}
+
+static void waitCycleStart() {
+    unsigned long cycleStart = scanMatrix.getCycleStartTime();
+    while (scanMatrix.getCycleStartTime() == cycleStart) {
+        loop();
+    }
+}
+
+static bool cacheMatchesBoard(BenchEnvironment& env) {
+    for (int i = 0; i < MATRIX_TOTAL_CELLS; i++) {
+        if (scanMatrix.getCardInfo(i).present != env.board.tagAt(i).present) return false;
+    }
+    return true;
+}
+
+static RfModeResult runMode(BenchEnvironment& env, bool profiles, unsigned long learnMs, uint32_t cycles) {
+    RfModeResult r;
+    memset(&r, 0, sizeof(r));
+
+    rebootFirmware(env);
+    hostsim::eraseFlash();
+    setup();
+    CellCalibrator& calibrator = scanMatrix.getCalibrator();
+    calibrator.setRfProfilesEnabled(profiles);
+
+    // Обучение: окна калибровки на занятых ячейках
+    env.runFor(learnMs);
+    waitCycleStart();
+
+    uint32_t eventsBefore = totalEvents();
+    uint32_t missesBefore = calibrator.getTotalMisses();
+    uint32_t confirmBefore = scanMatrix.getConfirmReads();
+    uint32_t switchesBefore = rfidManager.getRfProfileSwitches();
+    uint32_t readsBefore[RF_PROFILE_COUNT], profileMissesBefore[RF_PROFILE_COUNT];
+    for (int p = 0; p < RF_PROFILE_COUNT; p++) {
+        readsBefore[p] = calibrator.getRfReads(p);
+        profileMissesBefore[p] = calibrator.getRfMisses(p);
+    }
+    unsigned long totalMs = 0;
+
+    while (r.cycles < cycles) {
+        waitCycleStart();
+        totalMs += scanMatrix.getLastCycleTime();
+        r.cycles++;
+    }
+
+    r.meanCycleMs = totalMs / r.cycles;
+    r.events = totalEvents() - eventsBefore;
+    r.misses = calibrator.getTotalMisses() - missesBefore;
+    r.confirmReads = scanMatrix.getConfirmReads() - confirmBefore;
+    r.switchesPerPass = (rfidManager.getRfProfileSwitches() - switchesBefore) / r.cycles;
+    for (int p = 0; p < RF_PROFILE_COUNT; p++) {
+        r.reads[p] = calibrator.getRfReads(p) - readsBefore[p];
+        r.missesByProfile[p] = calibrator.getRfMisses(p) - profileMissesBefore[p];
+    }
+    for (int i = 0; i < WEAK_COUNT; i++) {
+        r.weakProfile[i] = calibrator.getRfProfile(WEAK_CELLS[i][0]);
+    }
+    r.profileChanges = calibrator.getRfProfileChanges();
+    r.matchesBoard = cacheMatchesBoard(env);
+    return r;
+}
+
+int runRfProfileBench(int argc, char** argv) {
+    unsigned long learnMs = (argc > 0) ? (unsigned long)atol(argv[0]) * 1000UL : 600000UL;
+    uint32_t cycles = (argc > 1) ? (uint32_t)atol(argv[1]) : 5;
+
+    BenchEnvironment env;
+    env.attach();
+    placeReferenceTags(env.board);
+    for (int i = 0; i < WEAK_COUNT; i++) {
+        env.board.setCellAnalog(WEAK_CELLS[i][0], WEAK_CELLS[i][1], WEAK_CELLS[i][2], WEAK_CELLS[i][3]);
+    }
+
+    printf("{\"bench\":\"rfprofile\",\"learn_s\":%lu,\"cycles\":%u,\"modes\":[",
+           learnMs / 1000, (unsigned)cycles);
+    for (int m = 0; m < 2; m++) {
+        bool profiles = (m == 1);
+        RfModeResult r = runMode(env, profiles, learnMs, cycles);
+        printf("%s{\"mode\":\"%s\",\"mean_cycle_ms\":%lu,\"events\":%u,\"misses\":%u,"
+               "\"confirm_reads\":%u,\"rf_switches_per_pass\":%u,\"profile_changes\":%u,\"profiles\":[",
+               m ? "," : "", profiles ? "per_cell" : "default", r.meanCycleMs, (unsigned)r.events,
+               (unsigned)r.misses, (unsigned)r.confirmReads, (unsigned)r.switchesPerPass,
+               (unsigned)r.profileChanges);
+        for (int p = 0; p < RF_PROFILE_COUNT; p++) {
+            printf("%s{\"profile\":%d,\"reads\":%u,\"hit_pct\":%.1f}", p ? "," : "", p,
+                   (unsigned)r.reads[p],
+                   r.reads[p] ? 100.0 * (r.reads[p] - r.missesByProfile[p]) / r.reads[p] : 0.0);
+        }
+        printf("],\"weak_cells\":[");
+        for (int i = 0; i < WEAK_COUNT; i++) {
+            printf("%s{\"cell\":%d,\"profile\":%d}", i ? "," : "", WEAK_CELLS[i][0], r.weakProfile[i]);
+        }
+        printf("],\"matches_board\":%s}", r.matchesBoard ? "true" : "false");
+    }
+    printf("]}\n");
+    return 0;
+}
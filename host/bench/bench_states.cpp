@@ -0,0 +1,111 @@
+#include "benchmarks.h"
+#include "state_manager.h"
+#include <chrono>
+
+// =============================================
+// БЕНЧМАРК ПРОФИЛЯ СОСТОЯНИЙ
+// Прошивка сканирует под периодическими зависаниями PN532 (сброс по
+// RSTPD_N). Бенчмарк сам ведет время в состояниях по виртуальным часам
+// после каждого loop() и сверяет с профилем StateManager; выводит
+// доступность, цену восстановлений, матрицу переходов и цену учета на CPU
+// =============================================
+
+extern StateManager stateManager;
+
+static const int OVERHEAD_RUNS = 200000;
+
+int runStatesBench(int argc, char** argv) {
+    unsigned long durationMs = (argc > 0) ? (unsigned long)atol(argv[0]) * 1000UL : 600000UL;
+    unsigned long faultIntervalMs = (argc > 1) ? (unsigned long)atol(argv[1]) * 1000UL : 30000UL;
+    if (faultIntervalMs == 0) faultIntervalMs = 30000UL;
+
+    BenchEnvironment env;
+    env.attach();
+    placeReferenceTags(env.board);
+    rebootFirmware(env);
+    hostsim::eraseFlash();
+    setup();
+
+    // Эталон: время между концами loop() относится к состоянию после loop()
+    uint64_t oracleUs[SYSTEM_STATE_COUNT] = {0};
+    uint64_t start = hostsim::nowMicros();
+    uint64_t end = start + (uint64_t)durationMs * 1000ULL;
+    uint64_t last = start;
+    uint64_t nextFault = start + (uint64_t)env.randomRange(faultIntervalMs / 2, faultIntervalMs) * 1000ULL;
+    uint32_t faults = 0;
+    while (hostsim::nowMicros() < end) {
+        SystemState before = stateManager.getCurrentState();
+        loop();
+        uint64_t now = hostsim::nowMicros();
+        // Переход внутри loop(): время до него неизвестно с точностью до прохода,
+        // относим к прежнему состоянию - расхождение не больше длины loop()
+        oracleUs[before] += now - last;
+        last = now;
+        if (now >= nextFault) {
+            env.pn532.injectFault(EMU_FAULT_HANG);
+            faults++;
+            nextFault = now + (uint64_t)env.randomRange(faultIntervalMs / 2, faultIntervalMs) * 1000ULL;
+        }
+    }
+    stateManager.updateState();     // Учет до текущего момента
+
+    const StateProfile& profile = stateManager.getProfile();
+    uint32_t profiledMs = stateManager.getProfiledMs();
+    uint64_t residencySum = 0;
+    long maxDeviationMs = 0;
+    for (int s = 0; s < SYSTEM_STATE_COUNT; s++) {
+        uint32_t residency = stateManager.getResidencyMs((SystemState)s);
+        residencySum += residency;
+        long deviation = labs((long)residency - (long)(oracleUs[s] / 1000));
+        if (deviation > maxDeviationMs) maxDeviationMs = deviation;
+    }
+    uint32_t errorVisits = profile.transitions[STATE_ERROR][STATE_SCANNING];
+    uint32_t meanRecoveryMs = errorVisits ? stateManager.getResidencyMs(STATE_ERROR) / errorVisits : 0;
+    uint32_t availability = stateManager.getAvailabilityPermille();
+
+    // Цена учета на CPU хоста: пара переходов и один updateState()
+    StateProfile saved = profile;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < OVERHEAD_RUNS; i++) {
+        stateManager.setState(STATE_IDLE);
+        stateManager.setState(STATE_SCANNING);
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    for (int i = 0; i < OVERHEAD_RUNS; i++) {
+        stateManager.updateState();
+    }
+    auto t2 = std::chrono::steady_clock::now();
+    double nsPerTransition = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count() /
+                             (2.0 * OVERHEAD_RUNS);
+    double nsPerUpdate = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(t2 - t1).count() /
+                         OVERHEAD_RUNS;
+
+    printf("{\"bench\":\"states\",\"seconds\":%lu,\"faults\":%u,\"profiled_ms\":%u,\"residency_sum_ms\":%llu,"
+           "\"max_deviation_ms\":%ld,\"availability_permille\":%u,\"recoveries\":%u,\"mean_recovery_ms\":%u,"
+           "\"max_recovery_ms\":%u,\"error_visit_buckets\":[",
+           durationMs / 1000, (unsigned)faults, (unsigned)profiledMs, (unsigned long long)residencySum,
+           maxDeviationMs, (unsigned)availability, (unsigned)errorVisits,
+           (unsigned)meanRecoveryMs, (unsigned)saved.maxVisitMs[STATE_ERROR]);
+    for (int b = 0; b < STATE_VISIT_BUCKETS; b++) {
+        uint32_t bound = StateManager::getVisitBucketBound(b);
+        if (bound == UINT32_MAX) {
+            printf("%s{\"le_ms\":null,\"n\":%u}", b ? "," : "", (unsigned)saved.visitBuckets[STATE_ERROR][b]);
+        } else {
+            printf("%s{\"le_ms\":%u,\"n\":%u}", b ? "," : "", (unsigned)bound,
+                   (unsigned)saved.visitBuckets[STATE_ERROR][b]);
+        }
+    }
+    printf("],\"transitions\":{");
+    bool first = true;
+    for (int from = 0; from < SYSTEM_STATE_COUNT; from++) {
+        for (int to = 0; to < SYSTEM_STATE_COUNT; to++) {
+            if (saved.transitions[from][to] == 0) continue;
+            printf("%s\"%s->%s\":%u", first ? "" : ",", stateManager.getStateName((SystemState)from),
+                   stateManager.getStateName((SystemState)to), (unsigned)saved.transitions[from][to]);
+            first = false;
+        }
+    }
+    printf("},\"history\":%u,\"ns_per_transition\":%.1f,\"ns_per_update\":%.1f}\n",
+           (unsigned)saved.historyCount, nsPerTransition, nsPerUpdate);
+    return 0;
+}
@@ -0,0 +1,175 @@
+#include "benchmarks.h"
+#include "scan_matrix.h"
+
+// =============================================
+// БЕНЧМАРК БЫСТРОЙ ПРОВЕРКИ ИЗВЕСТНОЙ КАРТЫ
+// Стоимость чтения занятой ячейки: полная антиколлизия InListPassiveTarget
+// против WUPA и ATQA (InCommunicateThru) для карты из кэша.
+// Сценарии: вход на ячейку после переключения, повтор на той же ячейке
+// (задержка на карте), карта снята, подменена картой того же типа и другого.
+// wrong - неверный результат самого чтения, wrong_after_dwell - после
+// следующего чтения задержки на карте (оно всегда полное).
+// stale_profile: профиль слабой ячейки сменился после активации соседней -
+// проверка обязана дописать RFCfg/ModGsP в CIU, иначе метка молчит
+// =============================================
+
+extern ScanMatrix scanMatrix;
+extern RFIDManager rfidManager;
+extern MultiplexerManager muxManager;
+
+static const int AWAY_CELL = MATRIX_TOTAL_CELLS - 1;   // Пустая и далекая от меток
+
+enum VerifyScenario {
+    SCENARIO_ENTER,
+    SCENARIO_DWELL,
+    SCENARIO_GONE,
+    SCENARIO_OTHER,
+    SCENARIO_OTHER_TYPE,
+    SCENARIO_COUNT
+};
+
+static const char* SCENARIO_NAMES[SCENARIO_COUNT] = {"enter", "dwell", "gone", "other", "other_type"};
+
+struct PathCost {
+    uint64_t totalUs;
+    uint32_t commands;
+    uint32_t samples;
+    uint32_t wrong;             // Результат не совпал с доской
+    uint32_t wrongAfterDwell;   // ...и после следующего чтения на той же ячейке
+};
+
+static bool resultMatches(BenchEnvironment& env, int cell, ScanResult result) {
+    const EmulatedTag& tag = env.board.tagAt(cell);
+    if (!tag.present) {
+        return result == SCAN_NO_CARD;
+    }
+    uint8_t uid[UID_BUFFER_SIZE];
+    uint8_t uidLength;
+    return (result == SCAN_CARD_FOUND || result == SCAN_CARD_CHANGED) &&
+           rfidManager.getLastUID(uid, uidLength) && uidLength == tag.uidLength &&
+           memcmp(uid, tag.uid, uidLength) == 0;
+}
+
+static void measure(BenchEnvironment& env, PathCost& cost, int cell) {
+    uint64_t start = hostsim::nowMicros();
+    uint32_t frames = env.pn532.getFramesReceived();
+    ScanResult result = scanMatrix.scanCell(cell);
+    cost.totalUs += hostsim::nowMicros() - start;
+    cost.commands += env.pn532.getFramesReceived() - frames;
+    cost.samples++;
+    if (!resultMatches(env, cell, result)) {
+        cost.wrong++;
+    }
+    if (!resultMatches(env, cell, scanMatrix.scanCell(cell))) {
+        cost.wrongAfterDwell++;
+    }
+}
+
+static void runScenario(BenchEnvironment& env, VerifyScenario scenario, int cell, PathCost& cost) {
+    EmulatedTag saved = env.board.tagAt(cell);
+
+    if (scenario == SCENARIO_GONE) {
+        env.board.removeTag(cell);
+    } else if (scenario == SCENARIO_OTHER || scenario == SCENARIO_OTHER_TYPE) {
+        uint8_t other[7];
+        memcpy(other, saved.uid, saved.uidLength);
+        other[1] ^= 0x5A;
+        other[4] = other[5] = other[6] = 0xA5;
+        uint8_t otherLength = saved.uidLength;
+        if (scenario == SCENARIO_OTHER_TYPE) {
+            otherLength = (saved.uidLength == 7) ? 4 : 7;
+        }
+        env.board.placeTag(cell, other, otherLength);
+    }
+
+    scanMatrix.scanCell(AWAY_CELL);
+    if (scenario == SCENARIO_DWELL) {
+        scanMatrix.scanCell(cell);
+    }
+    measure(env, cost, cell);
+
+    env.board.placeTag(cell, saved.uid, saved.uidLength);
+}
+
+static uint32_t runStaleProfile(BenchEnvironment& env, int cell, int rounds) {
+    CardInfo cached = scanMatrix.getCardInfo(cell);
+    uint32_t present = 0;
+
+    // Слабой ячейке нужен максимальный профиль: со штатным 1 попытка из 8
+    env.board.setCellAnalog(cell, 7, 7, 0x08);
+    for (int r = 0; r < rounds; r++) {
+        scanMatrix.scanCell(AWAY_CELL);         // Активация грузит в CIU штатный профиль
+        muxManager.selectCellByIndex(cell);
+        rfidManager.setRfProfile(RF_PROFILE_COUNT - 1);
+        if (rfidManager.verifyCard(cached.uid, cached.uidLength) == VERIFY_PRESENT) {
+            present++;
+        }
+    }
+    env.board.setCellAnalog(cell, 0, 6, 0x3F);
+    return present;
+}
+
+int runVerifyBench(int argc, char** argv) {
+    int rounds = (argc > 0) ? atoi(argv[0]) : 10;
+
+    BenchEnvironment env;
+    env.attach();
+    hostsim::eraseFlash();
+    placeReferenceTags(env.board);
+
+    setup();
+
+    // Один проход наполняет кэш
+    unsigned long cycleStart = scanMatrix.getCycleStartTime();
+    while (scanMatrix.getLastCycleTime() == 0 || scanMatrix.getCycleStartTime() == cycleStart) {
+        loop();
+    }
+
+    int occupied[MATRIX_TOTAL_CELLS];
+    int occupiedCount = 0;
+    for (int i = 0; i < MATRIX_TOTAL_CELLS; i++) {
+        if (scanMatrix.isCardPresent(i)) {
+            occupied[occupiedCount++] = i;
+        }
+    }
+
+    // [0] - полная антиколлизия, [1] - быстрая проверка. Режимы чередуются,
+    // чтобы калибровка таймингов влияла на оба одинаково
+    PathCost costs[2][SCENARIO_COUNT];
+    memset(costs, 0, sizeof(costs));
+
+    for (int r = 0; r < rounds; r++) {
+        for (int c = 0; c < occupiedCount; c++) {
+            for (int s = 0; s < SCENARIO_COUNT; s++) {
+                for (int mode = 0; mode < 2; mode++) {
+                    scanMatrix.setFastVerify(mode == 1);
+                    runScenario(env, (VerifyScenario)s, occupied[c], costs[mode][s]);
+                }
+            }
+        }
+    }
+    scanMatrix.setFastVerify(ENABLE_FAST_VERIFY);
+    uint32_t stalePresent = runStaleProfile(env, occupied[0], rounds * 4);
+
+    printf("{\"bench\":\"verify\",\"rounds\":%d,\"occupied_cells\":%d,\"scenarios\":[",
+           rounds, occupiedCount);
+    for (int s = 0; s < SCENARIO_COUNT; s++) {
+        printf("%s{\"scenario\":\"%s\"", s ? "," : "", SCENARIO_NAMES[s]);
+        const char* modes[2] = {"full", "verify"};
+        for (int mode = 0; mode < 2; mode++) {
+            const PathCost& c = costs[mode][s];
+            printf(",\"%s\":{\"mean_us\":%lu,\"commands\":%.1f,\"wrong\":%u,\"wrong_after_dwell\":%u}",
+                   modes[mode], c.samples ? (unsigned long)(c.totalUs / c.samples) : 0,
+                   c.samples ? (double)c.commands / c.samples : 0.0, (unsigned)c.wrong,
+                   (unsigned)c.wrongAfterDwell);
+        }
+        printf("}");
+    }
+    printf("],\"verify_results\":{\"present\":%u,\"absent\":%u,\"other\":%u,\"error\":%u},"
+           "\"stale_profile\":{\"checks\":%d,\"present\":%u}}\n",
+           (unsigned)scanMatrix.getVerifyCount(VERIFY_PRESENT),
+           (unsigned)scanMatrix.getVerifyCount(VERIFY_ABSENT),
+           (unsigned)scanMatrix.getVerifyCount(VERIFY_OTHER),
+           (unsigned)scanMatrix.getVerifyCount(VERIFY_ERROR), rounds * 4, (unsigned)stalePresent);
+    return stalePresent == (uint32_t)(rounds * 4) ? 0 : 1;
+}
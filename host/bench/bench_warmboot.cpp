@@ -0,0 +1,107 @@
+#include "benchmarks.h"
+#include "scan_matrix.h"
+
+// =============================================
+// БЕНЧМАРК ТЕПЛОГО СТАРТА
+// Время от включения до опубликованной (предположительной) доски, до
+// подтверждения восстановленных ячеек и до первой достоверной доски
+// (каждая ячейка просканирована после включения). Холодный старт - с
+// чистой NVS, теплый - перезагрузка с сохраненным снимком
+// =============================================
+
+extern ScanMatrix scanMatrix;
+
+static const unsigned long WARMBOOT_DEADLINE_MS = 60000;
+
+struct BootTimes {
+    unsigned long assumedMs;
+    unsigned long restoredVerifiedMs;
+    unsigned long validMs;
+    int restoredCards;
+    int cardsAtValid;
+    bool matchesBoard;
+};
+
+static bool cacheMatchesBoard(const BenchEnvironment& env) {
+    for (int i = 0; i < MATRIX_TOTAL_CELLS; i++) {
+        const CardInfo& info = scanMatrix.getCardInfo(i);
+        const EmulatedTag& tag = env.board.tagAt(i);
+        if (info.present != tag.present) return false;
+        if (tag.present && (info.uidLength != tag.uidLength ||
+                            memcmp(info.uid, tag.uid, tag.uidLength) != 0)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static BootTimes measureBoot(BenchEnvironment& env) {
+    setup();
+
+    while (!scanMatrix.isBoardValid() && millis() < WARMBOOT_DEADLINE_MS) {
+        loop();
+    }
+
+    BootTimes t;
+    t.assumedMs = scanMatrix.getAssumedBoardTime();
+    t.restoredVerifiedMs = scanMatrix.getRestoredVerifiedTime();
+    t.validMs = scanMatrix.isBoardValid() ? scanMatrix.getFirstValidBoardTime() : 0;
+    t.restoredCards = scanMatrix.getRestoredCards();
+    t.cardsAtValid = scanMatrix.findCardsInMatrix();
+    t.matchesBoard = cacheMatchesBoard(env);
+    return t;
+}
+
+static void printBoot(const char* name, const BootTimes& t, bool last) {
+    printf("\"%s\":{\"assumed_board_ms\":%lu,\"restored_verified_ms\":%lu,"
+           "\"first_valid_board_ms\":%lu,\"restored_cards\":%d,\"cards\":%d,\"matches_board\":%s}%s",
+           name, t.assumedMs, t.restoredVerifiedMs, t.validMs, t.restoredCards,
+           t.cardsAtValid, t.matchesBoard ? "true" : "false", last ? "" : ",");
+}
+
+int runWarmBootBench(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+
+    BenchEnvironment env;
+    env.attach();
+    hostsim::eraseFlash();
+    placeReferenceTags(env.board);
+
+    // Холодный старт: NVS пуста
+    BootTimes cold = measureBoot(env);
+
+    // Дадим снимку записаться (затишье + интервал записи)
+    env.runFor(SNAPSHOT_DEBOUNCE_MS + 1000);
+    uint32_t writesBeforeReboot = hostsim::getFlashWrites();
+
+    // Теплый старт: доска не менялась
+    rebootFirmware(env);
+    BootTimes warm = measureBoot(env);
+
+    // Теплый старт после того, как фигуру переставили при выключенном питании
+    env.runFor(SNAPSHOT_DEBOUNCE_MS + 1000);
+    env.board.moveTag(24, 40);
+    rebootFirmware(env);
+    BootTimes moved = measureBoot(env);
+
+    // Шумный режим: доска меняется каждые 2 с в течение 5 минут - считаем записи flash
+    uint32_t writesBeforeChurn = hostsim::getFlashWrites();
+    unsigned long churnMs = 300000;
+    for (unsigned long t = 0; t < churnMs; t += 2000) {
+        int from = env.board.hasTag(40) ? 40 : 41;
+        env.board.moveTag(from, from == 40 ? 41 : 40);
+        env.runFor(2000);
+    }
+    uint32_t churnWrites = hostsim::getFlashWrites() - writesBeforeChurn;
+
+    printf("{\"bench\":\"warmboot\",");
+    printBoot("cold", cold, false);
+    printBoot("warm", warm, false);
+    printBoot("warm_moved", moved, false);
+    printf("\"flash_writes_first_boot\":%u,\"churn_changes\":%lu,\"churn_flash_writes\":%u,"
+           "\"snapshot_bytes\":%u}\n",
+           (unsigned)writesBeforeReboot, churnMs / 2000, (unsigned)churnWrites,
+           (unsigned)sizeof(BoardSnapshot));
+    return 0;
+}
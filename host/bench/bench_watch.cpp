@@ -0,0 +1,124 @@
+#include "benchmarks.h"
+#include "scan_matrix.h"
+#include <algorithm>
+#include <vector>
+
+// =============================================
+// БЕНЧМАРК НАБЛЮДЕНИЯ ЗА ЯЧЕЙКОЙ (InAutoPoll)
+// Фигуру снимают, пока проход стоит на ее ячейке, и ставят обратно через
+// 0.3-1.5 с. Без наблюдения возврат виден только следующим проходом;
+// с наблюдением PN532 сам опрашивает поле, хост читает байт RDY.
+// Цена - проход стоит, пока идет наблюдение (задержка остальных ячеек)
+// =============================================
+
+extern ScanMatrix scanMatrix;
+
+static const int REFERENCE_CELLS[] = {2, 12, 14, 24, 25, 26};
+static const unsigned long RETURN_TIMEOUT_MS = 30000;
+
+struct WatchModeResult {
+    std::vector<unsigned long> latencyMs;   // От возврата фигуры до кэша
+    uint32_t commands;                      // Кадров PN532 от снятия до обнаружения
+    uint32_t missedLifts;                   // Снятие не заметили за время удержания
+    unsigned long meanCycleMs;
+};
+
+static unsigned long percentile(std::vector<unsigned long> values, int pct) {
+    if (values.empty()) return 0;
+    std::sort(values.begin(), values.end());
+    size_t index = (values.size() - 1) * pct / 100;
+    return values[index];
+}
+
+static WatchModeResult runMode(BenchEnvironment& env, bool watch, int trials) {
+    WatchModeResult r;
+    r.commands = 0;
+    r.missedLifts = 0;
+
+    rebootFirmware(env);
+    hostsim::eraseFlash();
+    env.board.clear();
+    placeReferenceTags(env.board);
+    setup();
+    scanMatrix.setWatchAfterRemoval(watch);
+
+    while (!scanMatrix.isBoardValid()) {
+        loop();
+    }
+
+    unsigned long cycleTotal = 0;
+    uint32_t cycles = 0;
+    unsigned long lastCycleStart = scanMatrix.getCycleStartTime();
+
+    for (int t = 0; t < trials; t++) {
+        int cell = REFERENCE_CELLS[t % 6];
+
+        // Проход дошел до ячейки и читает карту на ней
+        while (!(scanMatrix.getCurrentCellIndex() == cell && scanMatrix.isCardPresent(cell))) {
+            loop();
+            if (scanMatrix.getCycleStartTime() != lastCycleStart) {
+                lastCycleStart = scanMatrix.getCycleStartTime();
+                cycleTotal += scanMatrix.getLastCycleTime();
+                cycles++;
+            }
+        }
+
+        EmulatedTag saved = env.board.tagAt(cell);
+        uint32_t framesBefore = env.pn532.getFramesReceived();
+        env.board.removeTag(cell);
+        env.runFor(env.randomRange(300, 1500));
+        if (scanMatrix.isCardPresent(cell)) {
+            r.missedLifts++;
+        }
+
+        env.board.placeTag(cell, saved.uid, saved.uidLength);
+        unsigned long putAt = millis();
+        while (!scanMatrix.isCardPresent(cell) && millis() - putAt < RETURN_TIMEOUT_MS) {
+            loop();
+            if (scanMatrix.getCycleStartTime() != lastCycleStart) {
+                lastCycleStart = scanMatrix.getCycleStartTime();
+                cycleTotal += scanMatrix.getLastCycleTime();
+                cycles++;
+            }
+        }
+        r.latencyMs.push_back(millis() - putAt);
+        r.commands += env.pn532.getFramesReceived() - framesBefore;
+    }
+
+    r.meanCycleMs = cycles ? cycleTotal / cycles : 0;
+    return r;
+}
+
+int runWatchBench(int argc, char** argv) {
+    int trials = (argc > 0) ? atoi(argv[0]) : 24;
+
+    BenchEnvironment env;
+    env.attach();
+
+    printf("{\"bench\":\"watch\",\"trials\":%d,\"autopoll_period_ms\":%d,\"modes\":[",
+           trials, WATCH_AUTOPOLL_PERIOD * 150);
+    for (int m = 0; m < 2; m++) {
+        bool watch = (m == 1);
+        WatchModeResult r = runMode(env, watch, trials);
+        unsigned long sum = 0;
+        for (size_t i = 0; i < r.latencyMs.size(); i++) {
+            sum += r.latencyMs[i];
+        }
+        printf("%s{\"mode\":\"%s\",\"return_latency_ms\":{\"mean\":%lu,\"p50\":%lu,\"p95\":%lu,\"max\":%lu},"
+               "\"commands_per_trial\":%.1f,\"missed_lifts\":%u,\"mean_cycle_ms\":%lu",
+               m ? "," : "", watch ? "autopoll" : "pass", sum / r.latencyMs.size(),
+               percentile(r.latencyMs, 50), percentile(r.latencyMs, 95), percentile(r.latencyMs, 100),
+               (double)r.commands / trials, (unsigned)r.missedLifts, r.meanCycleMs);
+        if (watch) {
+            printf(",\"sessions\":%u,\"hits\":%u,\"timeouts\":%u,\"preempted\":%u,"
+                   "\"mean_hit_ms\":%lu,\"watch_ms_per_session\":%lu",
+                   (unsigned)scanMatrix.getWatchSessions(), (unsigned)scanMatrix.getWatchHits(),
+                   (unsigned)scanMatrix.getWatchTimeouts(), (unsigned)scanMatrix.getWatchPreempted(),
+                   scanMatrix.getMeanWatchHitMs(),
+                   scanMatrix.getWatchSessions() ? scanMatrix.getWatchTotalMs() / scanMatrix.getWatchSessions() : 0);
+        }
+        printf("}");
+    }
+    printf("]}\n");
+    return 0;
+}
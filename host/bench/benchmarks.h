@@ -0,0 +1,82 @@
+#ifndef HOST_BENCHMARKS_H
+#define HOST_BENCHMARKS_H
+
+#include <Arduino.h>
+#include "host_sim.h"
+#include "pn532_emulator.h"
+
+// =============================================
+// ХОСТ-БЕНЧМАРКИ: прошивка (setup/loop из main.cpp) поверх эмулятора
+// Запуск: .pio/build/native/program <бенчмарк> [параметры]
+// Результат - JSON в stdout, вывод прошивки подавлен
+// =============================================
+
+// Точки входа прошивки (src/main.cpp)
+void setup();
+void loop();
+
+// Общее окружение: доска, PN532 и детерминированный ГПСЧ
+struct BenchEnvironment {
+    BoardModel board;
+    PN532Emulator pn532;
+    uint32_t rngState;
+
+    BenchEnvironment() : pn532(&board), rngState(12345) {}
+
+    void attach(bool firmwareOutput = false) {
+        hostsim::setSerialEcho(firmwareOutput);
+        board.attach();
+        pn532.attach();
+    }
+
+    uint32_t random() {
+        rngState = rngState * 1664525UL + 1013904223UL;
+        return rngState >> 8;
+    }
+
+    uint32_t randomRange(uint32_t lo, uint32_t hi) {
+        return lo + random() % (hi - lo + 1);
+    }
+
+    // Крутит loop() пока не истечет durationMs виртуального времени
+    void runFor(unsigned long durationMs) {
+        uint64_t end = hostsim::nowMicros() + (uint64_t)durationMs * 1000ULL;
+        while (hostsim::nowMicros() < end) {
+            loop();
+        }
+    }
+};
+
+// Перезагрузка прошивки: глобальные объекты main.cpp создаются заново,
+// millis() снова с нуля, PN532 проходит сброс по питанию; NVS сохраняется
+void rebootFirmware(BenchEnvironment& env);
+
+// Стандартная расстановка: 6 меток из лога стенда (UID NTAG, 7 байт)
+void placeReferenceTags(BoardModel& board);
+
+int runRecoveryBench(int argc, char** argv);
+int runLivenessBench(int argc, char** argv);
+int runQueueBench(int argc, char** argv);
+int runWarmBootBench(int argc, char** argv);
+int runCalibrationBench(int argc, char** argv);
+int runVerifyBench(int argc, char** argv);
+int runMultiTargetBench(int argc, char** argv);
+int runWatchBench(int argc, char** argv);
+int runIrqBench(int argc, char** argv);
+int runRfProfileBench(int argc, char** argv);
+int runRfGateBench(int argc, char** argv);
+int runQuarantineBench(int argc, char** argv);
+int runEventsBench(int argc, char** argv);
+int runMovesBench(int argc, char** argv);
+int runPgnBench(int argc, char** argv);
+int runFaultsBench(int argc, char** argv);
+int runCrosstalkBench(int argc, char** argv);
+int runReplayBench(int argc, char** argv);
+int runKernelsBench(int argc, char** argv);
+int runMetricsBench(int argc, char** argv);
+int runConsoleBench(int argc, char** argv);
+int runStatesBench(int argc, char** argv);
+int runMemoryBench(int argc, char** argv);
+int runGeometryBench(int argc, char** argv);
+
+#endif // HOST_BENCHMARKS_H
@@ -0,0 +1,536 @@
+#include "chess_workload.h"
+#include "move_recognizer.h"
+#include <cctype>
+
+// =============================================
+// РАЗБОР PGN: SAN -> UCI
+// Неоднозначность SAN снимается по легальным ходам (связанная фигура не в счет),
+// поэтому ведется своя позиция со взятием на проходе и превращениями. Права на
+// рокировку не проверяются - запись партии считается корректной
+// =============================================
+
+namespace {
+
+struct Position {
+    char board[64];             // FEN-буквы, '.' - пусто
+    bool white;
+    int epSquare;               // Поле взятия на проходе, -1 нет
+
+    void reset() {
+        static const char backRank[] = "RNBQKBNR";
+        for (int i = 0; i < 64; i++) {
+            int rank = i / 8;
+            char piece = '.';
+            if (rank == 0) piece = backRank[i % 8];
+            else if (rank == 1) piece = 'P';
+            else if (rank == 6) piece = 'p';
+            else if (rank == 7) piece = tolower(backRank[i % 8]);
+            board[i] = piece;
+        }
+        white = true;
+        epSquare = -1;
+    }
+};
+
+bool isOwn(char piece, bool white) {
+    return piece != '.' && (isupper(piece) != 0) == white;
+}
+
+bool onBoard(int rank, int file) {
+    return rank >= 0 && rank < 8 && file >= 0 && file < 8;
+}
+
+bool pathClear(const Position& pos, int from, int to) {
+    int dr = (to / 8 > from / 8) - (to / 8 < from / 8);
+    int df = (to % 8 > from % 8) - (to % 8 < from % 8);
+    int rank = from / 8 + dr, file = from % 8 + df;
+    while (rank * 8 + file != to) {
+        if (pos.board[rank * 8 + file] != '.') {
+            return false;
+        }
+        rank += dr;
+        file += df;
+    }
+    return true;
+}
+
+// Ход фигуры (не пешки) по правилам ее движения, без учета шаха
+bool pieceReaches(const Position& pos, char type, int from, int to) {
+    int dr = abs(to / 8 - from / 8), df = abs(to % 8 - from % 8);
+    switch (type) {
+        case 'N': return (dr == 1 && df == 2) || (dr == 2 && df == 1);
+        case 'K': return dr <= 1 && df <= 1 && (dr || df);
+        case 'R': return (dr == 0) != (df == 0) && pathClear(pos, from, to);
+        case 'B': return dr == df && dr > 0 && pathClear(pos, from, to);
+        case 'Q': return ((dr == 0) != (df == 0) || (dr == df && dr > 0)) && pathClear(pos, from, to);
+    }
+    return false;
+}
+
+bool attacked(const Position& pos, int square, bool byWhite) {
+    int rank = square / 8, file = square % 8;
+    int pawnRank = rank + (byWhite ? -1 : 1);
+    for (int df = -1; df <= 1; df += 2) {
+        if (onBoard(pawnRank, file + df) && pos.board[pawnRank * 8 + file + df] == (byWhite ? 'P' : 'p')) {
+            return true;
+        }
+    }
+    for (int from = 0; from < 64; from++) {
+        char piece = pos.board[from];
+        if (from == square || !isOwn(piece, byWhite) || toupper(piece) == 'P') {
+            continue;
+        }
+        if (pieceReaches(pos, toupper(piece), from, square)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void makeMove(Position& pos, int from, int to, char promotion) {
+    char piece = pos.board[from];
+    char type = toupper(piece);
+
+    if (type == 'P' && to == pos.epSquare) {
+        pos.board[(from / 8) * 8 + to % 8] = '.';
+    }
+    if (type == 'K' && abs(to % 8 - from % 8) == 2) {
+        int rookFrom = (from / 8) * 8 + (to > from ? 7 : 0);
+        int rookTo = (from / 8) * 8 + (to > from ? 5 : 3);
+        pos.board[rookTo] = pos.board[rookFrom];
+        pos.board[rookFrom] = '.';
+    }
+
+    pos.epSquare = (type == 'P' && abs(to - from) == 16) ? (from + to) / 2 : -1;
+    pos.board[to] = promotion ? (pos.white ? toupper(promotion) : tolower(promotion)) : piece;
+    pos.board[from] = '.';
+    pos.white = !pos.white;
+}
+
+bool isLegal(const Position& pos, int from, int to, char promotion) {
+    Position next = pos;
+    makeMove(next, from, to, promotion);
+    char king = pos.white ? 'K' : 'k';
+    for (int i = 0; i < 64; i++) {
+        if (next.board[i] == king) {
+            return !attacked(next, i, !pos.white);
+        }
+    }
+    return false;
+}
+
+int parseSquareName(const std::string& text, size_t at) {
+    if (at + 1 >= text.size() || text[at] < 'a' || text[at] > 'h' || text[at + 1] < '1' || text[at + 1] > '8') {
+        return -1;
+    }
+    return (text[at + 1] - '1') * 8 + (text[at] - 'a');
+}
+
+// SAN одного хода -> from/to/promotion; false - ход не распознан или нелегален
+bool sanToMove(const Position& pos, std::string san, int& from, int& to, char& promotion) {
+    while (!san.empty() && strchr("+#!?", san.back())) {
+        san.pop_back();
+    }
+    promotion = 0;
+
+    int homeRank = pos.white ? 0 : 7;
+    if (san == "O-O" || san == "0-0" || san == "O-O-O" || san == "0-0-0") {
+        from = homeRank * 8 + 4;
+        to = homeRank * 8 + (san.size() == 3 ? 6 : 2);
+        return pos.board[from] == (pos.white ? 'K' : 'k') && isLegal(pos, from, to, 0);
+    }
+
+    size_t eq = san.find('=');
+    if (eq != std::string::npos && eq + 1 < san.size()) {
+        promotion = tolower(san[eq + 1]);
+        san.erase(eq);
+    } else if (san.size() > 2 && strchr("QRBN", san.back()) && isdigit(san[san.size() - 2])) {
+        promotion = tolower(san.back());
+        san.pop_back();
+    }
+    std::string body;
+    for (char c : san) {
+        if (c != 'x' && c != '-' && c != ':') body += c;
+    }
+    if (body.size() < 2) {
+        return false;
+    }
+
+    char type = isupper(body[0]) ? body[0] : 'P';
+    if (type != 'P') {
+        body.erase(0, 1);
+    }
+    to = parseSquareName(body, body.size() - 2);
+    if (to < 0 || isOwn(pos.board[to], pos.white)) {
+        return false;
+    }
+    std::string hint = body.substr(0, body.size() - 2);
+    int hintFile = -1, hintRank = -1;
+    for (char c : hint) {
+        if (c >= 'a' && c <= 'h') hintFile = c - 'a';
+        else if (c >= '1' && c <= '8') hintRank = c - '1';
+    }
+
+    char own = pos.white ? type : tolower(type);
+    int found = -1;
+    for (int square = 0; square < 64; square++) {
+        if (pos.board[square] != own || (hintFile >= 0 && square % 8 != hintFile) ||
+            (hintRank >= 0 && square / 8 != hintRank)) {
+            continue;
+        }
+        bool reaches;
+        if (type == 'P') {
+            int dir = pos.white ? 1 : -1;
+            int dr = to / 8 - square / 8, df = to % 8 - square % 8;
+            if (df == 0) {
+                reaches = pos.board[to] == '.' &&
+                          (dr == dir || (dr == 2 * dir && square / 8 == (pos.white ? 1 : 6) &&
+                                         pos.board[square + 8 * dir] == '.'));
+            } else {
+                reaches = abs(df) == 1 && dr == dir && (pos.board[to] != '.' || to == pos.epSquare);
+            }
+        } else {
+            reaches = pieceReaches(pos, type, square, to);
+        }
+        if (reaches && isLegal(pos, square, to, promotion)) {
+            if (found >= 0) {
+                return false;       // Неоднозначно
+            }
+            found = square;
+        }
+    }
+    from = found;
+    return found >= 0;
+}
+
+// [%clk h:mm:ss(.d)] внутри комментария
+long parseClock(const std::string& comment) {
+    size_t at = comment.find("%clk");
+    if (at == std::string::npos) {
+        return -1;
+    }
+    int h = 0, m = 0;
+    double s = 0;
+    if (sscanf(comment.c_str() + at + 4, " %d:%d:%lf", &h, &m, &s) != 3) {
+        return -1;
+    }
+    return (long)((h * 3600 + m * 60 + s) * 1000.0);
+}
+
+std::string tagValue(const std::string& tag, const char* name) {
+    std::string prefix = std::string("[") + name + " \"";
+    if (tag.compare(0, prefix.size(), prefix) != 0) {
+        return "";
+    }
+    size_t end = tag.find('"', prefix.size());
+    return tag.substr(prefix.size(), end == std::string::npos ? std::string::npos : end - prefix.size());
+}
+
+} // namespace
+
+int parsePgn(const std::string& text, std::vector<WorkloadGame>& games, std::string* error) {
+    Position pos;
+    pos.reset();
+    WorkloadGame game;
+    std::string white, black;
+    bool broken = false;
+    size_t firstGame = games.size();
+
+    auto finishGame = [&]() {
+        if (!game.moves.empty()) {
+            if (game.name.empty()) {
+                game.name = (!white.empty() || !black.empty()) ? white + " - " + black
+                                                               : "game " + std::to_string(games.size() + 1);
+            }
+            games.push_back(game);
+        }
+        game = WorkloadGame();
+        white.clear();
+        black.clear();
+        pos.reset();
+        broken = false;
+    };
+
+    size_t i = 0;
+    while (i < text.size()) {
+        char c = text[i];
+        if (isspace((unsigned char)c)) {
+            i++;
+        } else if (c == '[') {
+            size_t end = text.find(']', i);
+            std::string tag = text.substr(i, end == std::string::npos ? std::string::npos : end - i + 1);
+            if (!game.moves.empty()) {
+                finishGame();       // Заголовок следующей партии без результата у предыдущей
+            }
+            if (!tagValue(tag, "White").empty()) white = tagValue(tag, "White");
+            if (!tagValue(tag, "Black").empty()) black = tagValue(tag, "Black");
+            i = (end == std::string::npos) ? text.size() : end + 1;
+        } else if (c == '{') {
+            size_t end = text.find('}', i);
+            std::string comment = text.substr(i, end == std::string::npos ? std::string::npos : end - i);
+            long clock = parseClock(comment);
+            if (clock >= 0 && !game.moves.empty() && !broken) {
+                game.moves.back().clockMs = clock;
+            }
+            i = (end == std::string::npos) ? text.size() : end + 1;
+        } else if (c == ';') {
+            size_t end = text.find('\n', i);
+            i = (end == std::string::npos) ? text.size() : end + 1;
+        } else if (c == '(') {
+            // Варианты не разыгрываются
+            int depth = 0;
+            for (; i < text.size(); i++) {
+                if (text[i] == '(') depth++;
+                else if (text[i] == ')' && --depth == 0) break;
+                else if (text[i] == '{') i = text.find('}', i) == std::string::npos ? text.size() : text.find('}', i);
+            }
+            i++;
+        } else {
+            size_t end = i;
+            while (end < text.size() && !isspace((unsigned char)text[end]) && !strchr("{}();[", text[end])) {
+                end++;
+            }
+            std::string token = text.substr(i, end - i);
+            i = end;
+
+            if (token == "1-0" || token == "0-1" || token == "1/2-1/2" || token == "*") {
+                finishGame();
+                continue;
+            }
+            if (token[0] == '$') {
+                continue;           // NAG
+            }
+            size_t skip = 0;
+            while (skip < token.size() && (isdigit((unsigned char)token[skip]) || token[skip] == '.')) {
+                skip++;
+            }
+            if (skip > 0 && skip < token.size() && token[skip - 1] != '.') {
+                skip = 0;           // "0-0" - рокировка, а не номер хода
+            }
+            token.erase(0, skip);
+            if (token.empty() || broken) {
+                continue;
+            }
+
+            int from, to;
+            char promotion;
+            if (!sanToMove(pos, token, from, to, promotion)) {
+                if (error != nullptr && error->empty()) {
+                    *error = "партия " + std::to_string(games.size() + 1) + ", полуход " +
+                             std::to_string(game.moves.size() + 1) + ": " + token;
+                }
+                broken = true;
+                continue;
+            }
+
+            WorkloadMove move;
+            char uci[6];
+            MoveRecognizer::squareName(from, uci);
+            MoveRecognizer::squareName(to, uci + 2);
+            uci[4] = promotion;
+            uci[5] = '\0';
+            move.uci = uci;
+            move.clockMs = -1;
+            game.moves.push_back(move);
+            makeMove(pos, from, to, promotion);
+        }
+    }
+    finishGame();
+    return games.size() - firstGame;
+}
+
+unsigned long thinkTimeMs(BenchEnvironment& env, const WorkloadGame& game, size_t ply, unsigned long maxMs) {
+    unsigned long think;
+    if (ply >= 2 && game.moves[ply].clockMs >= 0 && game.moves[ply - 2].clockMs >= 0) {
+        // Часы того же игрока до и после хода (добавка может сделать разницу отрицательной)
+        long spent = game.moves[ply - 2].clockMs - game.moves[ply].clockMs;
+        think = spent > 1000 ? spent : 1000;
+    } else if (ply < 16) {
+        think = env.randomRange(2000, 10000);       // Дебют по памяти
+    } else {
+        uint32_t dice = env.randomRange(0, 99);
+        if (dice < 70) think = env.randomRange(5000, 30000);
+        else if (dice < 95) think = env.randomRange(30000, 120000);
+        else think = env.randomRange(120000, 300000);
+    }
+    return (maxMs > 0 && think > maxMs) ? maxMs : think;
+}
+
+// =============================================
+// РУКА ИГРОКА
+// =============================================
+
+static int cellOf(int square) { return MoveRecognizer::squareToCell(square); }
+static bool isWhiteType(char type) { return type >= 'A' && type <= 'Z'; }
+
+// Свободная ячейка лотка: белые - столбцы 0-1, черные - 10-11
+static int freeTrayCell(BoardModel& board, bool white) {
+    for (int row = 0; row < MATRIX_ROWS; row++) {
+        for (int c = 0; c < 2; c++) {
+            int col = white ? c : MATRIX_COLS - 1 - c;
+            int cell = row * MATRIX_COLS + col;
+            if (!board.hasTag(cell)) {
+                return cell;
+            }
+        }
+    }
+    return -1;
+}
+
+void Hand::lift(int cellIndex) {
+    env.runFor(env.randomRange(minPauseMs, maxPauseMs));
+    env.board.removeTag(cellIndex);
+    if (onOp != nullptr) {
+        onOp(cellIndex, false, nullptr, context);
+    }
+}
+
+void Hand::place(int cellIndex, int tag) {
+    env.runFor(env.randomRange(minPauseMs, maxPauseMs));
+    env.board.placeTag(cellIndex, played.uid[tag], 7);
+    if (onOp != nullptr) {
+        onOp(cellIndex, true, played.uid[tag], context);
+    }
+}
+
+void Hand::toTray(int tag) {
+    place(freeTrayCell(env.board, isWhiteType(played.type[tag])), tag);
+}
+
+void setUpChessBoard(BenchEnvironment& env, PlayedBoard& played) {
+    static const char backRank[] = "RNBQKBNR";
+
+    env.board.clear();
+    int tag = 0;
+    for (int square = 0; square < 64; square++) {
+        played.square[square] = -1;
+        int rank = square / 8;
+        char type = 0;
+        if (rank == 0) type = backRank[square % 8];
+        else if (rank == 1) type = 'P';
+        else if (rank == 6) type = 'p';
+        else if (rank == 7) type = backRank[square % 8] - 'A' + 'a';
+        if (type == 0) {
+            continue;
+        }
+        played.type[tag] = type;
+        played.square[square] = tag;
+        tag++;
+    }
+    played.type[WORKLOAD_PIECE_TAGS] = 'Q';
+    played.type[WORKLOAD_PIECE_TAGS + 1] = 'q';
+
+    for (int t = 0; t < WORKLOAD_TAGS; t++) {
+        const uint8_t uid[7] = {0x04, (uint8_t)(0x10 + t), 0x5A, 0xC1, 0x22, 0x6B, 0x80};
+        memcpy(played.uid[t], uid, sizeof(uid));
+    }
+    for (int square = 0; square < 64; square++) {
+        if (played.square[square] >= 0) {
+            env.board.placeTag(cellOf(square), played.uid[played.square[square]], 7);
+        }
+    }
+    played.spare[0] = WORKLOAD_PIECE_TAGS;
+    played.spare[1] = WORKLOAD_PIECE_TAGS + 1;
+    env.board.placeTag(freeTrayCell(env.board, true), played.uid[WORKLOAD_PIECE_TAGS], 7);
+    env.board.placeTag(freeTrayCell(env.board, false), played.uid[WORKLOAD_PIECE_TAGS + 1], 7);
+}
+
+uint64_t playChessMove(Hand& hand, const char* uci, bool whiteToMove) {
+    BenchEnvironment& env = hand.env;
+    PlayedBoard& played = hand.played;
+    int from = (uci[1] - '1') * 8 + (uci[0] - 'a');
+    int to = (uci[3] - '1') * 8 + (uci[2] - 'a');
+    char promotion = uci[4];
+    int mover = played.square[from];
+    if (mover < 0 || isWhiteType(played.type[mover]) != whiteToMove) {
+        return 0;
+    }
+    char type = toupper(played.type[mover]);
+    int victim = played.square[to];
+    int fileStep = to % 8 - from % 8;
+
+    // Касание другой фигуры: сняли и поставили на место
+    if ((int)env.randomRange(0, 99) < hand.touchPercent) {
+        int square = env.randomRange(0, 63);
+        int tag = played.square[square];
+        if (tag >= 0 && square != from && square != to) {
+            unsigned long pause = hand.maxPauseMs;
+            hand.lift(cellOf(square));
+            hand.maxPauseMs = 600;
+            hand.place(cellOf(square), tag);
+            hand.maxPauseMs = pause;
+        }
+    }
+
+    uint64_t decisiveUs = 0;
+    if (type == 'K' && abs(fileStep) == 2) {
+        int rookFrom = (from / 8) * 8 + (fileStep > 0 ? 7 : 0);
+        int rookTo = (from / 8) * 8 + (fileStep > 0 ? 5 : 3);
+        int rook = played.square[rookFrom];
+        bool rookFirst = env.randomRange(0, 1) == 1;
+        if (rookFirst) {
+            hand.lift(cellOf(rookFrom));
+            hand.place(cellOf(rookTo), rook);
+        }
+        hand.lift(cellOf(from));
+        hand.place(cellOf(to), mover);
+        decisiveUs = hostsim::nowMicros();
+        if (!rookFirst) {
+            hand.lift(cellOf(rookFrom));
+            hand.place(cellOf(rookTo), rook);
+        }
+        played.square[rookFrom] = -1;
+        played.square[rookTo] = rook;
+    } else if (type == 'P' && fileStep != 0 && victim < 0) {
+        // На проходе: побитая пешка рядом с исходным полем
+        int victimSquare = (from / 8) * 8 + to % 8;
+        int pawn = played.square[victimSquare];
+        bool victimFirst = env.randomRange(0, 1) == 1;
+        if (victimFirst) {
+            hand.lift(cellOf(victimSquare));
+            hand.toTray(pawn);
+        }
+        hand.lift(cellOf(from));
+        hand.place(cellOf(to), mover);
+        decisiveUs = hostsim::nowMicros();
+        if (!victimFirst) {
+            hand.lift(cellOf(victimSquare));
+            hand.toTray(pawn);
+        }
+        played.square[victimSquare] = -1;
+    } else {
+        bool victimFirst = victim >= 0 && env.randomRange(0, 1) == 1;
+        if (victimFirst) {
+            hand.lift(cellOf(to));
+            hand.toTray(victim);
+        }
+        hand.lift(cellOf(from));
+        if (victim >= 0 && !victimFirst) {
+            // Фигура в руке, взятую снимают второй рукой
+            hand.lift(cellOf(to));
+        }
+
+        int placed = mover;
+        int spareIndex = whiteToMove ? 0 : 1;
+        if (promotion == 'q' && played.spare[spareIndex] >= 0 && env.randomRange(0, 1) == 1) {
+            // Пешка уходит в лоток, на поле - запасной ферзь
+            placed = played.spare[spareIndex];
+            played.spare[spareIndex] = -1;
+            hand.lift(env.board.findTag(played.uid[placed], 7));
+            hand.toTray(mover);
+        }
+        hand.place(cellOf(to), placed);
+        decisiveUs = hostsim::nowMicros();
+        if (victim >= 0 && !victimFirst) {
+            hand.toTray(victim);
+        }
+        mover = placed;
+        if (promotion != 0) {
+            played.type[mover] = whiteToMove ? toupper(promotion) : promotion;
+        }
+    }
+
+    played.square[from] = -1;
+    played.square[to] = mover;
+    return decisiveUs;
+}
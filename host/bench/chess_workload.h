@@ -0,0 +1,70 @@
+#ifndef HOST_CHESS_WORKLOAD_H
+#define HOST_CHESS_WORKLOAD_H
+
+#include "benchmarks.h"
+#include <string>
+#include <vector>
+
+// =============================================
+// ШАХМАТНАЯ НАГРУЗКА ДЛЯ БЕНЧМАРКОВ
+// Партии из PGN (SAN переводится в UCI) и "рука", которая разыгрывает ходы
+// метками на эмулируемой доске: 32 метки на столбцах CHESS_FILE_A_COL..+7,
+// битые фигуры - в лотки (столбцы 0-1 белые, 10-11 черные), там же запасные ферзи
+// =============================================
+
+struct WorkloadMove {
+    std::string uci;
+    long clockMs;               // Остаток часов после хода из {[%clk ...]}, -1 - нет
+};
+
+struct WorkloadGame {
+    std::string name;
+    std::vector<WorkloadMove> moves;
+};
+
+// Разбор PGN: партии, варианты, комментарии, NAG. Партия с нераспознанным
+// ходом обрезается на нем (описание - в error). Возвращает число партий
+int parsePgn(const std::string& text, std::vector<WorkloadGame>& games, std::string* error);
+
+// Время обдумывания перед ходом: по часам PGN, иначе случайное "человеческое"
+// (быстрый дебют, изредка долгие раздумья)
+unsigned long thinkTimeMs(BenchEnvironment& env, const WorkloadGame& game, size_t ply, unsigned long maxMs);
+
+static const int WORKLOAD_PIECE_TAGS = 32;
+static const int WORKLOAD_SPARE_TAGS = 2;   // Запасные ферзи: белый и черный
+static const int WORKLOAD_TAGS = WORKLOAD_PIECE_TAGS + WORKLOAD_SPARE_TAGS;
+
+// Доска на стороне игрока
+struct PlayedBoard {
+    int square[64];                 // Метка на поле, -1 пусто
+    char type[WORKLOAD_TAGS];
+    int spare[2];                   // Метка запасного ферзя (белый, черный), -1 - использован
+    uint8_t uid[WORKLOAD_TAGS][7];
+};
+
+// Физическое действие руки: ячейка стала пустой (present = false) или с меткой uid
+typedef void (*HandOpCallback)(int cellIndex, bool present, const uint8_t* uid, void* context);
+
+struct Hand {
+    BenchEnvironment& env;
+    PlayedBoard& played;
+    unsigned long minPauseMs;       // Пауза перед каждым действием
+    unsigned long maxPauseMs;
+    int touchPercent;               // Касание другой фигуры перед ходом (снята и возвращена)
+    HandOpCallback onOp;
+    void* context;
+
+    void lift(int cellIndex);
+    void place(int cellIndex, int tag);
+    void toTray(int tag);
+};
+
+// Начальная расстановка и запасные ферзи в лотках
+void setUpChessBoard(BenchEnvironment& env, PlayedBoard& played);
+
+// Разыгрывает ход: порядок действий случайный (взятая фигура до или после хода,
+// ладья до или после короля, превращение той же меткой или ферзем из лотка).
+// Возвращает время установки сходившей фигуры, 0 - ход не сходится с доской
+uint64_t playChessMove(Hand& hand, const char* uci, bool whiteToMove);
+
+#endif // HOST_CHESS_WORKLOAD_H
@@ -0,0 +1,323 @@
+#include "i2c_trace_replay.h"
+#include "crc32.h"
+#include <stdio.h>
+
+static const uint8_t KIND_MASK = I2C_TRACE_READ | I2C_TRACE_RESET;
+
+static uint32_t getLe32(const uint8_t* in) {
+    return (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+// =============================================
+// РАЗБОР ПОТОКА
+// =============================================
+
+I2CTraceDecoder::I2CTraceDecoder() : badFrames(0), skippedBytes(0) {}
+
+void I2CTraceDecoder::feed(const uint8_t* data, size_t length) {
+    pending.insert(pending.end(), data, data + length);
+    parse();
+}
+
+bool I2CTraceDecoder::loadFile(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (file == nullptr) {
+        return false;
+    }
+    uint8_t buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        feed(buffer, n);
+    }
+    fclose(file);
+    return true;
+}
+
+const I2CTraceSession* I2CTraceDecoder::lastLiveSession() const {
+    for (size_t i = sessions.size(); i > 0; i--) {
+        if (!sessions[i - 1].saved && !sessions[i - 1].records.empty()) {
+            return &sessions[i - 1];
+        }
+    }
+    return nullptr;
+}
+
+void I2CTraceDecoder::parse() {
+    size_t i = 0;
+    while (i + I2CTraceRecorder::FRAME_OVERHEAD <= pending.size()) {
+        if (pending[i] != I2CTraceRecorder::FRAME_SYNC_0 || pending[i + 1] != I2CTraceRecorder::FRAME_SYNC_1) {
+            i++;
+            skippedBytes++;
+            continue;
+        }
+        size_t payload = pending[i + 3] | (pending[i + 4] << 8);
+        size_t frameBytes = I2CTraceRecorder::FRAME_OVERHEAD + payload;
+        if (frameBytes > I2CTraceRecorder::MAX_FRAME_BYTES) {
+            // Синхрослово внутри текста или данных - не кадр
+            i++;
+            skippedBytes++;
+            continue;
+        }
+        if (i + frameBytes > pending.size()) {
+            break;      // Кадр еще не пришел целиком
+        }
+
+        const uint8_t* frame = &pending[i];
+        uint32_t crc = ~crc32Update(0xFFFFFFFF, frame + 2, 3 + payload);
+        uint8_t type = frame[2];
+        const uint8_t* p = frame + 5;
+        bool valid = crc == getLe32(frame + 5 + payload);
+        if (valid && type == I2C_TRACE_FRAME_BOOT) {
+            I2CTraceSession session;
+            session.saved = false;
+            session.gaps = 0;
+            sessions.push_back(session);
+        } else if (valid && (type == I2C_TRACE_FRAME_RECORD || type == I2C_TRACE_FRAME_SAVED) &&
+                   payload >= 13 && payload == 13u + p[12]) {
+            I2CTraceRecord record;
+            record.sequence = getLe32(p);
+            record.startMicros = getLe32(p + 4);
+            record.durationUs = p[8] | (p[9] << 8);
+            record.address = p[10];
+            record.flags = p[11];
+            record.length = p[12];
+            memcpy(record.data, p + 13, record.length);
+            addRecord(record, type == I2C_TRACE_FRAME_SAVED);
+        } else if (valid && type != I2C_TRACE_FRAME_RECORD && type != I2C_TRACE_FRAME_SAVED) {
+            // Целый кадр другого потока (метрики) - не ошибка
+        } else {
+            badFrames++;
+            i++;
+            continue;
+        }
+        i += frameBytes;
+    }
+    pending.erase(pending.begin(), pending.begin() + i);
+}
+
+void I2CTraceDecoder::addRecord(const I2CTraceRecord& record, bool saved) {
+    // Поток, включенный после загрузки, начинается без кадра BOOT
+    if (sessions.empty() || sessions.back().saved != saved) {
+        I2CTraceSession session;
+        session.saved = saved;
+        session.gaps = 0;
+        sessions.push_back(session);
+    }
+    I2CTraceSession& session = sessions.back();
+    if (!session.records.empty() && record.sequence != session.records.back().sequence + 1) {
+        session.gaps += record.sequence - session.records.back().sequence - 1;
+    }
+    session.records.push_back(record);
+}
+
+// =============================================
+// ПОВТОР
+// =============================================
+
+I2CTraceReplayer::I2CTraceReplayer(uint8_t deviceAddress) {
+    address = deviceAddress;
+    position = 0;
+    epochMicros = 0;
+    irqWired = false;
+    irqLevel = HIGH;
+    replayed = 0;
+    mismatched = 0;
+    skipped = 0;
+    unmatched = 0;
+    afterEnd = 0;
+    rawProbes = 0;
+    firstDivergence = -1;
+    warpedMicros = 0;
+    maxLagMicros = 0;
+}
+
+void I2CTraceReplayer::load(const std::vector<I2CTraceRecord>& trace) {
+    records = trace;
+    startMicros.clear();
+
+    // micros() переполняется за ~71 минуту
+    uint64_t high = 0;
+    uint32_t previous = records.empty() ? 0 : records[0].startMicros;
+    for (size_t i = 0; i < records.size(); i++) {
+        uint32_t t = records[i].startMicros;
+        if (t < previous && previous - t > 0x80000000UL) {
+            high += 0x100000000ULL;
+        }
+        previous = t;
+        startMicros.push_back(high + t);
+    }
+    position = 0;
+}
+
+void I2CTraceReplayer::attach(bool wireIrq) {
+    epochMicros = hostsim::getPowerOnMicros();
+    irqWired = wireIrq;
+    irqLevel = HIGH;
+    Adafruit_I2CDevice::setTap(this);
+    hostsim::attachI2CSlave(address, this);
+    hostsim::addTimedDevice(this);
+    if (irqWired) {
+        hostsim::driveInputPin(PN532_IRQ_PIN, irqLevel);
+    }
+}
+
+void I2CTraceReplayer::detach() {
+    Adafruit_I2CDevice::setTap(nullptr);
+    hostsim::detachI2CSlave(address);
+    hostsim::removeTimedDevice(this);
+    if (irqWired) {
+        hostsim::driveInputPin(PN532_IRQ_PIN, -1);
+    }
+}
+
+uint64_t I2CTraceReplayer::getEndMicros() const {
+    if (records.empty()) {
+        return epochMicros;
+    }
+    return epochMicros + startMicros.back() + records.back().durationUs;
+}
+
+bool I2CTraceReplayer::write(Adafruit_I2CDevice*, const uint8_t* buffer, size_t len, bool,
+                             const uint8_t* prefixBuffer, size_t prefixLen) {
+    uint8_t data[sizeof(((I2CTraceRecord*)nullptr)->data)];
+    size_t total = 0;
+    for (size_t i = 0; prefixBuffer != nullptr && i < prefixLen && total < sizeof(data); i++) {
+        data[total++] = prefixBuffer[i];
+    }
+    for (size_t i = 0; i < len && total < sizeof(data); i++) {
+        data[total++] = buffer[i];
+    }
+
+    long index = match(0, data, total);
+    if (index < 0) {
+        return false;
+    }
+    consume(index);
+    bool ok = records[index].flags & I2C_TRACE_OK;
+    finish(index);
+    return ok;
+}
+
+bool I2CTraceReplayer::read(Adafruit_I2CDevice*, uint8_t* buffer, size_t len, bool) {
+    long index = match(I2C_TRACE_READ, nullptr, min(len, sizeof(((I2CTraceRecord*)nullptr)->data)));
+    if (index < 0) {
+        return false;
+    }
+    consume(index);
+    const I2CTraceRecord& record = records[index];
+    memcpy(buffer, record.data, record.length);
+    bool ok = record.flags & I2C_TRACE_OK;
+    finish(index);
+    return ok;
+}
+
+void I2CTraceReplayer::deviceReset(Adafruit_I2CDevice*) {
+    long index = match(I2C_TRACE_RESET, nullptr, 0);
+    if (index >= 0) {
+        consume(index);
+        finish(index);
+    }
+}
+
+long I2CTraceReplayer::match(uint8_t kind, const uint8_t* data, size_t length) {
+    if (position >= records.size()) {
+        afterEnd++;
+        return -1;
+    }
+
+    size_t end = min(records.size(), position + RESYNC_WINDOW);
+    for (size_t i = position; i < end; i++) {
+        const I2CTraceRecord& record = records[i];
+        if ((record.flags & KIND_MASK) != kind || record.length != length) {
+            continue;
+        }
+        if (kind == 0 && memcmp(record.data, data, length) != 0) {
+            continue;
+        }
+        return (long)i;
+    }
+
+    // Команда другая, но на месте запись того же вида - отвечаем ею
+    if (firstDivergence < 0) {
+        firstDivergence = (long)position;
+    }
+    const I2CTraceRecord& current = records[position];
+    if ((current.flags & KIND_MASK) == kind && current.length == length) {
+        mismatched++;
+        return (long)position;
+    }
+    unmatched++;
+    return -1;
+}
+
+void I2CTraceReplayer::consume(size_t index) {
+    if (index > position) {
+        skipped += index - position;
+        if (firstDivergence < 0) {
+            firstDivergence = (long)position;
+        }
+    }
+    position = index;
+    warpTo(epochMicros + startMicros[index], true);
+}
+
+void I2CTraceReplayer::finish(size_t index) {
+    replayed++;
+    position = index + 1;
+    warpTo(epochMicros + startMicros[index] + records[index].durationUs, false);
+    updateIrq();
+}
+
+void I2CTraceReplayer::warpTo(uint64_t target, bool countLag) {
+    uint64_t now = hostsim::nowMicros();
+    if (now < target) {
+        warpedMicros += target - now;
+        hostsim::advanceMicros(target - now);
+    } else if (countLag && now - target > maxLagMicros) {
+        maxLagMicros = now - target;
+    }
+}
+
+bool I2CTraceReplayer::onWrite(const uint8_t*, size_t) {
+    rawProbes++;
+    return true;
+}
+
+size_t I2CTraceReplayer::onRead(uint8_t*, size_t) {
+    return 0;
+}
+
+bool I2CTraceReplayer::readyReadPending() const {
+    if (position >= records.size()) {
+        return false;
+    }
+    const I2CTraceRecord& record = records[position];
+    return (record.flags & KIND_MASK) == I2C_TRACE_READ && (record.flags & I2C_TRACE_OK) &&
+           record.length > 0 && record.data[0] == 0x01;
+}
+
+uint64_t I2CTraceReplayer::nextEventMicros() {
+    if (irqLevel == LOW || !readyReadPending()) {
+        return UINT64_MAX;
+    }
+    return epochMicros + startMicros[position];
+}
+
+void I2CTraceReplayer::onTime(uint64_t) {
+    updateIrq();
+}
+
+void I2CTraceReplayer::updateIrq() {
+    // PN532 опускает IRQ, когда кадр готов, и поднимает после его чтения
+    uint8_t level = HIGH;
+    if (readyReadPending() && hostsim::nowMicros() >= epochMicros + startMicros[position]) {
+        level = LOW;
+    }
+    if (level == irqLevel) {
+        return;
+    }
+    irqLevel = level;
+    if (irqWired) {
+        hostsim::driveInputPin(PN532_IRQ_PIN, level);
+    }
+}
@@ -0,0 +1,142 @@
+#ifndef I2C_TRACE_REPLAY_H
+#define I2C_TRACE_REPLAY_H
+
+#include <Arduino.h>
+#include <vector>
+#include "host_sim.h"
+#include "i2c_trace.h"
+
+// =============================================
+// ПОВТОР ТРАССЫ I2C НА ХОСТЕ
+// Разбор потока Serial с кадрами I2CTraceRecorder и подача записанных
+// транзакций обратно драйверу PN532 вместо эмулятора
+// =============================================
+
+// Одна загрузка прошивки: записи от кадра BOOT до следующего
+struct I2CTraceSession {
+    std::vector<I2CTraceRecord> records;
+    bool saved;                 // Кадры SAVED - трасса до сбоя из NVS
+    uint32_t gaps;              // Пропуски номеров (вытеснены до отправки)
+};
+
+// Разбор потока: синхрослово, тип, длина, CRC. Текст лога между кадрами
+// пропускается, кадр с неверной CRC - тоже (поиск синхрослова со следующего байта),
+// целые кадры других типов (метрики, metrics.h) - без учета в ошибках
+class I2CTraceDecoder {
+private:
+    std::vector<uint8_t> pending;
+    std::vector<I2CTraceSession> sessions;
+    uint32_t badFrames;
+    uint32_t skippedBytes;
+
+public:
+    I2CTraceDecoder();
+
+    void feed(const uint8_t* data, size_t length);
+    bool loadFile(const char* path);
+
+    const std::vector<I2CTraceSession>& getSessions() const { return sessions; }
+    // Последняя загрузка с записями (не SAVED), nullptr - нет такой
+    const I2CTraceSession* lastLiveSession() const;
+    uint32_t getBadFrames() const { return badFrames; }
+    uint32_t getSkippedBytes() const { return skippedBytes; }
+
+private:
+    void parse();
+    void addRecord(const I2CTraceRecord& record, bool saved);
+};
+
+// Поток кадров в память (вместо Serial на стенде)
+class I2CTraceCapture : public Print {
+public:
+    std::vector<uint8_t> bytes;
+
+    size_t write(uint8_t c) override {
+        bytes.push_back(c);
+        return 1;
+    }
+    size_t write(const uint8_t* buffer, size_t size) override {
+        bytes.insert(bytes.end(), buffer, buffer + size);
+        return size;
+    }
+};
+
+// Повтор: стоит на месте записи (Adafruit_I2CDevice::setTap) и отвечает
+// драйверу записанными байтами и результатами. Часы подводятся к записанному
+// micros() начала и концу каждой транзакции, линия IRQ падает к моменту
+// записанного чтения готового кадра - тайминги прошивки совпадают с полем.
+// Транзакция, которой нет на месте, ищется в окне RESYNC_WINDOW записей
+// вперед (расхождение); не найденная получает NACK. Адресные пробы напрямую
+// через Wire (main.cpp) в трассу не попадают - на них отвечает ACK
+class I2CTraceReplayer : public Adafruit_I2CInterceptor, public hostsim::I2CSlave, public hostsim::TimedDevice {
+public:
+    static const size_t RESYNC_WINDOW = 16;
+
+private:
+    std::vector<I2CTraceRecord> records;
+    std::vector<uint64_t> startMicros;  // Развернутое 32-битное micros()
+    size_t position;
+    uint64_t epochMicros;               // hostsim::nowMicros() при micros() == 0
+    uint8_t address;
+    bool irqWired;
+    uint8_t irqLevel;
+
+    // Статистика
+    uint32_t replayed;
+    uint32_t mismatched;                // Запись с другими байтами
+    uint32_t skipped;                   // Записи, пропущенные при поиске
+    uint32_t unmatched;                 // Транзакции без записи (NACK)
+    uint32_t afterEnd;                  // Транзакции после конца трассы
+    uint32_t rawProbes;
+    long firstDivergence;               // Номер записи, -1 - расхождений нет
+    uint64_t warpedMicros;              // Сколько часов подведено вперед
+    uint64_t maxLagMicros;              // Прошивка позже записанного момента
+
+public:
+    I2CTraceReplayer(uint8_t deviceAddress);
+
+    void load(const std::vector<I2CTraceRecord>& trace);
+    // Ставит повтор на шину; время отсчитывается от последнего hostsim::powerOn()
+    void attach(bool wireIrq = true);
+    void detach();
+
+    bool isFinished() const { return position >= records.size(); }
+    size_t getPosition() const { return position; }
+    size_t getRecordCount() const { return records.size(); }
+    // Момент (hostsim::nowMicros) последней записи трассы
+    uint64_t getEndMicros() const;
+
+    uint32_t getReplayed() const { return replayed; }
+    uint32_t getMismatched() const { return mismatched; }
+    uint32_t getSkipped() const { return skipped; }
+    uint32_t getUnmatched() const { return unmatched; }
+    uint32_t getAfterEnd() const { return afterEnd; }
+    uint32_t getRawProbes() const { return rawProbes; }
+    long getFirstDivergence() const { return firstDivergence; }
+    uint64_t getWarpedMicros() const { return warpedMicros; }
+    uint64_t getMaxLagMicros() const { return maxLagMicros; }
+
+    // Adafruit_I2CInterceptor
+    bool write(Adafruit_I2CDevice* dev, const uint8_t* buffer, size_t len, bool stop,
+               const uint8_t* prefixBuffer, size_t prefixLen) override;
+    bool read(Adafruit_I2CDevice* dev, uint8_t* buffer, size_t len, bool stop) override;
+    void deviceReset(Adafruit_I2CDevice* dev) override;
+
+    // hostsim::I2CSlave
+    bool onWrite(const uint8_t* data, size_t len) override;
+    size_t onRead(uint8_t* data, size_t len) override;
+
+    // hostsim::TimedDevice
+    uint64_t nextEventMicros() override;
+    void onTime(uint64_t now) override;
+
+private:
+    long match(uint8_t kind, const uint8_t* data, size_t length);
+    void consume(size_t index);
+    void finish(size_t index);
+    void warpTo(uint64_t target, bool countLag);
+    bool readyReadPending() const;
+    void updateIrq();
+};
+
+#endif // I2C_TRACE_REPLAY_H
@@ -0,0 +1,188 @@
+#include "metrics_decoder.h"
+#include "crc32.h"
+#include "host_sim.h"
+#include <stdio.h>
+
+static const uint8_t FRAME_SYNC_0 = 0xA5;
+static const uint8_t FRAME_SYNC_1 = 0x5A;
+static const size_t FRAME_OVERHEAD = 9;
+static const size_t MAX_PAYLOAD = 4096;         // Больше схема не бывает
+
+static uint32_t getLe32(const uint8_t* in) {
+    return (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+MetricsDecoder::MetricsDecoder() : schemaId(0), hasSchema(false), badFrames(0), unknownSchema(0) {}
+
+size_t MetricsDecoder::write(uint8_t c) {
+    feed(&c, 1);
+    return 1;
+}
+
+size_t MetricsDecoder::write(const uint8_t* buffer, size_t size) {
+    feed(buffer, size);
+    return size;
+}
+
+void MetricsDecoder::feed(const uint8_t* data, size_t length) {
+    // Разбор идет на хосте во время loop(): его блоки - не куча прошивки
+    hostsim::FlashHeapScope hostHeap;
+    pending.insert(pending.end(), data, data + length);
+    parse();
+}
+
+bool MetricsDecoder::loadFile(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (file == nullptr) {
+        return false;
+    }
+    uint8_t buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        feed(buffer, n);
+    }
+    fclose(file);
+    return true;
+}
+
+void MetricsDecoder::parse() {
+    size_t i = 0;
+    while (i + FRAME_OVERHEAD <= pending.size()) {
+        if (pending[i] != FRAME_SYNC_0 || pending[i + 1] != FRAME_SYNC_1) {
+            i++;
+            continue;
+        }
+        size_t payload = pending[i + 3] | (pending[i + 4] << 8);
+        if (payload > MAX_PAYLOAD) {
+            i++;
+            continue;
+        }
+        if (i + FRAME_OVERHEAD + payload > pending.size()) {
+            break;
+        }
+
+        const uint8_t* frame = &pending[i];
+        uint32_t crc = ~crc32Update(0xFFFFFFFF, frame + 2, 3 + payload);
+        if (crc != getLe32(frame + 5 + payload)) {
+            badFrames++;
+            i++;
+            continue;
+        }
+        uint8_t type = frame[2];
+        if (type == METRICS_FRAME_SCHEMA) {
+            if (!decodeSchema(frame + 5, payload)) {
+                badFrames++;
+            }
+        } else if (type == METRICS_FRAME_SNAPSHOT) {
+            MetricsSnapshot snapshot;
+            if (decodeSnapshot(frame + 5, payload, snapshot)) {
+                snapshots.push_back(snapshot);
+            } else {
+                unknownSchema++;
+            }
+        }
+        i += FRAME_OVERHEAD + payload;
+    }
+    pending.erase(pending.begin(), pending.begin() + i);
+}
+
+bool MetricsDecoder::decodeSchema(const uint8_t* payload, size_t length) {
+    if (length < 5) {
+        return false;
+    }
+    std::vector<MetricInfo> parsed;
+    uint8_t count = payload[4];
+    size_t pos = 5;
+    for (uint8_t m = 0; m < count; m++) {
+        if (pos + 2 > length) {
+            return false;
+        }
+        MetricInfo info;
+        info.type = (MetricType)payload[pos];
+        uint8_t boundCount = payload[pos + 1];
+        pos += 2;
+        if (pos + boundCount * 4 + 1 > length) {
+            return false;
+        }
+        for (uint8_t b = 0; b < boundCount; b++) {
+            info.bounds.push_back(getLe32(payload + pos));
+            pos += 4;
+        }
+        uint8_t nameLength = payload[pos++];
+        if (pos + nameLength > length) {
+            return false;
+        }
+        info.name.assign((const char*)payload + pos, nameLength);
+        pos += nameLength;
+        parsed.push_back(info);
+    }
+    schema = parsed;
+    schemaId = getLe32(payload);
+    hasSchema = true;
+    return true;
+}
+
+bool MetricsDecoder::decodeSnapshot(const uint8_t* payload, size_t length, MetricsSnapshot& snapshot) const {
+    if (!hasSchema || length < MetricsRegistry::SNAPSHOT_HEADER_BYTES || getLe32(payload) != schemaId ||
+        payload[13] != schema.size()) {
+        return false;
+    }
+    snapshot.sequence = getLe32(payload + 4);
+    snapshot.millis = getLe32(payload + 8);
+    snapshot.delta = payload[12] & 1;
+    snapshot.values.clear();
+    snapshot.buckets.clear();
+
+    size_t pos = MetricsRegistry::SNAPSHOT_HEADER_BYTES;
+    for (size_t m = 0; m < schema.size(); m++) {
+        if (pos + 4 > length) {
+            return false;
+        }
+        snapshot.values.push_back(getLe32(payload + pos));
+        pos += 4;
+        std::vector<uint32_t> counts;
+        if (schema[m].type == METRIC_HISTOGRAM) {
+            size_t bucketCount = schema[m].bounds.size() + 1;
+            if (pos + bucketCount * 4 > length) {
+                return false;
+            }
+            for (size_t b = 0; b < bucketCount; b++) {
+                counts.push_back(getLe32(payload + pos));
+                pos += 4;
+            }
+        }
+        snapshot.buckets.push_back(counts);
+    }
+    return pos == length;
+}
+
+int MetricsDecoder::find(const char* name) const {
+    for (size_t i = 0; i < schema.size(); i++) {
+        if (schema[i].name == name) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+uint32_t MetricsDecoder::bucketQuantile(const MetricInfo& info, const std::vector<uint32_t>& counts, double q) {
+    uint64_t total = 0;
+    for (size_t b = 0; b < counts.size(); b++) {
+        total += counts[b];
+    }
+    if (total == 0) {
+        return 0;
+    }
+    uint64_t rank = (uint64_t)(q * total + 0.5);
+    if (rank < 1) {
+        rank = 1;
+    }
+    uint64_t seen = 0;
+    for (size_t b = 0; b < counts.size(); b++) {
+        seen += counts[b];
+        if (seen >= rank) {
+            return (b < info.bounds.size()) ? info.bounds[b] : UINT32_MAX;
+        }
+    }
+    return UINT32_MAX;
+}
@@ -0,0 +1,68 @@
+#ifndef METRICS_DECODER_H
+#define METRICS_DECODER_H
+
+#include <Arduino.h>
+#include <vector>
+#include <string>
+#include "metrics.h"
+
+// =============================================
+// РАЗБОР КАДРОВ МЕТРИК НА ХОСТЕ
+// Схема (имена, виды, границы корзин) и снимки MetricsRegistry из потока
+// Serial; скорости и квантили считает хост, прошивка ничего не форматирует
+// =============================================
+
+struct MetricInfo {
+    std::string name;
+    MetricType type;
+    std::vector<uint32_t> bounds;       // Гистограмма: верхние границы корзин
+};
+
+struct MetricsSnapshot {
+    uint32_t sequence;
+    uint32_t millis;
+    bool delta;
+    std::vector<uint32_t> values;       // Счетчик, датчик, сумма гистограммы - по схеме
+    std::vector<std::vector<uint32_t> > buckets;    // Пусто у не-гистограмм
+};
+
+// Принимает поток напрямую (Print) или из файла; текст лога и кадры трассы
+// I2C между кадрами метрик пропускаются
+class MetricsDecoder : public Print {
+private:
+    std::vector<uint8_t> pending;
+    std::vector<MetricInfo> schema;
+    uint32_t schemaId;
+    bool hasSchema;
+    std::vector<MetricsSnapshot> snapshots;
+    uint32_t badFrames;
+    uint32_t unknownSchema;             // Снимки без подходящей схемы
+
+public:
+    MetricsDecoder();
+
+    void feed(const uint8_t* data, size_t length);
+    bool loadFile(const char* path);
+
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+
+    // Разбор готового снимка (writeSnapshot) по текущей схеме
+    bool decodeSnapshot(const uint8_t* payload, size_t length, MetricsSnapshot& snapshot) const;
+    bool decodeSchema(const uint8_t* payload, size_t length);
+
+    const std::vector<MetricInfo>& getSchema() const { return schema; }
+    const std::vector<MetricsSnapshot>& getSnapshots() const { return snapshots; }
+    int find(const char* name) const;
+    uint32_t getBadFrames() const { return badFrames; }
+    uint32_t getUnknownSchema() const { return unknownSchema; }
+
+    // Квантиль гистограммы по корзинам (верхняя граница корзины; за
+    // последней границей - UINT32_MAX)
+    static uint32_t bucketQuantile(const MetricInfo& info, const std::vector<uint32_t>& counts, double q);
+
+private:
+    void parse();
+};
+
+#endif // METRICS_DECODER_H
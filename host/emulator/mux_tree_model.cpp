@@ -0,0 +1,49 @@
+#include "mux_tree_model.h"
+#include "host_sim.h"
+
+int decodeMuxAxis(const MuxAxis& axis) {
+    int line = 0;
+    int radix = 1;
+    for (int s = 0; s < axis.stageCount; s++) {
+        const MuxStage& stage = axis.stages[s];
+        int digit = 0;
+        if (stage.bits > 0) {
+            for (int b = 0; b < stage.bits; b++) {
+                if (hostsim::getPinLevel(stage.selectPins[b]) == HIGH) digit |= 1 << b;
+            }
+        } else {
+            digit = -1;
+            for (int i = 0; i < stage.inhibitCount; i++) {
+                if (hostsim::getPinLevel(stage.inhibitPins[i]) != LOW) continue;
+                if (digit >= 0) return -1;      // Два выхода на одной линии
+                digit = i;
+            }
+            if (digit < 0) return -1;
+        }
+        line += digit * radix;
+        radix *= muxStageChannels(stage);
+    }
+    return line < axis.lines ? line : -1;
+}
+
+int decodeMuxCell(const BoardGeometry& geometry) {
+    if (hostsim::getPinLevel(geometry.enablePin) != LOW) {
+        return -1;
+    }
+    int row = decodeMuxAxis(geometry.rowAxis);
+    int col = decodeMuxAxis(geometry.colAxis);
+    if (row < 0 || col < 0) {
+        return -1;
+    }
+    return row * geometry.colAxis.lines + col;
+}
+
+bool isMuxGeometryPin(const BoardGeometry& geometry, uint8_t pin) {
+    int8_t pins[2 * MUX_AXIS_MAX_PINS];
+    int count = muxAxisPins(geometry.rowAxis, pins);
+    count += muxAxisPins(geometry.colAxis, pins + count);
+    for (int i = 0; i < count; i++) {
+        if (pins[i] == pin) return true;
+    }
+    return pin == (uint8_t)geometry.enablePin;
+}
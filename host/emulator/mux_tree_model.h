@@ -0,0 +1,24 @@
+#ifndef MUX_TREE_MODEL_H
+#define MUX_TREE_MODEL_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// =============================================
+// МОДЕЛЬ ДЕРЕВА МУЛЬТИПЛЕКСОРОВ НА ХОСТЕ
+// Какую антенну подключили уровни пинов - прямо по описанию геометрии
+// (include/board_geometry.h), без таблиц src/multiplexer.h: эталон для
+// эмулятора доски и стенда geometry
+// =============================================
+
+// Линия оси по текущим уровням пинов; -1 - ступень INH без единственного
+// LOW (ни одного или два мультиплексора сразу) или линия за концом оси
+int decodeMuxAxis(const MuxAxis& axis);
+
+// Ячейка (строка * столбцов + столбец); -1 - EN выключен или ось не выбрана
+int decodeMuxCell(const BoardGeometry& geometry);
+
+// Пин участвует в выборе ячейки (адрес любой оси или EN)
+bool isMuxGeometryPin(const BoardGeometry& geometry, uint8_t pin);
+
+#endif // MUX_TREE_MODEL_H
@@ -0,0 +1,1190 @@
+#include "pn532_emulator.h"
+#include "mux_tree_model.h"
+#include <Adafruit_PN532.h>
+#include <math.h>
+
+// =============================================
+// BOARD MODEL
+// =============================================
+
+BoardModel::BoardModel() {
+    selected = 0;
+    coupled = 0;
+    lastSwitchMicros = 0;
+    fieldOn = false;
+    fieldOnMicros = 0;
+    switches = 0;
+    rngState = 0x2545F491;
+    placements = 0;
+    memset(rf, 0, sizeof(rf));
+    memset(coupling, 0, sizeof(coupling));
+    switchedWithField = false;
+    switchedFrom = -1;
+    crosstalkResponses = 0;
+    collisionFailures = 0;
+    for (int i = 0; i < MATRIX_TOTAL_CELLS; i++) {
+        bleedFrom[i] = -1;
+        bleedPercent[i] = 0;
+        analog[i].minRxGain = 0;
+        analog[i].maxRxGain = 6;
+        analog[i].maxModGsP = 0x3F;
+        shorted[i] = false;
+    }
+    clear();
+}
+
+void BoardModel::attach() {
+    hostsim::addPinListener(this);
+    decodeSelection();
+}
+
+void BoardModel::detach() {
+    hostsim::removePinListener(this);
+}
+
+void BoardModel::powerCycle() {
+    lastSwitchMicros = hostsim::nowMicros();
+    coupled = -1;
+    fieldOn = false;
+    decodeSelection();
+}
+
+void BoardModel::setFieldOn(bool on) {
+    if (on && !fieldOn) {
+        fieldOnMicros = hostsim::nowMicros();
+    }
+    fieldOn = on;
+}
+
+uint32_t BoardModel::powerUpRemainingUs() const {
+    uint64_t poweredAt = fieldOnMicros + TAG_POWER_UP_US;
+    uint64_t now = hostsim::nowMicros();
+    return (now >= poweredAt) ? 0 : (uint32_t)(poweredAt - now);
+}
+
+void BoardModel::setCellRf(int cellIndex, uint32_t settleUs, uint32_t activationUs, uint32_t jitterUs) {
+    if (cellIndex < 0 || cellIndex >= MATRIX_TOTAL_CELLS) {
+        return;
+    }
+    rf[cellIndex].settleUs = settleUs;
+    rf[cellIndex].activationUs = activationUs;
+    rf[cellIndex].jitterUs = jitterUs;
+}
+
+void BoardModel::setCellAnalog(int cellIndex, uint8_t minRxGain, uint8_t maxRxGain, uint8_t maxModGsP) {
+    if (cellIndex < 0 || cellIndex >= MATRIX_TOTAL_CELLS) {
+        return;
+    }
+    analog[cellIndex].minRxGain = minRxGain;
+    analog[cellIndex].maxRxGain = maxRxGain;
+    analog[cellIndex].maxModGsP = maxModGsP;
+}
+
+bool BoardModel::linkAttempt(int cellIndex, uint8_t rfCfg, uint8_t modGsP) {
+    if (cellIndex < 0 || cellIndex >= MATRIX_TOTAL_CELLS) {
+        return true;
+    }
+    const CellAnalogModel& a = analog[cellIndex];
+    uint8_t gain = (rfCfg >> 4) & 0x07;
+    int deficit = 0;
+    if (gain < a.minRxGain) deficit += a.minRxGain - gain;
+    if (gain > a.maxRxGain) deficit += gain - a.maxRxGain;
+    if (modGsP > a.maxModGsP) deficit++;
+    if (deficit == 0) {
+        return true;
+    }
+    return nextRandom() % (1U << min(deficit, 8)) == 0;
+}
+
+void BoardModel::setCellShorted(int cellIndex, bool isShorted) {
+    if (cellIndex < 0 || cellIndex >= MATRIX_TOTAL_CELLS) {
+        return;
+    }
+    shorted[cellIndex] = isShorted;
+}
+
+bool BoardModel::isCellShorted(int cellIndex) const {
+    return cellIndex >= 0 && cellIndex < MATRIX_TOTAL_CELLS && shorted[cellIndex];
+}
+
+uint32_t BoardModel::nextRandom() {
+    rngState = rngState * 1664525UL + 1013904223UL;
+    return rngState >> 8;
+}
+
+uint32_t BoardModel::activationDelayUs(int cellIndex) {
+    if (cellIndex < 0 || cellIndex >= MATRIX_TOTAL_CELLS || rf[cellIndex].activationUs == 0) {
+        return 0;
+    }
+    uint32_t delayUs = rf[cellIndex].activationUs;
+    if (rf[cellIndex].jitterUs > 0) {
+        delayUs += nextRandom() % (rf[cellIndex].jitterUs + 1);
+    }
+    return delayUs;
+}
+
+void BoardModel::setCellBleed(int cellIndex, int neighbourCell, uint8_t percent) {
+    if (cellIndex < 0 || cellIndex >= MATRIX_TOTAL_CELLS) {
+        return;
+    }
+    bleedFrom[cellIndex] = (neighbourCell >= 0 && neighbourCell < MATRIX_TOTAL_CELLS) ? neighbourCell : -1;
+    bleedPercent[cellIndex] = percent;
+}
+
+void BoardModel::setCellCoupling(int cellIndex, const CellCouplingModel& model) {
+    if (cellIndex < 0 || cellIndex >= MATRIX_TOTAL_CELLS) {
+        return;
+    }
+    coupling[cellIndex] = model;
+}
+
+void BoardModel::setCoupling(const CellCouplingModel& model) {
+    for (int i = 0; i < MATRIX_TOTAL_CELLS; i++) {
+        coupling[i] = model;
+    }
+}
+
+uint8_t BoardModel::couplingPercent(int cellIndex, int neighbourCell) const {
+    if (cellIndex < 0 || cellIndex >= MATRIX_TOTAL_CELLS || neighbourCell < 0 || neighbourCell >= MATRIX_TOTAL_CELLS) {
+        return 0;
+    }
+    int dr = cellIndex / MATRIX_COLS - neighbourCell / MATRIX_COLS;
+    int dc = cellIndex % MATRIX_COLS - neighbourCell % MATRIX_COLS;
+    int distance2 = dr * dr + dc * dc;
+    if (distance2 == 0 || distance2 > 4) {
+        return 0;
+    }
+
+    const CellCouplingModel& model = coupling[cellIndex];
+    double percent = model.steadyPercent;
+    if (switchedWithField && neighbourCell == switchedFrom && model.transientPercent > 0 && model.halfLifeUs > 0) {
+        double sinceSwitchUs = (double)(hostsim::nowMicros() - lastSwitchMicros);
+        percent += model.transientPercent * pow(2.0, -sinceSwitchUs / model.halfLifeUs);
+    }
+    // Ближнее поле: связь падает как куб расстояния
+    percent /= distance2 * sqrt((double)distance2);
+    return (uint8_t)min(percent + 0.5, 100.0);
+}
+
+int BoardModel::coupledTagsInField(int cellIndex, int* cells) {
+    int found[2 + COUPLING_NEIGHBOURS];
+    uint8_t strength[2 + COUPLING_NEIGHBOURS];
+    int count = 0;
+
+    if (tags[cellIndex].present) {
+        found[count] = cellIndex;
+        strength[count++] = 100;
+    }
+    int neighbour = bleedFrom[cellIndex];
+    if (neighbour >= 0 && tags[neighbour].present && nextRandom() % 100 < bleedPercent[cellIndex]) {
+        found[count] = neighbour;
+        strength[count++] = bleedPercent[cellIndex];
+    }
+    int row = cellIndex / MATRIX_COLS;
+    int col = cellIndex % MATRIX_COLS;
+    for (int r = max(row - 2, 0); r <= min(row + 2, MATRIX_ROWS - 1); r++) {
+        for (int c = max(col - 2, 0); c <= min(col + 2, MATRIX_COLS - 1); c++) {
+            int cell = r * MATRIX_COLS + c;
+            if (cell == neighbour || !tags[cell].present) {
+                continue;
+            }
+            uint8_t percent = couplingPercent(cellIndex, cell);
+            if (percent > 0 && nextRandom() % 100 < percent) {
+                found[count] = cell;
+                strength[count++] = percent;
+                crosstalkResponses++;
+            }
+        }
+    }
+    if (count == 0) {
+        return 0;
+    }
+
+    // Антиколлизию выигрывает метка с более сильной связью (с вероятностью по силе)
+    int listed = min(count, 2);
+    for (int slot = 0; slot < listed; slot++) {
+        uint32_t total = 0;
+        for (int i = slot; i < count; i++) {
+            total += strength[i];
+        }
+        uint32_t pick = nextRandom() % total;
+        int chosen = slot;
+        while (pick >= strength[chosen]) {
+            pick -= strength[chosen];
+            chosen++;
+        }
+        int cell = found[chosen];
+        uint8_t s = strength[chosen];
+        found[chosen] = found[slot];
+        strength[chosen] = strength[slot];
+        found[slot] = cell;
+        strength[slot] = s;
+    }
+
+    // Ответы сравнимой силы накладываются - антиколлизия не разрешается
+    if (count >= 2 && coupling[cellIndex].collisionPercent > 0) {
+        uint8_t strongest = 0, weakest = 100;
+        for (int i = 0; i < count; i++) {
+            strongest = max(strongest, strength[i]);
+            weakest = min(weakest, strength[i]);
+        }
+        if (nextRandom() % (100U * strongest) < (uint32_t)coupling[cellIndex].collisionPercent * weakest) {
+            collisionFailures++;
+            return 0;
+        }
+    }
+
+    for (int i = 0; i < listed; i++) {
+        cells[i] = found[i];
+    }
+    return listed;
+}
+
+int BoardModel::tagsInField(int cellIndex, int* cells) {
+    if (cellIndex < 0 || cellIndex >= MATRIX_TOTAL_CELLS) {
+        return 0;
+    }
+    const CellCouplingModel& model = coupling[cellIndex];
+    if (model.steadyPercent > 0 || model.transientPercent > 0 || model.collisionPercent > 0) {
+        return coupledTagsInField(cellIndex, cells);
+    }
+    
+    int count = 0;
+    if (tags[cellIndex].present) {
+        cells[count++] = cellIndex;
+    }
+    int neighbour = bleedFrom[cellIndex];
+    if (neighbour >= 0 && tags[neighbour].present && nextRandom() % 100 < bleedPercent[cellIndex]) {
+        cells[count++] = neighbour;
+    }
+    
+    // Какая метка выиграет антиколлизию, зависит от связи с антенной в этот момент
+    if (count == 2 && nextRandom() % 2) {
+        int first = cells[0];
+        cells[0] = cells[1];
+        cells[1] = first;
+    }
+    return count;
+}
+
+bool BoardModel::frameReceived(int cellIndex) {
+    // Долгая активация слабой ячейки - это повторы внутри InListPassiveTarget;
+    // одиночный кадр доходит с вероятностью штатная/фактическая активация
+    uint32_t delayUs = activationDelayUs(cellIndex);
+    if (delayUs <= PN532Emulator::ACTIVATION_7B_US) {
+        return true;
+    }
+    return nextRandom() % delayUs < PN532Emulator::ACTIVATION_7B_US;
+}
+
+int BoardModel::rfCell() {
+    if (selected < 0) {
+        return -1;
+    }
+    if (hostsim::nowMicros() >= lastSwitchMicros + rf[selected].settleUs) {
+        coupled = selected;
+    }
+    return coupled;
+}
+
+void BoardModel::placeTag(int cellIndex, const uint8_t* uid, uint8_t uidLength) {
+    if (cellIndex < 0 || cellIndex >= MATRIX_TOTAL_CELLS || uidLength > UID_BUFFER_SIZE) {
+        return;
+    }
+    EmulatedTag& tag = tags[cellIndex];
+    tag.present = true;
+    memcpy(tag.uid, uid, uidLength);
+    tag.uidLength = uidLength;
+    // NTAG21x (7 байт) / MIFARE Classic 1K (4 байта)
+    tag.atqa = (uidLength == 7) ? 0x0044 : 0x0004;
+    tag.sak = (uidLength == 7) ? 0x00 : 0x08;
+    tag.placement = ++placements;
+    tag.placedMicros = hostsim::nowMicros();
+    
+    // Страницы 0-2: UID с BCC, пользовательские страницы - по номеру ячейки
+    memset(tag.memory, 0, sizeof(tag.memory));
+    memcpy(tag.memory, uid, min((int)uidLength, 3));
+    tag.memory[3] = 0x88 ^ tag.memory[0] ^ tag.memory[1] ^ tag.memory[2];
+    if (uidLength == 7) {
+        memcpy(&tag.memory[4], &uid[3], 4);
+        tag.memory[8] = uid[3] ^ uid[4] ^ uid[5] ^ uid[6];
+    }
+    for (int i = 16; i < EMU_TAG_PAGES * 4; i++) {
+        tag.memory[i] = (uint8_t)(cellIndex + i);
+    }
+}
+
+void BoardModel::removeTag(int cellIndex) {
+    if (cellIndex < 0 || cellIndex >= MATRIX_TOTAL_CELLS) {
+        return;
+    }
+    tags[cellIndex].present = false;
+}
+
+void BoardModel::moveTag(int fromCell, int toCell) {
+    if (!hasTag(fromCell) || toCell < 0 || toCell >= MATRIX_TOTAL_CELLS) {
+        return;
+    }
+    tags[toCell] = tags[fromCell];
+    tags[toCell].placement = ++placements;
+    tags[toCell].placedMicros = hostsim::nowMicros();
+    tags[fromCell].present = false;
+}
+
+void BoardModel::clear() {
+    for (int i = 0; i < MATRIX_TOTAL_CELLS; i++) {
+        memset(&tags[i], 0, sizeof(tags[i]));
+    }
+}
+
+bool BoardModel::hasTag(int cellIndex) const {
+    return cellIndex >= 0 && cellIndex < MATRIX_TOTAL_CELLS && tags[cellIndex].present;
+}
+
+const EmulatedTag& BoardModel::tagAt(int cellIndex) const {
+    static EmulatedTag none = {false, {0}, 0, 0, 0};
+    if (cellIndex < 0 || cellIndex >= MATRIX_TOTAL_CELLS) {
+        return none;
+    }
+    return tags[cellIndex];
+}
+
+EmulatedTag& BoardModel::mutableTagAt(int cellIndex) {
+    return tags[cellIndex];
+}
+
+int BoardModel::findTag(const uint8_t* uid, uint8_t uidLength) const {
+    for (int i = 0; i < MATRIX_TOTAL_CELLS; i++) {
+        if (tags[i].present && tags[i].uidLength == uidLength &&
+            memcmp(tags[i].uid, uid, uidLength) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void BoardModel::onPinWrite(uint8_t pin, uint8_t level) {
+    (void)level;
+    if (isMuxGeometryPin(ActiveGeometry::layout, pin)) {
+        decodeSelection();
+    }
+}
+
+void BoardModel::decodeSelection() {
+    int previous = selected;
+
+    selected = decodeMuxCell(ActiveGeometry::layout);
+
+    if (selected != previous) {
+        // Прежняя ячейка остается подключенной, если успела успокоиться;
+        // промежуточные адреса при смене пинов не успевают
+        if (previous >= 0 && hostsim::nowMicros() >= lastSwitchMicros + rf[previous].settleUs) {
+            coupled = previous;
+        }
+        if (!fieldOn) {
+            coupled = selected;
+        }
+        switchedWithField = fieldOn;
+        switchedFrom = previous;
+        lastSwitchMicros = hostsim::nowMicros();
+        switches++;
+    }
+}
+
+// =============================================
+// PN532 EMULATOR
+// =============================================
+
+static const uint8_t EMU_ACK_FRAME[6] = {0x00, 0x00, 0xFF, 0x00, 0xFF, 0x00};
+
+// Регистры CIU (PN532 User Manual, 8.6.22)
+static const uint16_t EMU_CIU_TX_MODE = 0x6302;
+static const uint16_t EMU_CIU_RX_MODE = 0x6303;
+static const uint16_t EMU_CIU_BIT_FRAMING = 0x633D;
+static const uint16_t EMU_CIU_RF_CFG = 0x6316;
+static const uint16_t EMU_CIU_GSN_ON = 0x6317;
+static const uint16_t EMU_CIU_CW_GSP = 0x6318;
+static const uint16_t EMU_CIU_MOD_GSP = 0x6319;
+
+// RFConfiguration 0x0A по умолчанию (PN532 User Manual, 7.3.1):
+// RFCfg, GsNOn, CWGsP, ModGsP, DemodOwnRF, RxThreshold, DemodWithoutRF, ...
+static const uint8_t EMU_ANALOG_TYPE_A_DEFAULT[11] = {
+    0x59, 0xF4, 0x3F, 0x11, 0x4D, 0x85, 0x61, 0x6F, 0x26, 0x62, 0x87};
+static const uint8_t EMU_CIU_CRC_EN = 0x80;
+
+// Команды метки ISO14443-3
+static const uint8_t EMU_TAG_REQA = 0x26;
+static const uint8_t EMU_TAG_WUPA = 0x52;
+static const uint8_t EMU_TAG_HLTA = 0x50;
+static const uint8_t EMU_TAG_CT = 0x88;
+
+static uint16_t emuCrcA(const uint8_t* data, uint8_t length) {
+    uint16_t crc = 0x6363;
+    for (uint8_t i = 0; i < length; i++) {
+        uint8_t b = data[i] ^ (uint8_t)(crc & 0xFF);
+        b ^= b << 4;
+        crc = (crc >> 8) ^ ((uint16_t)b << 8) ^ ((uint16_t)b << 3) ^ (b >> 4);
+    }
+    return crc;
+}
+
+PN532Emulator::PN532Emulator(BoardModel* boardModel) {
+    board = boardModel;
+    framesReceived = 0;
+    lastFrameMicros = 0;
+    responsesDelivered = 0;
+    lastResponseMicros = 0;
+    checksumErrors = 0;
+    statusReads = 0;
+    memset(commandCounts, 0, sizeof(commandCounts));
+    irqWired = true;
+    irqLevel = HIGH;
+    inReset = false;
+    powerOnReset();
+    bootDoneMicros = 0;
+}
+
+void PN532Emulator::attach() {
+    hostsim::attachI2CSlave(PN532_I2C_ADDRESS, this);
+    hostsim::addPinListener(this);
+    hostsim::addTimedDevice(this);
+}
+
+void PN532Emulator::detach() {
+    hostsim::detachI2CSlave(PN532_I2C_ADDRESS);
+    hostsim::removePinListener(this);
+    hostsim::removeTimedDevice(this);
+}
+
+void PN532Emulator::setIrqWired(bool wired) {
+    irqWired = wired;
+    hostsim::driveInputPin(PN532_IRQ_PIN, wired ? irqLevel : -1);
+}
+
+uint64_t PN532Emulator::nextEventMicros() {
+    if (inReset || hung || irqLevel == LOW) {
+        return UINT64_MAX;
+    }
+    if (phase == PHASE_ACK_PENDING) {
+        return readyAtMicros;
+    }
+    // Ожидание метки без таймаута прошивка не использует - событий нет
+    if (phase == PHASE_BUSY && !waitingForTag) {
+        return autoPolling ? autoPollNext : readyAtMicros;
+    }
+    return UINT64_MAX;
+}
+
+void PN532Emulator::onTime(uint64_t now) {
+    (void)now;
+    updateIrq();
+}
+
+void PN532Emulator::updateIrq() {
+    uint8_t level = HIGH;
+    if (!inReset && !hung && !waitingForTag && hostsim::nowMicros() >= bootDoneMicros && isReady()) {
+        level = LOW;
+    }
+    if (level == irqLevel) {
+        return;
+    }
+    irqLevel = level;
+    if (irqWired) {
+        hostsim::driveInputPin(PN532_IRQ_PIN, level);
+    }
+}
+
+void PN532Emulator::injectFault(EmulatorFault fault) {
+    switch (fault) {
+        case EMU_FAULT_NACK_ONCE:
+            nackNextWrite = true;
+            break;
+        case EMU_FAULT_DROP_RESPONSE:
+            dropNextResponse = true;
+            break;
+        case EMU_FAULT_HANG:
+            hung = true;
+            break;
+        case EMU_FAULT_NONE:
+        default:
+            hung = false;
+            nackNextWrite = false;
+            dropNextResponse = false;
+            break;
+    }
+    updateIrq();
+}
+
+void PN532Emulator::powerOnReset() {
+    phase = PHASE_IDLE;
+    readyAtMicros = 0;
+    commandLength = 0;
+    responseLength = 0;
+    waitingForTag = false;
+    activatedCell = -1;
+    activatedTags[0] = activatedTags[1] = -1;
+    fieldTagCount = 0;
+    autoPolling = false;
+    activatedMicros = 0;
+    txMode = EMU_CIU_CRC_EN;
+    rxMode = EMU_CIU_CRC_EN;
+    bitFraming = 0;
+    retryTimeout = DEFAULT_RETRY_TIMEOUT;
+    passiveRetries = 0xFF;
+    memcpy(analogTypeA, EMU_ANALOG_TYPE_A_DEFAULT, sizeof(analogTypeA));
+    ciuRfCfg = analogTypeA[0];
+    ciuModGsP = analogTypeA[3];
+    board->setFieldOn(false);
+    memset(tagRf, 0, sizeof(tagRf));
+    hung = false;
+    nackNextWrite = false;
+    dropNextResponse = false;
+    bootDoneMicros = hostsim::nowMicros() + RESET_BOOT_US;
+    updateIrq();
+}
+
+void PN532Emulator::onPinWrite(uint8_t pin, uint8_t level) {
+    if (pin != PN532_RESET_PIN) {
+        return;
+    }
+    if (level == LOW) {
+        inReset = true;
+        updateIrq();
+    } else if (inReset) {
+        inReset = false;
+        powerOnReset();
+    }
+}
+
+bool PN532Emulator::onWrite(const uint8_t* data, size_t len) {
+    if (inReset || hung || hostsim::nowMicros() < bootDoneMicros) {
+        return false;
+    }
+
+    if (nackNextWrite) {
+        nackNextWrite = false;
+        return false;
+    }
+
+    // Пустая транзакция - проверка адреса
+    if (len == 0) {
+        return true;
+    }
+
+    // ACK от хоста прерывает текущую команду
+    if (len >= 6 && memcmp(data, EMU_ACK_FRAME, 6) == 0) {
+        phase = PHASE_IDLE;
+        waitingForTag = false;
+        autoPolling = false;
+        updateIrq();
+        return true;
+    }
+
+    if (len < 8 || data[0] != 0x00 || data[1] != 0x00 || data[2] != 0xFF) {
+        checksumErrors++;
+        return true;
+    }
+
+    uint8_t frameLen = data[3];
+    if ((uint8_t)(frameLen + data[4]) != 0 || (size_t)frameLen + 7 > len || frameLen < 2) {
+        checksumErrors++;
+        return true;
+    }
+
+    uint8_t sum = 0;
+    for (uint8_t i = 0; i <= frameLen; i++) {
+        sum += data[5 + i];
+    }
+    if (sum != 0 || data[5] != PN532_HOSTTOPN532) {
+        checksumErrors++;
+        return true;   // PN532 молча игнорирует битый кадр
+    }
+
+    framesReceived++;
+    lastFrameMicros = hostsim::nowMicros();
+    commandLength = frameLen - 1;
+    memcpy(command, &data[6], commandLength);
+    commandCounts[command[0]]++;
+
+    // Новая команда прерывает предыдущую (как у реального PN532)
+    waitingForTag = false;
+    autoPolling = false;
+
+    // Поле на антенне с КЗ: кадр принят по I2C, но ни ACK, ни ответа
+    if ((command[0] == PN532_COMMAND_INLISTPASSIVETARGET || command[0] == PN532_COMMAND_INAUTOPOLL) &&
+        board->isCellShorted(board->selectedCell())) {
+        phase = PHASE_IDLE;
+        updateIrq();
+        return true;
+    }
+
+    phase = PHASE_ACK_PENDING;
+    readyAtMicros = hostsim::nowMicros() + ACK_DELAY_US;
+    updateIrq();
+    return true;
+}
+
+size_t PN532Emulator::onRead(uint8_t* data, size_t len) {
+    if (inReset || hung || hostsim::nowMicros() < bootDoneMicros) {
+        return 0;
+    }
+
+    memset(data, 0, len);
+    bool ready = isReady();
+    data[0] = ready ? PN532_I2C_READY : PN532_I2C_BUSY;
+
+    if (len == 1) {
+        statusReads++;
+    }
+    if (!ready || len < 2) {
+        updateIrq();
+        return len;
+    }
+
+    if (phase == PHASE_ACK_PENDING) {
+        memcpy(&data[1], EMU_ACK_FRAME, min((size_t)6, len - 1));
+        startCommand();
+    } else if (phase == PHASE_RESPONSE_READY) {
+        memcpy(&data[1], response, min((size_t)responseLength, len - 1));
+        phase = PHASE_IDLE;
+        responsesDelivered++;
+        lastResponseMicros = hostsim::nowMicros();
+    }
+    updateIrq();
+    return len;
+}
+
+bool PN532Emulator::isReady() {
+    uint64_t now = hostsim::nowMicros();
+
+    if (phase == PHASE_ACK_PENDING) {
+        return now >= readyAtMicros;
+    }
+
+    if (phase == PHASE_BUSY) {
+        if (waitingForTag) {
+            // Бесконечные повторы активации: ждем появления метки в поле
+            fieldTagCount = board->tagsInField(board->rfCell(), fieldTags);
+            if (fieldTagCount > 0) {
+                waitingForTag = false;
+                readyAtMicros = now + executeInListPassiveTarget();
+            }
+            return false;
+        }
+        if (autoPolling && !advanceAutoPoll(now)) {
+            return false;
+        }
+        if (now >= readyAtMicros) {
+            phase = PHASE_RESPONSE_READY;
+        }
+    }
+
+    return phase == PHASE_RESPONSE_READY;
+}
+
+void PN532Emulator::startCommand() {
+    phase = PHASE_BUSY;
+    uint32_t latency = executeCommand();
+
+    if (dropNextResponse) {
+        dropNextResponse = false;
+        waitingForTag = false;
+        readyAtMicros = UINT64_MAX;
+        return;
+    }
+    readyAtMicros = hostsim::nowMicros() + latency;
+}
+
+uint32_t PN532Emulator::executeCommand() {
+    uint8_t payload[32];
+
+    switch (command[0]) {
+        case PN532_COMMAND_GETFIRMWAREVERSION: {
+            const uint8_t fw[] = {PN532_PN532TOHOST, 0x03, 0x32, 0x01, 0x06, 0x07};
+            setResponse(fw, sizeof(fw));
+            return SIMPLE_COMMAND_US;
+        }
+
+        case PN532_COMMAND_SAMCONFIGURATION:
+            payload[0] = PN532_PN532TOHOST;
+            payload[1] = 0x15;
+            setResponse(payload, 2);
+            return SAM_CONFIG_US;
+
+        case PN532_COMMAND_GETGENERALSTATUS:
+            payload[0] = PN532_PN532TOHOST;
+            payload[1] = 0x05;
+            payload[2] = 0x00;   // Err
+            payload[3] = 0x01;   // Field
+            payload[4] = 0x00;   // NbTg
+            payload[5] = 0x01;   // SAM status
+            setResponse(payload, 6);
+            return SIMPLE_COMMAND_US;
+
+        case PN532_COMMAND_RFCONFIGURATION:
+            return executeRFConfiguration();
+
+        case PN532_COMMAND_WRITEREGISTER:
+            return executeWriteRegister();
+
+        case PN532_COMMAND_READREGISTER:
+            return executeReadRegister();
+
+        case PN532_COMMAND_INCOMMUNICATETHRU:
+            return executeInCommunicateThru();
+
+        case PN532_COMMAND_INDATAEXCHANGE:
+            return executeInDataExchange();
+
+        case PN532_COMMAND_INAUTOPOLL:
+            return executeInAutoPoll();
+
+        case PN532_COMMAND_INLISTPASSIVETARGET:
+            activatedCell = -1;
+            // Активация включает поле и грузит в CIU аналоговые настройки пункта 0x0A
+            board->setFieldOn(true);
+            ciuRfCfg = analogTypeA[0];
+            ciuModGsP = analogTypeA[3];
+            fieldTagCount = board->tagsInField(board->rfCell(), fieldTags);
+            if (fieldTagCount == 0) {
+                if (passiveRetries == 0xFF) {
+                    waitingForTag = true;
+                    return 0;
+                }
+                // Конечное число повторов: пустой ответ NbTg=0
+                payload[0] = PN532_PN532TOHOST;
+                payload[1] = PN532_RESPONSE_INLISTPASSIVETARGET;
+                payload[2] = 0;
+                setResponse(payload, 3);
+                return (passiveRetries + 1) * PASSIVE_ATTEMPT_US;
+            }
+            return executeInListPassiveTarget();
+
+        default:
+            // Syntax error frame
+            payload[0] = 0x7F;
+            setResponse(payload, 1);
+            return SIMPLE_COMMAND_US;
+    }
+}
+
+uint32_t PN532Emulator::executeInListPassiveTarget() {
+    int cell = board->rfCell();
+    uint8_t maxTargets = (commandLength >= 2 && command[1] >= 2) ? 2 : 1;
+    int listed = min(fieldTagCount, (int)maxTargets);
+    uint8_t payload[32];
+    uint8_t n = 0;
+    uint32_t latency = board->powerUpRemainingUs();
+
+    // Слабая связь: попытки активации до первой удачной (повторы внутри PN532)
+    uint32_t failedAttempts = 0;
+    while (!board->linkAttempt(cell, ciuRfCfg, ciuModGsP)) {
+        failedAttempts++;
+        if ((passiveRetries != 0xFF && failedAttempts > passiveRetries) || failedAttempts >= 1000) {
+            payload[n++] = PN532_PN532TOHOST;
+            payload[n++] = PN532_RESPONSE_INLISTPASSIVETARGET;
+            payload[n++] = 0;
+            setResponse(payload, n);
+            return failedAttempts * PASSIVE_ATTEMPT_US;
+        }
+    }
+    latency += failedAttempts * PASSIVE_ATTEMPT_US;
+
+    payload[n++] = PN532_PN532TOHOST;
+    payload[n++] = PN532_RESPONSE_INLISTPASSIVETARGET;
+    payload[n++] = (uint8_t)listed;         // NbTg
+
+    // Активация перенастраивает CIU под кадры с CRC и оставляет метки в ACTIVE
+    txMode = EMU_CIU_CRC_EN;
+    rxMode = EMU_CIU_CRC_EN;
+    bitFraming = 0;
+    activatedTags[0] = activatedTags[1] = -1;
+
+    for (int t = 0; t < listed; t++) {
+        const EmulatedTag& tag = board->tagAt(fieldTags[t]);
+        payload[n++] = (uint8_t)(t + 1);        // Tg
+        payload[n++] = (tag.atqa >> 8) & 0xFF;  // SENS_RES
+        payload[n++] = tag.atqa & 0xFF;
+        payload[n++] = tag.sak;                 // SEL_RES
+        payload[n++] = tag.uidLength;
+        memcpy(&payload[n], tag.uid, tag.uidLength);
+        n += tag.uidLength;
+
+        activatedTags[t] = fieldTags[t];
+        EmulatedTagRf& state = tagRfState(fieldTags[t]);
+        state.state = TAG_STATE_ACTIVE;
+        state.fromHalt = false;
+
+        uint32_t activation = board->activationDelayUs(cell);
+        if (activation == 0) {
+            activation = (tag.uidLength > 4) ? ACTIVATION_7B_US : ACTIVATION_4B_US;
+        }
+        latency += activation;
+    }
+
+    // Вторую метку PN532 ищет новым REQA, даже если ее нет
+    if (maxTargets == 2 && listed < 2) {
+        latency += SECOND_TARGET_SEARCH_US;
+    }
+
+    setResponse(payload, n);
+    activatedCell = cell;
+    activatedMicros = hostsim::nowMicros();
+    return latency;
+}
+
+uint32_t PN532Emulator::executeInAutoPoll() {
+    // PollNr, Period, типы; моделируется только 0x10 (ISO14443A 106 кбит/с)
+    if (commandLength < 4 || command[2] < 0x01 || command[2] > 0x0F || command[1] == 0) {
+        uint8_t payload[1] = {0x7F};
+        setResponse(payload, 1);
+        return SIMPLE_COMMAND_US;
+    }
+
+    board->setFieldOn(true);
+    autoPolling = true;
+    autoPollRemaining = command[1];
+    autoPollPeriodUs = command[2] * AUTOPOLL_PERIOD_UNIT_US;
+    autoPollNext = hostsim::nowMicros();
+    return 0;
+}
+
+bool PN532Emulator::advanceAutoPoll(uint64_t now) {
+    // Опросы, которые успели пройти к моменту проверки RDY. Метка считается
+    // в поле с момента установки - время обнаружения не зависит от шага проверки
+    while (autoPollNext <= now) {
+        int cell = board->rfCell();
+        const EmulatedTag& tag = board->tagAt(cell);
+
+        if (tag.present && tag.placedMicros <= autoPollNext) {
+            uint8_t payload[32];
+            uint8_t n = 0;
+            payload[n++] = PN532_PN532TOHOST;
+            payload[n++] = PN532_COMMAND_INAUTOPOLL + 1;
+            payload[n++] = 1;                       // NbTg
+            payload[n++] = 0x10;                    // Type: ISO14443A 106 кбит/с
+            payload[n++] = 5 + tag.uidLength;       // Длина TargetData
+            payload[n++] = 1;                       // Tg
+            payload[n++] = (tag.atqa >> 8) & 0xFF;
+            payload[n++] = tag.atqa & 0xFF;
+            payload[n++] = tag.sak;
+            payload[n++] = tag.uidLength;
+            memcpy(&payload[n], tag.uid, tag.uidLength);
+            n += tag.uidLength;
+            setResponse(payload, n);
+
+            activatedCell = cell;
+            activatedTags[0] = cell;
+            activatedTags[1] = -1;
+            activatedMicros = autoPollNext;
+            txMode = EMU_CIU_CRC_EN;
+            rxMode = EMU_CIU_CRC_EN;
+            bitFraming = 0;
+            EmulatedTagRf& state = tagRfState(cell);
+            state.state = TAG_STATE_ACTIVE;
+            state.fromHalt = false;
+
+            uint32_t activation = board->activationDelayUs(cell);
+            if (activation == 0) {
+                activation = (tag.uidLength > 4) ? ACTIVATION_7B_US : ACTIVATION_4B_US;
+            }
+            readyAtMicros = autoPollNext + activation;
+            autoPolling = false;
+            return true;
+        }
+
+        if (autoPollRemaining != 0xFF && --autoPollRemaining == 0) {
+            uint8_t payload[3] = {PN532_PN532TOHOST, PN532_COMMAND_INAUTOPOLL + 1, 0};
+            setResponse(payload, 3);
+            readyAtMicros = autoPollNext;
+            autoPolling = false;
+            return true;
+        }
+
+        autoPollNext += autoPollPeriodUs;
+    }
+    return false;
+}
+
+uint32_t PN532Emulator::executeInDataExchange() {
+    uint8_t payload[32];
+    payload[0] = PN532_PN532TOHOST;
+    payload[1] = PN532_RESPONSE_INDATAEXCHANGE;
+    payload[2] = 0x01;   // Timeout: метка не отвечает
+
+    // Метка должна быть активирована на той же антенне без переключений после этого
+    int cell = board->selectedCell();
+    int target = (commandLength >= 3 && (command[1] == 1 || command[1] == 2)) ? activatedTags[command[1] - 1] : -1;
+    bool active = target >= 0 && cell >= 0 && cell == activatedCell &&
+                  board->getLastSwitchMicros() <= activatedMicros && board->hasTag(target);
+
+    if (!active) {
+        setResponse(payload, 3);
+        return SIMPLE_COMMAND_US;
+    }
+
+    EmulatedTag& tag = board->mutableTagAt(target);
+    uint8_t op = command[2];
+    uint8_t page = (commandLength >= 4) ? command[3] : 0xFF;
+
+    if (op == MIFARE_CMD_READ && page < EMU_TAG_PAGES) {
+        payload[2] = 0x00;
+        // READ возвращает 4 страницы с переходом через конец памяти
+        for (int i = 0; i < 16; i++) {
+            payload[3 + i] = tag.memory[(page * 4 + i) % (EMU_TAG_PAGES * 4)];
+        }
+        setResponse(payload, 19);
+        return TAG_READ_US;
+    }
+
+    if (op == MIFARE_ULTRALIGHT_CMD_WRITE && page < EMU_TAG_PAGES && commandLength >= 8) {
+        memcpy(&tag.memory[page * 4], &command[4], 4);
+        payload[2] = 0x00;
+        setResponse(payload, 3);
+        return TAG_WRITE_US;
+    }
+
+    setResponse(payload, 3);
+    return SIMPLE_COMMAND_US;
+}
+
+uint32_t PN532Emulator::executeRFConfiguration() {
+    // Пункт 2: RFU, fATR_RES_Timeout, fRetryTimeout
+    if (commandLength >= 5 && command[1] == 0x02) {
+        retryTimeout = command[4];
+    }
+    // Пункт 5: MxRtyATR, MxRtyPSL, MxRtyPassiveActivation
+    if (commandLength >= 5 && command[1] == 0x05) {
+        passiveRetries = command[4];
+    }
+    // Пункт 1: бит 0 - поле включено
+    if (commandLength >= 3 && command[1] == 0x01) {
+        board->setFieldOn(command[2] & 0x01);
+    }
+    // Пункт 0x0A: аналоговые настройки 106 кбит/с тип A
+    if (commandLength >= 2 + sizeof(analogTypeA) && command[1] == 0x0A) {
+        memcpy(analogTypeA, &command[2], sizeof(analogTypeA));
+    }
+    uint8_t payload[2] = {PN532_PN532TOHOST, PN532_COMMAND_RFCONFIGURATION + 1};
+    setResponse(payload, 2);
+    return SIMPLE_COMMAND_US;
+}
+
+uint32_t PN532Emulator::executeWriteRegister() {
+    for (uint8_t i = 1; i + 2 < commandLength; i += 3) {
+        uint16_t reg = ((uint16_t)command[i] << 8) | command[i + 1];
+        uint8_t value = command[i + 2];
+        if (reg == EMU_CIU_TX_MODE) txMode = value;
+        else if (reg == EMU_CIU_RX_MODE) rxMode = value;
+        else if (reg == EMU_CIU_BIT_FRAMING) bitFraming = value;
+        else if (reg == EMU_CIU_RF_CFG) ciuRfCfg = value;
+        else if (reg == EMU_CIU_MOD_GSP) ciuModGsP = value;
+    }
+    uint8_t payload[2] = {PN532_PN532TOHOST, PN532_COMMAND_WRITEREGISTER + 1};
+    setResponse(payload, 2);
+    return SIMPLE_COMMAND_US;
+}
+
+uint32_t PN532Emulator::executeReadRegister() {
+    uint8_t payload[48];
+    uint8_t n = 0;
+    payload[n++] = PN532_PN532TOHOST;
+    payload[n++] = PN532_COMMAND_READREGISTER + 1;
+    for (uint8_t i = 1; i + 1 < commandLength && n < sizeof(payload); i += 2) {
+        uint16_t reg = ((uint16_t)command[i] << 8) | command[i + 1];
+        uint8_t value = 0;
+        if (reg == EMU_CIU_TX_MODE) value = txMode;
+        else if (reg == EMU_CIU_RX_MODE) value = rxMode;
+        else if (reg == EMU_CIU_BIT_FRAMING) value = bitFraming;
+        else if (reg == EMU_CIU_RF_CFG) value = ciuRfCfg;
+        else if (reg == EMU_CIU_GSN_ON) value = analogTypeA[1];
+        else if (reg == EMU_CIU_CW_GSP) value = analogTypeA[2];
+        else if (reg == EMU_CIU_MOD_GSP) value = ciuModGsP;
+        payload[n++] = value;
+    }
+    setResponse(payload, n);
+    return SIMPLE_COMMAND_US;
+}
+
+uint32_t PN532Emulator::retryTimeoutUs() const {
+    // 0x01 = 100 мкс, каждое следующее значение вдвое больше
+    if (retryTimeout == 0) {
+        return 0;
+    }
+    return 100UL << (min(retryTimeout, (uint8_t)0x10) - 1);
+}
+
+EmulatedTagRf& PN532Emulator::tagRfState(int cell) {
+    EmulatedTagRf& state = tagRf[cell];
+    const EmulatedTag& tag = board->tagAt(cell);
+    // Переключение антенны или выключение поля обесточивает метку, новая метка - новое состояние
+    if (state.fieldSince != board->getFieldSinceMicros() || state.placement != tag.placement) {
+        state.state = TAG_STATE_IDLE;
+        state.fromHalt = false;
+        state.cascadeLevel = 0;
+        state.fieldSince = board->getFieldSinceMicros();
+        state.placement = tag.placement;
+    }
+    return state;
+}
+
+bool PN532Emulator::tagRespond(int cell, const uint8_t* frame, uint8_t length, bool shortFrame,
+                               uint8_t* answer, uint8_t& answerLength, bool& answerCrc) {
+    const EmulatedTag& tag = board->tagAt(cell);
+    EmulatedTagRf& state = tagRfState(cell);
+    uint8_t fallback = state.fromHalt ? TAG_STATE_HALT : TAG_STATE_IDLE;
+    answerLength = 0;
+    answerCrc = false;
+
+    if (shortFrame) {
+        bool wakeup = (frame[0] == EMU_TAG_WUPA);
+        if (frame[0] != EMU_TAG_REQA && !wakeup) {
+            return false;
+        }
+        if (state.state == TAG_STATE_IDLE || (wakeup && state.state == TAG_STATE_HALT)) {
+            if (!board->frameReceived(cell) || !board->linkAttempt(cell, ciuRfCfg, ciuModGsP)) {
+                return false;
+            }
+            state.fromHalt = (state.state == TAG_STATE_HALT);
+            state.state = TAG_STATE_READY;
+            state.cascadeLevel = 1;
+            answer[0] = tag.atqa & 0xFF;    // ATQA передается младшим байтом вперед
+            answer[1] = (tag.atqa >> 8) & 0xFF;
+            answerLength = 2;
+            return true;
+        }
+        if (state.state != TAG_STATE_HALT) {
+            state.state = fallback;
+        }
+        return false;
+    }
+
+    // SELECT: 93/95 70 + 4 байта уровня + BCC
+    if (length == 7 && frame[1] == 0x70 && (frame[0] == 0x93 || frame[0] == 0x95) &&
+        state.state == TAG_STATE_READY) {
+        uint8_t level = (frame[0] == 0x93) ? 1 : 2;
+        uint8_t expected[4];
+        bool last = (tag.uidLength <= 4) || level == 2;
+        if (tag.uidLength <= 4) {
+            memcpy(expected, tag.uid, 4);
+        } else if (level == 1) {
+            expected[0] = EMU_TAG_CT;
+            memcpy(&expected[1], tag.uid, 3);
+        } else {
+            memcpy(expected, &tag.uid[3], 4);
+        }
+        uint8_t bcc = expected[0] ^ expected[1] ^ expected[2] ^ expected[3];
+        if (level != state.cascadeLevel || memcmp(&frame[2], expected, 4) != 0 || frame[6] != bcc) {
+            state.state = fallback;
+            return false;
+        }
+        if (last) {
+            state.state = TAG_STATE_ACTIVE;
+            answer[0] = tag.sak;
+        } else {
+            state.cascadeLevel++;
+            answer[0] = 0x04;               // Бит каскада: UID не полный
+        }
+        answerLength = 1;
+        answerCrc = true;
+        return true;
+    }
+
+    if (state.state == TAG_STATE_ACTIVE && length == 2 && frame[0] == EMU_TAG_HLTA && frame[1] == 0x00) {
+        state.state = TAG_STATE_HALT;
+        state.fromHalt = false;
+        return false;                       // HLTA без ответа
+    }
+
+    if (state.state == TAG_STATE_ACTIVE && length == 2 && frame[0] == MIFARE_CMD_READ &&
+        frame[1] < EMU_TAG_PAGES) {
+        for (int i = 0; i < 16; i++) {
+            answer[i] = tag.memory[(frame[1] * 4 + i) % (EMU_TAG_PAGES * 4)];
+        }
+        answerLength = 16;
+        answerCrc = true;
+        return true;
+    }
+
+    // Неожиданная команда возвращает метку в IDLE (или HALT, если будили из HALT)
+    if (state.state != TAG_STATE_HALT) {
+        state.state = fallback;
+    }
+    return false;
+}
+
+uint32_t PN532Emulator::executeInCommunicateThru() {
+    uint8_t payload[32];
+    payload[0] = PN532_PN532TOHOST;
+    payload[1] = PN532_COMMAND_INCOMMUNICATETHRU + 1;
+    payload[2] = 0x01;                      // Timeout: метка не ответила
+
+    const uint8_t* data = &command[1];
+    uint8_t length = commandLength - 1;
+    uint8_t txBits = bitFraming & 0x07;
+    bool shortFrame = (txBits == 7 && length == 1);
+
+    // Кадр, который увидит метка: CRC добавляет CIU или он уже в данных
+    uint8_t frame[32];
+    uint8_t frameLength = 0;
+    bool frameValid = length > 0 && length <= sizeof(frame) && (txBits == 0 || shortFrame);
+    if (frameValid) {
+        memcpy(frame, data, length);
+        frameLength = length;
+        if (!shortFrame && !(txMode & EMU_CIU_CRC_EN)) {
+            uint16_t crc = (length >= 3) ? emuCrcA(data, length - 2) : 0;
+            frameValid = length >= 3 && data[length - 2] == (crc & 0xFF) && data[length - 1] == (crc >> 8);
+            frameLength = length - 2;
+        }
+    }
+
+    uint32_t txUs = THRU_OVERHEAD_US + (shortFrame ? RF_BYTE_US : (length + 2) * RF_BYTE_US);
+    // Без поля или до запитки метки кадр уходит в пустоту
+    int cell = (board->isFieldOn() && board->powerUpRemainingUs() == 0) ? board->rfCell() : -1;
+    uint8_t answer[18];
+    uint8_t answerLength = 0;
+    bool answerCrc = false;
+
+    if (!frameValid || !board->hasTag(cell) ||
+        !tagRespond(cell, frame, frameLength, shortFrame, answer, answerLength, answerCrc)) {
+        setResponse(payload, 3);
+        return txUs + retryTimeoutUs();
+    }
+
+    uint8_t n = 3;
+    payload[2] = 0x00;
+    if (answerCrc && !(rxMode & EMU_CIU_CRC_EN)) {
+        memcpy(&payload[n], answer, answerLength);
+        n += answerLength;
+        uint16_t crc = emuCrcA(answer, answerLength);
+        payload[n++] = crc & 0xFF;
+        payload[n++] = crc >> 8;
+    } else if (!answerCrc && (rxMode & EMU_CIU_CRC_EN)) {
+        payload[2] = 0x02;                  // CRC error: короткий ответ без CRC
+    } else {
+        memcpy(&payload[n], answer, answerLength);
+        n += answerLength;
+    }
+    setResponse(payload, n);
+
+    uint8_t rxBytes = answerLength + (answerCrc ? 2 : 0);
+    return txUs + RF_FDT_US + rxBytes * RF_BYTE_US;
+}
+
+void PN532Emulator::setResponse(const uint8_t* payload, uint8_t payloadLength) {
+    uint8_t n = 0;
+    response[n++] = PN532_PREAMBLE;
+    response[n++] = PN532_STARTCODE1;
+    response[n++] = PN532_STARTCODE2;
+    response[n++] = payloadLength;
+    response[n++] = (uint8_t)(~payloadLength + 1);
+
+    uint8_t sum = 0;
+    for (uint8_t i = 0; i < payloadLength; i++) {
+        response[n++] = payload[i];
+        sum += payload[i];
+    }
+    response[n++] = (uint8_t)(~sum + 1);
+    response[n++] = PN532_POSTAMBLE;
+    responseLength = n;
+}
@@ -0,0 +1,315 @@
+#ifndef PN532_EMULATOR_H
+#define PN532_EMULATOR_H
+
+#include <Arduino.h>
+#include "host_sim.h"
+#include "config.h"
+
+// =============================================
+// ЭМУЛЯТОР ДОСКИ И PN532 ДЛЯ ХОСТ-СБОРКИ
+// Модель на уровне I2C кадров: ACK, RDY байт, задержки обработки команд.
+// Антенна выбирается по уровням пинов дерева мультиплексоров ActiveGeometry (config.h)
+// =============================================
+
+// Память NTAG213: 45 страниц по 4 байта
+const int EMU_TAG_PAGES = 45;
+
+struct EmulatedTag {
+    bool present;
+    uint8_t uid[UID_BUFFER_SIZE];
+    uint8_t uidLength;
+    uint16_t atqa;
+    uint8_t sak;
+    uint8_t memory[EMU_TAG_PAGES * 4];
+    uint32_t placement;         // Номер установки на доску (сброс состояния метки)
+    uint64_t placedMicros;      // Время установки
+};
+
+// Состояния метки ISO14443-3. Поле пропадает при переключении антенны - метка в IDLE
+enum EmulatedTagState {
+    TAG_STATE_IDLE,
+    TAG_STATE_READY,
+    TAG_STATE_ACTIVE,
+    TAG_STATE_HALT
+};
+
+struct EmulatedTagRf {
+    uint8_t state;
+    bool fromHalt;              // READY*/ACTIVE*: разбужена WUPA из HALT
+    uint8_t cascadeLevel;       // Ожидаемый уровень SELECT в READY
+    uint64_t fieldSince;        // Переключение антенны, после которого действует состояние
+    uint32_t placement;
+};
+
+// RF-характеристики ячейки: сколько антенна успокаивается после переключения
+// (до этого PN532 видит метку прежней ячейки) и задержка активации метки
+struct CellRfModel {
+    uint32_t settleUs;
+    uint32_t activationUs;      // 0 = по длине UID (модель PN532)
+    uint32_t jitterUs;          // Случайная добавка 0..jitterUs
+};
+
+// Аналоговый тракт ячейки: ответ метки декодируется с первой попытки, если
+// RxGain (CIU_RFCfg, биты 6:4) в [minRxGain, maxRxGain] и ModGsP не больше
+// maxModGsP (слабой связи нужна глубокая модуляция). Каждый шаг мимо окна
+// вдвое снижает шанс попытки. Избыточное усиление насыщает демодулятор
+struct CellAnalogModel {
+    uint8_t minRxGain;
+    uint8_t maxRxGain;
+    uint8_t maxModGsP;
+};
+
+// Связь антенны с метками соседних ячеек. Метка соседа на расстоянии d шагов
+// сетки (1, 1.41, 2) отвечает на опрос с вероятностью
+//   (steadyPercent + transientPercent * 2^(-t / halfLifeUs)) / d^3.
+// Переходная часть - только для метки ячейки, с которой мультиплексор ушел при
+// включенном поле (ток прежней антенны еще не погас), t - время после
+// переключения. Переключение при выключенном поле хвоста не дает. Несколько меток в поле: антиколлизия не разрешается (NbTg=0) с
+// вероятностью collisionPercent * (слабейшая связь / сильнейшая)
+struct CellCouplingModel {
+    uint8_t steadyPercent;
+    uint8_t transientPercent;
+    uint32_t halfLifeUs;
+    uint8_t collisionPercent;
+};
+
+class BoardModel : public hostsim::PinListener {
+public:
+    // Метка отвечает не раньше, чем через столько после включения поля
+    static const uint32_t TAG_POWER_UP_US = 1000;
+    // Соседи в пределах 2 шагов сетки (центральная ячейка не считается)
+    static const int COUPLING_NEIGHBOURS = 12;
+
+private:
+    EmulatedTag tags[MATRIX_TOTAL_CELLS];
+    CellRfModel rf[MATRIX_TOTAL_CELLS];
+    int selected;
+    int coupled;                // Ячейка, чья антенна реально подключена к PN532
+    uint64_t lastSwitchMicros;
+    bool fieldOn;               // Поле PN532 (RFConfiguration, пункт 1)
+    uint64_t fieldOnMicros;
+    uint32_t switches;
+    uint32_t rngState;
+    uint32_t placements;
+    int bleedFrom[MATRIX_TOTAL_CELLS];          // Чья метка попадает в поле антенны (-1 нет)
+    uint8_t bleedPercent[MATRIX_TOTAL_CELLS];
+    CellAnalogModel analog[MATRIX_TOTAL_CELLS];
+    bool shorted[MATRIX_TOTAL_CELLS];
+    CellCouplingModel coupling[MATRIX_TOTAL_CELLS];
+    bool switchedWithField;     // Последнее переключение - при включенном поле
+    int switchedFrom;           // Ячейка до последнего переключения
+    uint32_t crosstalkResponses;
+    uint32_t collisionFailures;
+
+public:
+    BoardModel();
+
+    void attach();
+    void detach();
+
+    // Выключение питания: метки остаются на доске, мультиплексоры сбрасываются
+    void powerCycle();
+
+    // Управление метками
+    void placeTag(int cellIndex, const uint8_t* uid, uint8_t uidLength);
+    void removeTag(int cellIndex);
+    void moveTag(int fromCell, int toCell);
+    void clear();
+    bool hasTag(int cellIndex) const;
+    const EmulatedTag& tagAt(int cellIndex) const;
+    EmulatedTag& mutableTagAt(int cellIndex);
+    int findTag(const uint8_t* uid, uint8_t uidLength) const;
+
+    // RF-модель ячеек (по умолчанию мгновенное переключение, штатная активация)
+    void setCellRf(int cellIndex, uint32_t settleUs, uint32_t activationUs, uint32_t jitterUs);
+    uint32_t activationDelayUs(int cellIndex);
+    bool frameReceived(int cellIndex);  // Слабая антенна теряет одиночные кадры
+
+    // Аналоговый тракт (по умолчанию RxGain 0..6, любой ModGsP).
+    // linkAttempt() - удалась ли одна попытка обмена при текущих CIU_RFCfg/ModGsP
+    void setCellAnalog(int cellIndex, uint8_t minRxGain, uint8_t maxRxGain, uint8_t maxModGsP);
+    bool linkAttempt(int cellIndex, uint8_t rfCfg, uint8_t modGsP);
+    
+    // Метка соседней ячейки в поле антенны: отвечает на опрос с вероятностью percent.
+    // tagsInField() - ячейки ответивших меток в порядке, в котором их выберет антиколлизия
+    void setCellBleed(int cellIndex, int neighbourCell, uint8_t percent);
+    int tagsInField(int cellIndex, int* cells);
+
+    // Модель связи с соседями (по умолчанию выключена). setCoupling - всем ячейкам
+    void setCellCoupling(int cellIndex, const CellCouplingModel& model);
+    void setCoupling(const CellCouplingModel& model);
+    uint8_t couplingPercent(int cellIndex, int neighbourCell) const;
+    uint32_t getCrosstalkResponses() const { return crosstalkResponses; }
+    uint32_t getCollisionFailures() const { return collisionFailures; }
+
+    // КЗ антенны: команда, включающая поле на ячейке, перегружает драйвер TX -
+    // PN532 теряет кадр, не отвечая даже ACK. Остальные команды проходят
+    void setCellShorted(int cellIndex, bool isShorted);
+    bool isCellShorted(int cellIndex) const;
+
+    // Поле PN532. Переключение при выключенном поле не оставляет прежнюю антенну
+    // подключенной (успокаиваться нечему), но после включения метка запитывается
+    void setFieldOn(bool on);
+    bool isFieldOn() const { return fieldOn; }
+    uint32_t powerUpRemainingUs() const;
+    
+    // Состояние мультиплексоров (-1 если EN выключен)
+    int selectedCell() const { return selected; }
+    int rfCell();               // selectedCell() с учетом незавершенного переключения
+    uint64_t getLastSwitchMicros() const { return lastSwitchMicros; }
+    uint64_t getFieldSinceMicros() const { return max(lastSwitchMicros, fieldOnMicros); }
+    uint32_t getSwitchCount() const { return switches; }
+
+    void onPinWrite(uint8_t pin, uint8_t level) override;
+
+private:
+    void decodeSelection();
+    uint32_t nextRandom();
+    int coupledTagsInField(int cellIndex, int* cells);
+};
+
+// Классы неисправностей PN532
+enum EmulatorFault {
+    EMU_FAULT_NONE,
+    EMU_FAULT_NACK_ONCE,       // Одна транзакция записи получает NACK
+    EMU_FAULT_DROP_RESPONSE,   // ACK есть, ответ на команду не приходит (однократно)
+    EMU_FAULT_HANG             // NACK на все транзакции до аппаратного сброса
+};
+
+class PN532Emulator : public hostsim::I2CSlave, public hostsim::PinListener, public hostsim::TimedDevice {
+public:
+    enum Phase {
+        PHASE_IDLE,
+        PHASE_ACK_PENDING,
+        PHASE_BUSY,
+        PHASE_RESPONSE_READY
+    };
+
+    // Тайминги модели (мкс)
+    static const uint32_t ACK_DELAY_US = 300;
+    static const uint32_t SIMPLE_COMMAND_US = 400;
+    static const uint32_t SAM_CONFIG_US = 1000;
+    static const uint32_t ACTIVATION_4B_US = 2500;
+    static const uint32_t ACTIVATION_7B_US = 4200;
+    static const uint32_t RESET_BOOT_US = 2000;
+    static const uint32_t TAG_READ_US = 1500;
+    static const uint32_t TAG_WRITE_US = 5500;
+    static const uint32_t THRU_OVERHEAD_US = 200;    // Обработка InCommunicateThru в PN532
+    static const uint32_t RF_BYTE_US = 85;           // Байт с четностью на 106 кбит/с
+    static const uint32_t RF_FDT_US = 90;            // Пауза метки перед ответом
+    static const uint32_t SECOND_TARGET_SEARCH_US = 1000;  // MaxTg=2: REQA и ожидание второй метки
+    static const uint32_t AUTOPOLL_PERIOD_UNIT_US = 150000; // Единица Period у InAutoPoll
+    static const uint32_t PASSIVE_ATTEMPT_US = 4000; // Неудачная попытка активации: REQA, ожидание, повтор
+    static const uint8_t DEFAULT_RETRY_TIMEOUT = 0x0A;  // fRetryTimeout по умолчанию: 51.2 мс
+
+private:
+    BoardModel* board;
+
+    Phase phase;
+    uint64_t readyAtMicros;
+    uint8_t command[64];
+    uint8_t commandLength;
+    uint8_t response[64];
+    uint8_t responseLength;
+    bool waitingForTag;
+    int activatedCell;          // Антенна, на которой прошел InListPassiveTarget
+    int activatedTags[2];       // Ячейки меток Tg=1, Tg=2
+    int fieldTags[2];           // Метки в поле на текущий InListPassiveTarget
+    int fieldTagCount;
+
+    // InAutoPoll: опросы поля в моменты autoPollNext, autoPollNext + период, ...
+    bool autoPolling;
+    uint64_t autoPollNext;
+    uint32_t autoPollPeriodUs;
+    uint8_t autoPollRemaining;  // 0xFF = бесконечно
+    uint64_t activatedMicros;
+
+    // Регистры CIU, влияющие на кадры InCommunicateThru
+    uint8_t txMode;
+    uint8_t rxMode;
+    uint8_t bitFraming;
+    uint8_t retryTimeout;       // RFConfiguration, пункт 2
+    uint8_t passiveRetries;     // RFConfiguration, пункт 5: MxRtyPassiveActivation
+    uint8_t analogTypeA[11];    // RFConfiguration, пункт 0x0A: грузится в CIU при активации
+    uint8_t ciuRfCfg;           // Текущие CIU_RFCfg / CIU_ModGsP
+    uint8_t ciuModGsP;
+    EmulatedTagRf tagRf[MATRIX_TOTAL_CELLS];
+
+    // P70_IRQ: LOW, пока готовый ACK/ответ не прочитан хостом
+    bool irqWired;
+    uint8_t irqLevel;
+
+    bool inReset;
+    uint64_t bootDoneMicros;
+    bool hung;
+    bool nackNextWrite;
+    bool dropNextResponse;
+
+    // Статистика
+    uint32_t framesReceived;
+    uint64_t lastFrameMicros;
+    uint32_t responsesDelivered;
+    uint64_t lastResponseMicros;
+    uint32_t checksumErrors;
+    uint32_t statusReads;       // Чтения одного байта RDY
+    uint32_t commandCounts[256];
+
+public:
+    PN532Emulator(BoardModel* boardModel);
+
+    void attach();
+    void detach();
+
+    // Выключение питания
+    void powerCycle() { powerOnReset(); }
+
+    // Неисправности
+    void injectFault(EmulatorFault fault);
+    bool isHung() const { return hung; }
+
+    // Провод IRQ до ESP32 (false - линия висит на подтяжке)
+    void setIrqWired(bool wired);
+
+    // Статистика
+    uint32_t getFramesReceived() const { return framesReceived; }
+    uint64_t getLastFrameMicros() const { return lastFrameMicros; }
+    uint32_t getResponsesDelivered() const { return responsesDelivered; }
+    uint64_t getLastResponseMicros() const { return lastResponseMicros; }
+    uint32_t getChecksumErrors() const { return checksumErrors; }
+    uint32_t getStatusReads() const { return statusReads; }
+    uint32_t getCommandCount(uint8_t cmd) const { return commandCounts[cmd]; }
+    Phase getPhase() const { return phase; }
+
+    // I2CSlave
+    bool onWrite(const uint8_t* data, size_t len) override;
+    size_t onRead(uint8_t* data, size_t len) override;
+
+    // PinListener (RSTPD_N)
+    void onPinWrite(uint8_t pin, uint8_t level) override;
+
+    // TimedDevice: готовность ACK/ответа опускает IRQ
+    uint64_t nextEventMicros() override;
+    void onTime(uint64_t now) override;
+
+private:
+    bool isReady();
+    void updateIrq();
+    void startCommand();
+    uint32_t executeCommand();
+    uint32_t executeInListPassiveTarget();
+    uint32_t executeInDataExchange();
+    uint32_t executeInCommunicateThru();
+    uint32_t executeWriteRegister();
+    uint32_t executeReadRegister();
+    uint32_t executeRFConfiguration();
+    uint32_t executeInAutoPoll();
+    bool advanceAutoPoll(uint64_t now);
+    EmulatedTagRf& tagRfState(int cell);
+    bool tagRespond(int cell, const uint8_t* frame, uint8_t length, bool shortFrame,
+                    uint8_t* answer, uint8_t& answerLength, bool& answerCrc);
+    uint32_t retryTimeoutUs() const;
+    void setResponse(const uint8_t* payload, uint8_t payloadLength);
+    void powerOnReset();
+};
+
+#endif // PN532_EMULATOR_H
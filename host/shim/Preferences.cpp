@@ -0,0 +1,125 @@
+#include "Preferences.h"
+#include "host_sim.h"
+#include <map>
+#include <string>
+#include <vector>
+
+// Хранилище - память модели флеша: выделения под FlashHeapScope не считаются
+// кучей прошивки (host_heap.cpp)
+namespace {
+
+std::map<std::string, std::vector<uint8_t>>& flashStore() {
+    static std::map<std::string, std::vector<uint8_t>> store;
+    return store;
+}
+
+uint32_t flashWrites = 0;
+uint32_t flashBytesWritten = 0;
+
+std::string makeKey(const char* ns, const char* key) {
+    return std::string(ns) + "/" + key;
+}
+
+} // namespace
+
+namespace hostsim {
+
+void eraseFlash() {
+    hostsim::FlashHeapScope flashHeap;
+    flashStore().clear();
+    eraseFilesystem();
+    flashWrites = 0;
+    flashBytesWritten = 0;
+}
+
+uint32_t getFlashWrites() { return flashWrites; }
+uint32_t getFlashBytesWritten() { return flashBytesWritten; }
+
+} // namespace hostsim
+
+Preferences::Preferences() : opened(false), readOnly(false) {
+    ns[0] = '\0';
+}
+
+Preferences::~Preferences() {
+    end();
+}
+
+bool Preferences::begin(const char* name, bool ro, const char* partitionLabel) {
+    (void)partitionLabel;
+    if (name == nullptr || strlen(name) >= sizeof(ns)) {
+        return false;
+    }
+    strcpy(ns, name);
+    readOnly = ro;
+    opened = true;
+    return true;
+}
+
+void Preferences::end() {
+    opened = false;
+}
+
+bool Preferences::clear() {
+    hostsim::FlashHeapScope flashHeap;
+    if (!opened || readOnly) return false;
+    std::string prefix = std::string(ns) + "/";
+    auto& store = flashStore();
+    for (auto it = store.begin(); it != store.end();) {
+        if (it->first.compare(0, prefix.size(), prefix) == 0) {
+            it = store.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    return true;
+}
+
+bool Preferences::remove(const char* key) {
+    hostsim::FlashHeapScope flashHeap;
+    if (!opened || readOnly) return false;
+    return flashStore().erase(makeKey(ns, key)) > 0;
+}
+
+bool Preferences::isKey(const char* key) {
+    hostsim::FlashHeapScope flashHeap;
+    return opened && flashStore().count(makeKey(ns, key)) > 0;
+}
+
+size_t Preferences::putBytes(const char* key, const void* value, size_t len) {
+    hostsim::FlashHeapScope flashHeap;
+    if (!opened || readOnly || value == nullptr) return 0;
+    const uint8_t* bytes = (const uint8_t*)value;
+    flashStore()[makeKey(ns, key)] = std::vector<uint8_t>(bytes, bytes + len);
+    flashWrites++;
+    flashBytesWritten += len;
+    return len;
+}
+
+size_t Preferences::getBytes(const char* key, void* buf, size_t maxLen) {
+    hostsim::FlashHeapScope flashHeap;
+    if (!opened) return 0;
+    auto it = flashStore().find(makeKey(ns, key));
+    if (it == flashStore().end() || it->second.size() > maxLen) return 0;
+    memcpy(buf, it->second.data(), it->second.size());
+    return it->second.size();
+}
+
+size_t Preferences::getBytesLength(const char* key) {
+    hostsim::FlashHeapScope flashHeap;
+    if (!opened) return 0;
+    auto it = flashStore().find(makeKey(ns, key));
+    return (it == flashStore().end()) ? 0 : it->second.size();
+}
+
+size_t Preferences::putUInt(const char* key, uint32_t value) {
+    return putBytes(key, &value, sizeof(value));
+}
+
+uint32_t Preferences::getUInt(const char* key, uint32_t defaultValue) {
+    uint32_t value = defaultValue;
+    if (getBytesLength(key) == sizeof(value)) {
+        getBytes(key, &value, sizeof(value));
+    }
+    return value;
+}
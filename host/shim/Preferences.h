@@ -0,0 +1,37 @@
+#ifndef HOST_PREFERENCES_H
+#define HOST_PREFERENCES_H
+
+#include <Arduino.h>
+
+// =============================================
+// ХОСТ-ШИМ NVS (Preferences)
+// Хранилище живет в памяти процесса и переживает "перезагрузки" прошивки
+// внутри одного бенчмарка; hostsim::eraseFlash() очищает его
+// =============================================
+
+class Preferences {
+private:
+    char ns[16];
+    bool opened;
+    bool readOnly;
+
+public:
+    Preferences();
+    ~Preferences();
+
+    bool begin(const char* name, bool readOnly = false, const char* partitionLabel = nullptr);
+    void end();
+
+    bool clear();
+    bool remove(const char* key);
+    bool isKey(const char* key);
+
+    size_t putBytes(const char* key, const void* value, size_t len);
+    size_t getBytes(const char* key, void* buf, size_t maxLen);
+    size_t getBytesLength(const char* key);
+
+    size_t putUInt(const char* key, uint32_t value);
+    uint32_t getUInt(const char* key, uint32_t defaultValue = 0);
+};
+
+#endif // HOST_PREFERENCES_H
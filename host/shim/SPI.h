@@ -0,0 +1,32 @@
+#ifndef HOST_SPI_H
+#define HOST_SPI_H
+
+#include "Arduino.h"
+
+// Заглушка SPI: проект работает с PN532 по I2C, SPI нужен только для
+// компиляции Adafruit_SPIDevice в хост-сборке
+
+#define SPI_MODE0 0x00
+#define SPI_MODE1 0x01
+#define SPI_MODE2 0x02
+#define SPI_MODE3 0x03
+
+class SPISettings {
+public:
+    SPISettings() {}
+    SPISettings(uint32_t, uint8_t, uint8_t) {}
+};
+
+class SPIClass {
+public:
+    void begin() {}
+    void end() {}
+    void beginTransaction(SPISettings) {}
+    void endTransaction() {}
+    uint8_t transfer(uint8_t) { return 0xFF; }
+    void transfer(void* buffer, size_t len) { memset(buffer, 0xFF, len); }
+};
+
+extern SPIClass SPI;
+
+#endif // HOST_SPI_H
@@ -0,0 +1,97 @@
+#include "SPIFFS.h"
+#include "host_sim.h"
+#include <map>
+#include <string>
+#include <vector>
+
+SPIFFSFS SPIFFS;
+
+namespace {
+
+std::map<std::string, std::vector<uint8_t>>& fileStore() {
+    static std::map<std::string, std::vector<uint8_t>> store;
+    return store;
+}
+
+} // namespace
+
+namespace hostsim {
+
+void eraseFilesystem() {
+    hostsim::FlashHeapScope flashHeap;
+    fileStore().clear();
+}
+
+} // namespace hostsim
+
+File::File() : writing(false), position(0), isOpen(false) {
+    path[0] = '\0';
+}
+
+File::File(const char* filePath, bool forWrite) : writing(forWrite), position(0), isOpen(true) {
+    hostsim::FlashHeapScope flashHeap;
+    strncpy(path, filePath, sizeof(path) - 1);
+    path[sizeof(path) - 1] = '\0';
+    if (writing) {
+        fileStore()[path].clear();
+    }
+}
+
+size_t File::write(const uint8_t* buffer, size_t size) {
+    hostsim::FlashHeapScope flashHeap;
+    if (!isOpen || !writing) return 0;
+    std::vector<uint8_t>& data = fileStore()[path];
+    data.insert(data.end(), buffer, buffer + size);
+    return size;
+}
+
+size_t File::read(uint8_t* buffer, size_t size) {
+    hostsim::FlashHeapScope flashHeap;
+    if (!isOpen || writing) return 0;
+    const std::vector<uint8_t>& data = fileStore()[path];
+    size_t n = (position < data.size()) ? min(size, data.size() - position) : 0;
+    memcpy(buffer, data.data() + position, n);
+    position += n;
+    return n;
+}
+
+size_t File::size() const {
+    hostsim::FlashHeapScope flashHeap;
+    auto it = fileStore().find(path);
+    return (isOpen && it != fileStore().end()) ? it->second.size() : 0;
+}
+
+void File::close() {
+    isOpen = false;
+}
+
+bool SPIFFSFS::begin(bool formatOnFail) {
+    (void)formatOnFail;
+    mounted = true;
+    return true;
+}
+
+bool SPIFFSFS::format() {
+    hostsim::FlashHeapScope flashHeap;
+    fileStore().clear();
+    return true;
+}
+
+File SPIFFSFS::open(const char* path, const char* mode) {
+    hostsim::FlashHeapScope flashHeap;
+    bool forWrite = mode != nullptr && mode[0] == 'w';
+    if (!mounted || (!forWrite && fileStore().count(path) == 0)) {
+        return File();
+    }
+    return File(path, forWrite);
+}
+
+bool SPIFFSFS::exists(const char* path) {
+    hostsim::FlashHeapScope flashHeap;
+    return mounted && fileStore().count(path) > 0;
+}
+
+bool SPIFFSFS::remove(const char* path) {
+    hostsim::FlashHeapScope flashHeap;
+    return mounted && fileStore().erase(path) > 0;
+}
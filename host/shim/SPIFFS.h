@@ -0,0 +1,51 @@
+#ifndef HOST_SPIFFS_H
+#define HOST_SPIFFS_H
+
+#include <Arduino.h>
+
+// =============================================
+// ХОСТ-ШИМ SPIFFS
+// Файлы живут в памяти процесса, как NVS в Preferences: переживают
+// "перезагрузки" прошивки, hostsim::eraseFlash() очищает и их.
+// Только то, что нужно прошивке: целый файл на запись или чтение
+// =============================================
+
+#define FILE_READ  "r"
+#define FILE_WRITE "w"
+
+class File {
+private:
+    char path[32];
+    bool writing;
+    size_t position;
+    bool isOpen;
+
+public:
+    File();
+    File(const char* filePath, bool forWrite);
+
+    operator bool() const { return isOpen; }
+    size_t write(const uint8_t* buffer, size_t size);
+    size_t read(uint8_t* buffer, size_t size);
+    size_t size() const;
+    void close();
+};
+
+class SPIFFSFS {
+private:
+    bool mounted;
+
+public:
+    SPIFFSFS() : mounted(false) {}
+
+    bool begin(bool formatOnFail = false);
+    void end() { mounted = false; }
+    bool format();
+    File open(const char* path, const char* mode = FILE_READ);
+    bool exists(const char* path);
+    bool remove(const char* path);
+};
+
+extern SPIFFSFS SPIFFS;
+
+#endif // HOST_SPIFFS_H
@@ -0,0 +1,52 @@
+#ifndef HOST_WIRE_H
+#define HOST_WIRE_H
+
+#include "Arduino.h"
+
+#define I2C_BUFFER_LENGTH 128
+
+// Хост-вариант TwoWire: транзакции уходят эмулируемым ведомым из host_sim
+class TwoWire : public Stream {
+public:
+    TwoWire();
+
+    bool begin();
+    bool begin(int sda, int scl, uint32_t frequency = 0);
+    bool end();
+    bool setClock(uint32_t frequency);
+    uint32_t getClock() const { return clockHz; }
+    void setTimeOut(uint16_t timeOutMillis) { timeOutMs = timeOutMillis; }
+    uint16_t getTimeOut() const { return timeOutMs; }
+
+    void beginTransmission(uint8_t address);
+    void beginTransmission(int address) { beginTransmission((uint8_t)address); }
+    uint8_t endTransmission(bool sendStop = true);
+
+    size_t requestFrom(uint8_t address, size_t size, bool sendStop);
+    uint8_t requestFrom(uint8_t address, uint8_t size, uint8_t sendStop);
+    uint8_t requestFrom(int address, int size);
+
+    size_t write(uint8_t data) override;
+    size_t write(const uint8_t* data, size_t quantity) override;
+    using Print::write;
+    int available() override;
+    int read() override;
+    int peek() override;
+
+    bool isBegun() const { return begun; }
+
+private:
+    uint8_t txAddress;
+    uint8_t txBuffer[I2C_BUFFER_LENGTH];
+    size_t txLength;
+    uint8_t rxBuffer[I2C_BUFFER_LENGTH];
+    size_t rxLength;
+    size_t rxIndex;
+    uint32_t clockHz;
+    uint16_t timeOutMs;
+    bool begun;
+};
+
+extern TwoWire Wire;
+
+#endif // HOST_WIRE_H
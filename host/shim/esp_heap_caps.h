@@ -0,0 +1,28 @@
+#ifndef HOST_ESP_HEAP_CAPS_H
+#define HOST_ESP_HEAP_CAPS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// =============================================
+// ХОСТ-ШИМ КУЧИ ESP-IDF (env:native)
+// Куча - модель: объем как у свободной DRAM ESP32 после загрузки, занято -
+// живые блоки operator new хоста (host/shim/host_heap.cpp). Фрагментации
+// модель не знает: наибольший свободный блок равен всей свободной памяти
+// =============================================
+
+#define MALLOC_CAP_8BIT (1 << 2)
+
+typedef struct multi_heap_info_t {
+    size_t total_free_bytes;
+    size_t total_allocated_bytes;
+    size_t largest_free_block;
+    size_t minimum_free_bytes;
+    size_t allocated_blocks;
+    size_t free_blocks;
+    size_t total_blocks;
+} multi_heap_info_t;
+
+void heap_caps_get_info(multi_heap_info_t* info, uint32_t caps);
+
+#endif // HOST_ESP_HEAP_CAPS_H
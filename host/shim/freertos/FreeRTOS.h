@@ -0,0 +1,26 @@
+#ifndef HOST_FREERTOS_H
+#define HOST_FREERTOS_H
+
+#include <stdint.h>
+
+// =============================================
+// ХОСТ-ШИМ FREERTOS (env:native)
+// Только то, что использует прошивка: двоичный семафор, который отдает ISR,
+// и запас стека задачи. Тик 1 мс, как CONFIG_FREERTOS_HZ=1000 у arduino-esp32
+// =============================================
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE 0
+#define pdTRUE  1
+
+#define portMAX_DELAY       ((TickType_t)0xFFFFFFFFUL)
+#define portTICK_PERIOD_MS  1
+#define pdMS_TO_TICKS(ms)   ((TickType_t)(ms))
+
+// Переключение контекста не нужно: ожидающий один и ждет на виртуальных часах
+#define portYIELD_FROM_ISR(...)
+
+#endif // HOST_FREERTOS_H
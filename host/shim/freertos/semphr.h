@@ -0,0 +1,21 @@
+#ifndef HOST_SEMPHR_H
+#define HOST_SEMPHR_H
+
+#include "freertos/FreeRTOS.h"
+
+// Двоичный семафор. xSemaphoreTake() двигает виртуальные часы до ближайшего
+// события эмулируемых устройств (их ISR отдают семафор) или до таймаута
+struct HostSemaphore {
+    bool given;
+};
+typedef HostSemaphore* SemaphoreHandle_t;
+typedef HostSemaphore StaticSemaphore_t;   // Память семафора у вызывающего
+
+SemaphoreHandle_t xSemaphoreCreateBinary();
+SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t* buffer);
+void vSemaphoreDelete(SemaphoreHandle_t semaphore);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore);
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t semaphore, BaseType_t* higherPriorityTaskWoken);
+
+#endif // HOST_SEMPHR_H
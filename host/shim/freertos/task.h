@@ -0,0 +1,15 @@
+#ifndef HOST_TASK_H
+#define HOST_TASK_H
+
+#include "freertos/FreeRTOS.h"
+
+// Задача loop(). Стек задачи - отдельный стек хоста, заполненный образцом
+// (hostsim::runOnTaskStack); запас, как у ESP-IDF, - в байтах (StackType_t =
+// uint8_t). Вне стека задачи запас не измерить - возвращается весь стек
+struct HostTask;
+typedef HostTask* TaskHandle_t;
+
+TaskHandle_t xTaskGetCurrentTaskHandle();
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);
+
+#endif // HOST_TASK_H
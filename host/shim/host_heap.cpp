@@ -0,0 +1,107 @@
+#include "host_sim.h"
+#include "esp_heap_caps.h"
+#include <new>
+#include <stdlib.h>
+
+// =============================================
+// МОДЕЛЬ КУЧИ ХОСТА
+// operator new/delete процесса ведут учет живых блоков: перед блоком -
+// заголовок с размером и признаком учета (выравнивание max_align_t сохраняется)
+// =============================================
+
+namespace {
+
+struct BlockHeader {
+    size_t size;
+    size_t counted;             // 0 - блок модели флеша (FlashHeapScope)
+};
+
+const size_t HEADER_BYTES = (sizeof(BlockHeader) + alignof(max_align_t) - 1) / alignof(max_align_t) *
+                            alignof(max_align_t);
+
+uint64_t allocations = 0;
+size_t liveBlocks = 0;
+size_t liveBytes = 0;
+size_t peakBytes = 0;
+int flashScopeDepth = 0;
+
+void* allocate(size_t size) {
+    uint8_t* raw = (uint8_t*)malloc(HEADER_BYTES + (size ? size : 1));
+    if (raw == nullptr) {
+        return nullptr;
+    }
+    BlockHeader* header = (BlockHeader*)raw;
+    header->size = size;
+    header->counted = flashScopeDepth == 0;
+    if (header->counted) {
+        allocations++;
+        liveBlocks++;
+        liveBytes += size;
+        if (liveBytes > peakBytes) peakBytes = liveBytes;
+    }
+    return raw + HEADER_BYTES;
+}
+
+void release(void* block) {
+    if (block == nullptr) return;
+    uint8_t* raw = (uint8_t*)block - HEADER_BYTES;
+    BlockHeader* header = (BlockHeader*)raw;
+    if (header->counted) {
+        liveBlocks--;
+        liveBytes -= header->size;
+    }
+    free(raw);
+}
+
+} // namespace
+
+void* operator new(size_t size) {
+    void* block = allocate(size);
+    if (block == nullptr) throw std::bad_alloc();
+    return block;
+}
+
+void* operator new[](size_t size) {
+    void* block = allocate(size);
+    if (block == nullptr) throw std::bad_alloc();
+    return block;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return allocate(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return allocate(size); }
+
+void operator delete(void* block) noexcept { release(block); }
+void operator delete[](void* block) noexcept { release(block); }
+void operator delete(void* block, size_t) noexcept { release(block); }
+void operator delete[](void* block, size_t) noexcept { release(block); }
+void operator delete(void* block, const std::nothrow_t&) noexcept { release(block); }
+void operator delete[](void* block, const std::nothrow_t&) noexcept { release(block); }
+
+namespace hostsim {
+
+HeapStats getHeapStats() {
+    HeapStats stats;
+    stats.allocations = allocations;
+    stats.liveBlocks = liveBlocks;
+    stats.liveBytes = liveBytes;
+    stats.peakBytes = peakBytes;
+    return stats;
+}
+
+FlashHeapScope::FlashHeapScope() { flashScopeDepth++; }
+FlashHeapScope::~FlashHeapScope() { flashScopeDepth--; }
+
+} // namespace hostsim
+
+void heap_caps_get_info(multi_heap_info_t* info, uint32_t caps) {
+    (void)caps;
+    size_t used = liveBytes < hostsim::HEAP_BYTES ? liveBytes : hostsim::HEAP_BYTES;
+    size_t peak = peakBytes < hostsim::HEAP_BYTES ? peakBytes : hostsim::HEAP_BYTES;
+    info->total_free_bytes = hostsim::HEAP_BYTES - used;
+    info->total_allocated_bytes = liveBytes;
+    info->largest_free_block = info->total_free_bytes;
+    info->minimum_free_bytes = hostsim::HEAP_BYTES - peak;
+    info->allocated_blocks = liveBlocks;
+    info->free_blocks = 1;
+    info->total_blocks = liveBlocks + 1;
+}
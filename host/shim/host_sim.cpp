@@ -0,0 +1,604 @@
+#include "Arduino.h"
+#include "Wire.h"
+#include "SPI.h"
+#include "host_sim.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "config.h"
+#include <ucontext.h>
+
+// =============================================
+// РЕАЛИЗАЦИЯ ХОСТ-ШИМА
+// =============================================
+
+HardwareSerial Serial;
+TwoWire Wire;
+SPIClass SPI;
+
+namespace hostsim {
+
+namespace {
+
+uint64_t simMicros = 0;
+uint64_t powerOnMicros = 0;
+
+struct PinState {
+    uint8_t mode;
+    uint8_t level;
+    int driven;           // -1 = уровень задает прошивка
+    void (*isr)(void);
+    int isrMode;
+};
+
+PinState pins[MAX_PINS];
+bool pinsInitialized = false;
+
+const int MAX_LISTENERS = 8;
+PinListener* listeners[MAX_LISTENERS];
+int listenerCount = 0;
+
+const int MAX_DEVICES = 4;
+TimedDevice* devices[MAX_DEVICES];
+int deviceCount = 0;
+
+const int MAX_SLAVES = 4;
+struct SlaveEntry {
+    uint8_t address;
+    I2CSlave* slave;
+};
+SlaveEntry slaves[MAX_SLAVES];
+int slaveCount = 0;
+
+uint8_t stuckClocksLeft = 0;
+uint32_t busFrequency = 100000;
+
+const size_t SERIAL_INPUT_SIZE = 512;
+char serialInput[SERIAL_INPUT_SIZE];
+size_t serialHead = 0;
+size_t serialTail = 0;
+bool serialEcho = false;
+
+void ensurePins() {
+    if (pinsInitialized) return;
+    for (int i = 0; i < MAX_PINS; i++) {
+        pins[i].mode = INPUT;
+        pins[i].level = HIGH;   // подтяжки I2C / неподключенные входы
+        pins[i].driven = -1;
+        pins[i].isr = nullptr;
+        pins[i].isrMode = 0;
+    }
+    pinsInitialized = true;
+}
+
+void fireIsr(PinState& p, uint8_t oldLevel, uint8_t newLevel) {
+    if (p.isr == nullptr || oldLevel == newLevel) return;
+    bool rising = newLevel == HIGH;
+    if (p.isrMode == CHANGE || (p.isrMode == RISING && rising) || (p.isrMode == FALLING && !rising)) {
+        p.isr();
+    }
+}
+
+} // namespace
+
+uint64_t nowMicros() { return simMicros; }
+
+void advanceMicros(uint64_t us) {
+    uint64_t target = simMicros + us;
+    // События устройств по порядку; устройство, не сдвинувшее свое событие
+    // после onTime(), до конца шага не вызывается
+    bool stalled[MAX_DEVICES] = {false};
+    for (;;) {
+        int due = -1;
+        uint64_t at = target;
+        for (int i = 0; i < deviceCount; i++) {
+            if (stalled[i]) continue;
+            uint64_t t = devices[i]->nextEventMicros();
+            if (t <= at) {
+                at = t;
+                due = i;
+            }
+        }
+        if (due < 0) break;
+        if (at > simMicros) simMicros = at;
+        devices[due]->onTime(simMicros);
+        if (devices[due]->nextEventMicros() <= simMicros) {
+            stalled[due] = true;
+        }
+    }
+    simMicros = target;
+}
+
+void resetClock() { simMicros = 0; powerOnMicros = 0; }
+void powerOn() {
+    powerOnMicros = simMicros;
+    // Сброс ESP32 возвращает GPIO в состояние по умолчанию
+    pinsInitialized = false;
+    ensurePins();
+}
+uint64_t getPowerOnMicros() { return powerOnMicros; }
+
+void addPinListener(PinListener* listener) {
+    if (listenerCount < MAX_LISTENERS) {
+        listeners[listenerCount++] = listener;
+    }
+}
+
+void removePinListener(PinListener* listener) {
+    for (int i = 0; i < listenerCount; i++) {
+        if (listeners[i] == listener) {
+            listeners[i] = listeners[--listenerCount];
+            return;
+        }
+    }
+}
+
+void addTimedDevice(TimedDevice* device) {
+    if (deviceCount < MAX_DEVICES) {
+        devices[deviceCount++] = device;
+    }
+}
+
+void removeTimedDevice(TimedDevice* device) {
+    for (int i = 0; i < deviceCount; i++) {
+        if (devices[i] == device) {
+            devices[i] = devices[--deviceCount];
+            return;
+        }
+    }
+}
+
+uint64_t nextDeviceEventMicros() {
+    uint64_t next = UINT64_MAX;
+    for (int i = 0; i < deviceCount; i++) {
+        uint64_t t = devices[i]->nextEventMicros();
+        if (t > simMicros && t < next) next = t;
+    }
+    return next;
+}
+
+uint8_t getPinLevel(uint8_t pin) {
+    ensurePins();
+    if (pin >= MAX_PINS) return LOW;
+    if (pins[pin].driven >= 0) return (uint8_t)pins[pin].driven;
+    return pins[pin].level;
+}
+
+uint8_t getPinMode(uint8_t pin) {
+    ensurePins();
+    return pin < MAX_PINS ? pins[pin].mode : 0;
+}
+
+void driveInputPin(uint8_t pin, int level) {
+    ensurePins();
+    if (pin >= MAX_PINS) return;
+    uint8_t oldLevel = getPinLevel(pin);
+    pins[pin].driven = level;
+    fireIsr(pins[pin], oldLevel, getPinLevel(pin));
+}
+
+void attachI2CSlave(uint8_t address, I2CSlave* slave) {
+    detachI2CSlave(address);
+    if (slaveCount < MAX_SLAVES) {
+        slaves[slaveCount].address = address;
+        slaves[slaveCount].slave = slave;
+        slaveCount++;
+    }
+}
+
+void detachI2CSlave(uint8_t address) {
+    for (int i = 0; i < slaveCount; i++) {
+        if (slaves[i].address == address) {
+            slaves[i] = slaves[--slaveCount];
+            return;
+        }
+    }
+}
+
+I2CSlave* findI2CSlave(uint8_t address) {
+    for (int i = 0; i < slaveCount; i++) {
+        if (slaves[i].address == address) return slaves[i].slave;
+    }
+    return nullptr;
+}
+
+void holdSdaLow(uint8_t releaseAfterClocks) {
+    stuckClocksLeft = releaseAfterClocks > 0 ? releaseAfterClocks : 1;
+}
+
+bool isSdaStuck() { return stuckClocksLeft > 0; }
+
+void setBusFrequency(uint32_t hz) { busFrequency = hz > 0 ? hz : 100000; }
+
+uint32_t byteTimeMicros() { return (9UL * 1000000UL + busFrequency - 1) / busFrequency; }
+
+void feedSerialInput(const char* text) {
+    while (*text) {
+        size_t next = (serialHead + 1) % SERIAL_INPUT_SIZE;
+        if (next == serialTail) return;
+        serialInput[serialHead] = *text++;
+        serialHead = next;
+    }
+}
+
+void setSerialEcho(bool enabled) { serialEcho = enabled; }
+
+// Вызывается из pinMode/digitalWrite: импульсы SCL освобождают зависший SDA
+void onFirmwarePinWrite(uint8_t pin, uint8_t oldLevel, uint8_t newLevel) {
+    if (pin == PN532_SCL_PIN && oldLevel == LOW && newLevel == HIGH && stuckClocksLeft > 0) {
+        stuckClocksLeft--;
+    }
+    for (int i = 0; i < listenerCount; i++) {
+        listeners[i]->onPinWrite(pin, newLevel);
+    }
+    (void)oldLevel;
+}
+
+int readSerialByte(bool consume) {
+    if (serialHead == serialTail) return -1;
+    int c = (uint8_t)serialInput[serialTail];
+    if (consume) serialTail = (serialTail + 1) % SERIAL_INPUT_SIZE;
+    return c;
+}
+
+int serialAvailable() {
+    return (int)((serialHead + SERIAL_INPUT_SIZE - serialTail) % SERIAL_INPUT_SIZE);
+}
+
+bool serialEchoEnabled() { return serialEcho; }
+
+} // namespace hostsim
+
+// =============================================
+// ARDUINO API
+// =============================================
+
+// millis()/micros() считают от последнего "включения" (hostsim::powerOn)
+unsigned long millis() { return (unsigned long)((hostsim::nowMicros() - hostsim::getPowerOnMicros()) / 1000ULL); }
+unsigned long micros() { return (unsigned long)(hostsim::nowMicros() - hostsim::getPowerOnMicros()); }
+void delay(unsigned long ms) { hostsim::advanceMicros((uint64_t)ms * 1000ULL); }
+void delayMicroseconds(unsigned int us) { hostsim::advanceMicros(us); }
+void yield() {}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+    hostsim::ensurePins();
+    if (pin >= hostsim::MAX_PINS) return;
+    uint8_t oldLevel = hostsim::getPinLevel(pin);
+    uint8_t oldMode = hostsim::pins[pin].mode;
+    hostsim::pins[pin].mode = mode;
+    // Вход/открытый сток без драйва - линия подтянута вверх
+    if (mode == INPUT || mode == INPUT_PULLUP) {
+        hostsim::pins[pin].level = HIGH;
+        hostsim::onFirmwarePinWrite(pin, oldLevel, hostsim::getPinLevel(pin));
+    } else if (mode == OUTPUT && oldMode != OUTPUT) {
+        // Регистр выхода GPIO ESP32 после сброса = 0: пин, переведенный
+        // в OUTPUT без digitalWrite, держит LOW
+        hostsim::pins[pin].level = LOW;
+        hostsim::onFirmwarePinWrite(pin, oldLevel, hostsim::getPinLevel(pin));
+    }
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+    hostsim::ensurePins();
+    if (pin >= hostsim::MAX_PINS) return;
+    uint8_t oldLevel = hostsim::getPinLevel(pin);
+    hostsim::pins[pin].level = val ? HIGH : LOW;
+    hostsim::onFirmwarePinWrite(pin, oldLevel, hostsim::getPinLevel(pin));
+}
+
+int digitalRead(uint8_t pin) {
+    // Зависший ведомый держит SDA
+    if (pin == PN532_SDA_PIN && hostsim::isSdaStuck()) return LOW;
+    return hostsim::getPinLevel(pin);
+}
+
+void attachInterrupt(uint8_t pin, void (*isr)(void), int mode) {
+    hostsim::ensurePins();
+    if (pin >= hostsim::MAX_PINS) return;
+    hostsim::pins[pin].isr = isr;
+    hostsim::pins[pin].isrMode = mode;
+}
+
+void detachInterrupt(uint8_t pin) {
+    hostsim::ensurePins();
+    if (pin >= hostsim::MAX_PINS) return;
+    hostsim::pins[pin].isr = nullptr;
+}
+
+// =============================================
+// FREERTOS: ДВОИЧНЫЙ СЕМАФОР
+// =============================================
+
+SemaphoreHandle_t xSemaphoreCreateBinary() {
+    HostSemaphore* semaphore = new HostSemaphore;
+    semaphore->given = false;
+    return semaphore;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t* buffer) {
+    buffer->given = false;
+    return buffer;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t semaphore) { delete semaphore; }
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks) {
+    uint64_t deadline = (ticks == portMAX_DELAY) ? UINT64_MAX
+                                                 : hostsim::nowMicros() + (uint64_t)ticks * 1000ULL;
+    // Сначала события, наступившие к текущему моменту
+    hostsim::advanceMicros(0);
+    while (!semaphore->given) {
+        uint64_t now = hostsim::nowMicros();
+        if (now >= deadline) {
+            return pdFALSE;
+        }
+        uint64_t next = hostsim::nextDeviceEventMicros();
+        if (next == UINT64_MAX && deadline == UINT64_MAX) {
+            // На железе задача зависла бы навсегда
+            fprintf(stderr, "hostsim: xSemaphoreTake(portMAX_DELAY) без событий устройств\n");
+            abort();
+        }
+        hostsim::advanceMicros((next < deadline ? next : deadline) - now);
+    }
+    semaphore->given = false;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+    if (semaphore->given) return pdFALSE;
+    semaphore->given = true;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t semaphore, BaseType_t* higherPriorityTaskWoken) {
+    if (higherPriorityTaskWoken != nullptr) *higherPriorityTaskWoken = pdFALSE;
+    return xSemaphoreGive(semaphore);
+}
+
+// =============================================
+// FREERTOS: СТЕК ЗАДАЧИ LOOP()
+// =============================================
+
+namespace {
+
+const uint8_t TASK_STACK_PAINT = 0xA5;      // Образец заполнения, как у FreeRTOS
+
+alignas(16) uint8_t taskStack[hostsim::TASK_STACK_BYTES];
+bool taskStackPainted = false;
+bool onTaskStack = false;
+ucontext_t taskContext;
+ucontext_t callerContext;
+void (*taskBody)(void*) = nullptr;
+void* taskArgument = nullptr;
+
+// Дескрипторы: задача loop() и "вызывающий" (бенчмарк на стеке процесса)
+uint8_t loopTaskToken;
+uint8_t callerTaskToken;
+
+void taskEntry() {
+    taskBody(taskArgument);
+}
+
+} // namespace
+
+namespace hostsim {
+
+void paintTaskStack() {
+    if (onTaskStack) return;    // Свой стек не перекрашивается
+    memset(taskStack, TASK_STACK_PAINT, sizeof(taskStack));
+    taskStackPainted = true;
+}
+
+void runOnTaskStack(void (*body)(void*), void* context) {
+    if (onTaskStack) {
+        body(context);
+        return;
+    }
+    if (!taskStackPainted) paintTaskStack();
+    taskBody = body;
+    taskArgument = context;
+    getcontext(&taskContext);
+    taskContext.uc_stack.ss_sp = taskStack;
+    taskContext.uc_stack.ss_size = sizeof(taskStack);
+    taskContext.uc_link = &callerContext;
+    makecontext(&taskContext, taskEntry, 0);
+    onTaskStack = true;
+    swapcontext(&callerContext, &taskContext);
+    onTaskStack = false;
+}
+
+bool isOnTaskStack() { return onTaskStack; }
+
+} // namespace hostsim
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+    return (TaskHandle_t)(onTaskStack ? &loopTaskToken : &callerTaskToken);
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+    bool loopTask = task == (TaskHandle_t)&loopTaskToken || (task == nullptr && onTaskStack);
+    if (!loopTask || !taskStackPainted) {
+        return (UBaseType_t)hostsim::TASK_STACK_BYTES;
+    }
+    // Стек растет вниз: нетронутый образец - от начала буфера
+    size_t untouched = 0;
+    while (untouched < sizeof(taskStack) && taskStack[untouched] == TASK_STACK_PAINT) {
+        untouched++;
+    }
+    return (UBaseType_t)untouched;
+}
+
+// =============================================
+// PRINT / SERIAL
+// =============================================
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+    size_t n = 0;
+    while (size--) n += write(*buffer++);
+    return n;
+}
+
+size_t Print::print(long v, int base) {
+    if (base == DEC) return printf("%ld", v);
+    return print((unsigned long)v, base);
+}
+
+size_t Print::print(unsigned long v, int base) {
+    if (base == HEX) return printf("%lX", v);
+    if (base == OCT) return printf("%lo", v);
+    if (base == BIN) {
+        char buf[8 * sizeof(long) + 1];
+        char* p = &buf[sizeof(buf) - 1];
+        *p = '\0';
+        do {
+            *--p = (v & 1) ? '1' : '0';
+            v >>= 1;
+        } while (v);
+        return write(p);
+    }
+    return printf("%lu", v);
+}
+
+size_t Print::print(double v, int digits) { return printf("%.*f", digits, v); }
+
+size_t Print::printf(const char* format, ...) {
+    char buf[512];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+    if (len < 0) return 0;
+    if ((size_t)len >= sizeof(buf)) len = sizeof(buf) - 1;
+    return write((const uint8_t*)buf, (size_t)len);
+}
+
+size_t Stream::readBytes(uint8_t* buffer, size_t length) {
+    size_t n = 0;
+    while (n < length) {
+        int c = read();
+        if (c < 0) break;
+        buffer[n++] = (uint8_t)c;
+    }
+    return n;
+}
+
+namespace hostsim {
+int readSerialByte(bool consume);
+int serialAvailable();
+bool serialEchoEnabled();
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+    if (hostsim::serialEchoEnabled()) fputc(c, stdout);
+    return 1;
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size) {
+    if (hostsim::serialEchoEnabled()) fwrite(buffer, 1, size, stdout);
+    return size;
+}
+
+int HardwareSerial::available() { return hostsim::serialAvailable(); }
+int HardwareSerial::read() { return hostsim::readSerialByte(true); }
+int HardwareSerial::peek() { return hostsim::readSerialByte(false); }
+
+// =============================================
+// TWOWIRE
+// =============================================
+
+TwoWire::TwoWire()
+    : txAddress(0), txLength(0), rxLength(0), rxIndex(0),
+      clockHz(100000), timeOutMs(50), begun(false) {}
+
+bool TwoWire::begin() {
+    begun = true;
+    return true;
+}
+
+bool TwoWire::begin(int sda, int scl, uint32_t frequency) {
+    (void)sda;
+    (void)scl;
+    if (frequency > 0) setClock(frequency);
+    begun = true;
+    return true;
+}
+
+bool TwoWire::end() {
+    begun = false;
+    return true;
+}
+
+bool TwoWire::setClock(uint32_t frequency) {
+    clockHz = frequency;
+    hostsim::setBusFrequency(frequency);
+    return true;
+}
+
+void TwoWire::beginTransmission(uint8_t address) {
+    txAddress = address;
+    txLength = 0;
+}
+
+uint8_t TwoWire::endTransmission(bool sendStop) {
+    (void)sendStop;
+    hostsim::advanceMicros((uint64_t)(txLength + 1) * hostsim::byteTimeMicros());
+    if (!begun) return 4;
+    // Зависшая шина: драйвер ESP32 ждет timeOutMs и возвращает ошибку
+    if (hostsim::isSdaStuck()) {
+        hostsim::advanceMicros((uint64_t)timeOutMs * 1000ULL);
+        return 5;
+    }
+    hostsim::I2CSlave* slave = hostsim::findI2CSlave(txAddress);
+    if (slave == nullptr || !slave->onWrite(txBuffer, txLength)) {
+        return 2;   // NACK по адресу
+    }
+    return 0;
+}
+
+size_t TwoWire::requestFrom(uint8_t address, size_t size, bool sendStop) {
+    (void)sendStop;
+    rxLength = 0;
+    rxIndex = 0;
+    if (size > I2C_BUFFER_LENGTH) size = I2C_BUFFER_LENGTH;
+    hostsim::advanceMicros((uint64_t)(size + 1) * hostsim::byteTimeMicros());
+    if (!begun) return 0;
+    if (hostsim::isSdaStuck()) {
+        hostsim::advanceMicros((uint64_t)timeOutMs * 1000ULL);
+        return 0;
+    }
+    hostsim::I2CSlave* slave = hostsim::findI2CSlave(address);
+    if (slave == nullptr) return 0;
+    rxLength = slave->onRead(rxBuffer, size);
+    return rxLength;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t size, uint8_t sendStop) {
+    return (uint8_t)requestFrom(address, (size_t)size, (bool)sendStop);
+}
+
+uint8_t TwoWire::requestFrom(int address, int size) {
+    return (uint8_t)requestFrom((uint8_t)address, (size_t)size, true);
+}
+
+size_t TwoWire::write(uint8_t data) {
+    if (txLength >= I2C_BUFFER_LENGTH) return 0;
+    txBuffer[txLength++] = data;
+    return 1;
+}
+
+size_t TwoWire::write(const uint8_t* data, size_t quantity) {
+    size_t n = 0;
+    while (n < quantity && write(data[n])) n++;
+    return n;
+}
+
+int TwoWire::available() { return (int)(rxLength - rxIndex); }
+
+int TwoWire::read() {
+    if (rxIndex >= rxLength) return -1;
+    return rxBuffer[rxIndex++];
+}
+
+int TwoWire::peek() {
+    if (rxIndex >= rxLength) return -1;
+    return rxBuffer[rxIndex];
+}
@@ -0,0 +1,124 @@
+#ifndef HOST_SIM_H
+#define HOST_SIM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// =============================================
+// СИМУЛЯЦИЯ ОКРУЖЕНИЯ ДЛЯ ХОСТ-СБОРКИ
+// Виртуальные часы, GPIO и I2C шина, к которой подключаются эмуляторы
+// =============================================
+
+namespace hostsim {
+
+// ---------- Виртуальные часы ----------
+uint64_t nowMicros();
+void advanceMicros(uint64_t us);
+void resetClock();
+
+// "Включение питания": millis()/micros() прошивки снова считают от нуля,
+// nowMicros() остается монотонным для эмуляторов
+void powerOn();
+uint64_t getPowerOnMicros();
+
+// ---------- GPIO ----------
+const int MAX_PINS = 40;
+
+// Наблюдатель за уровнями пинов (мультиплексоры, RESET PN532, SCL)
+class PinListener {
+public:
+    virtual ~PinListener() {}
+    virtual void onPinWrite(uint8_t pin, uint8_t level) = 0;
+};
+
+void addPinListener(PinListener* listener);
+void removePinListener(PinListener* listener);
+uint8_t getPinLevel(uint8_t pin);
+uint8_t getPinMode(uint8_t pin);
+
+// Внешний источник уровня (IRQ PN532, удержание SDA): -1 = пин не управляется
+void driveInputPin(uint8_t pin, int level);
+
+// ---------- События устройств ----------
+// Устройство с собственным временем (готовность ответа PN532 -> линия IRQ).
+// Часы останавливаются на каждом событии, поэтому ISR срабатывает вовремя,
+// даже если прошивка в этот момент ничего не читает с шины
+class TimedDevice {
+public:
+    virtual ~TimedDevice() {}
+    // Момент следующего события (UINT64_MAX - событий нет)
+    virtual uint64_t nextEventMicros() = 0;
+    virtual void onTime(uint64_t now) = 0;
+};
+
+void addTimedDevice(TimedDevice* device);
+void removeTimedDevice(TimedDevice* device);
+// Ближайшее событие строго позже текущего момента
+uint64_t nextDeviceEventMicros();
+
+// ---------- I2C ----------
+class I2CSlave {
+public:
+    virtual ~I2CSlave() {}
+    // false = NACK по адресу
+    virtual bool onWrite(const uint8_t* data, size_t len) = 0;
+    // Возвращает число байт, выданных ведомым (0 = NACK)
+    virtual size_t onRead(uint8_t* data, size_t len) = 0;
+};
+
+void attachI2CSlave(uint8_t address, I2CSlave* slave);
+void detachI2CSlave(uint8_t address);
+I2CSlave* findI2CSlave(uint8_t address);
+
+// Зависание шины: ведомый держит SDA в LOW до releaseAfterClocks импульсов SCL
+void holdSdaLow(uint8_t releaseAfterClocks);
+bool isSdaStuck();
+
+// Время передачи байта на текущей частоте шины (9 бит с ACK)
+void setBusFrequency(uint32_t hz);
+uint32_t byteTimeMicros();
+
+// ---------- Flash (NVS и SPIFFS) ----------
+void eraseFlash();
+void eraseFilesystem();
+uint32_t getFlashWrites();
+uint32_t getFlashBytesWritten();
+
+// ---------- Serial ----------
+void feedSerialInput(const char* text);
+void setSerialEcho(bool enabled);
+
+// ---------- Куча (operator new хоста) ----------
+// Блоки, выделенные внутри FlashHeapScope, не считаются: модели NVS и SPIFFS
+// на std::map (на ESP32 это память драйвера флеша) и учет стенда, который
+// работает посреди loop() (разбор кадров Serial и т.п.) - это не куча прошивки
+const size_t HEAP_BYTES = 300 * 1024;   // Свободная DRAM ESP32 после загрузки
+
+struct HeapStats {
+    uint64_t allocations;       // Выделений с начала процесса
+    size_t liveBlocks;
+    size_t liveBytes;
+    size_t peakBytes;
+};
+
+HeapStats getHeapStats();
+
+class FlashHeapScope {
+public:
+    FlashHeapScope();
+    ~FlashHeapScope();
+};
+
+// ---------- Стек задачи loop() ----------
+// body исполняется на отдельном стеке TASK_STACK_BYTES, как задача FreeRTOS;
+// paintTaskStack() заполняет его образцом (сброс запаса), после этого
+// uxTaskGetStackHighWaterMark() считает нетронутые байты
+const size_t TASK_STACK_BYTES = 16384;
+
+void paintTaskStack();
+void runOnTaskStack(void (*body)(void*), void* context);
+bool isOnTaskStack();
+
+} // namespace hostsim
+
+#endif // HOST_SIM_H
@@ -0,0 +1,129 @@
+#ifndef BOARD_GEOMETRY_H
+#define BOARD_GEOMETRY_H
+
+#include <stdint.h>
+
+// =============================================
+// ГЕОМЕТРИЯ ДОСКИ: ОСИ И ДЕРЕВЬЯ МУЛЬТИПЛЕКСОРОВ
+// Ось (строки или столбцы) - дерево HP4067 до MUX_MAX_STAGES ступеней.
+// Ступень 0 - мультиплексоры у антенн, последняя - ближайшая к PN532.
+// Ступень выбирает "цифру" адреса линии: двоичным кодом на общих S0..S3
+// (мультиплексоры ступени на одной шине S, выходы - на входы следующей
+// ступени) или одной из линий INH (активный LOW; мультиплексоры с общим
+// выходом). Линия = цифра ступени 0 + каналы ступени 0 * (цифра ступени 1 + ...).
+// Описания - constexpr (config.h), уровни пинов по линиям считает компилятор
+// (src/multiplexer.h)
+// =============================================
+
+#define MUX_MAX_STAGES          3       // 16^3 линий на ось - с запасом
+#define MUX_SELECT_PINS         4       // S0..S3 HP4067
+#define MUX_MAX_INHIBIT_PINS    4       // Линий INH на ступень
+
+struct MuxStage {
+    uint8_t bits;                               // Разрядов S (0 - ступень на линиях INH)
+    int8_t selectPins[MUX_SELECT_PINS];         // -1 - вывод на GND
+    uint8_t inhibitCount;
+    int8_t inhibitPins[MUX_MAX_INHIBIT_PINS];
+};
+
+struct MuxAxis {
+    uint8_t lines;                              // Линий (антенн) на оси
+    uint8_t stageCount;
+    MuxStage stages[MUX_MAX_STAGES];
+};
+
+struct BoardGeometry {
+    const char* name;
+    MuxAxis rowAxis;
+    MuxAxis colAxis;
+    int8_t enablePin;                           // Общий EN всех мультиплексоров (активный LOW)
+};
+
+// Ступень на двоичном коде: bits разрядов на S0..S3 (лишние S - на GND)
+constexpr MuxStage muxSelect(uint8_t bits, int8_t s0, int8_t s1 = -1, int8_t s2 = -1, int8_t s3 = -1) {
+    return MuxStage{bits, {s0, s1, s2, s3}, 0, {-1, -1, -1, -1}};
+}
+
+// Ступень на линиях INH: count мультиплексоров с общим выходом
+constexpr MuxStage muxInhibit(uint8_t count, int8_t inh0, int8_t inh1, int8_t inh2 = -1, int8_t inh3 = -1) {
+    return MuxStage{0, {-1, -1, -1, -1}, count, {inh0, inh1, inh2, inh3}};
+}
+
+constexpr MuxAxis muxAxis(uint8_t lines, MuxStage stage0) {
+    return MuxAxis{lines, 1, {stage0, MuxStage{}, MuxStage{}}};
+}
+
+constexpr MuxAxis muxAxis(uint8_t lines, MuxStage stage0, MuxStage stage1) {
+    return MuxAxis{lines, 2, {stage0, stage1, MuxStage{}}};
+}
+
+constexpr MuxAxis muxAxis(uint8_t lines, MuxStage stage0, MuxStage stage1, MuxStage stage2) {
+    return MuxAxis{lines, 3, {stage0, stage1, stage2}};
+}
+
+// Каналов ступени и линий, которые ось может адресовать
+constexpr uint16_t muxStageChannels(const MuxStage& stage) {
+    return stage.bits > 0 ? (uint16_t)(1u << stage.bits) : stage.inhibitCount;
+}
+
+constexpr uint32_t muxAxisCapacity(const MuxAxis& axis) {
+    uint32_t capacity = 1;
+    for (int s = 0; s < axis.stageCount; s++) {
+        capacity *= muxStageChannels(axis.stages[s]);
+    }
+    return capacity;
+}
+
+// Описание без противоречий: разряды 1..4, линии INH заданы, линий не больше емкости
+constexpr bool muxAxisValid(const MuxAxis& axis) {
+    if (axis.lines == 0 || axis.stageCount == 0 || axis.stageCount > MUX_MAX_STAGES) {
+        return false;
+    }
+    for (int s = 0; s < axis.stageCount; s++) {
+        const MuxStage& stage = axis.stages[s];
+        if (stage.bits > MUX_SELECT_PINS) return false;
+        if (stage.bits == 0) {
+            if (stage.inhibitCount < 2 || stage.inhibitCount > MUX_MAX_INHIBIT_PINS) return false;
+            for (int i = 0; i < stage.inhibitCount; i++) {
+                if (stage.inhibitPins[i] < 0) return false;
+            }
+        } else {
+            for (int b = 0; b < stage.bits; b++) {
+                if (stage.selectPins[b] < 0) return false;
+            }
+        }
+    }
+    return axis.lines <= muxAxisCapacity(axis);
+}
+
+// Подключенные пины оси по ступеням: S0..S(bits-1), затем INH; возвращает их число
+constexpr int muxAxisPins(const MuxAxis& axis, int8_t* out) {
+    int count = 0;
+    for (int s = 0; s < axis.stageCount; s++) {
+        const MuxStage& stage = axis.stages[s];
+        for (int b = 0; b < stage.bits; b++) out[count++] = stage.selectPins[b];
+        for (int i = 0; i < stage.inhibitCount; i++) out[count++] = stage.inhibitPins[i];
+    }
+    return count;
+}
+
+#define MUX_AXIS_MAX_PINS       (MUX_MAX_STAGES * (MUX_SELECT_PINS + MUX_MAX_INHIBIT_PINS))
+
+// Геометрия целиком: обе оси корректны, у каждого пина (и EN) одна роль
+constexpr bool muxGeometryValid(const BoardGeometry& geometry) {
+    if (!muxAxisValid(geometry.rowAxis) || !muxAxisValid(geometry.colAxis) || geometry.enablePin < 0) {
+        return false;
+    }
+    int8_t pins[2 * MUX_AXIS_MAX_PINS + 1] = {};
+    int count = muxAxisPins(geometry.rowAxis, pins);
+    count += muxAxisPins(geometry.colAxis, pins + count);
+    pins[count++] = geometry.enablePin;
+    for (int i = 0; i < count; i++) {
+        for (int j = i + 1; j < count; j++) {
+            if (pins[i] == pins[j]) return false;
+        }
+    }
+    return true;
+}
+
+#endif // BOARD_GEOMETRY_H
@@ -10,8 +10,8 @@
 #define PN532_SCL_PIN           22
 // PN532_I2C_ADDRESS уже определен в библиотеке Adafruit как 0x24, используем тот
 // #define PN532_I2C_ADDRESS       0x24
-#define PN532_IRQ_DUMMY         -1   // Не используем IRQ пин в I2C режиме  
-#define PN532_RESET_DUMMY       -1   // Не используем RESET пин в I2C режиме
+#define PN532_IRQ_PIN           34   // P70_IRQ PN532 (только вход, внешняя подтяжка 10 кОм к 3.3V)
+#define PN532_RESET_PIN         27   // RSTPD_N PN532 - аппаратный сброс при восстановлении
 
 // HP4067 Мультиплексор #1 (строки 0-7, S3=GND)
 #define MUX1_S0_PIN             4
@@ -28,20 +28,240 @@
 // Общий EN пин для обоих мультиплексоров (экономия GPIO)
 #define MUX_COMMON_EN_PIN       26
 
+// Варианты 10×10 и 16×16: S3 мультиплексора строк на GPIO вместо GND
+#define MUX1_S3_PIN             13
+
+// Геометрия доски (include/board_geometry.h): оси - деревья HP4067. Уровни
+// пинов для каждой линии считаются при компиляции, переключение ячейки -
+// запись только изменившихся пинов из таблицы
+#include "board_geometry.h"
+
+struct Geometry8x12 {
+    static constexpr BoardGeometry layout = {
+        "8x12",
+        muxAxis(8, muxSelect(3, MUX1_S0_PIN, MUX1_S1_PIN, MUX1_S2_PIN)),    // S3 на GND
+        muxAxis(12, muxSelect(4, MUX2_S0_PIN, MUX2_S1_PIN, MUX2_S2_PIN, MUX2_S3_PIN)),
+        MUX_COMMON_EN_PIN
+    };
+};
+
+struct Geometry10x10 {
+    static constexpr BoardGeometry layout = {
+        "10x10",
+        muxAxis(10, muxSelect(4, MUX1_S0_PIN, MUX1_S1_PIN, MUX1_S2_PIN, MUX1_S3_PIN)),
+        muxAxis(10, muxSelect(4, MUX2_S0_PIN, MUX2_S1_PIN, MUX2_S2_PIN, MUX2_S3_PIN)),
+        MUX_COMMON_EN_PIN
+    };
+};
+
+// Доска анализа: полные HP4067 на обеих осях
+struct Geometry16x16 {
+    static constexpr BoardGeometry layout = {
+        "16x16",
+        muxAxis(16, muxSelect(4, MUX1_S0_PIN, MUX1_S1_PIN, MUX1_S2_PIN, MUX1_S3_PIN)),
+        muxAxis(16, muxSelect(4, MUX2_S0_PIN, MUX2_S1_PIN, MUX2_S2_PIN, MUX2_S3_PIN)),
+        MUX_COMMON_EN_PIN
+    };
+};
+
+// Каскад для осей длиннее 16 линий. Строки: два HP4067 на общих S0..S3,
+// выход - общий, выбор - их INH. Столбцы: два HP4067 на общих S0..S3,
+// выходы - на каналы 0/1 корневого HP4067 (S0 корня на GPIO, S1..S3 на GND)
+#define MUX_ROW_INH0_PIN        32
+#define MUX_ROW_INH1_PIN        33
+#define MUX_COL_ROOT_S0_PIN     14
+
+struct Geometry32x32 {
+    static constexpr BoardGeometry layout = {
+        "32x32",
+        muxAxis(32, muxSelect(4, MUX1_S0_PIN, MUX1_S1_PIN, MUX1_S2_PIN, MUX1_S3_PIN),
+                    muxInhibit(2, MUX_ROW_INH0_PIN, MUX_ROW_INH1_PIN)),
+        muxAxis(32, muxSelect(4, MUX2_S0_PIN, MUX2_S1_PIN, MUX2_S2_PIN, MUX2_S3_PIN),
+                    muxSelect(1, MUX_COL_ROOT_S0_PIN)),
+        MUX_COMMON_EN_PIN
+    };
+};
+
+// Активная геометрия: Geometry8x12 (шахматы), Geometry10x10, Geometry16x16
+// (доска анализа), Geometry32x32 (каскад; массивы по ячейкам - в 10 раз больше ОЗУ)
+#ifndef BOARD_GEOMETRY
+#define BOARD_GEOMETRY          Geometry8x12
+#endif
+typedef BOARD_GEOMETRY ActiveGeometry;
+
+static_assert(muxGeometryValid(ActiveGeometry::layout), "Геометрия доски: описание мультиплексоров или пины");
+
 // Размеры матрицы
-#define MATRIX_ROWS             8
-#define MATRIX_COLS             12
-#define MATRIX_TOTAL_CELLS      (MATRIX_ROWS * MATRIX_COLS)  // 96 ячеек
+#define MATRIX_ROWS             (ActiveGeometry::layout.rowAxis.lines)
+#define MATRIX_COLS             (ActiveGeometry::layout.colAxis.lines)
+#define MATRIX_TOTAL_CELLS      (MATRIX_ROWS * MATRIX_COLS)  // 96 ячеек на 8×12
 
 // СТАБИЛЬНЫЕ ТАЙМИНГИ - ЭТАП A (устранение мерцания)
 #define SCAN_DELAY_MS           20    // Задержка между сканированиями ячеек (УСКОРЕНО 2x: 40→20мс)
 #define PN532_TIMEOUT_MS        35    // Таймаут PN532 операций (консервативно для стабильности)
 #define MUX_SETTLE_TIME_US      50    // Время стабилизации мультиплексора (устранение crosstalk в столбце 2)
 #define DISPLAY_UPDATE_INTERVAL 2000  // Обновление дисплея каждые 2 сек
+#define CARD_DWELL_MS           1000  // Задержка на ячейке с картой для стабильного чтения
 
 // I2C настройки
 #define I2C_FREQUENCY           100000  // 100kHz для максимально стабильной работы
-#define I2C_TIMEOUT_MS          100
+#define I2C_TIMEOUT_MS          20      // Самый длинный кадр PN532 (~65 байт) идет ~6мс
+
+// Многоуровневое восстановление связи с PN532
+#define RECOVERY_TRANSACTION_RETRIES 1    // Уровень 1: повтор неудачной транзакции
+#define I2C_BUS_CLEAR_PULSES    9       // Уровень 2: импульсы SCL для освобождения SDA
+#define I2C_BUS_CLEAR_HALF_PERIOD_US 5  // Полупериод SCL при очистке шины (~100kHz)
+#define RECOVERY_BACKOFF_MS     1000    // Пауза после неудачи всех уровней (уровень 3 - сброс)
+
+// Живость PN532 по трафику: каждый ACK от PN532 подтверждает связь,
+// явная проба GetGeneralStatus - только при тишине или серии неудач
+#define LIVENESS_SILENT_PERIOD_MS   5000  // Проба после такой паузы в обмене
+#define LIVENESS_FAILURE_THRESHOLD  2     // ...или после стольких транзакций без ACK подряд
+
+// Очередь команд PN532 (диагностика, чтение/запись NTAG между сканированиями)
+#define COMMAND_QUEUE_SIZE          8       // Максимум команд в очереди
+#define SCAN_STALENESS_BUDGET_MS    12000   // Фоновые команды не растягивают проход дольше
+
+// Снимок доски в NVS (теплый старт)
+#define SNAPSHOT_DEBOUNCE_MS            5000    // Запись после такого затишья на доске
+#define SNAPSHOT_MIN_WRITE_INTERVAL_MS  30000   // ...и не чаще (ресурс flash)
+
+// Самокалибровка таймингов по ячейкам. Значения выше - консервативный профиль
+// по умолчанию; ячейка получает свой профиль после окна чтений с картой на ней
+#define ENABLE_CELL_CALIBRATION         true
+#define PN532_POLLS_PER_TIMEOUT         8       // Опросов RDY за таймаут чтения (шаг 1..10 мс)
+#define CALIBRATION_TARGET_SUCCESS_PCT  99      // Доля чтений без пропуска/перекрестного чтения
+#define CALIBRATION_WINDOW_READS        32      // Чтений с картой на одно решение по таймауту
+#define CALIBRATION_SETTLE_WINDOW       4       // Переключений с занятой ячейки на решение по паузе
+#define CALIBRATION_TIMEOUT_MARGIN_PCT  50      // Запас таймаута к худшей задержке окна
+#define CALIBRATION_MIN_TIMEOUT_MS      3
+#define CALIBRATION_MAX_TIMEOUT_MS      60
+#define CALIBRATION_MIN_SETTLE_US       20
+#define CALIBRATION_MAX_SETTLE_US       (SCAN_DELAY_MS * 1000UL)  // Старт обучения паузы
+#define CALIBRATION_MAX_RETRIES         2       // Повторов до контрольного чтения
+#define CALIBRATION_RELEARN_INTERVAL_MS 600000  // Повторный поиск минимума паузы (дрейф)
+#define CALIBRATION_SAVE_INTERVAL_MS    60000   // Запись профилей во flash не чаще
+
+// Профили аналогового тракта PN532 по ячейкам (RxGain в CIU_RFCfg, ModGsP).
+// Слабой антенне нужно больше усиления и глубже модуляция, сильной - наоборот:
+// на штатных настройках она тратит повторы активации и таймауты. Профиль ячейки
+// выбирает калибровка по пропускам окна, записывается при переключении ячейки,
+// только если отличается от текущего
+#define ENABLE_RF_PROFILES              true
+#define RF_PROFILE_COUNT                3       // штатный, усиленный, максимальный
+
+// Выключение поля PN532 (RFConfiguration, пункт 1) на время переключения с занятой
+// ячейки: прежней антенне нечем наводить метку, пауза успокоения не нужна, но
+// стоит двух команд и времени запитки метки. В режиме AUTO стратегия выбирается
+// по ячейке по измеренной цене: пауза (+ контрольные чтения) против выключения поля
+#define RF_GATING_MODE                  RF_GATING_AUTO
+#define RF_FIELD_GUARD_US               1000    // Запитка метки после включения поля
+#define RF_GATING_PROBE_INTERVAL        16      // Раз в столько переключений - замер другой стратегии
+
+// Карантин неисправных ячеек: антенна с обрывом или КЗ стоит каждому проходу
+// таймаута транзакции, повторов и пробы живости. После стольких ошибок подряд
+// при живой связи ячейка выпадает из прохода (в кэше - последнее известное
+// состояние) и проверяется фоном; возвращается после серии чистых чтений
+#define ENABLE_CELL_QUARANTINE          true
+#define CELL_QUARANTINE_FAILURES        3       // Ошибок подряд до карантина
+#define CELL_PROBE_INTERVAL_MS          10000   // Фоновая проверка одной ячейки в карантине не чаще
+#define CELL_REINSTATE_READS            3       // Чистых чтений подряд до возврата в проход
+
+// Предварительные события карт: первое чтение, расходящееся с кэшем, сообщается
+// сразу (снятие фигуры на ~70 мс раньше повторов и контрольного чтения), решение
+// фильтра - подтверждением или отзывом с тем же id
+#define ENABLE_PROVISIONAL_EVENTS       true
+
+// Распознавание ходов: шахматная доска 8x8 на столбцах CHESS_FILE_A_COL..+7
+// (вертикали a..h), строка 0 - первая горизонталь. Остальные столбцы - лотки
+// для битых фигур и запасных ферзей
+#define ENABLE_MOVE_RECOGNIZER          true
+#define CHESS_FILE_A_COL                2
+#define CHESS_MAX_PIECES                40      // 32 фигуры + запасные метки в лотках
+#define MOVE_LOG_SIZE                   128     // Полуходов в журнале (старые вытесняются)
+#define MOVE_HOLD_MS                    40000   // Ход не в очередь / ладья раньше короля: ждем до прохода полной доски
+
+// Быстрая проверка карты из кэша: WUPA через InCommunicateThru, ATQA с тем же
+// размером UID - карта на месте. Только первое чтение после переключения
+// антенны; тишина, другой ATQA или сбой - полная антиколлизия. Подмену картой
+// того же типа ловят полные чтения задержки на карте. Две команды PN532 вместо
+// одной: вход на ячейку ~8.2 мс против ~8.6 мс, снятая карта ~62 мс против
+// ~58 мс (бенчмарк verify) - на весь проход выигрыш меньше процента. Выключено
+#define ENABLE_FAST_VERIFY              false
+#define FAST_VERIFY_RETRY_TIMEOUT       0x04    // fRetryTimeout (RFConfiguration, пункт 2): 800 мкс
+#define PN532_RETRY_TIMEOUT_DEFAULT     0x0A    // 51.2 мс - по умолчанию PN532, нужно записи NTAG
+
+// Две метки в поле одной антенны (мерцание [2,1]/[2,2]): метка соседней ячейки
+// отвечает на чужую антенну. InListPassiveTarget с MaxTg=2 возвращает обе, владелец
+// определяется по кэшу соседних ячеек. Поиск второй метки стоит ~1 мс на чтение,
+// поэтому в адаптивном режиме MaxTg=2 - только на ячейках, где прочитан UID соседа
+#define MULTI_TARGET_MODE               MULTI_TARGET_ADAPTIVE
+#define MULTI_TARGET_RELEASE_READS      64      // Чтений подряд с одной меткой до возврата к MaxTg=1
+
+// Наблюдение за ячейкой (InAutoPoll): мультиплексор стоит на ячейке, PN532 сам
+// опрашивает поле раз в период, хост читает только байт RDY. Включается после
+// снятия фигуры (ее часто ставят обратно) и ограничено запасом устаревания прохода.
+// По умолчанию выключено: на стенде watch больше половины наблюдений кончаются
+// таймаутом, выигрывает только медиана возврата, а p95 и полный проход хуже
+#define ENABLE_WATCH_AFTER_REMOVAL      false
+#define WATCH_AFTER_REMOVAL_MS          2000    // Длительность наблюдения после снятия
+#define WATCH_AUTOPOLL_PERIOD           1       // Период опроса InAutoPoll, x150 мс (1..15)
+#define WATCH_RDY_POLL_MS               10      // Шаг чтения RDY во время наблюдения (без IRQ)
+
+// ОЖИДАНИЕ ОТВЕТА PN532 ПО ЛИНИИ IRQ
+// Спад P70_IRQ будит ожидание через семафор вместо чтения байта RDY каждые
+// 1-10 мс: шина свободна, ответ забирается сразу. Плата без провода IRQ -
+// сборка с -DPN532_USE_IRQ=false (опрос RDY); если линия не отвечает при
+// инициализации, RFIDManager сам переходит на опрос
+#ifndef PN532_USE_IRQ
+#define PN532_USE_IRQ                   true
+#endif
+
+// Запись транзакций I2C (сборка с -DI2C_TRACE): каждая транзакция драйвера PN532
+// (направление, байты, время начала в мкс, результат) - в кольцо в RAM. Кольцо
+// уходит кадрами с CRC32 в Serial и сохраняется в SPIFFS при потере PN532, чтобы
+// после сбоя в поле повторить обмен на хосте (бенчмарк replay)
+#define I2C_TRACE_RING_BYTES            8192    // Кольцо записей в RAM
+#define I2C_TRACE_ENABLED_DEFAULT       true    // Запись с первой транзакции setup()
+#define I2C_TRACE_STREAM_DEFAULT        false   // Поток кадров в Serial вперемешку с логом
+#define I2C_TRACE_STREAM_BYTES_PER_LOOP 512     // Сколько байт кадров отдавать за loop()
+#define I2C_TRACE_SPILL_INTERVAL_MS     60000   // Сохранение кольца в SPIFFS не чаще (ресурс flash)
+
+// Реестр метрик: счетчики, датчики и гистограммы модулей в статических слотах
+// (без выделения памяти), атомарные обновления с обоих ядер. Снимок - двоичный
+// кадр в Serial (значения или приращения с прошлого чтения); имена и границы
+// корзин - отдельным кадром схемы, скорости считает хост
+#define METRICS_MAX_ENTRIES             32      // Слотов метрик всего
+#define METRICS_MAX_HISTOGRAMS          4       // Из них гистограмм
+#define METRICS_HISTOGRAM_BUCKETS       8       // Корзин гистограммы (последняя - переполнение)
+#define METRICS_STREAM_INTERVAL_MS      0       // Период кадров-приращений в Serial (0 - выкл.)
+
+// Консоль Serial: текстовые команды (help - список) и те же команды кадрами
+// 'C' с ответом кадрами 'A' (формат кадров трассы I2C). Не блокирует loop():
+// за проход читается не больше CONSOLE_RX_BYTES_PER_LOOP байт, исполняется
+// не больше одной команды, длинная таблица выводится по строке за проход.
+// Настройки сохраняются в NVS командой save и применяются при загрузке
+#define CONSOLE_LINE_BYTES              64      // Длина строки команды
+#define CONSOLE_RX_BYTES_PER_LOOP       32      // Байт ввода за loop()
+#define CONSOLE_FRAME_TIMEOUT_MS        200     // Недописанный кадр сбрасывается
+#define CONSOLE_REPLY_CHUNK_BYTES       96      // Текста ответа в одном кадре 'A'
+#define STATUS_REPORT_INTERVAL_MS       5000    // Период отчета о состоянии (0 - только по status)
+
+// Профиль состояний StateManager: время в каждом состоянии, длительность
+// визитов по корзинам, матрица переходов и последние переходы с временем.
+// Учет - вычитание и сложение на переходе и раз в loop(), без выделения памяти;
+// время в SCANNING/ERROR и длительность восстановлений - еще и в реестре метрик
+#define STATE_HISTORY_SIZE              16      // Последних переходов в кольце
+
+// Память: после setup() прошивка не выделяет кучу (драйвер PN532 и буферы -
+// статические). Монитор раз в MEMORY_SAMPLE_INTERVAL_MS снимает свободную кучу,
+// ее минимум и наибольший блок, рост числа блоков с конца setup() и запас
+// стека задач - в реестр метрик; выход за пороги - предупреждение в лог
+#define MEMORY_SAMPLE_INTERVAL_MS       1000    // Период снятия (обход кучи и стека)
+#define MEMORY_MAX_TASKS                4       // Задач под наблюдением (loop() - всегда)
+#define MEMORY_STACK_WARN_BYTES         1024    // Запас стека задачи ниже - предупреждение
+#define MEMORY_HEAP_WARN_BYTES          16384   // Минимум свободной кучи ниже - предупреждение
+#define MEMORY_BLOCKS_ALERT_STEP        16      // Рост блоков кучи: предупреждение раз на шаг
 
 // Размеры буферов
 #define UID_BUFFER_SIZE         7      // Максимальный размер UID
@@ -62,7 +282,8 @@ enum SystemState {
     STATE_SWITCH_CELL,    // Переключение на следующую ячейку
     STATE_UPDATE_DISPLAY, // Обновление дисплея
     STATE_IDLE,           // Режим ожидания
-    STATE_ERROR           // Обработка ошибок
+    STATE_ERROR,          // Обработка ошибок
+    SYSTEM_STATE_COUNT
 };
 
 // Результаты сканирования
@@ -73,11 +294,27 @@ enum ScanResult {
     SCAN_ERROR            // Ошибка сканирования
 };
 
-// Макросы для отладки
+// Режим чтения нескольких меток в поле антенны
+enum MultiTargetMode {
+    MULTI_TARGET_OFF,         // Всегда MaxTg=1
+    MULTI_TARGET_ADAPTIVE,    // MaxTg=2 на ячейках с UID соседа
+    MULTI_TARGET_ALWAYS       // MaxTg=2 на всех ячейках
+};
+
+// Поле PN532 при переключении мультиплексора после занятой ячейки
+enum RfGatingMode {
+    RF_GATING_OFF,            // Поле включено всегда, пауза успокоения
+    RF_GATING_AUTO,           // По ячейке: что дешевле по замерам
+    RF_GATING_ALWAYS          // Всегда выключать поле на переключение
+};
+
+// Макросы для отладки. serialDebugEnabled - выключатель лога на ходу
+// (команда консоли log, src/serial_console.cpp)
 #if ENABLE_SERIAL_DEBUG
-    #define DEBUG_PRINT(x)   Serial.print(x)
-    #define DEBUG_PRINTLN(x) Serial.println(x)
-    #define DEBUG_PRINTF(fmt, ...) Serial.printf(fmt, ##__VA_ARGS__)
+    extern bool serialDebugEnabled;
+    #define DEBUG_PRINT(x)   do { if (serialDebugEnabled) Serial.print(x); } while (0)
+    #define DEBUG_PRINTLN(x) do { if (serialDebugEnabled) Serial.println(x); } while (0)
+    #define DEBUG_PRINTF(fmt, ...) do { if (serialDebugEnabled) Serial.printf(fmt, ##__VA_ARGS__); } while (0)
 #else
     #define DEBUG_PRINT(x)
     #define DEBUG_PRINTLN(x)  
@@ -91,15 +328,7 @@ struct CardInfo {
     uint8_t uidLength;              // Длина UID
     unsigned long lastSeen;         // Время последнего обнаружения
     bool changed;                   // Флаг изменения
-};
-
-// Структура для метрик производительности
-struct PerformanceMetrics {
-    unsigned long totalScans;       // Общее количество сканирований
-    unsigned long successfulReads;  // Успешные чтения
-    unsigned long errors;           // Количество ошибок
-    unsigned long lastCycleTime;    // Время последнего полного цикла
-    float currentFPS;               // Текущий FPS
+    bool assumed;                   // Восстановлено из снимка, еще не подтверждено
 };
 
 #endif // CONFIG_H 
\ No newline at end of file
@@ -58,6 +58,24 @@
 /**************************************************************************/
 
 #include "Adafruit_PN532.h"
+#include <new>
+
+#if defined(ARDUINO_ARCH_ESP32) || defined(HOST_BUILD)
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#define PN532_IRQ_WAIT ///< IRQ edge wakes waitready() through a semaphore
+
+static SemaphoreHandle_t pn532IrqSemaphore = NULL; ///< Given on IRQ falling edge
+static StaticSemaphore_t pn532IrqSemaphoreBuffer; ///< Semaphore storage (no heap)
+
+static void IRAM_ATTR pn532IrqHandler() {
+  BaseType_t woken = pdFALSE;
+  xSemaphoreGiveFromISR(pn532IrqSemaphore, &woken);
+  if (woken) {
+    portYIELD_FROM_ISR();
+  }
+}
+#endif
 
 byte pn532ack[] = {0x00, 0x00, 0xFF,
                    0x00, 0xFF, 0x00}; ///< ACK message from PN532
@@ -78,6 +96,11 @@ byte pn532response_firmwarevers[] = {
 #define PN532_PACKBUFFSIZ 64                ///< Packet buffer size in bytes
 byte pn532_packetbuffer[PN532_PACKBUFFSIZ]; ///< Packet buffer used in various
                                             ///< transactions
+static uint8_t pn532_readbuffer[PN532_PACKBUFFSIZ + 1]; ///< I2C read: RDY byte
+                                                        ///< + packet
+static uint8_t pn532_writebuffer[PN532_PACKBUFFSIZ + 9]; ///< Command frame:
+                                                         ///< (SPI DW) + header
+                                                         ///< + packet + DCS/00
 
 /**************************************************************************/
 /*!
@@ -109,7 +132,7 @@ Adafruit_PN532::Adafruit_PN532(uint8_t irq, uint8_t reset, TwoWire *theWire)
     : _irq(irq), _reset(reset) {
   pinMode(_irq, INPUT);
   pinMode(_reset, OUTPUT);
-  i2c_dev = new Adafruit_I2CDevice(PN532_I2C_ADDRESS, theWire);
+  i2c_dev = new (_i2cStorage) Adafruit_I2CDevice(PN532_I2C_ADDRESS, theWire);
 }
 
 /**************************************************************************/
@@ -140,6 +163,19 @@ Adafruit_PN532::Adafruit_PN532(uint8_t reset, HardwareSerial *theSer)
   ser_dev = theSer;
 }
 
+/**************************************************************************/
+/*!
+    @brief  Destroys the embedded I2C device. SPI devices are not owned
+            (the upstream driver never frees them).
+*/
+/**************************************************************************/
+Adafruit_PN532::~Adafruit_PN532() {
+  if (i2c_dev == reinterpret_cast<Adafruit_I2CDevice *>(_i2cStorage)) {
+    i2c_dev->~Adafruit_I2CDevice();
+  }
+  i2c_dev = NULL;
+}
+
 /**************************************************************************/
 /*!
     @brief  Setups the HW
@@ -186,6 +222,11 @@ void Adafruit_PN532::reset(void) {
     delay(1); // min 20ns
     digitalWrite(_reset, HIGH);
     delay(2); // max 2ms
+#if defined(I2C_FAULT_INJECTION) || defined(I2C_TRACE)
+    if (i2c_dev) {
+      i2c_dev->notifyReset();
+    }
+#endif
   }
 }
 
@@ -307,6 +348,37 @@ uint32_t Adafruit_PN532::getFirmwareVersion(void) {
   return response;
 }
 
+/**************************************************************************/
+/*!
+    @brief  Cheap liveness check using GetGeneralStatus
+
+    @param  err  Optional pointer that receives the Err byte (last error
+                 detected by the PN532)
+
+    @returns  true if the chip answered with a valid status frame
+*/
+/**************************************************************************/
+bool Adafruit_PN532::getGeneralStatus(uint8_t *err) {
+  pn532_packetbuffer[0] = PN532_COMMAND_GETGENERALSTATUS;
+
+  if (!sendCommandCheckAck(pn532_packetbuffer, 1)) {
+    return false;
+  }
+
+  // 00 00 FF LEN LCS D5 05 Err Field NbTg ... SAM
+  readdata(pn532_packetbuffer, 12);
+
+  if (pn532_packetbuffer[5] != PN532_PN532TOHOST ||
+      pn532_packetbuffer[6] != PN532_COMMAND_GETGENERALSTATUS + 1) {
+    return false;
+  }
+
+  if (err) {
+    *err = pn532_packetbuffer[7];
+  }
+  return true;
+}
+
 /**************************************************************************/
 /*!
     @brief  Sends a command and waits a specified period for the ACK
@@ -328,9 +400,23 @@ bool Adafruit_PN532::sendCommandCheckAck(uint8_t *cmd, uint8_t cmdlen,
   uint8_t SLOWDOWN = 0;
   if (i2c_dev || spi_dev) // SPI and I2C need 1ms slow for page reads
     SLOWDOWN = 1;
+  // with IRQ the bus is not touched until the chip pulls the line low
+  if (_irqWait)
+    SLOWDOWN = 0;
 
-  // write the command
-  writecommand(cmd, cmdlen);
+  _lastAck = false;
+  _busError = false;
+  _frameError = false;
+
+  // write the command (an oversize one never reaches the bus)
+  if (!writecommand(cmd, cmdlen)) {
+    return false;
+  }
+
+  // a NACK'd write means the chip (or the bus) is gone - don't poll for RDY
+  if (_busError) {
+    return false;
+  }
 
   // I2C TUNING
   delay(SLOWDOWN);
@@ -353,6 +439,7 @@ bool Adafruit_PN532::sendCommandCheckAck(uint8_t *cmd, uint8_t cmdlen,
 #endif
     return false;
   }
+  _lastAck = true;
 
   // I2C TUNING
   delay(SLOWDOWN);
@@ -537,6 +624,107 @@ bool Adafruit_PN532::setPassiveActivationRetries(uint8_t maxRetries) {
   return 1;
 }
 
+/**************************************************************************/
+/*!
+    @brief  Sets one RFConfiguration item
+
+    @param  cfgItem     Configuration item (1 = RF field, 2 = timings,
+                        5 = max retries, ...)
+    @param  data        Item data
+    @param  dataLength  Item data length in bytes
+
+    @returns 1 if everything executed properly, 0 for an error
+*/
+/**************************************************************************/
+bool Adafruit_PN532::setRFConfiguration(uint8_t cfgItem, const uint8_t *data,
+                                        uint8_t dataLength) {
+  if (dataLength > PN532_PACKBUFFSIZ - 2) {
+    return false;
+  }
+
+  pn532_packetbuffer[0] = PN532_COMMAND_RFCONFIGURATION;
+  pn532_packetbuffer[1] = cfgItem;
+  memcpy(&pn532_packetbuffer[2], data, dataLength);
+
+  if (!sendCommandCheckAck(pn532_packetbuffer, dataLength + 2))
+    return false;
+
+  // 00 00 FF LEN LCS D5 33 DCS 00
+  readdata(pn532_packetbuffer, 9);
+  return checkframe(PN532_COMMAND_RFCONFIGURATION, 9);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Writes several PN532/CIU registers in a single WriteRegister
+            command
+
+    @param  regs    Register addresses (e.g. 0x633D = CIU_BitFraming)
+    @param  values  Values to write, one per address
+    @param  count   Number of registers
+
+    @returns 1 if everything executed properly, 0 for an error
+*/
+/**************************************************************************/
+bool Adafruit_PN532::writeRegisters(const uint16_t *regs,
+                                    const uint8_t *values, uint8_t count) {
+  if (count == 0 || 1 + 3 * count > PN532_PACKBUFFSIZ) {
+    return false;
+  }
+
+  pn532_packetbuffer[0] = PN532_COMMAND_WRITEREGISTER;
+  for (uint8_t i = 0; i < count; i++) {
+    pn532_packetbuffer[1 + 3 * i] = regs[i] >> 8;
+    pn532_packetbuffer[2 + 3 * i] = regs[i] & 0xFF;
+    pn532_packetbuffer[3 + 3 * i] = values[i];
+  }
+
+  if (!sendCommandCheckAck(pn532_packetbuffer, 1 + 3 * count))
+    return false;
+
+  // 00 00 FF LEN LCS D5 09 DCS 00
+  readdata(pn532_packetbuffer, 9);
+  return checkframe(PN532_COMMAND_WRITEREGISTER, 9);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Reads several PN532/CIU registers in a single ReadRegister
+            command
+
+    @param  regs    Register addresses (e.g. 0x6316 = CIU_RFCfg)
+    @param  values  Buffer for the values, one per address
+    @param  count   Number of registers
+
+    @returns 1 if everything executed properly, 0 for an error
+*/
+/**************************************************************************/
+bool Adafruit_PN532::readRegisters(const uint16_t *regs, uint8_t *values,
+                                   uint8_t count) {
+  if (count == 0 || 1 + 2 * count > PN532_PACKBUFFSIZ ||
+      8 + count > PN532_PACKBUFFSIZ) {
+    return false;
+  }
+
+  pn532_packetbuffer[0] = PN532_COMMAND_READREGISTER;
+  for (uint8_t i = 0; i < count; i++) {
+    pn532_packetbuffer[1 + 2 * i] = regs[i] >> 8;
+    pn532_packetbuffer[2 + 2 * i] = regs[i] & 0xFF;
+  }
+
+  if (!sendCommandCheckAck(pn532_packetbuffer, 1 + 2 * count))
+    return false;
+
+  // 00 00 FF LEN LCS D5 07 VAL1..VALn DCS 00
+  readdata(pn532_packetbuffer, 9 + count);
+  if (!checkframe(PN532_COMMAND_READREGISTER, 9 + count) ||
+      pn532_packetbuffer[3] != 2 + count) {
+    return false;
+  }
+  memcpy(values, &pn532_packetbuffer[7], count);
+  return true;
+}
+
 /***** ISO14443A Commands ******/
 
 /**************************************************************************/
@@ -570,6 +758,83 @@ bool Adafruit_PN532::readPassiveTargetID(uint8_t cardbaudrate, uint8_t *uid,
   return readDetectedPassiveTargetID(uid, uidLength);
 }
 
+/**************************************************************************/
+/*!
+    @brief   Lists up to two ISO14443A targets in the field and reads
+             their IDs (InListPassiveTarget with MaxTg > 1).
+
+    @param   cardbaudrate  Baud rate of the card
+    @param   maxTargets    Maximum number of targets to list (1 or 2)
+    @param   uids          Arrays populated with the UIDs (up to 7 bytes each)
+    @param   uidLengths    Lengths of the UIDs
+    @param   targetCount   Number of targets found
+    @param   timeout       Timeout in milliseconds.
+
+    @return  1 if at least one target was read, 0 otherwise
+*/
+/**************************************************************************/
+bool Adafruit_PN532::readPassiveTargetIDs(uint8_t cardbaudrate,
+                                          uint8_t maxTargets,
+                                          uint8_t uids[][7],
+                                          uint8_t *uidLengths,
+                                          uint8_t *targetCount,
+                                          uint16_t timeout) {
+  if (maxTargets < 1 || maxTargets > 2)
+    return 0;
+
+  pn532_packetbuffer[0] = PN532_COMMAND_INLISTPASSIVETARGET;
+  pn532_packetbuffer[1] = maxTargets;
+  pn532_packetbuffer[2] = cardbaudrate;
+
+  *targetCount = 0;
+  if (!sendCommandCheckAck(pn532_packetbuffer, 3, timeout)) {
+#ifdef PN532DEBUG
+    PN532DEBUGPRINT.println(F("No card(s) read"));
+#endif
+    return 0x0; // no cards read
+  }
+
+  // Frame header, NbTg, then per target: Tg, SENS_RES (2), SEL_RES,
+  // NFCID length, NFCID (up to 7 bytes); DCS and postamble
+  uint8_t frameLength = 10 + maxTargets * 12;
+  readdata(pn532_packetbuffer, frameLength);
+  if (!checkframe(PN532_COMMAND_INLISTPASSIVETARGET, frameLength))
+    return 0;
+
+  uint8_t found = pn532_packetbuffer[7];
+  if (found < 1 || found > maxTargets)
+    return 0;
+
+  uint8_t pos = 8;
+  for (uint8_t t = 0; t < found; t++) {
+    uint8_t len = pn532_packetbuffer[pos + 4];
+    if (len > 7)
+      return 0;
+    _targetTg[t] = pn532_packetbuffer[pos];
+    uidLengths[t] = len;
+    memcpy(uids[t], &pn532_packetbuffer[pos + 5], len);
+    pos += 5 + len;
+  }
+
+  // Tg of the first target, used by inDataExchange()
+  _inListedTag = _targetTg[0];
+  *targetCount = found;
+  return 1;
+}
+
+/**************************************************************************/
+/*!
+    @brief   Selects which of the targets listed by readPassiveTargetIDs()
+             inDataExchange() talks to.
+
+    @param   index  Target index (0 or 1)
+*/
+/**************************************************************************/
+void Adafruit_PN532::selectListedTarget(uint8_t index) {
+  if (index < 2)
+    _inListedTag = _targetTg[index];
+}
+
 /**************************************************************************/
 /*!
     @brief   Put the reader in detection mode, non blocking so interrupts
@@ -600,9 +865,11 @@ bool Adafruit_PN532::startPassiveTargetIDDetection(uint8_t cardbaudrate) {
 /**************************************************************************/
 bool Adafruit_PN532::readDetectedPassiveTargetID(uint8_t *uid,
                                                  uint8_t *uidLength) {
-  // read data packet
-  readdata(pn532_packetbuffer, 20);
-  // check some basic stuff
+  // read data packet (up to a 7 byte NFCID, DCS and postamble)
+  readdata(pn532_packetbuffer, 22);
+  // check the frame before trusting any field of it
+  if (!checkframe(PN532_COMMAND_INLISTPASSIVETARGET, 22))
+    return 0;
 
   /* ISO14443A card response should be in the following format:
 
@@ -621,9 +888,12 @@ bool Adafruit_PN532::readDetectedPassiveTargetID(uint8_t *uid,
   PN532DEBUGPRINT.print(pn532_packetbuffer[7], DEC);
   PN532DEBUGPRINT.println(F(" tags"));
 #endif
-  if (pn532_packetbuffer[7] != 1)
+  if (pn532_packetbuffer[7] != 1 || pn532_packetbuffer[12] > 7)
     return 0;
 
+  // Tg of the activated target, used by inDataExchange()
+  _inListedTag = pn532_packetbuffer[8];
+
   uint16_t sens_res = pn532_packetbuffer[9];
   sens_res <<= 8;
   sens_res |= pn532_packetbuffer[10];
@@ -653,6 +923,104 @@ bool Adafruit_PN532::readDetectedPassiveTargetID(uint8_t *uid,
   return 1;
 }
 
+/**************************************************************************/
+/*!
+    @brief   Starts InAutoPoll: the PN532 polls the field on its own and
+             answers only when a target shows up (or PollNr runs out).
+             Returns right after the ACK; use responseReady() and
+             readAutoPollTarget() to collect the result, abortCommand()
+             to stop polling.
+
+    @param   pollNr     Number of polls (0x01..0xFE), 0xFF for endless
+    @param   period     Polling period in units of 150 ms (0x01..0x0F)
+    @param   types      Target types to poll (e.g. 0x10 for ISO14443A)
+    @param   typeCount  Number of types (1..15)
+
+    @return  true if the command was ACK'd
+*/
+/**************************************************************************/
+bool Adafruit_PN532::startAutoPoll(uint8_t pollNr, uint8_t period,
+                                   const uint8_t *types, uint8_t typeCount) {
+  if (typeCount < 1 || typeCount > 15)
+    return false;
+
+  pn532_packetbuffer[0] = PN532_COMMAND_INAUTOPOLL;
+  pn532_packetbuffer[1] = pollNr;
+  pn532_packetbuffer[2] = period;
+  memcpy(&pn532_packetbuffer[3], types, typeCount);
+
+  _lastAck = false;
+  _busError = false;
+  if (!writecommand(pn532_packetbuffer, 3 + typeCount) || _busError)
+    return false;
+
+  // Only the ACK is awaited - the response comes when a target is found
+  delay(1);
+  if (!waitready(PN532_I2C_READYTIMEOUT) || !readack())
+    return false;
+  _lastAck = true;
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief   Non-blocking check whether the response to the pending
+             command is ready (one RDY read over I2C, or the IRQ level)
+
+    @return  true if the response can be read
+*/
+/**************************************************************************/
+bool Adafruit_PN532::responseReady() {
+  _busError = false;
+  return isready();
+}
+
+/**************************************************************************/
+/*!
+    @brief   Reads the response to InAutoPoll started by startAutoPoll()
+
+    @param   uid        Pointer to the array that will be populated
+                        with the card's UID (up to 7 bytes)
+    @param   uidLength  Pointer to the variable that will hold the
+                        length of the card's UID.
+
+    @return  1 if a target was reported, 0 if none (PollNr ran out) or
+             the frame is not an InAutoPoll response
+*/
+/**************************************************************************/
+bool Adafruit_PN532::readAutoPollTarget(uint8_t *uid, uint8_t *uidLength) {
+  // b0..6 header, b7 NbTg, b8 Type, b9 Length, b10 Tg, b11..12 SENS_RES,
+  // b13 SEL_RES, b14 NFCID length, b15.. NFCID, DCS, postamble
+  _frameError = false;
+  readdata(pn532_packetbuffer, 24);
+
+  if (!checkframe(PN532_COMMAND_INAUTOPOLL, 24) ||
+      pn532_packetbuffer[7] < 1 || pn532_packetbuffer[14] > 7)
+    return 0;
+
+  _inListedTag = pn532_packetbuffer[10];
+  *uidLength = pn532_packetbuffer[14];
+  memcpy(uid, &pn532_packetbuffer[15], *uidLength);
+  return 1;
+}
+
+/**************************************************************************/
+/*!
+    @brief   Aborts the command in progress (the host sends an ACK frame)
+*/
+/**************************************************************************/
+void Adafruit_PN532::abortCommand() {
+  if (i2c_dev) {
+    _busError = !i2c_dev->write(pn532ack, sizeof(pn532ack));
+  } else if (spi_dev) {
+    uint8_t packet[7] = {PN532_SPI_DATAWRITE};
+    memcpy(&packet[1], pn532ack, sizeof(pn532ack));
+    spi_dev->write(packet, sizeof(packet));
+  } else if (ser_dev) {
+    ser_dev->write(pn532ack, sizeof(pn532ack));
+  }
+}
+
 /**************************************************************************/
 /*!
     @brief   Exchanges an APDU with the currently inlisted peer
@@ -661,12 +1029,14 @@ bool Adafruit_PN532::readDetectedPassiveTargetID(uint8_t *uid,
     @param   sendLength      Length of the data to send
     @param   response        Pointer to response data
     @param   responseLength  Pointer to the response data length
+    @param   timeout         Timeout in ms for the ACK and for the response
     @return  true on success, false otherwise.
 */
 /**************************************************************************/
 bool Adafruit_PN532::inDataExchange(uint8_t *send, uint8_t sendLength,
                                     uint8_t *response,
-                                    uint8_t *responseLength) {
+                                    uint8_t *responseLength,
+                                    uint16_t timeout) {
   if (sendLength > PN532_PACKBUFFSIZ - 2) {
 #ifdef PN532DEBUG
     PN532DEBUGPRINT.println(F("APDU length too long for packet buffer"));
@@ -681,14 +1051,14 @@ bool Adafruit_PN532::inDataExchange(uint8_t *send, uint8_t sendLength,
     pn532_packetbuffer[i + 2] = send[i];
   }
 
-  if (!sendCommandCheckAck(pn532_packetbuffer, sendLength + 2, 1000)) {
+  if (!sendCommandCheckAck(pn532_packetbuffer, sendLength + 2, timeout)) {
 #ifdef PN532DEBUG
     PN532DEBUGPRINT.println(F("Could not send APDU"));
 #endif
     return false;
   }
 
-  if (!waitready(1000)) {
+  if (!waitready(timeout)) {
 #ifdef PN532DEBUG
     PN532DEBUGPRINT.println(F("Response never received for APDU..."));
 #endif
@@ -740,6 +1110,60 @@ bool Adafruit_PN532::inDataExchange(uint8_t *send, uint8_t sendLength,
   }
 }
 
+/**************************************************************************/
+/*!
+    @brief   Sends raw bytes to the target in the field, bypassing the
+             PN532 protocol handling (framing is set by the CIU registers)
+
+    @param   send            Pointer to data to send
+    @param   sendLength      Length of the data to send
+    @param   response        Pointer to response data
+    @param   responseLength  In: response buffer size, out: bytes received
+    @param   timeout         Timeout in ms for the ACK and for the response
+    @return  true if the target answered; lastThruStatus() tells a silent
+             target (0x01) from other errors
+*/
+/**************************************************************************/
+bool Adafruit_PN532::inCommunicateThru(const uint8_t *send,
+                                       uint8_t sendLength, uint8_t *response,
+                                       uint8_t *responseLength,
+                                       uint16_t timeout) {
+  // Response frame: 00 00 FF LEN LCS D5 43 Status data... DCS 00
+  uint8_t frameLength = 10 + *responseLength;
+  if (sendLength > PN532_PACKBUFFSIZ - 1 || frameLength > PN532_PACKBUFFSIZ) {
+    return false;
+  }
+
+  _lastThruStatus = 0xFF;
+  pn532_packetbuffer[0] = PN532_COMMAND_INCOMMUNICATETHRU;
+  memcpy(&pn532_packetbuffer[1], send, sendLength);
+
+  if (!sendCommandCheckAck(pn532_packetbuffer, sendLength + 1, timeout)) {
+    return false;
+  }
+
+  // Only the expected bytes are read: short answers keep the bus short
+  readdata(pn532_packetbuffer, frameLength);
+
+  uint8_t length = pn532_packetbuffer[3];
+  if (!checkframe(PN532_COMMAND_INCOMMUNICATETHRU, frameLength) || length < 3) {
+    return false;
+  }
+
+  _lastThruStatus = pn532_packetbuffer[7] & 0x3F;
+  if (_lastThruStatus != 0) {
+    return false;
+  }
+
+  length -= 3;
+  if (length > *responseLength) {
+    return false;
+  }
+  memcpy(response, &pn532_packetbuffer[8], length);
+  *responseLength = length;
+  return true;
+}
+
 /**************************************************************************/
 /*!
     @brief   'InLists' a passive target. PN532 acting as reader/initiator,
@@ -1540,6 +1964,37 @@ bool Adafruit_PN532::readack() {
   return (0 == memcmp((char *)ackbuff, (char *)pn532ack, 6));
 }
 
+/**************************************************************************/
+/*!
+    @brief  Checks the response frame in pn532_packetbuffer: preamble,
+            LCS, DCS and the D5 / command + 1 header. A corrupted frame
+            sets lastFrameError() so the caller retries instead of
+            parsing garbage.
+
+    @param  command  Command the response belongs to
+    @param  n        Bytes read into the buffer; the DCS must be among them
+
+    @returns true if the frame is intact
+*/
+/**************************************************************************/
+bool Adafruit_PN532::checkframe(uint8_t command, uint8_t n) {
+  const uint8_t *frame = pn532_packetbuffer;
+  uint8_t len = frame[3];
+  bool valid = n >= 8 && frame[0] == PN532_PREAMBLE &&
+               frame[1] == PN532_STARTCODE1 && frame[2] == PN532_STARTCODE2 &&
+               (uint8_t)(len + frame[4]) == 0 && len >= 2 && 5 + len < n &&
+               frame[5] == PN532_PN532TOHOST && frame[6] == command + 1;
+  if (valid) {
+    uint8_t sum = 0;
+    for (uint8_t i = 0; i <= len; i++) {
+      sum += frame[5 + i]; // TFI, data, DCS
+    }
+    valid = sum == 0;
+  }
+  _frameError = !valid;
+  return valid;
+}
+
 /**************************************************************************/
 /*!
     @brief  Return true if the PN532 is ready with a response.
@@ -1553,9 +2008,16 @@ bool Adafruit_PN532::isready() {
     spi_dev->write_then_read(&cmd, 1, &reply, 1);
     return reply == PN532_SPI_READY;
   } else if (i2c_dev) {
+    // IRQ is held low while a frame is waiting - no bus traffic
+    if (_irqWait) {
+      return digitalRead(_irq) == LOW;
+    }
     // I2C ready check via reading RDY byte
     uint8_t rdy[1];
-    i2c_dev->read(rdy, 1);
+    if (!i2c_dev->read(rdy, 1)) {
+      _busError = true;
+      return false;
+    }
     return rdy[0] == PN532_I2C_READY;
   } else if (ser_dev) {
     // Serial ready check based on non-zero read buffer
@@ -1575,10 +2037,24 @@ bool Adafruit_PN532::isready() {
 */
 /**************************************************************************/
 bool Adafruit_PN532::waitready(uint16_t timeout) {
+  if (_irqWait) {
+    return waitirq(timeout);
+  }
   uint16_t timer = 0;
+  uint8_t busErrors = 0;
+  uint32_t start = micros();
+  _busError = false;
   while (!isready()) {
+    // a failed RDY read is a bus error, not "busy": give up after a few
+    // instead of burning the whole timeout on NACKs
+    if (_busError) {
+      if (++busErrors >= PN532_I2C_MAXBUSERRORS) {
+        return false;
+      }
+      _busError = false;
+    }
     if (timeout != 0) {
-      timer += 10;
+      timer += _pollInterval;
       if (timer > timeout) {
 #ifdef PN532DEBUG
         PN532DEBUGPRINT.println("TIMEOUT!");
@@ -1586,11 +2062,88 @@ bool Adafruit_PN532::waitready(uint16_t timeout) {
         return false;
       }
     }
-    delay(10);
+    delay(_pollInterval);
   }
+  _lastReadyWait = micros() - start;
   return true;
 }
 
+/**************************************************************************/
+/*!
+    @brief  Waits for the IRQ line instead of polling the RDY byte. The
+            level is checked first: an edge may have been consumed by an
+            earlier wait, and a stale semaphore must not end this one.
+
+    @param  timeout   Timeout before giving up (0 = wait forever)
+*/
+/**************************************************************************/
+bool Adafruit_PN532::waitirq(uint16_t timeout) {
+#ifdef PN532_IRQ_WAIT
+  uint32_t start = micros();
+  while (digitalRead(_irq) != LOW) {
+    TickType_t ticks = portMAX_DELAY;
+    if (timeout != 0) {
+      int32_t left = (int32_t)((uint32_t)timeout * 1000UL - (micros() - start));
+      if (left <= 0) {
+#ifdef PN532DEBUG
+        PN532DEBUGPRINT.println("TIMEOUT!");
+#endif
+        return false;
+      }
+      ticks = pdMS_TO_TICKS((left + 999) / 1000);
+      if (ticks == 0) {
+        ticks = 1;
+      }
+    }
+    xSemaphoreTake(pn532IrqSemaphore, ticks);
+  }
+  xSemaphoreTake(pn532IrqSemaphore, 0);
+  _lastReadyWait = micros() - start;
+  return true;
+#else
+  (void)timeout;
+  return false;
+#endif
+}
+
+/**************************************************************************/
+/*!
+    @brief  Switches I2C waits between the IRQ line and RDY byte polling.
+            Only one PN532 per sketch can use the IRQ wait.
+
+    @param  enabled   true to wait on the IRQ pin given to the constructor
+    @returns  false if the IRQ wait is not available (no pin, not I2C,
+              no FreeRTOS)
+*/
+/**************************************************************************/
+bool Adafruit_PN532::enableIrq(bool enabled) {
+#ifdef PN532_IRQ_WAIT
+  if (!enabled) {
+    if (_irqWait) {
+      detachInterrupt(digitalPinToInterrupt(_irq));
+      _irqWait = false;
+    }
+    return true;
+  }
+  if (!i2c_dev || _irq < 0) {
+    return false;
+  }
+  if (pn532IrqSemaphore == NULL) {
+    pn532IrqSemaphore = xSemaphoreCreateBinaryStatic(&pn532IrqSemaphoreBuffer);
+    if (pn532IrqSemaphore == NULL) {
+      return false;
+    }
+  }
+  pinMode(_irq, INPUT);
+  xSemaphoreTake(pn532IrqSemaphore, 0);
+  attachInterrupt(digitalPinToInterrupt(_irq), pn532IrqHandler, FALLING);
+  _irqWait = true;
+  return true;
+#else
+  return !enabled;
+#endif
+}
+
 /**************************************************************************/
 /*!
     @brief  Reads n bytes of data from the PN532 via SPI or I2C.
@@ -1605,11 +2158,13 @@ void Adafruit_PN532::readdata(uint8_t *buff, uint8_t n) {
     uint8_t cmd = PN532_SPI_DATAREAD;
     spi_dev->write_then_read(&cmd, 1, buff, n);
   } else if (i2c_dev) {
-    // I2C read
-    uint8_t rbuff[n + 1]; // +1 for leading RDY byte
-    i2c_dev->read(rbuff, n + 1);
+    // I2C read (fixed buffer: replies never exceed the packet buffer)
+    if (n > PN532_PACKBUFFSIZ) {
+      n = PN532_PACKBUFFSIZ;
+    }
+    i2c_dev->read(pn532_readbuffer, n + 1);
     for (uint8_t i = 0; i < n; i++) {
-      buff[i] = rbuff[i + 1];
+      buff[i] = pn532_readbuffer[i + 1];
     }
   } else if (ser_dev) {
     // Serial read
@@ -1730,13 +2285,20 @@ uint8_t Adafruit_PN532::setDataTarget(uint8_t *cmd, uint8_t cmdlen) {
 
     @param  cmd       Pointer to the command buffer
     @param  cmdlen    Command length in bytes
+
+    @returns false if the command does not fit the frame buffer (nothing
+             is written)
 */
 /**************************************************************************/
-void Adafruit_PN532::writecommand(uint8_t *cmd, uint8_t cmdlen) {
+bool Adafruit_PN532::writecommand(uint8_t *cmd, uint8_t cmdlen) {
+  if (cmdlen > PN532_PACKBUFFSIZ) {
+    return false;
+  }
+
+  uint8_t *packet = pn532_writebuffer;
   if (spi_dev) {
     // SPI command write.
     uint8_t checksum;
-    uint8_t packet[9 + cmdlen];
     uint8_t *p = packet;
     cmdlen++;
 
@@ -1784,7 +2346,6 @@ void Adafruit_PN532::writecommand(uint8_t *cmd, uint8_t cmdlen) {
     spi_dev->write(packet, 8 + cmdlen);
   } else if (i2c_dev || ser_dev) {
     // I2C or Serial command write.
-    uint8_t packet[8 + cmdlen];
     uint8_t LEN = cmdlen + 1;
 
     packet[0] = PN532_PREAMBLE;
@@ -1812,9 +2373,10 @@ void Adafruit_PN532::writecommand(uint8_t *cmd, uint8_t cmdlen) {
 #endif
 
     if (i2c_dev) {
-      i2c_dev->write(packet, 8 + cmdlen);
+      _busError = !i2c_dev->write(packet, 8 + cmdlen);
     } else {
       ser_dev->write(packet, 8 + cmdlen);
     }
   }
+  return true;
 }
@@ -75,8 +75,10 @@
 #define PN532_I2C_BUSY (0x00)         ///< Busy
 #define PN532_I2C_READY (0x01)        ///< Ready
 #define PN532_I2C_READYTIMEOUT (20)   ///< Ready timeout
+#define PN532_I2C_MAXBUSERRORS (3)    ///< Failed RDY reads before giving up
 
 #define PN532_MIFARE_ISO14443A (0x00) ///< MiFare
+#define PN532_AUTOPOLL_MIFARE (0x10)  ///< InAutoPoll type: MiFare, 106 kbps
 
 // Mifare Commands
 #define MIFARE_CMD_AUTH_A (0x60)           ///< Auth A
@@ -139,6 +141,9 @@
  * @brief Class for working with Adafruit PN532 NFC/RFID breakout boards.
  */
 class Adafruit_PN532 {
+#ifdef HOST_BUILD
+  friend class HostKernelAccess; // host microbenchmarks (host/bench)
+#endif
 public:
   Adafruit_PN532(uint8_t clk, uint8_t miso, uint8_t mosi,
                  uint8_t ss);                          // Software SPI
@@ -146,6 +151,7 @@ public:
   Adafruit_PN532(uint8_t irq, uint8_t reset,
                  TwoWire *theWire = &Wire);              // Hardware I2C
   Adafruit_PN532(uint8_t reset, HardwareSerial *theSer); // Hardware UART
+  ~Adafruit_PN532();
   bool begin(void);
 
   void reset(void);
@@ -154,11 +160,31 @@ public:
   // Generic PN532 functions
   bool SAMConfig(void);
   uint32_t getFirmwareVersion(void);
+  bool getGeneralStatus(uint8_t *err = NULL);
   bool sendCommandCheckAck(uint8_t *cmd, uint8_t cmdlen,
                            uint16_t timeout = 100);
+  /*!  @brief  Whether the last command was ACK'd by the PN532
+       @return false if the command never reached the chip (bus error,
+               NACK, missing ACK frame) */
+  bool lastCommandAcked() const { return _lastAck; }
+  /*!  @brief  Sets the RDY polling interval used while waiting for the chip
+       @param  ms  Interval in ms (1..255), also the timeout granularity */
+  void setReadyPollInterval(uint8_t ms) { _pollInterval = ms ? ms : 1; }
+  /*!  @brief  How long the last successful wait for RDY took
+       @return Wait time in us (the part of a command bounded by timeout) */
+  uint32_t lastReadyWaitMicros() const { return _lastReadyWait; }
+  bool enableIrq(bool enabled);
+  /*!  @brief  Whether waits block on the IRQ line instead of polling RDY
+       @return true after a successful enableIrq(true) */
+  bool irqEnabled() const { return _irqWait; }
   bool writeGPIO(uint8_t pinstate);
   uint8_t readGPIO(void);
   bool setPassiveActivationRetries(uint8_t maxRetries);
+  bool setRFConfiguration(uint8_t cfgItem, const uint8_t *data,
+                          uint8_t dataLength);
+  bool writeRegisters(const uint16_t *regs, const uint8_t *values,
+                      uint8_t count);
+  bool readRegisters(const uint16_t *regs, uint8_t *values, uint8_t count);
 
   // ISO14443A functions
   bool readPassiveTargetID(
@@ -166,9 +192,31 @@ public:
       uint16_t timeout = 0); // timeout 0 means no timeout - will block forever.
   bool startPassiveTargetIDDetection(uint8_t cardbaudrate);
   bool readDetectedPassiveTargetID(uint8_t *uid, uint8_t *uidLength);
+  bool readPassiveTargetIDs(uint8_t cardbaudrate, uint8_t maxTargets,
+                            uint8_t uids[][7], uint8_t *uidLengths,
+                            uint8_t *targetCount, uint16_t timeout = 0);
+  void selectListedTarget(uint8_t index);
+  bool startAutoPoll(uint8_t pollNr, uint8_t period, const uint8_t *types,
+                     uint8_t typeCount);
+  bool readAutoPollTarget(uint8_t *uid, uint8_t *uidLength);
+  bool responseReady(void);
+  /*!  @brief  Whether the last I2C transfer failed (NACK)
+       @return true after a failed RDY read or command write */
+  bool lastBusError() const { return _busError; }
+  /*!  @brief  Whether the last response frame was rejected
+       @return true if LCS, DCS or the D5/response code header did not
+               match (the frame was corrupted on the bus) */
+  bool lastFrameError() const { return _frameError; }
+  void abortCommand(void);
   bool inDataExchange(uint8_t *send, uint8_t sendLength, uint8_t *response,
-                      uint8_t *responseLength);
+                      uint8_t *responseLength, uint16_t timeout = 1000);
   bool inListPassiveTarget();
+  bool inCommunicateThru(const uint8_t *send, uint8_t sendLength,
+                         uint8_t *response, uint8_t *responseLength,
+                         uint16_t timeout = 1000);
+  /*!  @brief  Status byte of the last InCommunicateThru
+       @return 0x00 on success, 0x01 if the target did not answer */
+  uint8_t lastThruStatus() const { return _lastThruStatus; }
   uint8_t AsTarget();
   uint8_t getDataTarget(uint8_t *cmd, uint8_t *cmdlen);
   uint8_t setDataTarget(uint8_t *cmd, uint8_t cmdlen);
@@ -205,17 +253,30 @@ private:
   int8_t _uidLen;      // uid len
   int8_t _key[6];      // Mifare Classic key
   int8_t _inListedTag; // Tg number of inlisted tag.
+  int8_t _targetTg[2] = {1, 2}; // Tg numbers from readPassiveTargetIDs()
+  bool _lastAck = false;  // last command got an ACK frame
+  bool _busError = false; // last I2C transfer failed
+  bool _frameError = false; // last response frame failed LCS/DCS/header
+  uint8_t _pollInterval = 10; // RDY polling interval, ms
+  uint32_t _lastReadyWait = 0; // last successful RDY wait, us
+  uint8_t _lastThruStatus = 0; // last InCommunicateThru status byte
+  bool _irqWait = false;       // I2C: wait for the IRQ line, not the RDY byte
 
   // Low level communication functions that handle both SPI and I2C.
   void readdata(uint8_t *buff, uint8_t n);
-  void writecommand(uint8_t *cmd, uint8_t cmdlen);
+  bool writecommand(uint8_t *cmd, uint8_t cmdlen);
   bool isready();
   bool waitready(uint16_t timeout);
+  bool waitirq(uint16_t timeout);
   bool readack();
+  bool checkframe(uint8_t command, uint8_t n);
 
   Adafruit_SPIDevice *spi_dev = NULL;
   Adafruit_I2CDevice *i2c_dev = NULL;
   HardwareSerial *ser_dev = NULL;
+
+  // I2C device lives inside this object (placement-constructed, no heap)
+  alignas(Adafruit_I2CDevice) uint8_t _i2cStorage[sizeof(Adafruit_I2CDevice)];
 };
 
 #endif
@@ -2,6 +2,49 @@
 
 // #define DEBUG_SERIAL Serial
 
+#ifdef I2C_FAULT_INJECTION
+Adafruit_I2CInterceptor *Adafruit_I2CDevice::_interceptor = nullptr;
+
+/*!
+ *    @brief  Route every transaction of every device through an interceptor
+ *    @param  interceptor The hook, nullptr to talk to the bus directly
+ */
+void Adafruit_I2CDevice::setInterceptor(Adafruit_I2CInterceptor *interceptor) {
+  _interceptor = interceptor;
+}
+
+#endif
+
+#ifdef I2C_TRACE
+Adafruit_I2CInterceptor *Adafruit_I2CDevice::_tap = nullptr;
+
+/*!
+ *    @brief  Route every transaction through a tap outside the interceptor:
+ *            it sees exactly what the driver sees (recording) or supplies
+ *            it (replay)
+ *    @param  tap The hook, nullptr to disable
+ */
+void Adafruit_I2CDevice::setTap(Adafruit_I2CInterceptor *tap) { _tap = tap; }
+#endif
+
+#if defined(I2C_FAULT_INJECTION) || defined(I2C_TRACE)
+/*!
+ *    @brief  Tell the hooks that the chip was reset by its driver
+ */
+void Adafruit_I2CDevice::notifyReset(void) {
+#ifdef I2C_TRACE
+  if (_tap != nullptr) {
+    _tap->deviceReset(this);
+  }
+#endif
+#ifdef I2C_FAULT_INJECTION
+  if (_interceptor != nullptr) {
+    _interceptor->deviceReset(this);
+  }
+#endif
+}
+#endif
+
 /*!
  *    @brief  Create an I2C device at a given address
  *    @param  addr The 7-bit I2C address for the device
@@ -11,9 +54,15 @@ Adafruit_I2CDevice::Adafruit_I2CDevice(uint8_t addr, TwoWire *theWire) {
   _addr = addr;
   _wire = theWire;
   _begun = false;
+#ifdef I2C_FAULT_INJECTION
+  _passThrough = false;
+#endif
+#ifdef I2C_TRACE
+  _inTap = false;
+#endif
 #ifdef ARDUINO_ARCH_SAMD
   _maxBufferSize = 250; // as defined in Wire.h's RingBuffer
-#elif defined(ESP32)
+#elif defined(ESP32) || defined(HOST_BUILD)
   _maxBufferSize = I2C_BUFFER_LENGTH;
 #else
   _maxBufferSize = 32;
@@ -65,6 +114,11 @@ bool Adafruit_I2CDevice::detected(void) {
     return false;
   }
 
+#ifdef I2C_TRACE
+  // The address probe is a zero-length write: the hooks see it too
+  return write(nullptr, 0);
+#endif
+
   // A basic scanner, see if it ACK's
   _wire->beginTransmission(_addr);
 #ifdef DEBUG_SERIAL
@@ -102,6 +156,23 @@ bool Adafruit_I2CDevice::detected(void) {
 bool Adafruit_I2CDevice::write(const uint8_t *buffer, size_t len, bool stop,
                                const uint8_t *prefix_buffer,
                                size_t prefix_len) {
+#ifdef I2C_TRACE
+  if (_tap != nullptr && !_inTap) {
+    _inTap = true;
+    bool ok = _tap->write(this, buffer, len, stop, prefix_buffer, prefix_len);
+    _inTap = false;
+    return ok;
+  }
+#endif
+#ifdef I2C_FAULT_INJECTION
+  if (_interceptor != nullptr && !_passThrough) {
+    _passThrough = true;
+    bool ok = _interceptor->write(this, buffer, len, stop, prefix_buffer,
+                                  prefix_len);
+    _passThrough = false;
+    return ok;
+  }
+#endif
   if ((len + prefix_len) > maxBufferSize()) {
     // currently not guaranteed to work if more than 32 bytes!
     // we will need to find out if some platforms have larger
@@ -181,6 +252,22 @@ bool Adafruit_I2CDevice::write(const uint8_t *buffer, size_t len, bool stop,
  *    @return True if read was successful, otherwise false.
  */
 bool Adafruit_I2CDevice::read(uint8_t *buffer, size_t len, bool stop) {
+#ifdef I2C_TRACE
+  if (_tap != nullptr && !_inTap) {
+    _inTap = true;
+    bool ok = _tap->read(this, buffer, len, stop);
+    _inTap = false;
+    return ok;
+  }
+#endif
+#ifdef I2C_FAULT_INJECTION
+  if (_interceptor != nullptr && !_passThrough) {
+    _passThrough = true;
+    bool ok = _interceptor->read(this, buffer, len, stop);
+    _passThrough = false;
+    return ok;
+  }
+#endif
   size_t pos = 0;
   while (pos < len) {
     size_t read_len =
@@ -4,6 +4,26 @@
 #include <Arduino.h>
 #include <Wire.h>
 
+#if defined(I2C_FAULT_INJECTION) || defined(I2C_TRACE)
+class Adafruit_I2CDevice;
+
+///< Hook wrapped around every I2C transaction (fault injection and trace
+///< builds only)
+class Adafruit_I2CInterceptor {
+public:
+  virtual ~Adafruit_I2CInterceptor() {}
+  /// Replaces the transaction; calling dev->write()/read() again passes it
+  /// through to the bus
+  virtual bool write(Adafruit_I2CDevice *dev, const uint8_t *buffer,
+                     size_t len, bool stop, const uint8_t *prefix_buffer,
+                     size_t prefix_len) = 0;
+  virtual bool read(Adafruit_I2CDevice *dev, uint8_t *buffer, size_t len,
+                    bool stop) = 0;
+  /// The chip behind dev was reset through its reset line
+  virtual void deviceReset(Adafruit_I2CDevice *) {}
+};
+#endif
+
 ///< The class which defines how we will talk to this device over I2C
 class Adafruit_I2CDevice {
 public:
@@ -25,7 +45,25 @@ public:
    *    @return The size of the Wire receive/transmit buffer */
   size_t maxBufferSize() { return _maxBufferSize; }
 
+#ifdef I2C_FAULT_INJECTION
+  static void setInterceptor(Adafruit_I2CInterceptor *interceptor);
+#endif
+#ifdef I2C_TRACE
+  static void setTap(Adafruit_I2CInterceptor *tap);
+#endif
+#if defined(I2C_FAULT_INJECTION) || defined(I2C_TRACE)
+  void notifyReset(void);
+#endif
+
 private:
+#ifdef I2C_FAULT_INJECTION
+  static Adafruit_I2CInterceptor *_interceptor;
+  bool _passThrough;
+#endif
+#ifdef I2C_TRACE
+  static Adafruit_I2CInterceptor *_tap;
+  bool _inTap;
+#endif
   uint8_t _addr;
   TwoWire *_wire;
   bool _begun;
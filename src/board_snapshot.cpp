@@ -0,0 +1,154 @@
+#include "board_snapshot.h"
+#include "crc32.h"
+
+static const uint32_t SNAPSHOT_MAGIC = 0x53424652;  // "RFBS"
+static const uint16_t SNAPSHOT_VERSION = 1;
+static const char* SNAPSHOT_NAMESPACE = "rfid_board";
+static const char* SNAPSHOT_KEY = "snapshot";
+
+BoardSnapshotStore::BoardSnapshotStore() {
+    storageOpen = false;
+    
+    dirty = false;
+    lastChangeTime = 0;
+    lastWriteTime = 0;
+    hasWritten = false;
+    lastWrittenCrc = 0;
+    sequence = 0;
+    
+    writes = 0;
+    skippedUnchanged = 0;
+    writeFailures = 0;
+}
+
+bool BoardSnapshotStore::begin() {
+    if (!storageOpen) {
+        storageOpen = preferences.begin(SNAPSHOT_NAMESPACE, false);
+        if (!storageOpen) {
+            DEBUG_PRINTLN("BoardSnapshot: ОШИБКА - NVS недоступна");
+        }
+    }
+    return storageOpen;
+}
+
+bool BoardSnapshotStore::load(BoardSnapshot& snapshot) {
+    if (!begin()) {
+        return false;
+    }
+    
+    if (preferences.getBytesLength(SNAPSHOT_KEY) != sizeof(BoardSnapshot)) {
+        return false;
+    }
+    
+    preferences.getBytes(SNAPSHOT_KEY, &snapshot, sizeof(BoardSnapshot));
+    
+    if (snapshot.magic != SNAPSHOT_MAGIC || snapshot.version != SNAPSHOT_VERSION ||
+        snapshot.rows != MATRIX_ROWS || snapshot.cols != MATRIX_COLS) {
+        DEBUG_PRINTLN("BoardSnapshot: Снимок другого формата - игнорируем");
+        return false;
+    }
+    
+    if (computeCrc(snapshot) != snapshot.crc) {
+        DEBUG_PRINTLN("BoardSnapshot: CRC снимка не совпадает - игнорируем");
+        return false;
+    }
+    
+    // Следующая запись продолжает нумерацию и не повторяет тот же снимок
+    sequence = snapshot.sequence;
+    lastWrittenCrc = snapshot.crc;
+    hasWritten = true;
+    return true;
+}
+
+void BoardSnapshotStore::markDirty() {
+    dirty = true;
+    lastChangeTime = millis();
+}
+
+bool BoardSnapshotStore::update(const CardInfo* cache) {
+    if (!dirty) {
+        return false;
+    }
+    
+    unsigned long now = millis();
+    
+    // Доска еще меняется - ждем затишья
+    if (now - lastChangeTime < SNAPSHOT_DEBOUNCE_MS) {
+        return false;
+    }
+    
+    // Ограничение частоты записи
+    if (hasWritten && now - lastWriteTime < SNAPSHOT_MIN_WRITE_INTERVAL_MS) {
+        return false;
+    }
+    
+    return flush(cache);
+}
+
+bool BoardSnapshotStore::flush(const CardInfo* cache) {
+    if (!begin()) {
+        writeFailures++;
+        return false;
+    }
+    
+    BoardSnapshot snapshot;
+    buildSnapshot(cache, snapshot);
+    
+    // Содержимое не изменилось (например, фигуру вернули на место)
+    if (hasWritten && snapshot.crc == lastWrittenCrc) {
+        skippedUnchanged++;
+        dirty = false;
+        return false;
+    }
+    
+    snapshot.sequence = sequence + 1;
+    
+    if (preferences.putBytes(SNAPSHOT_KEY, &snapshot, sizeof(snapshot)) != sizeof(snapshot)) {
+        writeFailures++;
+        DEBUG_PRINTLN("BoardSnapshot: ОШИБКА записи снимка");
+        return false;
+    }
+    
+    sequence = snapshot.sequence;
+    lastWrittenCrc = snapshot.crc;
+    lastWriteTime = millis();
+    hasWritten = true;
+    dirty = false;
+    writes++;
+    
+    DEBUG_PRINTF("BoardSnapshot: Снимок #%lu сохранен\n", sequence);
+    return true;
+}
+
+void BoardSnapshotStore::erase() {
+    if (begin()) {
+        preferences.remove(SNAPSHOT_KEY);
+    }
+    hasWritten = false;
+    lastWrittenCrc = 0;
+}
+
+void BoardSnapshotStore::buildSnapshot(const CardInfo* cache, BoardSnapshot& snapshot) const {
+    memset(&snapshot, 0, sizeof(snapshot));
+    snapshot.magic = SNAPSHOT_MAGIC;
+    snapshot.version = SNAPSHOT_VERSION;
+    snapshot.rows = MATRIX_ROWS;
+    snapshot.cols = MATRIX_COLS;
+    
+    for (int i = 0; i < MATRIX_TOTAL_CELLS; i++) {
+        if (cache[i].present) {
+            snapshot.uidLength[i] = cache[i].uidLength;
+            memcpy(snapshot.uid[i], cache[i].uid, cache[i].uidLength);
+        }
+    }
+    
+    // CRC считается по содержимому, без номера записи
+    snapshot.crc = computeCrc(snapshot);
+}
+
+uint32_t BoardSnapshotStore::computeCrc(const BoardSnapshot& snapshot) {
+    // CRC-32 по занятости и UID
+    uint32_t crc = crc32Update(0xFFFFFFFF, snapshot.uidLength, sizeof(snapshot.uidLength));
+    crc = crc32Update(crc, &snapshot.uid[0][0], sizeof(snapshot.uid));
+    return ~crc;
+}
@@ -0,0 +1,70 @@
+#ifndef BOARD_SNAPSHOT_H
+#define BOARD_SNAPSHOT_H
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include "config.h"
+
+// Снимок доски в NVS: занятость и UID всех ячеек
+struct BoardSnapshot {
+    uint32_t magic;
+    uint16_t version;
+    uint8_t rows;
+    uint8_t cols;
+    uint32_t sequence;                                  // Номер записи
+    uint8_t uidLength[MATRIX_TOTAL_CELLS];              // 0 = ячейка пуста
+    uint8_t uid[MATRIX_TOTAL_CELLS][UID_BUFFER_SIZE];
+    uint32_t crc;
+};
+
+// Хранилище снимка с отложенной записью: пишем только после затишья
+// SNAPSHOT_DEBOUNCE_MS, не чаще SNAPSHOT_MIN_WRITE_INTERVAL_MS и только
+// если содержимое действительно изменилось (бережем ресурс flash)
+class BoardSnapshotStore {
+private:
+    Preferences preferences;
+    bool storageOpen;
+
+    bool dirty;
+    unsigned long lastChangeTime;
+    unsigned long lastWriteTime;
+    bool hasWritten;
+    uint32_t lastWrittenCrc;
+    uint32_t sequence;
+
+    // Статистика
+    uint32_t writes;
+    uint32_t skippedUnchanged;
+    uint32_t writeFailures;
+
+public:
+    BoardSnapshotStore();
+
+    bool begin();
+
+    // Загрузка и проверка снимка (магия, версия, геометрия, CRC)
+    bool load(BoardSnapshot& snapshot);
+
+    // Сообщить об изменении доски
+    void markDirty();
+
+    // Отложенная запись; вызывается из цикла сканирования
+    bool update(const CardInfo* cache);
+
+    // Немедленная запись (например, перед плановой перезагрузкой)
+    bool flush(const CardInfo* cache);
+
+    void erase();
+
+    // Статистика
+    bool isDirty() const { return dirty; }
+    uint32_t getWrites() const { return writes; }
+    uint32_t getSkippedUnchanged() const { return skippedUnchanged; }
+    uint32_t getWriteFailures() const { return writeFailures; }
+
+private:
+    void buildSnapshot(const CardInfo* cache, BoardSnapshot& snapshot) const;
+    static uint32_t computeCrc(const BoardSnapshot& snapshot);
+};
+
+#endif // BOARD_SNAPSHOT_H
@@ -0,0 +1,134 @@
+#include "card_events.h"
+
+CardEventTracker::CardEventTracker() {
+    provisionalEnabled = ENABLE_PROVISIONAL_EVENTS;
+    callback = nullptr;
+    callbackContext = nullptr;
+    nextId = 1;
+    memset(&pending, 0, sizeof(pending));
+    pendingStartUs = 0;
+    resetStatistics();
+}
+
+void CardEventTracker::resetStatistics() {
+    provisionalCount = 0;
+    confirmedCount = 0;
+    retractedCount = 0;
+    directCount = 0;
+    totalConfirmUs = 0;
+    maxConfirmUs = 0;
+    totalRetractUs = 0;
+}
+
+void CardEventTracker::setCallback(CardEventCallback onEvent, void* context) {
+    callback = onEvent;
+    callbackContext = context;
+}
+
+void CardEventTracker::setProvisionalEnabled(bool enabled) {
+    if (!enabled && pending.id != 0) {
+        resolvePending(CARD_EVENT_RETRACTED);
+    }
+    provisionalEnabled = enabled;
+}
+
+void CardEventTracker::fill(CardEvent& event, int cellIndex, CardEventKind kind,
+                            const uint8_t* uid, uint8_t uidLength) {
+    event.id = nextId++;
+    if (nextId == 0) {
+        nextId = 1;     // 0 - признак "нет события"
+    }
+    event.kind = kind;
+    event.cellIndex = cellIndex;
+    event.uidLength = min(uidLength, (uint8_t)UID_BUFFER_SIZE);
+    memset(event.uid, 0, sizeof(event.uid));
+    if (uid != nullptr) {
+        memcpy(event.uid, uid, event.uidLength);
+    }
+}
+
+void CardEventTracker::provisional(int cellIndex, CardEventKind kind, const uint8_t* uid, uint8_t uidLength) {
+    if (!provisionalEnabled) {
+        return;
+    }
+    if (pending.id != 0) {
+        // Прежняя ячейка так и не дождалась решения (сбой связи посреди фильтра)
+        resolvePending(CARD_EVENT_RETRACTED);
+    }
+
+    fill(pending, cellIndex, kind, uid, uidLength);
+    pending.tier = CARD_EVENT_PROVISIONAL;
+    pending.provisionalTime = millis();
+    pending.decidedTime = 0;
+    pendingStartUs = micros();
+    provisionalCount++;
+    emit(pending);
+}
+
+unsigned long CardEventTracker::commit(int cellIndex, CardEventKind kind, const uint8_t* uid, uint8_t uidLength) {
+    if (pending.id != 0 && pending.cellIndex == cellIndex) {
+        bool sameCard = kind == CARD_EVENT_REMOVED ||
+                        (pending.uidLength == uidLength && memcmp(pending.uid, uid, uidLength) == 0);
+        if (pending.kind == kind && sameCard) {
+            unsigned long firstSeen = pending.provisionalTime;
+            resolvePending(CARD_EVENT_CONFIRMED);
+            return firstSeen;
+        }
+        // Фильтр решил иначе, чем показало первое чтение
+        resolvePending(CARD_EVENT_RETRACTED);
+    }
+
+    CardEvent event;
+    fill(event, cellIndex, kind, uid, uidLength);
+    event.tier = CARD_EVENT_CONFIRMED;
+    event.decidedTime = millis();
+    event.provisionalTime = event.decidedTime;
+    directCount++;
+    emit(event);
+    return event.provisionalTime;
+}
+
+void CardEventTracker::settle(int cellIndex) {
+    if (pending.id != 0 && pending.cellIndex == cellIndex) {
+        resolvePending(CARD_EVENT_RETRACTED);
+    }
+}
+
+void CardEventTracker::resolvePending(CardEventTier tier) {
+    unsigned long latencyUs = micros() - pendingStartUs;
+
+    pending.tier = tier;
+    pending.decidedTime = millis();
+    if (tier == CARD_EVENT_CONFIRMED) {
+        confirmedCount++;
+        totalConfirmUs += latencyUs;
+        if (latencyUs > maxConfirmUs) {
+            maxConfirmUs = latencyUs;
+        }
+    } else {
+        retractedCount++;
+        totalRetractUs += latencyUs;
+    }
+    emit(pending);
+    pending.id = 0;
+}
+
+void CardEventTracker::emit(const CardEvent& event) {
+    if (callback != nullptr) {
+        callback(event, callbackContext);
+    }
+}
+
+float CardEventTracker::getRetractionRate() const {
+    uint32_t decided = confirmedCount + retractedCount;
+    return decided ? (float)retractedCount / decided * 100.0 : 0.0;
+}
+
+void CardEventTracker::printStatus() const {
+    DEBUG_PRINTF("События карт: предварительных=%lu (%s), подтверждено=%lu, отозвано=%lu (%.1f%%), "
+                 "без фильтра=%lu\n",
+                 provisionalCount, provisionalEnabled ? "ВКЛ" : "ВЫКЛ", confirmedCount, retractedCount,
+                 getRetractionRate(), directCount);
+    DEBUG_PRINTF("  до подтверждения: среднее %lu мкс, макс %lu мкс; до отзыва: среднее %lu мкс\n",
+                 getMeanConfirmUs(), maxConfirmUs, getMeanRetractUs());
+}
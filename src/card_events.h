@@ -0,0 +1,88 @@
+#ifndef CARD_EVENTS_H
+#define CARD_EVENTS_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// Уровень события карты
+enum CardEventTier {
+    CARD_EVENT_PROVISIONAL,     // Первое отличающееся чтение, фильтр еще решает
+    CARD_EVENT_CONFIRMED,       // Изменение записано в кэш
+    CARD_EVENT_RETRACTED        // Фильтр отверг предварительное событие
+};
+
+enum CardEventKind {
+    CARD_EVENT_ADDED,
+    CARD_EVENT_REMOVED,
+    CARD_EVENT_REPLACED
+};
+
+struct CardEvent {
+    uint32_t id;                    // Общий у предварительного и его решения
+    CardEventTier tier;
+    CardEventKind kind;
+    int cellIndex;
+    uint8_t uid[UID_BUFFER_SIZE];   // Новая карта (снятая - для REMOVED)
+    uint8_t uidLength;
+    unsigned long provisionalTime;  // millis() первого отличающегося чтения
+    unsigned long decidedTime;      // millis() решения, 0 у предварительного
+};
+
+typedef void (*CardEventCallback)(const CardEvent& event, void* context);
+
+// Двухуровневые события карт. Повторы и контрольное чтение ScanMatrix стоят
+// десятков миллисекунд до записи изменения в кэш - предварительное событие
+// уходит сразу, подтверждение или отзыв с тем же id - после решения фильтра.
+// Изменение без фильтра сразу подтверждено (provisionalTime == decidedTime).
+// Фильтр решает за одно сканирование ячейки - ожидающее событие одно
+class CardEventTracker {
+private:
+    bool provisionalEnabled;
+    CardEventCallback callback;
+    void* callbackContext;
+    uint32_t nextId;
+
+    CardEvent pending;              // id 0 = нет ожидающего
+    unsigned long pendingStartUs;
+
+    // Статистика для настройки порогов фильтра
+    uint32_t provisionalCount;
+    uint32_t confirmedCount;        // ...подтверждено
+    uint32_t retractedCount;        // ...отозвано
+    uint32_t directCount;           // Подтверждено без предварительного
+    unsigned long totalConfirmUs;   // От предварительного до подтверждения
+    unsigned long maxConfirmUs;
+    unsigned long totalRetractUs;
+
+public:
+    CardEventTracker();
+
+    void setCallback(CardEventCallback onEvent, void* context);
+    void setProvisionalEnabled(bool enabled);
+    bool getProvisionalEnabled() const { return provisionalEnabled; }
+
+    // Первое чтение, отличающееся от кэша, перед повторами/контрольным чтением
+    void provisional(int cellIndex, CardEventKind kind, const uint8_t* uid, uint8_t uidLength);
+    // Изменение записано в кэш. Возвращает millis() первого чтения, показавшего изменение
+    unsigned long commit(int cellIndex, CardEventKind kind, const uint8_t* uid, uint8_t uidLength);
+    // Сканирование ячейки закончено: не подтвержденное событие отзывается
+    void settle(int cellIndex);
+
+    uint32_t getProvisionalCount() const { return provisionalCount; }
+    uint32_t getConfirmedCount() const { return confirmedCount; }
+    uint32_t getRetractedCount() const { return retractedCount; }
+    uint32_t getDirectCount() const { return directCount; }
+    float getRetractionRate() const;
+    unsigned long getMeanConfirmUs() const { return confirmedCount ? totalConfirmUs / confirmedCount : 0; }
+    unsigned long getMaxConfirmUs() const { return maxConfirmUs; }
+    unsigned long getMeanRetractUs() const { return retractedCount ? totalRetractUs / retractedCount : 0; }
+    void printStatus() const;
+    void resetStatistics();
+
+private:
+    void fill(CardEvent& event, int cellIndex, CardEventKind kind, const uint8_t* uid, uint8_t uidLength);
+    void resolvePending(CardEventTier tier);
+    void emit(const CardEvent& event);
+};
+
+#endif // CARD_EVENTS_H
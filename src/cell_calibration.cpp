@@ -0,0 +1,383 @@
+#include "cell_calibration.h"
+#include "crc32.h"
+
+static const uint32_t CALIBRATION_MAGIC = 0x4C414352;  // "RCAL"
+static const uint16_t CALIBRATION_VERSION = 1;
+static const char* CALIBRATION_NAMESPACE = "rfid_calib";
+static const char* CALIBRATION_KEY = "profiles";
+
+// Сколько неудач окно может себе позволить, не опускаясь ниже цели
+static uint16_t allowedFailures(uint16_t window) {
+    return (uint16_t)((uint32_t)window * (100 - CALIBRATION_TARGET_SUCCESS_PCT) / 100);
+}
+
+CellCalibrator::CellCalibrator() {
+    storageOpen = false;
+    dirty = false;
+    lastSaveTime = 0;
+    lastRelearnTime = 0;
+    lastSavedCrc = 0;
+
+    tightened = 0;
+    relaxed = 0;
+    totalMisses = 0;
+    totalCrosstalk = 0;
+    saves = 0;
+
+    rfProfilesEnabled = ENABLE_RF_PROFILES;
+    rfProfileChanges = 0;
+    memset(rfReads, 0, sizeof(rfReads));
+    memset(rfMisses, 0, sizeof(rfMisses));
+
+    reset();
+    dirty = false;
+}
+
+CellTimingProfile CellCalibrator::defaultProfile() {
+    CellTimingProfile profile;
+    profile.settleUs = CALIBRATION_MAX_SETTLE_US;
+    profile.failedSettleUs = 0;
+    profile.timeoutMs = PN532_TIMEOUT_MS;
+    profile.retries = 0;
+    profile.calibrated = 0;
+    profile.rfProfile = 0;
+    return profile;
+}
+
+uint8_t CellCalibrator::getRfProfile(int cellIndex) const {
+    return rfProfilesEnabled ? profiles[cellIndex].rfProfile : 0;
+}
+
+bool CellCalibrator::begin() {
+    if (!storageOpen) {
+        storageOpen = preferences.begin(CALIBRATION_NAMESPACE, false);
+        if (!storageOpen) {
+            DEBUG_PRINTLN("CellCalibrator: ОШИБКА - NVS недоступна, профили не сохраняются");
+            return false;
+        }
+    }
+
+    if (preferences.getBytesLength(CALIBRATION_KEY) != sizeof(CalibrationRecord)) {
+        DEBUG_PRINTLN("CellCalibrator: Профилей нет - консервативные тайминги");
+        return false;
+    }
+
+    CalibrationRecord record;
+    preferences.getBytes(CALIBRATION_KEY, &record, sizeof(record));
+
+    if (record.magic != CALIBRATION_MAGIC || record.version != CALIBRATION_VERSION ||
+        record.rows != MATRIX_ROWS || record.cols != MATRIX_COLS ||
+        computeCrc(record) != record.crc) {
+        DEBUG_PRINTLN("CellCalibrator: Профили повреждены или другого формата - игнорируем");
+        return false;
+    }
+
+    memcpy(profiles, record.profiles, sizeof(profiles));
+    lastSavedCrc = record.crc;
+    for (int i = 0; i < MATRIX_TOTAL_CELLS; i++) {
+        // Запись прошивки с другим числом профилей RF
+        if (profiles[i].rfProfile >= RF_PROFILE_COUNT) {
+            profiles[i].rfProfile = 0;
+        }
+    }
+
+    DEBUG_PRINTF("CellCalibrator: Загружено профилей: %d из %d\n",
+                 getCalibratedCount(), MATRIX_TOTAL_CELLS);
+    return true;
+}
+
+void CellCalibrator::recordRead(int cellIndex, CellReadOutcome outcome, unsigned long latencyUs) {
+    if (!ENABLE_CELL_CALIBRATION || cellIndex < 0 || cellIndex >= MATRIX_TOTAL_CELLS) {
+        return;
+    }
+
+    CellReadStats& s = stats[cellIndex];
+    uint8_t rf = getRfProfile(cellIndex);
+    s.reads++;
+    rfReads[rf]++;
+    if (latencyUs > s.maxLatencyUs) {
+        s.maxLatencyUs = latencyUs;
+    }
+    if (outcome == READ_OUTCOME_MISSED) {
+        s.misses++;
+        totalMisses++;
+        rfMisses[rf]++;
+    }
+
+    // Решение - по заполнении окна или как только окно уже не может уложиться в цель
+    if (s.reads >= CALIBRATION_WINDOW_READS || s.misses > allowedFailures(CALIBRATION_WINDOW_READS)) {
+        learnTiming(cellIndex);
+    }
+}
+
+void CellCalibrator::recordSettle(int cellIndex, bool crosstalk) {
+    if (!ENABLE_CELL_CALIBRATION || cellIndex < 0 || cellIndex >= MATRIX_TOTAL_CELLS ||
+        !profiles[cellIndex].calibrated) {
+        return;
+    }
+
+    CellReadStats& s = stats[cellIndex];
+    s.settleSamples++;
+    if (crosstalk) {
+        s.crosstalk++;
+        totalCrosstalk++;
+    }
+
+    if (s.settleSamples >= CALIBRATION_SETTLE_WINDOW ||
+        s.crosstalk > allowedFailures(CALIBRATION_SETTLE_WINDOW)) {
+        learnSettle(cellIndex);
+    }
+}
+
+bool CellCalibrator::isSettleLearned(int cellIndex) const {
+    const CellTimingProfile& p = profiles[cellIndex];
+    if (!p.calibrated) {
+        return false;
+    }
+    // Тот же шаг, что в learnSettle()
+    uint16_t next = max((uint16_t)(p.settleUs / 4), (uint16_t)CALIBRATION_MIN_SETTLE_US);
+    return next >= p.settleUs || next <= p.failedSettleUs;
+}
+
+void CellCalibrator::learnTiming(int cellIndex) {
+    CellReadStats& s = stats[cellIndex];
+    CellTimingProfile& p = profiles[cellIndex];
+    CellTimingProfile before = p;
+
+    uint8_t needed = timeoutForLatency(s.maxLatencyUs);
+
+    if (p.calibrated) {
+        s.rfTried |= 1 << p.rfProfile;
+        s.rfMissPct[p.rfProfile] = (uint8_t)((uint32_t)s.misses * 100 / s.reads);
+    }
+
+    if (s.misses <= allowedFailures(s.reads)) {
+        calibrate(cellIndex);
+
+        // Рост задержки принимаем сразу, сокращение - на половину разрыва за окно
+        if (needed >= p.timeoutMs) {
+            p.timeoutMs = needed;
+        } else {
+            p.timeoutMs -= (p.timeoutMs - needed + 1) / 2;
+        }
+        if (s.misses == 0 && p.retries > 0) {
+            p.retries--;
+        }
+        tightened++;
+    } else if (switchRfProfile(cellIndex)) {
+        relaxed++;
+        DEBUG_PRINTF("CellCalibrator: Ячейка %d - пропуски, профиль RF %d\n", cellIndex, p.rfProfile);
+    } else {
+        uint16_t grown = p.timeoutMs + p.timeoutMs / 2;
+        p.timeoutMs = constrain(max((uint16_t)needed, grown),
+                                (uint16_t)CALIBRATION_MIN_TIMEOUT_MS, (uint16_t)CALIBRATION_MAX_TIMEOUT_MS);
+        if (p.retries < CALIBRATION_MAX_RETRIES) {
+            p.retries++;
+        }
+        relaxed++;
+        DEBUG_PRINTF("CellCalibrator: Ячейка %d - пропуски, таймаут %d мс, повторов %d\n",
+                     cellIndex, p.timeoutMs, p.retries);
+    }
+
+    s.reads = 0;
+    s.misses = 0;
+    s.maxLatencyUs = 0;
+
+    if (memcmp(&before, &p, sizeof(p)) != 0) {
+        dirty = true;
+    }
+}
+
+void CellCalibrator::learnSettle(int cellIndex) {
+    CellReadStats& s = stats[cellIndex];
+    CellTimingProfile& p = profiles[cellIndex];
+    CellTimingProfile before = p;
+
+    if (s.crosstalk <= allowedFailures(s.settleSamples)) {
+        // Пробуем вчетверо короче (образцы редки - только после занятой ячейки),
+        // но не до значения, уже давшего перекрестное чтение
+        uint16_t next = max((uint16_t)(p.settleUs / 4), (uint16_t)CALIBRATION_MIN_SETTLE_US);
+        if (next > p.failedSettleUs) {
+            p.settleUs = next;
+        }
+    } else {
+        if (p.settleUs > p.failedSettleUs) {
+            p.failedSettleUs = p.settleUs;
+        }
+        p.settleUs = min((unsigned long)p.settleUs * 2, (unsigned long)CALIBRATION_MAX_SETTLE_US);
+        DEBUG_PRINTF("CellCalibrator: Ячейка %d - перекрестное чтение, пауза %u мкс\n",
+                     cellIndex, p.settleUs);
+    }
+
+    s.settleSamples = 0;
+    s.crosstalk = 0;
+
+    if (memcmp(&before, &p, sizeof(p)) != 0) {
+        dirty = true;
+    }
+}
+
+bool CellCalibrator::switchRfProfile(int cellIndex) {
+    if (!rfProfilesEnabled) {
+        return false;
+    }
+
+    CellReadStats& s = stats[cellIndex];
+    CellTimingProfile& p = profiles[cellIndex];
+
+    // Соседний профиль, которого ячейка еще не пробовала: сначала сильнее
+    int candidates[2] = {p.rfProfile + 1, p.rfProfile - 1};
+    for (int i = 0; i < 2; i++) {
+        int c = candidates[i];
+        if (c >= 0 && c < RF_PROFILE_COUNT && !(s.rfTried & (1 << c))) {
+            p.rfProfile = (uint8_t)c;
+            rfProfileChanges++;
+            return true;
+        }
+    }
+
+    // Испробованы все - лучший по пропускам; если это текущий, менять нечего
+    uint8_t best = p.rfProfile;
+    for (uint8_t i = 0; i < RF_PROFILE_COUNT; i++) {
+        if ((s.rfTried & (1 << i)) && s.rfMissPct[i] < s.rfMissPct[best]) {
+            best = i;
+        }
+    }
+    if (best == p.rfProfile) {
+        return false;
+    }
+    p.rfProfile = best;
+    rfProfileChanges++;
+    return true;
+}
+
+void CellCalibrator::calibrate(int cellIndex) {
+    CellTimingProfile& p = profiles[cellIndex];
+    if (p.calibrated) {
+        return;
+    }
+
+    // Обучение паузы начинается с консервативного значения
+    p.calibrated = 1;
+    p.settleUs = CALIBRATION_MAX_SETTLE_US;
+    p.failedSettleUs = 0;
+}
+
+uint8_t CellCalibrator::timeoutForLatency(unsigned long latencyUs) {
+    unsigned long withMargin = latencyUs * (100 + CALIBRATION_TIMEOUT_MARGIN_PCT) / 100;
+    unsigned long ms = (withMargin + 999) / 1000;
+    return (uint8_t)constrain(ms, (unsigned long)CALIBRATION_MIN_TIMEOUT_MS,
+                              (unsigned long)CALIBRATION_MAX_TIMEOUT_MS);
+}
+
+void CellCalibrator::update() {
+    if (!ENABLE_CELL_CALIBRATION) {
+        return;
+    }
+
+    unsigned long now = millis();
+
+    // Условия дрейфуют (температура, питание): снова разрешаем пробовать паузы
+    // и профили RF, отвергнутые раньше. Таймауты переучиваются каждым окном и так
+    if (now - lastRelearnTime >= CALIBRATION_RELEARN_INTERVAL_MS) {
+        lastRelearnTime = now;
+        for (int i = 0; i < MATRIX_TOTAL_CELLS; i++) {
+            profiles[i].failedSettleUs = 0;
+            stats[i].rfTried = 0;
+        }
+    }
+
+    if (dirty && now - lastSaveTime >= CALIBRATION_SAVE_INTERVAL_MS) {
+        save();
+    }
+}
+
+bool CellCalibrator::save() {
+    lastSaveTime = millis();
+
+    if (!storageOpen) {
+        return false;
+    }
+
+    CalibrationRecord record;
+    memset(&record, 0, sizeof(record));
+    record.magic = CALIBRATION_MAGIC;
+    record.version = CALIBRATION_VERSION;
+    record.rows = MATRIX_ROWS;
+    record.cols = MATRIX_COLS;
+    memcpy(record.profiles, profiles, sizeof(profiles));
+    record.crc = computeCrc(record);
+
+    dirty = false;
+
+    if (record.crc == lastSavedCrc) {
+        return true;
+    }
+
+    if (preferences.putBytes(CALIBRATION_KEY, &record, sizeof(record)) != sizeof(record)) {
+        DEBUG_PRINTLN("CellCalibrator: ОШИБКА записи профилей");
+        return false;
+    }
+
+    lastSavedCrc = record.crc;
+    saves++;
+    return true;
+}
+
+void CellCalibrator::reset() {
+    for (int i = 0; i < MATRIX_TOTAL_CELLS; i++) {
+        profiles[i] = defaultProfile();
+    }
+    memset(stats, 0, sizeof(stats));
+    dirty = true;
+}
+
+int CellCalibrator::getCalibratedCount() const {
+    int count = 0;
+    for (int i = 0; i < MATRIX_TOTAL_CELLS; i++) {
+        if (profiles[i].calibrated) {
+            count++;
+        }
+    }
+    return count;
+}
+
+float CellCalibrator::getRfHitRate(uint8_t profile) const {
+    if (profile >= RF_PROFILE_COUNT || rfReads[profile] == 0) return 0.0;
+    return (float)(rfReads[profile] - rfMisses[profile]) / rfReads[profile] * 100.0;
+}
+
+int CellCalibrator::getRfProfileCellCount(uint8_t profile) const {
+    int count = 0;
+    for (int i = 0; i < MATRIX_TOTAL_CELLS; i++) {
+        if (getRfProfile(i) == profile) {
+            count++;
+        }
+    }
+    return count;
+}
+
+unsigned long CellCalibrator::getMeanTimeoutMs() const {
+    unsigned long total = 0;
+    for (int i = 0; i < MATRIX_TOTAL_CELLS; i++) {
+        total += profiles[i].timeoutMs;
+    }
+    return total / MATRIX_TOTAL_CELLS;
+}
+
+void CellCalibrator::printStatus() const {
+    DEBUG_PRINTF("Калибровка: ячеек с профилем %d/%d, средний таймаут %lu мс\n",
+                 getCalibratedCount(), MATRIX_TOTAL_CELLS, getMeanTimeoutMs());
+    DEBUG_PRINTF("  окон: ужато=%lu, ослаблено=%lu; пропусков=%lu, перекрестных=%lu; записей=%lu\n",
+                 tightened, relaxed, totalMisses, totalCrosstalk, saves);
+    DEBUG_PRINTF("  профили RF (%s): смен=%lu\n", rfProfilesEnabled ? "вкл" : "выкл", rfProfileChanges);
+    for (uint8_t i = 0; i < RF_PROFILE_COUNT; i++) {
+        DEBUG_PRINTF("    %d: ячеек=%d, чтений=%lu, без пропуска=%.1f%%\n",
+                     i, getRfProfileCellCount(i), rfReads[i], getRfHitRate(i));
+    }
+}
+
+uint32_t CellCalibrator::computeCrc(const CalibrationRecord& record) {
+    uint32_t crc = crc32Update(0xFFFFFFFF, (const uint8_t*)record.profiles, sizeof(record.profiles));
+    return ~crc;
+}
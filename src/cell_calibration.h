@@ -0,0 +1,128 @@
+#ifndef CELL_CALIBRATION_H
+#define CELL_CALIBRATION_H
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include "config.h"
+
+// Тайминги чтения одной ячейки
+struct CellTimingProfile {
+    uint16_t settleUs;          // Пауза после переключения с занятой ячейки
+    uint16_t failedSettleUs;    // Наибольшая пауза, давшая перекрестное чтение (0 = нет)
+    uint8_t timeoutMs;          // Таймаут ответа PN532
+    uint8_t retries;            // Повторы перед контрольным чтением
+    uint8_t calibrated;         // 0 = консервативный профиль из config.h
+    uint8_t rfProfile;          // Профиль аналогового тракта PN532 (0 = штатный)
+};
+
+// Исход информативного чтения ячейки
+enum CellReadOutcome {
+    READ_OUTCOME_OK,            // Карта прочитана с профилем ячейки
+    READ_OUTCOME_MISSED         // Карта найдена только повтором или контрольным чтением
+};
+
+// Статистика текущего окна обучения ячейки
+struct CellReadStats {
+    uint16_t reads;
+    uint16_t misses;
+    uint32_t maxLatencyUs;
+    uint16_t settleSamples;     // Переключения с занятой ячейки
+    uint16_t crosstalk;         // ...после которых прочитан UID той ячейки
+    uint8_t rfTried;            // Маска испробованных профилей RF (до переобучения)
+    uint8_t rfMissPct[RF_PROFILE_COUNT];    // Доля пропусков последнего окна профиля
+};
+
+// Профили всех ячеек в NVS
+struct CalibrationRecord {
+    uint32_t magic;
+    uint16_t version;
+    uint8_t rows;
+    uint8_t cols;
+    CellTimingProfile profiles[MATRIX_TOTAL_CELLS];
+    uint32_t crc;
+};
+
+// Самокалибровка таймингов по ячейкам.
+// Таймаут - худшая задержка ответа за окно + запас; пауза переключения сокращается,
+// пока не появится перекрестное чтение, и откатывается вдвое; повторы растут при пропусках.
+// Окно с пропусками сначала пробует соседний профиль RF (сильнее, затем слабее),
+// а когда испробованы все - берет лучший; таймаут и повторы растут, только если
+// менять профиль уже не на что.
+// Ячейка без карт остается на консервативном профиле: учиться не на чем
+class CellCalibrator {
+private:
+    CellTimingProfile profiles[MATRIX_TOTAL_CELLS];
+    CellReadStats stats[MATRIX_TOTAL_CELLS];
+
+    Preferences preferences;
+    bool storageOpen;
+    bool dirty;
+    unsigned long lastSaveTime;
+    unsigned long lastRelearnTime;
+    uint32_t lastSavedCrc;
+
+    // Статистика
+    uint32_t tightened;         // Окон, после которых профиль ужат
+    uint32_t relaxed;           // Окон, после которых профиль ослаблен
+    uint32_t totalMisses;
+    uint32_t totalCrosstalk;
+    uint32_t saves;
+    
+    // Профили RF
+    bool rfProfilesEnabled;
+    uint32_t rfProfileChanges;
+    uint32_t rfReads[RF_PROFILE_COUNT];     // Чтений с картой по профилям
+    uint32_t rfMisses[RF_PROFILE_COUNT];    // ...из них с пропуском
+
+public:
+    CellCalibrator();
+
+    // Загрузка профилей из NVS
+    bool begin();
+
+    const CellTimingProfile& getProfile(int cellIndex) const { return profiles[cellIndex]; }
+    static CellTimingProfile defaultProfile();
+    
+    // Профиль RF, который применяется к ячейке (штатный, если выбор выключен)
+    uint8_t getRfProfile(int cellIndex) const;
+    void setRfProfilesEnabled(bool enabled) { rfProfilesEnabled = enabled; }
+    bool getRfProfilesEnabled() const { return rfProfilesEnabled; }
+
+    // Учет чтения с картой. latencyUs - ожидание ответа на InListPassiveTarget
+    void recordRead(int cellIndex, CellReadOutcome outcome, unsigned long latencyUs);
+
+    // Учет переключения с занятой ячейки (для обучения паузы)
+    void recordSettle(int cellIndex, bool crosstalk);
+    // Пауза обучена: короче она уже не станет (минимум или упор в перекрестное чтение)
+    bool isSettleLearned(int cellIndex) const;
+
+    // Отложенная запись и периодическое переобучение; из цикла сканирования
+    void update();
+    bool save();
+    void reset();
+
+    // Статистика
+    int getCalibratedCount() const;
+    unsigned long getMeanTimeoutMs() const;
+    uint32_t getTightened() const { return tightened; }
+    uint32_t getRelaxed() const { return relaxed; }
+    uint32_t getTotalMisses() const { return totalMisses; }
+    uint32_t getTotalCrosstalk() const { return totalCrosstalk; }
+    uint32_t getSaves() const { return saves; }
+    uint32_t getRfProfileChanges() const { return rfProfileChanges; }
+    uint32_t getRfReads(uint8_t profile) const { return rfReads[profile]; }
+    uint32_t getRfMisses(uint8_t profile) const { return rfMisses[profile]; }
+    float getRfHitRate(uint8_t profile) const;
+    int getRfProfileCellCount(uint8_t profile) const;
+    void printStatus() const;
+
+private:
+    void learnTiming(int cellIndex);
+    void learnSettle(int cellIndex);
+    bool switchRfProfile(int cellIndex);
+    void calibrate(int cellIndex);
+    static uint8_t timeoutForLatency(unsigned long latencyUs);
+    static uint32_t computeCrc(const CalibrationRecord& record);
+};
+
+#endif // CELL_CALIBRATION_H
@@ -0,0 +1,122 @@
+#include "cell_quarantine.h"
+
+CellQuarantine::CellQuarantine() {
+    enabled = ENABLE_CELL_QUARANTINE;
+    reset();
+}
+
+void CellQuarantine::reset() {
+    for (int i = 0; i < MATRIX_TOTAL_CELLS; i++) {
+        failures[i] = 0;
+        cleanReads[i] = 0;
+        quarantined[i] = false;
+    }
+    quarantinedCount = 0;
+    probeCursor = 0;
+    lastProbeTime = 0;
+    totalFailures = 0;
+    quarantineEvents = 0;
+    reinstatements = 0;
+    probes = 0;
+}
+
+void CellQuarantine::setEnabled(bool on) {
+    enabled = on;
+    if (enabled) {
+        return;
+    }
+    // Без карантина все ячейки снова в проходе
+    for (int i = 0; i < MATRIX_TOTAL_CELLS; i++) {
+        if (quarantined[i]) {
+            release(i);
+        }
+    }
+}
+
+bool CellQuarantine::recordFailure(int cellIndex) {
+    if (cellIndex < 0 || cellIndex >= MATRIX_TOTAL_CELLS) {
+        return false;
+    }
+
+    totalFailures++;
+    if (failures[cellIndex] < 255) {
+        failures[cellIndex]++;
+    }
+
+    if (quarantined[cellIndex]) {
+        // Серия чистых чтений прервана - проверка начнется заново
+        cleanReads[cellIndex] = 0;
+        return false;
+    }
+    if (!enabled || failures[cellIndex] < CELL_QUARANTINE_FAILURES) {
+        return false;
+    }
+
+    quarantined[cellIndex] = true;
+    cleanReads[cellIndex] = 0;
+    quarantinedCount++;
+    quarantineEvents++;
+    if (quarantinedCount == 1) {
+        // Первая проверка - через полный интервал
+        lastProbeTime = millis();
+    }
+    DEBUG_PRINTF("CellQuarantine: Ячейка [%d,%d] в карантине после %d ошибок подряд\n",
+                 cellIndex / MATRIX_COLS, cellIndex % MATRIX_COLS, failures[cellIndex]);
+    return true;
+}
+
+bool CellQuarantine::recordSuccess(int cellIndex) {
+    if (cellIndex < 0 || cellIndex >= MATRIX_TOTAL_CELLS) {
+        return false;
+    }
+
+    failures[cellIndex] = 0;
+    if (!quarantined[cellIndex] || ++cleanReads[cellIndex] < CELL_REINSTATE_READS) {
+        return false;
+    }
+
+    release(cellIndex);
+    reinstatements++;
+    DEBUG_PRINTF("CellQuarantine: Ячейка [%d,%d] возвращена в проход после %d чистых чтений\n",
+                 cellIndex / MATRIX_COLS, cellIndex % MATRIX_COLS, CELL_REINSTATE_READS);
+    return true;
+}
+
+void CellQuarantine::release(int cellIndex) {
+    quarantined[cellIndex] = false;
+    cleanReads[cellIndex] = 0;
+    quarantinedCount--;
+}
+
+int CellQuarantine::nextProbeCell() {
+    if (quarantinedCount == 0 || millis() - lastProbeTime < CELL_PROBE_INTERVAL_MS) {
+        return -1;
+    }
+
+    // По кругу: несколько неисправных ячеек проверяются по очереди
+    for (int i = 0; i < MATRIX_TOTAL_CELLS; i++) {
+        int cellIndex = (probeCursor + i) % MATRIX_TOTAL_CELLS;
+        if (quarantined[cellIndex]) {
+            probeCursor = (cellIndex + 1) % MATRIX_TOTAL_CELLS;
+            lastProbeTime = millis();
+            probes++;
+            return cellIndex;
+        }
+    }
+    return -1;
+}
+
+void CellQuarantine::printStatus() const {
+    DEBUG_PRINTF("Карантин ячеек: %s, в карантине %d\n", enabled ? "ВКЛ" : "ВЫКЛ", quarantinedCount);
+    if (quarantinedCount > 0) {
+        DEBUG_PRINT("  ячейки:");
+        for (int i = 0; i < MATRIX_TOTAL_CELLS; i++) {
+            if (quarantined[i]) {
+                DEBUG_PRINTF(" [%d,%d]", i / MATRIX_COLS, i % MATRIX_COLS);
+            }
+        }
+        DEBUG_PRINTLN("");
+    }
+    DEBUG_PRINTF("  ошибок ячеек=%lu, в карантин=%lu, возвращено=%lu, фоновых проверок=%lu\n",
+                 totalFailures, quarantineEvents, reinstatements, probes);
+}
@@ -0,0 +1,59 @@
+#ifndef CELL_QUARANTINE_H
+#define CELL_QUARANTINE_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// Учет ошибок по ячейкам и карантин неисправных антенн.
+// Ошибка - SCAN_ERROR при живой связи с PN532; CELL_QUARANTINE_FAILURES подряд
+// выводят ячейку из прохода. Ячейки в карантине проверяются по одной не чаще
+// CELL_PROBE_INTERVAL_MS, CELL_REINSTATE_READS чистых чтений подряд возвращают
+// ячейку в проход. Ошибки считаются и при выключенном карантине
+class CellQuarantine {
+private:
+    bool enabled;
+
+    uint8_t failures[MATRIX_TOTAL_CELLS];       // Ошибок подряд
+    uint8_t cleanReads[MATRIX_TOTAL_CELLS];     // Чистых чтений подряд в карантине
+    bool quarantined[MATRIX_TOTAL_CELLS];
+    int quarantinedCount;
+
+    int probeCursor;                            // Следующая ячейка фоновой проверки
+    unsigned long lastProbeTime;
+
+    // Статистика
+    uint32_t totalFailures;
+    uint32_t quarantineEvents;
+    uint32_t reinstatements;
+    uint32_t probes;
+
+public:
+    CellQuarantine();
+
+    void setEnabled(bool on);
+    bool isEnabled() const { return enabled; }
+
+    // Итог чтения ячейки; true - ячейка вошла в карантин или вышла из него
+    bool recordFailure(int cellIndex);
+    bool recordSuccess(int cellIndex);
+
+    uint8_t getFailures(int cellIndex) const { return failures[cellIndex]; }
+    bool isQuarantined(int cellIndex) const { return quarantined[cellIndex]; }
+    int getQuarantinedCount() const { return quarantinedCount; }
+
+    // Ячейка для фоновой проверки или -1, если проверять некого или рано
+    int nextProbeCell();
+
+    uint32_t getTotalFailures() const { return totalFailures; }
+    uint32_t getQuarantineEvents() const { return quarantineEvents; }
+    uint32_t getReinstatements() const { return reinstatements; }
+    uint32_t getProbes() const { return probes; }
+    void printStatus() const;
+
+    void reset();
+
+private:
+    void release(int cellIndex);
+};
+
+#endif // CELL_QUARANTINE_H
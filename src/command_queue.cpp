@@ -0,0 +1,173 @@
+#include "command_queue.h"
+
+CommandQueue::CommandQueue() {
+    for (int i = 0; i < COMMAND_QUEUE_SIZE; i++) {
+        slotUsed[i] = false;
+        slotSequence[i] = 0;
+    }
+    count = 0;
+    nextSequence = 0;
+
+    resetMetrics();
+}
+
+bool CommandQueue::push(const PN532Command& command) {
+    if (command.priority >= PRIORITY_COUNT) {
+        return false;
+    }
+
+    CommandClassMetrics& m = metrics[command.priority];
+    m.submitted++;
+
+    if (isFull()) {
+        m.rejected++;
+        return false;
+    }
+
+    for (int i = 0; i < COMMAND_QUEUE_SIZE; i++) {
+        if (!slotUsed[i]) {
+            slots[i] = command;
+            slotSequence[i] = nextSequence++;
+            slotUsed[i] = true;
+            count++;
+            return true;
+        }
+    }
+
+    m.rejected++;
+    return false;
+}
+
+bool CommandQueue::pop(PN532Command& command, unsigned long backgroundSlackMs) {
+    int best = -1;
+
+    for (int i = 0; i < COMMAND_QUEUE_SIZE; i++) {
+        if (!slotUsed[i]) {
+            continue;
+        }
+
+        const PN532Command& candidate = slots[i];
+
+        // Фоновая команда не должна растянуть проход сверх бюджета устаревания
+        if (candidate.priority == PRIORITY_BACKGROUND &&
+            estimateDurationMs(candidate.type) > backgroundSlackMs) {
+            continue;
+        }
+
+        if (best < 0 ||
+            candidate.priority < slots[best].priority ||
+            (candidate.priority == slots[best].priority && slotSequence[i] < slotSequence[best])) {
+            best = i;
+        }
+    }
+
+    if (best < 0) {
+        return false;
+    }
+
+    command = slots[best];
+    slotUsed[best] = false;
+    count--;
+
+    recordWait(command);
+    return true;
+}
+
+void CommandQueue::expire() {
+    if (count == 0) {
+        return;
+    }
+
+    unsigned long now = millis();
+
+    for (int i = 0; i < COMMAND_QUEUE_SIZE; i++) {
+        if (slotUsed[i] && slots[i].deadline != 0 && (long)(now - slots[i].deadline) >= 0) {
+            finishExpired(i);
+        }
+    }
+}
+
+void CommandQueue::finishExpired(int slot) {
+    PN532Command command = slots[slot];
+    slotUsed[slot] = false;
+    count--;
+
+    recordWait(command);
+
+    command.success = false;
+    command.deadlineMissed = true;
+    recordCompletion(command);
+
+    if (command.onComplete != nullptr) {
+        command.onComplete(command, command.context);
+    }
+}
+
+void CommandQueue::recordWait(const PN532Command& command) {
+    CommandClassMetrics& m = metrics[command.priority];
+    unsigned long waitMs = millis() - command.enqueuedAt;
+
+    m.totalWaitMs += waitMs;
+    if (waitMs > m.maxWaitMs) {
+        m.maxWaitMs = waitMs;
+    }
+}
+
+void CommandQueue::recordCompletion(const PN532Command& command) {
+    CommandClassMetrics& m = metrics[command.priority];
+
+    if (command.success) {
+        m.completed++;
+    } else {
+        m.failed++;
+    }
+
+    if (command.deadlineMissed) {
+        m.deadlineMisses++;
+    }
+}
+
+unsigned long CommandQueue::getMeanWaitMs(CommandPriority priority) const {
+    const CommandClassMetrics& m = metrics[priority];
+    uint32_t finished = m.completed + m.failed;
+    if (finished == 0) return 0;
+    return m.totalWaitMs / finished;
+}
+
+void CommandQueue::resetMetrics() {
+    for (int i = 0; i < PRIORITY_COUNT; i++) {
+        memset(&metrics[i], 0, sizeof(metrics[i]));
+    }
+}
+
+void CommandQueue::printMetrics() const {
+    DEBUG_PRINTF("Очередь команд: %d/%d\n", count, COMMAND_QUEUE_SIZE);
+    for (int i = 0; i < PRIORITY_COUNT; i++) {
+        const CommandClassMetrics& m = metrics[i];
+        DEBUG_PRINTF("  %-11s: принято=%lu, отклонено=%lu, выполнено=%lu, ошибок=%lu, "
+                     "дедлайн пропущен=%lu, ожидание ср=%lu мс макс=%lu мс\n",
+                     getPriorityName((CommandPriority)i), m.submitted, m.rejected,
+                     m.completed, m.failed, m.deadlineMisses,
+                     getMeanWaitMs((CommandPriority)i), m.maxWaitMs);
+    }
+}
+
+unsigned long CommandQueue::estimateDurationMs(PN532CommandType type) {
+    switch (type) {
+        case CMD_SCAN_CELL:             return PN532_TIMEOUT_MS;
+        case CMD_GET_FIRMWARE_VERSION:  return 5;
+        case CMD_GET_GENERAL_STATUS:    return 5;
+        case CMD_NTAG_READ_PAGES:       return PN532_TIMEOUT_MS + 10;  // активация + READ
+        case CMD_NTAG_WRITE_PAGE:       return PN532_TIMEOUT_MS + 15;  // активация + WRITE
+        default:                        return PN532_TIMEOUT_MS;
+    }
+}
+
+const char* CommandQueue::getPriorityName(CommandPriority priority) {
+    switch (priority) {
+        case PRIORITY_SCAN:         return "SCAN";
+        case PRIORITY_INTERACTIVE:  return "INTERACTIVE";
+        case PRIORITY_BACKGROUND:   return "BACKGROUND";
+        default:                    return "UNKNOWN";
+    }
+}
@@ -0,0 +1,106 @@
+#ifndef COMMAND_QUEUE_H
+#define COMMAND_QUEUE_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// Классы приоритета команд PN532 (по убыванию)
+enum CommandPriority {
+    PRIORITY_SCAN,          // Внеочередное сканирование ячейки
+    PRIORITY_INTERACTIVE,   // Запрос пользователя - в ближайший зазор сканирования
+    PRIORITY_BACKGROUND,    // Только если проход укладывается в бюджет устаревания
+    PRIORITY_COUNT
+};
+
+// Команды, которые можно поставить в очередь
+enum PN532CommandType {
+    CMD_SCAN_CELL,              // Чтение UID на ячейке cellIndex
+    CMD_GET_FIRMWARE_VERSION,   // Версия прошивки -> data[0..3]
+    CMD_GET_GENERAL_STATUS,     // Err -> data[0]
+    CMD_NTAG_READ_PAGES,        // 4 страницы (16 байт) начиная с page -> data
+    CMD_NTAG_WRITE_PAGE,        // 4 байта data -> страница page
+    CMD_TYPE_COUNT
+};
+
+struct PN532Command;
+typedef void (*CommandCallback)(const PN532Command& command, void* context);
+
+struct PN532Command {
+    PN532CommandType type;
+    CommandPriority priority;
+    int cellIndex;              // Антенна для команды, -1 = не переключать
+    uint8_t page;
+    uint8_t data[16];           // Вход (запись) / результат (чтение)
+    uint8_t dataLength;
+    unsigned long deadline;     // Абсолютное время millis(), 0 = без дедлайна
+    unsigned long enqueuedAt;
+
+    // Результат
+    bool success;
+    bool deadlineMissed;
+    ScanResult scanResult;      // Для CMD_SCAN_CELL
+
+    CommandCallback onComplete;
+    void* context;
+};
+
+// Метрики одного класса приоритета
+struct CommandClassMetrics {
+    uint32_t submitted;
+    uint32_t rejected;          // Очередь заполнена
+    uint32_t completed;
+    uint32_t failed;
+    uint32_t deadlineMisses;    // Истекли в очереди или закончились после дедлайна
+    unsigned long totalWaitMs;
+    unsigned long maxWaitMs;
+};
+
+// Ограниченная очередь команд PN532 с классами приоритета.
+// Хранение статическое (COMMAND_QUEUE_SIZE слотов), FIFO внутри класса
+class CommandQueue {
+private:
+    PN532Command slots[COMMAND_QUEUE_SIZE];
+    uint32_t slotSequence[COMMAND_QUEUE_SIZE];
+    bool slotUsed[COMMAND_QUEUE_SIZE];
+    uint8_t count;
+    uint32_t nextSequence;
+
+    CommandClassMetrics metrics[PRIORITY_COUNT];
+
+public:
+    CommandQueue();
+
+    // Постановка в очередь (false если очередь заполнена)
+    bool push(const PN532Command& command);
+
+    // Следующая команда: SCAN > INTERACTIVE > BACKGROUND.
+    // Фоновая выдается только если ее оценка укладывается в backgroundSlackMs
+    bool pop(PN532Command& command, unsigned long backgroundSlackMs);
+
+    // Снимает команды с истекшим дедлайном, для каждой вызывает onComplete
+    void expire();
+
+    // Учет завершения команды, выданной pop()
+    void recordCompletion(const PN532Command& command);
+
+    // Состояние
+    uint8_t size() const { return count; }
+    bool isEmpty() const { return count == 0; }
+    bool isFull() const { return count >= COMMAND_QUEUE_SIZE; }
+
+    // Метрики
+    const CommandClassMetrics& getMetrics(CommandPriority priority) const { return metrics[priority]; }
+    unsigned long getMeanWaitMs(CommandPriority priority) const;
+    void resetMetrics();
+    void printMetrics() const;
+
+    // Оценка длительности команды на PN532 (мс)
+    static unsigned long estimateDurationMs(PN532CommandType type);
+    static const char* getPriorityName(CommandPriority priority);
+
+private:
+    void recordWait(const PN532Command& command);
+    void finishExpired(int slot);
+};
+
+#endif // COMMAND_QUEUE_H
@@ -0,0 +1,18 @@
+#ifndef CRC32_H
+#define CRC32_H
+
+#include <Arduino.h>
+
+// CRC-32 (IEEE 802.3) для записей в NVS. Начальное значение 0xFFFFFFFF,
+// результат инвертируется вызывающим: ~crc32Update(0xFFFFFFFF, ...)
+inline uint32_t crc32Update(uint32_t crc, const uint8_t* data, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (int b = 0; b < 8; b++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+    }
+    return crc;
+}
+
+#endif // CRC32_H
@@ -42,9 +42,7 @@ bool DisplayManager::isTimeForUpdate() const {
 void DisplayManager::printStartupInfo() const {
     DEBUG_PRINTLN("=== КОНФИГУРАЦИЯ ПИНОВ ===");
     DEBUG_PRINTF("- I2C PN532: SDA=%d, SCL=%d\n", PN532_SDA_PIN, PN532_SCL_PIN);
-    DEBUG_PRINTF("- MUX1 (строки): S0=%d, S1=%d, S2=%d, S3=GND\n", MUX1_S0_PIN, MUX1_S1_PIN, MUX1_S2_PIN);
-    DEBUG_PRINTF("- MUX2 (столбцы): S0=%d, S1=%d, S2=%d, S3=%d\n", MUX2_S0_PIN, MUX2_S1_PIN, MUX2_S2_PIN, MUX2_S3_PIN);
-    DEBUG_PRINTF("- Общий EN: %d\n", MUX_COMMON_EN_PIN);
+    muxManager->printGeometry();
     DEBUG_PRINTLN("==========================");
 }
 
@@ -53,16 +51,19 @@ void DisplayManager::printSystemStatus() const {
     static uint32_t lastCardsCount = 0;
     static uint32_t lastEvents = 0;
     static SystemState lastState = STATE_INIT;
+    static int lastQuarantined = 0;
     static unsigned long lastPrint = 0;
     
     // Проверяем есть ли значимые изменения
     int currentCards = scanMatrix->findCardsInMatrix();
     uint32_t currentEvents = scanMatrix->getCardsDetected() + scanMatrix->getCardsRemoved() + scanMatrix->getCardChanges();
     SystemState currentState = stateManager->getCurrentState();
+    int quarantined = scanMatrix->getQuarantine().getQuarantinedCount();
     
     bool hasChanges = (currentCards != lastCardsCount) || 
                      (currentEvents != lastEvents) || 
                      (currentState != lastState) ||
+                     (quarantined != lastQuarantined) ||
                      (millis() - lastPrint > 30000); // Принудительно раз в 30 сек
     
     if (!hasChanges) {
@@ -73,6 +74,7 @@ void DisplayManager::printSystemStatus() const {
     lastCardsCount = currentCards;
     lastEvents = currentEvents;
     lastState = currentState;
+    lastQuarantined = quarantined;
     lastPrint = millis();
     
     DEBUG_PRINTLN("=== СТАТУС СИСТЕМЫ ===");
@@ -82,6 +84,9 @@ void DisplayManager::printSystemStatus() const {
     
     DEBUG_PRINTF("Время работы: %s\n", uptimeBuffer);
     DEBUG_PRINTF("Карт в матрице: %d\n", currentCards);
+    if (quarantined > 0) {
+        DEBUG_PRINTF("Ячеек в карантине: %d (не сканируются, проверка фоном)\n", quarantined);
+    }
     
     DEBUG_PRINTLN("======================");
 }
@@ -104,6 +109,9 @@ void DisplayManager::printPerformanceReport() const {
     // Статистика состояний
     DEBUG_PRINTF("Переходы состояний: %lu\n", stateManager->getStateTransitions());
     DEBUG_PRINTF("Ошибки состояний: %lu\n", stateManager->getErrorCount());
+    uint32_t availability = stateManager->getAvailabilityPermille();
+    DEBUG_PRINTF("Доступность (SCANNING): %lu.%lu%%\n",
+                 (unsigned long)availability / 10, (unsigned long)availability % 10);
     
     printFooter();
 }
@@ -120,6 +128,11 @@ void DisplayManager::printMatrixStatus() const {
                  scanMatrix->getCardsRemoved(), 
                  scanMatrix->getCardChanges());
     
+    const CellQuarantine& quarantine = scanMatrix->getQuarantine();
+    DEBUG_PRINTF("Ячеек в карантине: %d (в карантин=%lu, возвращено=%lu)\n",
+                 quarantine.getQuarantinedCount(), quarantine.getQuarantineEvents(),
+                 quarantine.getReinstatements());
+    
     // Текущая позиция мультиплексоров
     DEBUG_PRINTF("Текущая ячейка: [%d,%d] (индекс %d)\n", 
                  muxManager->getCurrentRow(), 
@@ -159,6 +172,9 @@ void DisplayManager::printErrorReport() const {
     if (stateManager->isInErrorState()) {
         DEBUG_PRINTF("Время в состоянии ошибки: %lu мс\n", stateManager->getStateRunTime());
     }
+    DEBUG_PRINTF("Всего в ошибке: %lu мс, входов %lu\n",
+                 (unsigned long)stateManager->getResidencyMs(STATE_ERROR),
+                 (unsigned long)stateManager->getProfile().visits[STATE_ERROR]);
     
     printFooter();
 }
@@ -0,0 +1,81 @@
+#include "field_gating.h"
+
+FieldGatePlanner::FieldGatePlanner() {
+    mode = RF_GATING_MODE;
+    reset();
+}
+
+void FieldGatePlanner::reset() {
+    for (int i = 0; i < MATRIX_TOTAL_CELLS; i++) {
+        settleCostUs[i] = 0;
+        gatedCostUs[i] = 0;
+        sinceProbe[i] = 0;
+    }
+    settleSwitches = 0;
+    gatedSwitches = 0;
+    gateFailures = 0;
+}
+
+bool FieldGatePlanner::shouldGate(int cellIndex) {
+    if (mode != RF_GATING_AUTO) {
+        return mode == RF_GATING_ALWAYS;
+    }
+
+    // Сначала замер обеих стратегий: пауза (как раньше), затем выключение поля
+    if (settleCostUs[cellIndex] == 0) {
+        return false;
+    }
+    if (gatedCostUs[cellIndex] == 0) {
+        return true;
+    }
+
+    bool preferred = prefersGating(cellIndex);
+    if (++sinceProbe[cellIndex] >= RF_GATING_PROBE_INTERVAL) {
+        // Условия дрейфуют: цена отвергнутой стратегии тоже должна быть свежей
+        sinceProbe[cellIndex] = 0;
+        return !preferred;
+    }
+    return preferred;
+}
+
+void FieldGatePlanner::recordSwitch(int cellIndex, bool gated, unsigned long costUs) {
+    if (cellIndex < 0 || cellIndex >= MATRIX_TOTAL_CELLS) {
+        return;
+    }
+
+    uint32_t& cost = gated ? gatedCostUs[cellIndex] : settleCostUs[cellIndex];
+    uint32_t sample = max(costUs, 1UL);     // 0 - признак "не замерено"
+    cost = (cost == 0) ? sample : (cost * 3 + sample) / 4;
+
+    if (gated) {
+        gatedSwitches++;
+    } else {
+        settleSwitches++;
+    }
+}
+
+bool FieldGatePlanner::prefersGating(int cellIndex) const {
+    if (mode != RF_GATING_AUTO) {
+        return mode == RF_GATING_ALWAYS;
+    }
+    return gatedCostUs[cellIndex] > 0 && settleCostUs[cellIndex] > 0 &&
+           gatedCostUs[cellIndex] < settleCostUs[cellIndex];
+}
+
+int FieldGatePlanner::getGatedCellCount() const {
+    int count = 0;
+    for (int i = 0; i < MATRIX_TOTAL_CELLS; i++) {
+        if (prefersGating(i)) {
+            count++;
+        }
+    }
+    return count;
+}
+
+void FieldGatePlanner::printStatus() const {
+    static const char* modeNames[] = {"выкл", "авто", "всегда"};
+    DEBUG_PRINTF("Поле на переключении: режим %s, ячеек с выключением %d\n",
+                 modeNames[mode], getGatedCellCount());
+    DEBUG_PRINTF("  переключений: с паузой=%lu, с выключением=%lu, сбоев=%lu\n",
+                 settleSwitches, gatedSwitches, gateFailures);
+}
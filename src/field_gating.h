@@ -0,0 +1,54 @@
+#ifndef FIELD_GATING_H
+#define FIELD_GATING_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// Выбор стратегии переключения на ячейку после занятой.
+// Цена паузы - ожидание успокоения антенны плюс контрольное чтение при подозрении
+// на перекрестное чтение; цена выключения поля - две команды RFConfiguration и
+// запитка метки. Обе - скользящее среднее по ячейке; в режиме AUTO берется
+// дешевая, а раз в RF_GATING_PROBE_INTERVAL переключений замеряется другая.
+// Цену паузы ScanMatrix сообщает только после ее обучения - до того ячейка
+// в AUTO переключается с паузой и дает образцы обучению
+class FieldGatePlanner {
+private:
+    RfGatingMode mode;
+
+    uint32_t settleCostUs[MATRIX_TOTAL_CELLS];  // 0 = еще не замерено
+    uint32_t gatedCostUs[MATRIX_TOTAL_CELLS];
+    uint8_t sinceProbe[MATRIX_TOTAL_CELLS];
+
+    // Статистика
+    uint32_t settleSwitches;
+    uint32_t gatedSwitches;
+    uint32_t gateFailures;
+
+public:
+    FieldGatePlanner();
+
+    void setMode(RfGatingMode gatingMode) { mode = gatingMode; }
+    RfGatingMode getMode() const { return mode; }
+
+    // Выключать ли поле на переключение на ячейку (с занятой)
+    bool shouldGate(int cellIndex);
+
+    // Цена состоявшегося переключения
+    void recordSwitch(int cellIndex, bool gated, unsigned long costUs);
+    void recordGateFailure() { gateFailures++; }
+
+    // Дешевая по замерам стратегия ячейки
+    bool prefersGating(int cellIndex) const;
+    uint32_t getSettleCostUs(int cellIndex) const { return settleCostUs[cellIndex]; }
+    uint32_t getGatedCostUs(int cellIndex) const { return gatedCostUs[cellIndex]; }
+    int getGatedCellCount() const;
+
+    uint32_t getSettleSwitches() const { return settleSwitches; }
+    uint32_t getGatedSwitches() const { return gatedSwitches; }
+    uint32_t getGateFailures() const { return gateFailures; }
+    void printStatus() const;
+
+    void reset();
+};
+
+#endif // FIELD_GATING_H
@@ -0,0 +1,239 @@
+#include "i2c_fault_injector.h"
+
+#ifdef I2C_FAULT_INJECTION
+
+static const uint8_t PN532_STATUS_READY = 0x01;
+static const uint8_t PN532_ACK_FRAME[6] = {0x00, 0x00, 0xFF, 0x00, 0xFF, 0x00};
+
+static const char* FAULT_NAMES[I2C_FAULT_CLASS_COUNT] = {
+    "nack", "short_read", "missing_ack", "corrupt_frame", "pn532_hang", "watchdog"
+};
+
+#ifndef HOST_BUILD
+static void restartOnWatchdog(void* context) {
+    ESP.restart();
+}
+#endif
+
+I2CFaultInjector::I2CFaultInjector() {
+    rngState = 0x2545F491;
+#ifdef HOST_BUILD
+    resetHandler = nullptr;
+#else
+    resetHandler = restartOnWatchdog;
+#endif
+    resetContext = nullptr;
+    clear();
+    resetStatistics();
+}
+
+void I2CFaultInjector::install() {
+    Adafruit_I2CDevice::setInterceptor(this);
+}
+
+void I2CFaultInjector::uninstall() {
+    Adafruit_I2CDevice::setInterceptor(nullptr);
+}
+
+void I2CFaultInjector::setRate(I2CFaultClass faultClass, uint32_t perMillion) {
+    ratePerMillion[faultClass] = min(perMillion, (uint32_t)1000000);
+}
+
+bool I2CFaultInjector::scheduleFault(I2CFaultClass faultClass, unsigned long atMs) {
+    for (int i = 0; i < SCHEDULE_SIZE; i++) {
+        if (!schedule[i].armed) {
+            schedule[i].faultClass = faultClass;
+            schedule[i].atMs = atMs;
+            schedule[i].armed = true;
+            return true;
+        }
+    }
+    return false;
+}
+
+int I2CFaultInjector::getScheduledCount() const {
+    int count = 0;
+    for (int i = 0; i < SCHEDULE_SIZE; i++) {
+        if (schedule[i].armed) {
+            count++;
+        }
+    }
+    return count;
+}
+
+void I2CFaultInjector::clear() {
+    for (int c = 0; c < I2C_FAULT_CLASS_COUNT; c++) {
+        ratePerMillion[c] = 0;
+    }
+    for (int i = 0; i < SCHEDULE_SIZE; i++) {
+        schedule[i].armed = false;
+    }
+    hung = false;
+}
+
+void I2CFaultInjector::setWatchdogHandler(WatchdogResetHandler handler, void* context) {
+    resetHandler = handler;
+    resetContext = context;
+}
+
+void I2CFaultInjector::resetStatistics() {
+    transactions = 0;
+    cleanFrames = 0;
+    lastCleanFrameMicros = 0;
+    for (int c = 0; c < I2C_FAULT_CLASS_COUNT; c++) {
+        injected[c] = 0;
+    }
+    lastFaultMicros = 0;
+    lastFault = I2C_FAULT_NACK;
+    chipResets = 0;
+}
+
+uint32_t I2CFaultInjector::getTotalInjected() const {
+    uint32_t total = 0;
+    for (int c = 0; c < I2C_FAULT_CLASS_COUNT; c++) {
+        total += injected[c];
+    }
+    return total;
+}
+
+const char* I2CFaultInjector::getFaultName(I2CFaultClass faultClass) {
+    return (faultClass < I2C_FAULT_CLASS_COUNT) ? FAULT_NAMES[faultClass] : "?";
+}
+
+bool I2CFaultInjector::write(Adafruit_I2CDevice* dev, const uint8_t* buffer, size_t len, bool stop,
+                             const uint8_t* prefixBuffer, size_t prefixLen) {
+    transactions++;
+
+    // Зависший PN532: интерфейс I2C принимает байты, ядро их не обрабатывает
+    if (hung) {
+        return true;
+    }
+    if (shouldInject(I2C_FAULT_HANG)) {
+        fire(I2C_FAULT_HANG);
+        return true;
+    }
+    if (shouldInject(I2C_FAULT_WATCHDOG)) {
+        fire(I2C_FAULT_WATCHDOG);
+        return false;
+    }
+    if (shouldInject(I2C_FAULT_NACK)) {
+        fire(I2C_FAULT_NACK);
+        return false;
+    }
+    return dev->write(buffer, len, stop, prefixBuffer, prefixLen);
+}
+
+bool I2CFaultInjector::read(Adafruit_I2CDevice* dev, uint8_t* buffer, size_t len, bool stop) {
+    transactions++;
+
+    // Зависший PN532 отвечает на чтение статусом "не готов"
+    if (hung) {
+        memset(buffer, 0, len);
+        return true;
+    }
+    if (shouldInject(I2C_FAULT_HANG)) {
+        fire(I2C_FAULT_HANG);
+        memset(buffer, 0, len);
+        return true;
+    }
+    if (shouldInject(I2C_FAULT_WATCHDOG)) {
+        fire(I2C_FAULT_WATCHDOG);
+        return false;
+    }
+    if (shouldInject(I2C_FAULT_NACK)) {
+        fire(I2C_FAULT_NACK);
+        return false;
+    }
+
+    // Байт RDY и чтения длиннее буфера Wire - без искажений
+    uint8_t saved[I2C_BUFFER_LENGTH];
+    if (len < 2 || len > sizeof(saved)) {
+        return dev->read(buffer, len, stop);
+    }
+
+    memcpy(saved, buffer, len);
+    if (!dev->read(buffer, len, stop) || buffer[0] != PN532_STATUS_READY) {
+        return false;
+    }
+
+    bool ackFrame = len >= 7 && memcmp(buffer + 1, PN532_ACK_FRAME, sizeof(PN532_ACK_FRAME)) == 0;
+    bool responseFrame = !ackFrame && len >= 8 && buffer[1] == 0x00 && buffer[2] == 0x00 &&
+                         buffer[3] == 0xFF && buffer[4] != 0;
+
+    // Короткое чтение: PN532 кадр уже отдал, а буфер драйвера остался прежним
+    if (shouldInject(I2C_FAULT_SHORT_READ)) {
+        fire(I2C_FAULT_SHORT_READ);
+        memcpy(buffer, saved, len);
+        return false;
+    }
+    if (ackFrame && shouldInject(I2C_FAULT_MISSING_ACK)) {
+        fire(I2C_FAULT_MISSING_ACK);
+        memset(buffer, 0, len);
+        return true;
+    }
+    if (responseFrame && shouldInject(I2C_FAULT_CORRUPT_FRAME)) {
+        // Бит в диапазоне LEN..DCS: LEN, LCS, TFI, данные, DCS
+        size_t last = min((size_t)(6 + buffer[4]), len - 1);
+        size_t index = 4 + nextRandom() % (last - 4 + 1);
+        buffer[index] ^= (uint8_t)(1 << (nextRandom() % 8));
+        fire(I2C_FAULT_CORRUPT_FRAME);
+        return true;
+    }
+
+    if (responseFrame) {
+        cleanFrames++;
+        lastCleanFrameMicros = micros();
+    }
+    return true;
+}
+
+void I2CFaultInjector::deviceReset(Adafruit_I2CDevice*) {
+    chipResets++;
+    if (hung) {
+        hung = false;
+        DEBUG_PRINTLN("I2CFaultInjector: зависание PN532 снято сбросом");
+    }
+}
+
+bool I2CFaultInjector::shouldInject(I2CFaultClass faultClass) {
+    unsigned long now = millis();
+    for (int i = 0; i < SCHEDULE_SIZE; i++) {
+        if (schedule[i].armed && schedule[i].faultClass == faultClass && (long)(now - schedule[i].atMs) >= 0) {
+            schedule[i].armed = false;
+            return true;
+        }
+    }
+    return ratePerMillion[faultClass] > 0 && nextRandom() % 1000000 < ratePerMillion[faultClass];
+}
+
+void I2CFaultInjector::fire(I2CFaultClass faultClass) {
+    injected[faultClass]++;
+    lastFault = faultClass;
+    lastFaultMicros = micros();
+
+    if (faultClass == I2C_FAULT_HANG) {
+        hung = true;
+    } else if (faultClass == I2C_FAULT_WATCHDOG && resetHandler != nullptr) {
+        resetHandler(resetContext);
+    }
+}
+
+uint32_t I2CFaultInjector::nextRandom() {
+    // xorshift32: воспроизводимая последовательность сбоев
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 17;
+    rngState ^= rngState << 5;
+    return rngState;
+}
+
+void I2CFaultInjector::printStatus() const {
+    DEBUG_PRINTF("Инъекция сбоев I2C: транзакций=%lu, чистых кадров=%lu, сбросов PN532=%lu%s\n",
+                 transactions, cleanFrames, chipResets, hung ? ", PN532 ЗАВИС" : "");
+    for (int c = 0; c < I2C_FAULT_CLASS_COUNT; c++) {
+        if (injected[c] > 0 || ratePerMillion[c] > 0) {
+            DEBUG_PRINTF("  %s: внесено=%lu, вероятность=%lu/1e6\n", FAULT_NAMES[c], injected[c], ratePerMillion[c]);
+        }
+    }
+}
+
+#endif // I2C_FAULT_INJECTION
@@ -0,0 +1,106 @@
+#ifndef I2C_FAULT_INJECTOR_H
+#define I2C_FAULT_INJECTOR_H
+
+#ifdef I2C_FAULT_INJECTION
+
+#include <Arduino.h>
+#include <Adafruit_I2CDevice.h>
+#include "config.h"
+
+// Классы сбоев шины и PN532
+enum I2CFaultClass {
+    I2C_FAULT_NACK,             // Транзакция (запись команды или чтение) без ACK по адресу
+    I2C_FAULT_SHORT_READ,       // Ведомый отдал не все байты кадра - кадр потерян
+    I2C_FAULT_MISSING_ACK,      // ACK-кадр PN532 не пришел (вместо него пустое чтение)
+    I2C_FAULT_CORRUPT_FRAME,    // Искажен бит кадра ответа - LCS/DCS не сходятся
+    I2C_FAULT_HANG,             // PN532 молчит (RDY не приходит) до сброса по RSTPD_N
+    I2C_FAULT_WATCHDOG,         // Прошивка зависает в транзакции - сброс по watchdog
+    I2C_FAULT_CLASS_COUNT
+};
+
+typedef void (*WatchdogResetHandler)(void* context);
+
+// Инъекция сбоев между драйвером PN532 и шиной (сборка с -DI2C_FAULT_INJECTION).
+// Сбой вносится с вероятностью на подходящую транзакцию или по расписанию -
+// в первую подходящую транзакцию после заданного millis(). Подходящая: NACK и
+// зависание - любая, короткое чтение - чтение кадра, пропуск ACK - чтение
+// ACK-кадра, искажение - чтение кадра ответа
+class I2CFaultInjector : public Adafruit_I2CInterceptor {
+public:
+    static const int SCHEDULE_SIZE = 16;
+
+private:
+    struct ScheduledFault {
+        I2CFaultClass faultClass;
+        unsigned long atMs;
+        bool armed;
+    };
+
+    uint32_t ratePerMillion[I2C_FAULT_CLASS_COUNT];
+    ScheduledFault schedule[SCHEDULE_SIZE];
+    uint32_t rngState;
+    bool hung;
+
+    WatchdogResetHandler resetHandler;
+    void* resetContext;
+
+    // Статистика
+    uint32_t transactions;
+    uint32_t cleanFrames;           // Кадры ответа, прошедшие без сбоя
+    unsigned long lastCleanFrameMicros;
+    uint32_t injected[I2C_FAULT_CLASS_COUNT];
+    unsigned long lastFaultMicros;
+    I2CFaultClass lastFault;
+    uint32_t chipResets;
+
+public:
+    I2CFaultInjector();
+
+    // Перехват всех транзакций Adafruit_I2CDevice
+    void install();
+    void uninstall();
+
+    // Вероятность на подходящую транзакцию (на миллион), 0 - выключено
+    void setRate(I2CFaultClass faultClass, uint32_t perMillion);
+    uint32_t getRate(I2CFaultClass faultClass) const { return ratePerMillion[faultClass]; }
+
+    // Однократный сбой в первой подходящей транзакции после atMs
+    bool scheduleFault(I2CFaultClass faultClass, unsigned long atMs);
+    int getScheduledCount() const;
+
+    // Снять вероятности, расписание и зависание
+    void clear();
+
+    // Сброс по watchdog. По умолчанию на ESP32 - перезагрузка, на хосте - только
+    // сбой транзакции (перезагрузку делает бенчмарк)
+    void setWatchdogHandler(WatchdogResetHandler handler, void* context);
+
+    bool isHung() const { return hung; }
+    uint32_t getTransactions() const { return transactions; }
+    uint32_t getCleanFrames() const { return cleanFrames; }
+    unsigned long getLastCleanFrameMicros() const { return lastCleanFrameMicros; }
+    uint32_t getInjected(I2CFaultClass faultClass) const { return injected[faultClass]; }
+    uint32_t getTotalInjected() const;
+    unsigned long getLastFaultMicros() const { return lastFaultMicros; }
+    I2CFaultClass getLastFault() const { return lastFault; }
+    uint32_t getChipResets() const { return chipResets; }
+    static const char* getFaultName(I2CFaultClass faultClass);
+    void printStatus() const;
+
+    void resetStatistics();
+
+    // Adafruit_I2CInterceptor
+    bool write(Adafruit_I2CDevice* dev, const uint8_t* buffer, size_t len, bool stop,
+               const uint8_t* prefixBuffer, size_t prefixLen) override;
+    bool read(Adafruit_I2CDevice* dev, uint8_t* buffer, size_t len, bool stop) override;
+    void deviceReset(Adafruit_I2CDevice* dev) override;
+
+private:
+    bool shouldInject(I2CFaultClass faultClass);
+    void fire(I2CFaultClass faultClass);
+    uint32_t nextRandom();
+};
+
+#endif // I2C_FAULT_INJECTION
+
+#endif // I2C_FAULT_INJECTOR_H
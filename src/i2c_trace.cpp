@@ -0,0 +1,373 @@
+#include "i2c_trace.h"
+
+#ifdef I2C_TRACE
+
+#include "crc32.h"
+#include <algorithm>
+
+static const uint32_t TRACE_MAGIC = 0x54433249;    // "I2CT"
+static const uint16_t TRACE_VERSION = 1;
+static const char* TRACE_FILE = "/i2c_trace.bin";
+
+// Заголовок файла трассы, за ним - байты кольца от самой старой записи
+struct SavedTraceMeta {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t reserved;
+    uint32_t firstSequence;
+    uint32_t records;
+    uint32_t bytes;
+    uint32_t crc;               // CRC32 байт кольца
+};
+
+static void putLe16(uint8_t* out, uint16_t value) {
+    out[0] = value & 0xFF;
+    out[1] = value >> 8;
+}
+
+static void putLe32(uint8_t* out, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        out[i] = (value >> (8 * i)) & 0xFF;
+    }
+}
+
+static uint32_t getLe32(const uint8_t* in) {
+    return (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+static uint16_t elapsedUs(uint32_t start) {
+    uint32_t elapsed = micros() - start;
+    return (elapsed > 0xFFFF) ? 0xFFFF : (uint16_t)elapsed;
+}
+
+I2CTraceRecorder::I2CTraceRecorder() {
+    enabled = I2C_TRACE_ENABLED_DEFAULT;
+    streaming = I2C_TRACE_STREAM_DEFAULT;
+    output = &Serial;
+    storageOpen = false;
+    hasSpilled = false;
+    lastSpillTime = 0;
+    savedRecords = 0;
+    clearRing();
+}
+
+void I2CTraceRecorder::clearRing() {
+    head = 0;
+    used = 0;
+    firstSequence = 0;
+    nextSequence = 0;
+    streamOffset = 0;
+    streamSequence = 0;
+    evicted = 0;
+    streamDropped = 0;
+    framesSent = 0;
+    spills = 0;
+}
+
+void I2CTraceRecorder::begin() {
+    clearRing();
+    hasSpilled = false;
+
+    // Трасса до прошлого сбоя: ее пишет spill(), разбирает хост
+    streamSaved();
+    clearRing();
+
+    if (!enabled) {
+        return;
+    }
+    if (streaming) {
+        uint8_t frame[FRAME_OVERHEAD];
+        output->write(frame, encodeBootFrame(frame));
+        framesSent++;
+    }
+    Adafruit_I2CDevice::setTap(this);
+}
+
+void I2CTraceRecorder::setEnabled(bool enable) {
+    enabled = enable;
+    Adafruit_I2CDevice::setTap(enable ? this : nullptr);
+}
+
+void I2CTraceRecorder::setStreaming(bool enable) {
+    if (enable && !streaming) {
+        // Поток начинается с текущего момента: старое кольцо уже не догнать
+        streamOffset = (head + used) % I2C_TRACE_RING_BYTES;
+        streamSequence = nextSequence;
+    }
+    streaming = enable;
+}
+
+// =============================================
+// ЗАПИСЬ
+// =============================================
+
+bool I2CTraceRecorder::write(Adafruit_I2CDevice* dev, const uint8_t* buffer, size_t len, bool stop,
+                             const uint8_t* prefixBuffer, size_t prefixLen) {
+    I2CTraceRecord record;
+    record.startMicros = micros();
+    bool ok = dev->write(buffer, len, stop, prefixBuffer, prefixLen);
+    record.durationUs = elapsedUs(record.startMicros);
+    record.address = dev->address();
+    record.flags = (ok ? I2C_TRACE_OK : 0) | (stop ? I2C_TRACE_STOP : 0);
+
+    size_t total = 0;
+    if (prefixBuffer != nullptr) {
+        for (size_t i = 0; i < prefixLen && total < sizeof(record.data); i++) {
+            record.data[total++] = prefixBuffer[i];
+        }
+    }
+    for (size_t i = 0; i < len && total < sizeof(record.data); i++) {
+        record.data[total++] = buffer[i];
+    }
+    record.length = (uint8_t)total;
+    append(record);
+    return ok;
+}
+
+bool I2CTraceRecorder::read(Adafruit_I2CDevice* dev, uint8_t* buffer, size_t len, bool stop) {
+    I2CTraceRecord record;
+    record.startMicros = micros();
+    bool ok = dev->read(buffer, len, stop);
+    record.durationUs = elapsedUs(record.startMicros);
+    record.address = dev->address();
+    record.flags = I2C_TRACE_READ | (ok ? I2C_TRACE_OK : 0) | (stop ? I2C_TRACE_STOP : 0);
+    record.length = (uint8_t)min(len, sizeof(record.data));
+    memcpy(record.data, buffer, record.length);
+    append(record);
+    return ok;
+}
+
+void I2CTraceRecorder::deviceReset(Adafruit_I2CDevice* dev) {
+    I2CTraceRecord record;
+    record.startMicros = micros();
+    record.durationUs = 0;
+    record.address = dev->address();
+    record.flags = I2C_TRACE_RESET;
+    record.length = 0;
+    append(record);
+}
+
+void I2CTraceRecorder::append(I2CTraceRecord& record) {
+    size_t bytes = HEADER_BYTES + record.length;
+    while (used + bytes > I2C_TRACE_RING_BYTES) {
+        evictOldest();
+    }
+
+    record.sequence = nextSequence++;
+    uint8_t header[HEADER_BYTES];
+    putLe32(header, record.startMicros);
+    putLe16(header + 4, record.durationUs);
+    header[6] = record.address;
+    header[7] = record.flags;
+    header[8] = record.length;
+
+    size_t tail = (head + used) % I2C_TRACE_RING_BYTES;
+    copyToRing(tail, header, HEADER_BYTES);
+    copyToRing((tail + HEADER_BYTES) % I2C_TRACE_RING_BYTES, record.data, record.length);
+    used += bytes;
+}
+
+void I2CTraceRecorder::evictOldest() {
+    size_t bytes = recordBytesAt(head);
+    if (streaming && streamSequence == firstSequence) {
+        streamOffset = (streamOffset + bytes) % I2C_TRACE_RING_BYTES;
+        streamSequence++;
+        streamDropped++;
+    }
+    head = (head + bytes) % I2C_TRACE_RING_BYTES;
+    used -= bytes;
+    firstSequence++;
+    evicted++;
+}
+
+size_t I2CTraceRecorder::recordBytesAt(size_t offset) const {
+    return HEADER_BYTES + ring[(offset + HEADER_BYTES - 1) % I2C_TRACE_RING_BYTES];
+}
+
+void I2CTraceRecorder::readRecordAt(size_t offset, I2CTraceRecord& record) const {
+    uint8_t header[HEADER_BYTES];
+    copyFromRing(offset, header, HEADER_BYTES);
+    record.startMicros = getLe32(header);
+    record.durationUs = header[4] | (header[5] << 8);
+    record.address = header[6];
+    record.flags = header[7];
+    record.length = header[8];
+    copyFromRing((offset + HEADER_BYTES) % I2C_TRACE_RING_BYTES, record.data, record.length);
+}
+
+void I2CTraceRecorder::copyFromRing(size_t offset, uint8_t* out, size_t length) const {
+    size_t first = min(length, (size_t)I2C_TRACE_RING_BYTES - offset);
+    memcpy(out, ring + offset, first);
+    memcpy(out + first, ring, length - first);
+}
+
+void I2CTraceRecorder::copyToRing(size_t offset, const uint8_t* data, size_t length) {
+    size_t first = min(length, (size_t)I2C_TRACE_RING_BYTES - offset);
+    memcpy(ring + offset, data, first);
+    memcpy(ring, data + first, length - first);
+}
+
+// =============================================
+// ПОТОК В SERIAL
+// =============================================
+
+size_t I2CTraceRecorder::encodeFrame(uint8_t type, const I2CTraceRecord& record, uint8_t* out) {
+    uint16_t payload = 4 + HEADER_BYTES + record.length;
+    out[0] = FRAME_SYNC_0;
+    out[1] = FRAME_SYNC_1;
+    out[2] = type;
+    putLe16(out + 3, payload);
+    uint8_t* p = out + 5;
+    putLe32(p, record.sequence);
+    putLe32(p + 4, record.startMicros);
+    putLe16(p + 8, record.durationUs);
+    p[10] = record.address;
+    p[11] = record.flags;
+    p[12] = record.length;
+    memcpy(p + 13, record.data, record.length);
+    putLe32(out + 5 + payload, ~crc32Update(0xFFFFFFFF, out + 2, 3 + payload));
+    return FRAME_OVERHEAD + payload;
+}
+
+size_t I2CTraceRecorder::encodeBootFrame(uint8_t* out) {
+    out[0] = FRAME_SYNC_0;
+    out[1] = FRAME_SYNC_1;
+    out[2] = I2C_TRACE_FRAME_BOOT;
+    putLe16(out + 3, 0);
+    putLe32(out + 5, ~crc32Update(0xFFFFFFFF, out + 2, 3));
+    return FRAME_OVERHEAD;
+}
+
+void I2CTraceRecorder::poll() {
+    if (!streaming || output == nullptr) {
+        return;
+    }
+
+    uint8_t frame[MAX_FRAME_BYTES];
+    I2CTraceRecord record;
+    size_t sent = 0;
+    while (streamSequence < nextSequence && sent < I2C_TRACE_STREAM_BYTES_PER_LOOP) {
+        readRecordAt(streamOffset, record);
+        record.sequence = streamSequence;
+        size_t length = encodeFrame(I2C_TRACE_FRAME_RECORD, record, frame);
+        output->write(frame, length);
+        sent += length;
+        framesSent++;
+        streamOffset = (streamOffset + HEADER_BYTES + record.length) % I2C_TRACE_RING_BYTES;
+        streamSequence++;
+    }
+}
+
+// =============================================
+// СОХРАНЕНИЕ В SPIFFS
+// =============================================
+
+bool I2CTraceRecorder::openStorage() {
+    if (!storageOpen) {
+        storageOpen = SPIFFS.begin(true);
+        if (!storageOpen) {
+            DEBUG_PRINTLN("I2CTrace: ОШИБКА - SPIFFS недоступна");
+        }
+    }
+    return storageOpen;
+}
+
+bool I2CTraceRecorder::spill(bool force) {
+    if (!enabled || used == 0) {
+        return false;
+    }
+    unsigned long now = millis();
+    if (!force && hasSpilled && now - lastSpillTime < I2C_TRACE_SPILL_INTERVAL_MS) {
+        return false;
+    }
+    if (!openStorage()) {
+        return false;
+    }
+
+    // Разрыв кольца: поворачиваем содержимое к началу, чтобы записать одним блоком
+    if (head + used > I2C_TRACE_RING_BYTES) {
+        std::rotate(ring, ring + head, ring + I2C_TRACE_RING_BYTES);
+        streamOffset = (streamOffset + I2C_TRACE_RING_BYTES - head) % I2C_TRACE_RING_BYTES;
+        head = 0;
+    }
+
+    SavedTraceMeta meta;
+    meta.magic = TRACE_MAGIC;
+    meta.version = TRACE_VERSION;
+    meta.reserved = 0;
+    meta.firstSequence = firstSequence;
+    meta.records = nextSequence - firstSequence;
+    meta.bytes = used;
+    meta.crc = ~crc32Update(0xFFFFFFFF, ring + head, used);
+
+    File file = SPIFFS.open(TRACE_FILE, FILE_WRITE);
+    bool ok = file && file.write((const uint8_t*)&meta, sizeof(meta)) == sizeof(meta) &&
+              file.write(ring + head, used) == used;
+    if (file) {
+        file.close();
+    }
+
+    hasSpilled = true;
+    lastSpillTime = now;
+    if (ok) {
+        spills++;
+        DEBUG_PRINTF("I2CTrace: %lu записей (%u байт) сохранены в SPIFFS\n", meta.records, (unsigned)used);
+    }
+    return ok;
+}
+
+void I2CTraceRecorder::eraseSaved() {
+    if (openStorage()) {
+        SPIFFS.remove(TRACE_FILE);
+    }
+    savedRecords = 0;
+}
+
+void I2CTraceRecorder::streamSaved() {
+    savedRecords = 0;
+    if (!openStorage() || !SPIFFS.exists(TRACE_FILE)) {
+        return;
+    }
+    File file = SPIFFS.open(TRACE_FILE, FILE_READ);
+    if (!file) {
+        return;
+    }
+
+    // Кольцо пусто до первой транзакции - читаем сохраненное прямо в него
+    SavedTraceMeta meta;
+    bool ok = file.read((uint8_t*)&meta, sizeof(meta)) == sizeof(meta) && meta.magic == TRACE_MAGIC &&
+              meta.version == TRACE_VERSION && meta.bytes <= I2C_TRACE_RING_BYTES &&
+              file.read(ring, meta.bytes) == meta.bytes;
+    file.close();
+    if (!ok) {
+        return;
+    }
+    if (~crc32Update(0xFFFFFFFF, ring, meta.bytes) != meta.crc) {
+        DEBUG_PRINTLN("I2CTrace: CRC трассы в SPIFFS не совпадает - игнорируем");
+        return;
+    }
+    savedRecords = meta.records;
+    DEBUG_PRINTF("I2CTrace: в SPIFFS трасса до прошлого сбоя - %lu записей\n", meta.records);
+    if (!streaming || output == nullptr) {
+        return;
+    }
+
+    uint8_t frame[MAX_FRAME_BYTES];
+    I2CTraceRecord record;
+    size_t offset = 0;
+    for (uint32_t i = 0; i < meta.records && offset + HEADER_BYTES <= meta.bytes; i++) {
+        readRecordAt(offset, record);
+        record.sequence = meta.firstSequence + i;
+        output->write(frame, encodeFrame(I2C_TRACE_FRAME_SAVED, record, frame));
+        offset += HEADER_BYTES + record.length;
+    }
+}
+
+void I2CTraceRecorder::printStatus() const {
+    DEBUG_PRINTF("Трасса I2C: записей=%lu, в кольце=%lu (%u байт), вытеснено=%lu, кадров=%lu, "
+                 "не отправлено=%lu, сохранений в SPIFFS=%lu\n",
+                 nextSequence, nextSequence - firstSequence, (unsigned)used, evicted, framesSent,
+                 streamDropped, spills);
+}
+
+#endif // I2C_TRACE
@@ -0,0 +1,129 @@
+#ifndef I2C_TRACE_H
+#define I2C_TRACE_H
+
+#ifdef I2C_TRACE
+
+#include <Arduino.h>
+#include <SPIFFS.h>
+#include <Adafruit_I2CDevice.h>
+#include "config.h"
+
+// Флаги записи трассы
+enum I2CTraceFlags {
+    I2C_TRACE_READ  = 0x01,     // Чтение (иначе запись; запись длины 0 - проба адреса)
+    I2C_TRACE_OK    = 0x02,     // Драйвер получил true
+    I2C_TRACE_STOP  = 0x04,     // STOP после транзакции
+    I2C_TRACE_RESET = 0x08      // Не транзакция: сброс PN532 по RSTPD_N
+};
+
+// Транзакция в том виде, как ее видел драйвер (уже после инъекции сбоев)
+struct I2CTraceRecord {
+    uint32_t sequence;          // Номер с начала записи (setup())
+    uint32_t startMicros;       // micros() перед транзакцией
+    uint16_t durationUs;        // До возврата в драйвер, с насыщением
+    uint8_t address;
+    uint8_t flags;
+    uint8_t length;
+    uint8_t data[255];          // Запись: префикс + данные; чтение: что получил драйвер
+};
+
+// Кадр в Serial: A5 5A | тип | длина (2, LE) | данные | CRC32 (4, LE) от типа
+// до конца данных. Кадры идут вперемешку с текстом лога - разборщик ищет
+// синхрослово и проверяет CRC. Запись: номер (4) + заголовок (9) + байты
+enum I2CTraceFrameType {
+    I2C_TRACE_FRAME_BOOT   = 'B',   // Начало записи после загрузки
+    I2C_TRACE_FRAME_RECORD = 'R',   // Запись текущей загрузки
+    I2C_TRACE_FRAME_SAVED  = 'S'    // Запись из SPIFFS (трасса до прошлого сбоя)
+};
+
+// Запись транзакций I2C (сборка с -DI2C_TRACE). Стоит снаружи инъекции сбоев
+// (Adafruit_I2CDevice::setTap), кольцо в RAM вытесняет самые старые записи.
+// Поток в Serial - по бюджету за loop(); сохранение в SPIFFS - по запросу
+// (потеря PN532) не чаще I2C_TRACE_SPILL_INTERVAL_MS
+class I2CTraceRecorder : public Adafruit_I2CInterceptor {
+public:
+    static const uint8_t FRAME_SYNC_0 = 0xA5;
+    static const uint8_t FRAME_SYNC_1 = 0x5A;
+    static const size_t HEADER_BYTES = 9;
+    static const size_t FRAME_OVERHEAD = 9;     // Синхрослово, тип, длина, CRC
+    static const size_t MAX_FRAME_BYTES = FRAME_OVERHEAD + 4 + HEADER_BYTES + 255;
+
+private:
+    uint8_t ring[I2C_TRACE_RING_BYTES];
+    size_t head;                    // Начало самой старой записи
+    size_t used;
+    uint32_t firstSequence;         // Номер самой старой записи в кольце
+    uint32_t nextSequence;
+
+    bool enabled;
+    bool streaming;
+    Print* output;
+    size_t streamOffset;            // Следующая запись к отправке
+    uint32_t streamSequence;
+
+    bool storageOpen;
+    bool hasSpilled;
+    unsigned long lastSpillTime;
+
+    // Статистика
+    uint32_t evicted;               // Вытеснены из кольца
+    uint32_t streamDropped;         // ...из них не успели уйти в Serial
+    uint32_t framesSent;
+    uint32_t spills;
+    uint32_t savedRecords;          // Записей в SPIFFS на момент загрузки
+
+public:
+    I2CTraceRecorder();
+
+    // Вызывается в начале setup(): очищает кольцо, сообщает о трассе в SPIFFS
+    // (при потоке - отправляет ее кадрами SAVED) и ставит запись на шину
+    void begin();
+
+    void setEnabled(bool enable);
+    bool isEnabled() const { return enabled; }
+    void setStreaming(bool enable);
+    bool isStreaming() const { return streaming; }
+    void setOutput(Print* stream) { output = stream; }
+
+    // Отправка накопленных записей; вызывается из loop()
+    void poll();
+
+    // Кольцо в SPIFFS (force - без ограничения частоты)
+    bool spill(bool force = false);
+    void eraseSaved();
+
+    uint32_t getRecordsInRing() const { return nextSequence - firstSequence; }
+    uint32_t getTotalRecords() const { return nextSequence; }
+    size_t getUsedBytes() const { return used; }
+    uint32_t getEvicted() const { return evicted; }
+    uint32_t getStreamDropped() const { return streamDropped; }
+    uint32_t getFramesSent() const { return framesSent; }
+    uint32_t getSpills() const { return spills; }
+    uint32_t getSavedRecords() const { return savedRecords; }
+    void printStatus() const;
+
+    // Кадр записи; out - не меньше MAX_FRAME_BYTES
+    static size_t encodeFrame(uint8_t type, const I2CTraceRecord& record, uint8_t* out);
+    static size_t encodeBootFrame(uint8_t* out);
+
+    // Adafruit_I2CInterceptor
+    bool write(Adafruit_I2CDevice* dev, const uint8_t* buffer, size_t len, bool stop,
+               const uint8_t* prefixBuffer, size_t prefixLen) override;
+    bool read(Adafruit_I2CDevice* dev, uint8_t* buffer, size_t len, bool stop) override;
+    void deviceReset(Adafruit_I2CDevice* dev) override;
+
+private:
+    void clearRing();
+    void append(I2CTraceRecord& record);
+    void evictOldest();
+    size_t recordBytesAt(size_t offset) const;
+    void readRecordAt(size_t offset, I2CTraceRecord& record) const;
+    void copyFromRing(size_t offset, uint8_t* out, size_t length) const;
+    void copyToRing(size_t offset, const uint8_t* data, size_t length);
+    void streamSaved();
+    bool openStorage();
+};
+
+#endif // I2C_TRACE
+
+#endif // I2C_TRACE_H
@@ -18,17 +18,31 @@
 #include "multiplexer.h"
 #include "scan_matrix.h"
 #include "display_manager.h"
+#include "i2c_fault_injector.h"
+#include "i2c_trace.h"
+#include "metrics.h"
+#include "serial_console.h"
+#include "memory_monitor.h"
 
 // =============================================
 // RFID MATRIX 8×12 - ОСНОВНОЙ ФАЙЛ v3.1
 // =============================================
 
 // Глобальные объекты
+MetricsRegistry metrics;               // Первым: менеджеры регистрируют метрики в конструкторах
 StateManager stateManager;
 RFIDManager rfidManager;
 MultiplexerManager muxManager;
 ScanMatrix scanMatrix(&muxManager, &rfidManager);
 DisplayManager displayManager(&stateManager, &rfidManager, &scanMatrix, &muxManager);
+SerialConsole serialConsole(&stateManager, &rfidManager, &muxManager, &scanMatrix, &displayManager);
+MemoryMonitor memoryMonitor;           // Куча и стек задач: после setup() кучу никто не берет
+#ifdef I2C_FAULT_INJECTION
+I2CFaultInjector i2cFaultInjector;     // Между драйвером PN532 и шиной (стенд сбоев)
+#endif
+#ifdef I2C_TRACE
+I2CTraceRecorder i2cTrace;             // Запись транзакций драйвера PN532 (повтор на хосте)
+#endif
 
 // Счетчики попыток инициализации
 int pn532InitAttempts = 0;
@@ -54,10 +68,21 @@ void handlePeriodicTasks();
 
 void setup() {
     Serial.begin(115200);
+#ifdef I2C_FAULT_INJECTION
+    i2cFaultInjector.install();
+#endif
+#ifdef I2C_TRACE
+    i2cTrace.begin();
+#endif
+    
+    // Теплый старт: доска из NVS публикуется сразу, до паузы Serial и
+    // инициализации PN532; первый проход начнет с проверки восстановленных ячеек
+    scanMatrix.restoreSnapshot();
+    
     delay(1000);
     
     DEBUG_PRINTLN("========================================");
-    DEBUG_PRINTLN("RFID Matrix 8×12 - Запуск системы v3.1");
+    DEBUG_PRINTF("RFID Matrix %s - Запуск системы v3.1\n", ActiveGeometry::layout.name);
     DEBUG_PRINTLN("КОНСЕРВАТИВНЫЙ РЕЖИМ (стабильные тайминги)");
     DEBUG_PRINTLN("========================================");
     
@@ -78,6 +103,7 @@ void setup() {
     }
     
     initializeOtherComponents();
+    serialConsole.begin();  // Настройки из NVS - поверх значений config.h
     stateManager.setState(STATE_SCANNING);
     
     DEBUG_PRINTLN("✅ СИСТЕМА ПОЛНОСТЬЮ ИНИЦИАЛИЗИРОВАНА!");
@@ -189,6 +215,7 @@ void initializeOtherComponents() {
 bool initializeI2C() {
     Wire.begin(PN532_SDA_PIN, PN532_SCL_PIN);
     Wire.setClock(I2C_FREQUENCY);  // 100kHz для стабильной работы
+    Wire.setTimeOut(I2C_TIMEOUT_MS); // Зависшая транзакция не должна держать loop() до watchdog
     
     // Быстрая проверка I2C шины
     Wire.beginTransmission(0x24);
@@ -218,16 +245,16 @@ void handleInitializationError() {
 }
 
 void handleErrorRecovery() {
-    static unsigned long lastRecoveryAttempt = 0;
-    
-    // Попытка восстановления каждые 5 секунд
-    if (millis() - lastRecoveryAttempt >= 5000) {
-        if (rfidManager.reconnect()) {
-            DEBUG_PRINTLN("✅ Подключение восстановлено!");
-            stateManager.setState(STATE_SCANNING);
-        }
-        
-        lastRecoveryAttempt = millis();
+    // Многоуровневое восстановление: повтор -> очистка шины -> сброс PN532.
+    // Первая попытка сразу, пауза RECOVERY_BACKOFF_MS - только после неудачи всех уровней.
+    // Кэш карт и позиция сканирования ScanMatrix при этом сохраняются
+#ifdef I2C_TRACE
+    // Обмен до потери PN532 - в SPIFFS, пока кольцо его не вытеснило
+    i2cTrace.spill();
+#endif
+    if (rfidManager.reconnect()) {
+        DEBUG_PRINTLN("✅ Подключение восстановлено!");
+        stateManager.setState(STATE_SCANNING);
     }
 }
 
@@ -236,26 +263,42 @@ void handleErrorRecovery() {
 // =============================================
 
 void handlePeriodicTasks() {
-    // Периодическое обновление дисплея (раз в 5 секунд)
+    // Команды консоли: не больше одной за проход
+    serialConsole.poll();
+    
+    // Периодическое обновление дисплея (STATUS_REPORT_INTERVAL_MS, консоль: set report)
     static unsigned long lastDisplay = 0;
-    if (millis() - lastDisplay >= 5000) {
+    unsigned long reportInterval = serialConsole.getReportInterval();
+    if (reportInterval > 0 && millis() - lastDisplay >= reportInterval) {
         if (stateManager.getCurrentState() != STATE_ERROR) {
             displayManager.printSystemStatus();
         }
+#ifdef I2C_FAULT_INJECTION
+        if (i2cFaultInjector.getTotalInjected() > 0) {
+            i2cFaultInjector.printStatus();
+        }
+#endif
+#ifdef I2C_TRACE
+        if (i2cTrace.isStreaming() || i2cTrace.getSpills() > 0) {
+            i2cTrace.printStatus();
+        }
+#endif
         lastDisplay = millis();
     }
     
-    // Проверка подключения RFID (раз в 10 секунд) 
-    static unsigned long lastRFIDCheck = 0;
-    if (millis() - lastRFIDCheck >= 10000) {
-        rfidManager.checkConnection();
-        
-        // Если PN532 отключился во время работы
-        if (!rfidManager.getConnected() && stateManager.getCurrentState() == STATE_SCANNING) {
-            stateManager.setState(STATE_ERROR);
-        }
-        
-        lastRFIDCheck = millis();
+#ifdef I2C_TRACE
+    i2cTrace.poll();
+#endif
+    memoryMonitor.update();         // Первый вызов - снимок на конец setup()
+    metrics.poll();
+    
+    // Живость PN532 выводится из трафика сканирования, проба GetGeneralStatus
+    // уходит только после тишины или серии неудачных транзакций
+    rfidManager.checkConnection();
+    
+    // Если PN532 отключился во время работы
+    if (!rfidManager.getConnected() && stateManager.getCurrentState() == STATE_SCANNING) {
+        stateManager.setState(STATE_ERROR);
     }
 }
 
@@ -0,0 +1,148 @@
+#include "memory_monitor.h"
+#include <esp_heap_caps.h>
+
+MemoryMonitor::MemoryMonitor() {
+    taskCount = 0;
+    baselineTaken = false;
+    memset(&baseline, 0, sizeof(baseline));
+    memset(&last, 0, sizeof(last));
+    maxBlocksGrown = 0;
+    nextBlocksAlert = 1;
+    heapWarned = false;
+    lastSampleTime = 0;
+    samples = 0;
+    lastSampleUs = 0;
+
+    heapFree = metrics.gauge("mem.heap_free");
+    heapMin = metrics.gauge("mem.heap_min");
+    heapLargest = metrics.gauge("mem.heap_largest");
+    heapBlocksGrown = metrics.gauge("mem.heap_blocks_grown");
+    alerts = metrics.counter("mem.alerts");
+
+    // Задача loop(): дескриптор - при первом update()
+    watchTask("mem.stack_loop", nullptr);
+}
+
+bool MemoryMonitor::watchTask(const char* metricName, TaskHandle_t handle) {
+    if (taskCount >= MEMORY_MAX_TASKS) {
+        return false;
+    }
+    TaskWatch& task = tasks[taskCount++];
+    task.metricName = metricName;
+    task.handle = handle;
+    task.freeStack = 0;
+    task.warned = false;
+    task.gauge = metrics.gauge(metricName);
+    return true;
+}
+
+void MemoryMonitor::update() {
+    if (!baselineTaken) {
+        takeBaseline();
+        return;
+    }
+    if (millis() - lastSampleTime < MEMORY_SAMPLE_INTERVAL_MS) {
+        return;
+    }
+    sample();
+}
+
+void MemoryMonitor::takeBaseline() {
+    // Первый вызов из loop(): setup() завершен, дальше куча не должна расти
+    tasks[0].handle = xTaskGetCurrentTaskHandle();
+    sample();
+    baseline = last;
+    baselineTaken = true;
+    DEBUG_PRINTF("MemoryMonitor: после setup() свободно %lu байт кучи (блок до %lu), %lu блоков, стек loop() - запас %lu байт\n",
+                 (unsigned long)baseline.freeBytes, (unsigned long)baseline.largestBlock,
+                 (unsigned long)baseline.allocatedBlocks, (unsigned long)tasks[0].freeStack);
+}
+
+void MemoryMonitor::readHeap(HeapSample& out) const {
+    multi_heap_info_t info;
+    heap_caps_get_info(&info, MALLOC_CAP_8BIT);
+    out.freeBytes = info.total_free_bytes;
+    out.minFreeBytes = info.minimum_free_bytes;
+    out.largestBlock = info.largest_free_block;
+    out.allocatedBlocks = info.allocated_blocks;
+}
+
+void MemoryMonitor::sample() {
+    unsigned long startUs = micros();
+    readHeap(last);
+    heapFree.set((int32_t)last.freeBytes);
+    heapMin.set((int32_t)last.minFreeBytes);
+    heapLargest.set((int32_t)last.largestBlock);
+
+    if (baselineTaken) {
+        int32_t grown = getBlocksGrown();
+        heapBlocksGrown.set(grown);
+        if (grown > maxBlocksGrown) {
+            maxBlocksGrown = grown;
+        }
+        // Раз на пересечение порога: первый блок, дальше каждые
+        // MEMORY_BLOCKS_ALERT_STEP - медленная утечка не забивает лог
+        if (grown >= nextBlocksAlert) {
+            nextBlocksAlert = (grown / MEMORY_BLOCKS_ALERT_STEP + 1) * MEMORY_BLOCKS_ALERT_STEP;
+            alerts.add();
+            DEBUG_PRINTF("⚠️ MemoryMonitor: +%ld блоков кучи с конца setup() (свободно %lu байт)\n",
+                         (long)grown, (unsigned long)last.freeBytes);
+        }
+    }
+    if (!heapWarned && last.minFreeBytes < MEMORY_HEAP_WARN_BYTES) {
+        heapWarned = true;
+        alerts.add();
+        DEBUG_PRINTF("⚠️ MemoryMonitor: минимум свободной кучи %lu байт\n", (unsigned long)last.minFreeBytes);
+    }
+
+    for (int i = 0; i < taskCount; i++) {
+        TaskWatch& task = tasks[i];
+        if (task.handle == nullptr) continue;
+        task.freeStack = uxTaskGetStackHighWaterMark(task.handle);
+        task.gauge.set((int32_t)task.freeStack);
+        if (!task.warned && task.freeStack < MEMORY_STACK_WARN_BYTES) {
+            task.warned = true;
+            alerts.add();
+            DEBUG_PRINTF("⚠️ MemoryMonitor: %s - запас стека %lu байт\n", task.metricName,
+                         (unsigned long)task.freeStack);
+        }
+    }
+
+    samples++;
+    lastSampleTime = millis();
+    lastSampleUs = micros() - startUs;
+}
+
+int32_t MemoryMonitor::getBlocksGrown() const {
+    if (!baselineTaken) return 0;
+    return (int32_t)last.allocatedBlocks - (int32_t)baseline.allocatedBlocks;
+}
+
+uint32_t MemoryMonitor::getFragmentationPermille() const {
+    if (last.freeBytes == 0) return 0;
+    return 1000 - (uint32_t)((uint64_t)last.largestBlock * 1000 / last.freeBytes);
+}
+
+void MemoryMonitor::printReport() const {
+    DEBUG_PRINTLN("========================================");
+    DEBUG_PRINTLN("ПАМЯТЬ");
+    DEBUG_PRINTLN("========================================");
+    if (!baselineTaken) {
+        DEBUG_PRINTLN("Снимков еще нет (до первого loop())");
+        DEBUG_PRINTLN("========================================");
+        return;
+    }
+    DEBUG_PRINTF("Куча: свободно %lu байт, минимум %lu, наибольший блок %lu (фрагментация %lu‰)\n",
+                 (unsigned long)last.freeBytes, (unsigned long)last.minFreeBytes,
+                 (unsigned long)last.largestBlock, (unsigned long)getFragmentationPermille());
+    DEBUG_PRINTF("Блоков: %lu, с конца setup() %+ld (наибольший рост %+ld)\n",
+                 (unsigned long)last.allocatedBlocks, (long)getBlocksGrown(), (long)maxBlocksGrown);
+    DEBUG_PRINTF("После setup(): свободно %lu байт, изменение %+ld\n",
+                 (unsigned long)baseline.freeBytes, (long)last.freeBytes - (long)baseline.freeBytes);
+    for (int i = 0; i < taskCount; i++) {
+        DEBUG_PRINTF("%s: запас стека %lu байт\n", tasks[i].metricName, (unsigned long)tasks[i].freeStack);
+    }
+    DEBUG_PRINTF("Снимков: %lu, последний %lu мкс, предупреждений %lu\n",
+                 (unsigned long)samples, lastSampleUs, (unsigned long)alerts.get());
+    DEBUG_PRINTLN("========================================");
+}
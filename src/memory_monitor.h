@@ -0,0 +1,90 @@
+#ifndef MEMORY_MONITOR_H
+#define MEMORY_MONITOR_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "config.h"
+#include "metrics.h"
+
+// Снимок кучи (heap_caps_get_info, MALLOC_CAP_8BIT)
+struct HeapSample {
+    uint32_t freeBytes;
+    uint32_t minFreeBytes;          // Минимум с загрузки (ведет ESP-IDF)
+    uint32_t largestBlock;          // Наибольший свободный блок
+    uint32_t allocatedBlocks;
+};
+
+// Наблюдение за памятью: куча и запас стека задач. Первый update() из loop()
+// запоминает кучу на конец setup() и задачу loop(); дальше раз в
+// MEMORY_SAMPLE_INTERVAL_MS - снимок в реестр метрик. Рост числа блоков кучи
+// после setup() - выделение без освобождения (утечка или новый new в работе).
+// Куча общая на все задачи: FreeRTOS не ведет ее по задачам.
+// Стек смотрим только у loop(): прошивка не создает задач (нет xTaskCreate,
+// WiFi/BLE и программных таймеров), прерывание PN532 - ISR с семафором,
+// который ждет сама loop(). Системные задачи (IDLE, ipc, esp_timer) кода
+// прошивки не исполняют; watchTask() - для задач, если они появятся
+class MemoryMonitor {
+private:
+    struct TaskWatch {
+        const char* metricName;     // Строковая константа: mem.stack_<задача>
+        TaskHandle_t handle;
+        uint32_t freeStack;         // Запас стека с начала задачи, байт
+        bool warned;
+        MetricGauge gauge;
+    };
+
+    TaskWatch tasks[MEMORY_MAX_TASKS];
+    uint8_t taskCount;
+
+    bool baselineTaken;
+    HeapSample baseline;            // Конец setup()
+    HeapSample last;
+    int32_t maxBlocksGrown;         // Наибольший рост числа блоков с конца setup()
+    int32_t nextBlocksAlert;        // Порог роста для следующего предупреждения
+    bool heapWarned;
+
+    unsigned long lastSampleTime;
+    uint32_t samples;
+    unsigned long lastSampleUs;     // Цена снимка (обход кучи и стека)
+
+    MetricGauge heapFree;
+    MetricGauge heapMin;
+    MetricGauge heapLargest;
+    MetricGauge heapBlocksGrown;
+    MetricCounter alerts;
+
+public:
+    MemoryMonitor();
+
+    // Еще одна задача под наблюдением (loop() добавляется сам); false - нет места
+    bool watchTask(const char* metricName, TaskHandle_t handle);
+
+    void update();                  // Вызывается из loop()
+    void sample();                  // Снимок сейчас (консоль, стенды)
+
+    bool isBaselineTaken() const { return baselineTaken; }
+    const HeapSample& getBaseline() const { return baseline; }
+    const HeapSample& getLastSample() const { return last; }
+    int32_t getBlocksGrown() const;
+    int32_t getMaxBlocksGrown() const { return maxBlocksGrown; }
+    uint32_t getFragmentationPermille() const;
+    uint32_t getLoopStackFree() const { return tasks[0].freeStack; }
+    uint8_t getTaskCount() const { return taskCount; }
+    uint32_t getTaskStackFree(int index) const { return tasks[index].freeStack; }
+    const char* getTaskMetricName(int index) const { return tasks[index].metricName; }
+    uint32_t getAlertCount() const { return alerts.get(); }
+    uint32_t getSampleCount() const { return samples; }
+    unsigned long getLastSampleUs() const { return lastSampleUs; }
+
+    void printReport() const;
+
+private:
+    void takeBaseline();
+    void readHeap(HeapSample& out) const;
+};
+
+// Глобальный монитор (src/main.cpp)
+extern MemoryMonitor memoryMonitor;
+
+#endif // MEMORY_MONITOR_H
@@ -0,0 +1,359 @@
+#include "metrics.h"
+#include "crc32.h"
+
+static const uint8_t FRAME_SYNC_0 = 0xA5;
+static const uint8_t FRAME_SYNC_1 = 0x5A;
+static const size_t FRAME_OVERHEAD = 9;         // Синхрослово, тип, длина, CRC
+static const size_t NAME_MAX = 31;              // Длиннее в схеме обрезается
+
+static const size_t MAX_SCHEMA_BYTES = 5 + METRICS_MAX_ENTRIES * (3 + NAME_MAX) +
+                                       METRICS_MAX_HISTOGRAMS * (METRICS_HISTOGRAM_BUCKETS - 1) * 4;
+
+// Запасной слот для ручек по умолчанию и регистраций сверх лимита
+static uint32_t spareCells[METRICS_HISTOGRAM_BUCKETS + 1];
+
+// Кадр собирается здесь, а не на стеке loop()
+static uint8_t frameBuffer[FRAME_OVERHEAD + MAX_SCHEMA_BYTES];
+
+static void putLe32(uint8_t* out, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        out[i] = (value >> (8 * i)) & 0xFF;
+    }
+}
+
+static uint32_t loadCell(const uint32_t* cell) {
+    return __atomic_load_n(cell, __ATOMIC_RELAXED);
+}
+
+static size_t nameLength(const char* name) {
+    size_t length = strlen(name);
+    return (length > NAME_MAX) ? NAME_MAX : length;
+}
+
+// =============================================
+// РУЧКИ
+// =============================================
+
+MetricCounter::MetricCounter() : cell(&spareCells[0]) {}
+
+MetricGauge::MetricGauge() : cell(&spareCells[0]) {}
+
+MetricHistogram::MetricHistogram() : sum(&spareCells[0]), buckets(&spareCells[1]), bounds(nullptr), boundCount(0) {}
+
+void MetricHistogram::observe(uint32_t value) {
+    uint8_t bucket = 0;
+    while (bucket < boundCount && value > bounds[bucket]) {
+        bucket++;
+    }
+    __atomic_fetch_add(&buckets[bucket], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(sum, value, __ATOMIC_RELAXED);
+}
+
+void MetricHistogram::reset() {
+    for (uint8_t i = 0; i <= boundCount; i++) {
+        __atomic_store_n(&buckets[i], 0, __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(sum, 0, __ATOMIC_RELAXED);
+}
+
+uint32_t MetricHistogram::getCount() const {
+    uint32_t count = 0;
+    for (uint8_t i = 0; i <= boundCount; i++) {
+        count += loadCell(&buckets[i]);
+    }
+    return count;
+}
+
+uint32_t MetricHistogram::getMean() const {
+    uint32_t count = getCount();
+    return count ? getSum() / count : 0;
+}
+
+// =============================================
+// РЕГИСТРАЦИЯ
+// =============================================
+
+MetricsRegistry::MetricsRegistry() {
+    memset(slots, 0, sizeof(slots));
+    memset(histograms, 0, sizeof(histograms));
+    slotCount = 0;
+    histogramCount = 0;
+    dropped = 0;
+    schemaId = 0;
+    snapshotSequence = 0;
+    output = &Serial;
+    streamIntervalMs = METRICS_STREAM_INTERVAL_MS;
+    lastStreamTime = 0;
+    streamedSchemaId = 0;
+    updateSchemaId();
+}
+
+int MetricsRegistry::findSlot(const char* name) const {
+    for (uint8_t i = 0; i < slotCount; i++) {
+        if (strcmp(slots[i].name, name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int MetricsRegistry::addSlot(const char* name, MetricType type) {
+    int index = findSlot(name);
+    if (index >= 0) {
+        if (slots[index].type != type) {
+            DEBUG_PRINTF("Metrics: ОШИБКА - %s уже зарегистрирована другого вида\n", name);
+            dropped++;
+            return -1;
+        }
+        __atomic_store_n(&slots[index].value, 0, __ATOMIC_RELAXED);
+        slots[index].readValue = 0;
+        return index;
+    }
+    if (slotCount >= METRICS_MAX_ENTRIES) {
+        DEBUG_PRINTF("Metrics: ОШИБКА - нет места для %s\n", name);
+        dropped++;
+        return -1;
+    }
+    Slot& slot = slots[slotCount];
+    slot.name = name;
+    slot.type = type;
+    slot.histogram = -1;
+    slot.value = 0;
+    slot.readValue = 0;
+    return slotCount++;
+}
+
+MetricCounter MetricsRegistry::counter(const char* name) {
+    int index = addSlot(name, METRIC_COUNTER);
+    if (index < 0) {
+        return MetricCounter();
+    }
+    updateSchemaId();
+    return MetricCounter(&slots[index].value);
+}
+
+MetricGauge MetricsRegistry::gauge(const char* name) {
+    int index = addSlot(name, METRIC_GAUGE);
+    if (index < 0) {
+        return MetricGauge();
+    }
+    updateSchemaId();
+    return MetricGauge(&slots[index].value);
+}
+
+MetricHistogram MetricsRegistry::histogram(const char* name, const uint32_t* upperBounds, uint8_t boundCount) {
+    if (boundCount > METRICS_HISTOGRAM_BUCKETS - 1) {
+        boundCount = METRICS_HISTOGRAM_BUCKETS - 1;
+    }
+    bool existed = findSlot(name) >= 0;
+    if (!existed && histogramCount >= METRICS_MAX_HISTOGRAMS) {
+        DEBUG_PRINTF("Metrics: ОШИБКА - нет места для гистограммы %s\n", name);
+        dropped++;
+        return MetricHistogram();
+    }
+    int index = addSlot(name, METRIC_HISTOGRAM);
+    if (index < 0) {
+        return MetricHistogram();
+    }
+    Slot& slot = slots[index];
+    if (slot.histogram < 0) {
+        slot.histogram = histogramCount++;
+    }
+    HistogramCells& cells = histograms[slot.histogram];
+    cells.bounds = upperBounds;
+    cells.boundCount = boundCount;
+    for (uint8_t i = 0; i < METRICS_HISTOGRAM_BUCKETS; i++) {
+        __atomic_store_n(&cells.buckets[i], 0, __ATOMIC_RELAXED);
+        cells.readBuckets[i] = 0;
+    }
+    updateSchemaId();
+    return MetricHistogram(&slot.value, cells.buckets, upperBounds, boundCount);
+}
+
+void MetricsRegistry::updateSchemaId() {
+    // Те же поля, что в кадре схемы: хост сверяет id снимка со схемой
+    uint32_t crc = 0xFFFFFFFF;
+    for (uint8_t i = 0; i < slotCount; i++) {
+        const Slot& slot = slots[i];
+        uint8_t header[2] = {slot.type, 0};
+        if (slot.histogram >= 0) {
+            header[1] = histograms[slot.histogram].boundCount;
+        }
+        crc = crc32Update(crc, header, sizeof(header));
+        for (uint8_t b = 0; b < header[1]; b++) {
+            uint8_t bound[4];
+            putLe32(bound, histograms[slot.histogram].bounds[b]);
+            crc = crc32Update(crc, bound, sizeof(bound));
+        }
+        crc = crc32Update(crc, (const uint8_t*)slot.name, nameLength(slot.name));
+    }
+    schemaId = ~crc;
+}
+
+// =============================================
+// ДВОИЧНЫЕ ФОРМЫ
+// =============================================
+
+size_t MetricsRegistry::getSchemaBytes() const {
+    size_t bytes = 5;
+    for (uint8_t i = 0; i < slotCount; i++) {
+        const Slot& slot = slots[i];
+        bytes += 3 + nameLength(slot.name);
+        if (slot.histogram >= 0) {
+            bytes += histograms[slot.histogram].boundCount * 4;
+        }
+    }
+    return bytes;
+}
+
+size_t MetricsRegistry::getSnapshotBytes() const {
+    size_t bytes = SNAPSHOT_HEADER_BYTES;
+    for (uint8_t i = 0; i < slotCount; i++) {
+        const Slot& slot = slots[i];
+        bytes += 4;
+        if (slot.histogram >= 0) {
+            bytes += (histograms[slot.histogram].boundCount + 1) * 4;
+        }
+    }
+    return bytes;
+}
+
+size_t MetricsRegistry::writeSchema(uint8_t* out, size_t capacity) const {
+    if (capacity < getSchemaBytes()) {
+        return 0;
+    }
+    uint8_t* p = out;
+    putLe32(p, schemaId);
+    p[4] = slotCount;
+    p += 5;
+    for (uint8_t i = 0; i < slotCount; i++) {
+        const Slot& slot = slots[i];
+        uint8_t boundCount = (slot.histogram >= 0) ? histograms[slot.histogram].boundCount : 0;
+        *p++ = slot.type;
+        *p++ = boundCount;
+        for (uint8_t b = 0; b < boundCount; b++) {
+            putLe32(p, histograms[slot.histogram].bounds[b]);
+            p += 4;
+        }
+        size_t length = nameLength(slot.name);
+        *p++ = length;
+        memcpy(p, slot.name, length);
+        p += length;
+    }
+    return p - out;
+}
+
+size_t MetricsRegistry::writeSnapshot(uint8_t* out, size_t capacity, bool delta) {
+    if (capacity < getSnapshotBytes()) {
+        return 0;
+    }
+    uint8_t* p = out;
+    putLe32(p, schemaId);
+    putLe32(p + 4, snapshotSequence++);
+    putLe32(p + 8, millis());
+    p[12] = delta ? 1 : 0;
+    p[13] = slotCount;
+    p += SNAPSHOT_HEADER_BYTES;
+
+    for (uint8_t i = 0; i < slotCount; i++) {
+        Slot& slot = slots[i];
+        uint32_t value = loadCell(&slot.value);
+        uint32_t written = value;
+        if (delta && slot.type != METRIC_GAUGE) {
+            // Меньше прошлого чтения - счетчик сброшен, приращение с нуля
+            written = (value >= slot.readValue) ? value - slot.readValue : value;
+            slot.readValue = value;
+        }
+        putLe32(p, written);
+        p += 4;
+
+        if (slot.histogram >= 0) {
+            HistogramCells& cells = histograms[slot.histogram];
+            for (uint8_t b = 0; b <= cells.boundCount; b++) {
+                uint32_t count = loadCell(&cells.buckets[b]);
+                uint32_t bucketWritten = count;
+                if (delta) {
+                    bucketWritten = (count >= cells.readBuckets[b]) ? count - cells.readBuckets[b] : count;
+                    cells.readBuckets[b] = count;
+                }
+                putLe32(p, bucketWritten);
+                p += 4;
+            }
+        }
+    }
+    return p - out;
+}
+
+// =============================================
+// ПОТОК В SERIAL
+// =============================================
+
+bool MetricsRegistry::sendFrame(uint8_t type, size_t payload) {
+    if (output == nullptr || payload == 0) {
+        return false;
+    }
+    frameBuffer[0] = FRAME_SYNC_0;
+    frameBuffer[1] = FRAME_SYNC_1;
+    frameBuffer[2] = type;
+    frameBuffer[3] = payload & 0xFF;
+    frameBuffer[4] = payload >> 8;
+    putLe32(frameBuffer + 5 + payload, ~crc32Update(0xFFFFFFFF, frameBuffer + 2, 3 + payload));
+    output->write(frameBuffer, FRAME_OVERHEAD + payload);
+    return true;
+}
+
+bool MetricsRegistry::sendSchema() {
+    size_t payload = writeSchema(frameBuffer + 5, MAX_SCHEMA_BYTES);
+    if (!sendFrame(METRICS_FRAME_SCHEMA, payload)) {
+        return false;
+    }
+    streamedSchemaId = schemaId;
+    return true;
+}
+
+bool MetricsRegistry::sendSnapshot(bool delta) {
+    if (streamedSchemaId != schemaId && !sendSchema()) {
+        return false;
+    }
+    return sendFrame(METRICS_FRAME_SNAPSHOT, writeSnapshot(frameBuffer + 5, MAX_SCHEMA_BYTES, delta));
+}
+
+void MetricsRegistry::poll() {
+    if (streamIntervalMs == 0 || millis() - lastStreamTime < streamIntervalMs) {
+        return;
+    }
+    lastStreamTime = millis();
+    sendSnapshot(true);
+}
+
+void MetricsRegistry::printAll() const {
+    DEBUG_PRINTF("Metrics: %u метрик, схема %08lX, снимков %lu\n",
+                 slotCount, schemaId, snapshotSequence);
+    for (uint8_t i = 0; i < slotCount; i++) {
+        const Slot& slot = slots[i];
+        uint32_t value = loadCell(&slot.value);
+        if (slot.type == METRIC_COUNTER) {
+            DEBUG_PRINTF("  %-28s %lu\n", slot.name, value);
+        } else if (slot.type == METRIC_GAUGE) {
+            DEBUG_PRINTF("  %-28s %ld\n", slot.name, (int32_t)value);
+        } else {
+            const HistogramCells& cells = histograms[slot.histogram];
+            uint32_t count = 0;
+            for (uint8_t b = 0; b <= cells.boundCount; b++) {
+                count += loadCell(&cells.buckets[b]);
+            }
+            DEBUG_PRINTF("  %-28s n=%lu, среднее=%lu:", slot.name, count, count ? value / count : 0);
+            for (uint8_t b = 0; b <= cells.boundCount; b++) {
+                if (b < cells.boundCount) {
+                    DEBUG_PRINTF(" <=%lu:%lu", cells.bounds[b], loadCell(&cells.buckets[b]));
+                } else {
+                    DEBUG_PRINTF(" >:%lu", loadCell(&cells.buckets[b]));
+                }
+            }
+            DEBUG_PRINTLN("");
+        }
+    }
+    if (dropped > 0) {
+        DEBUG_PRINTF("  не зарегистрировано: %lu\n", dropped);
+    }
+}
@@ -0,0 +1,142 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// Виды метрик
+enum MetricType {
+    METRIC_COUNTER,             // Растет с начала работы (uint32, с переполнением)
+    METRIC_GAUGE,               // Текущее значение (int32)
+    METRIC_HISTOGRAM            // Число наблюдений по корзинам + сумма значений
+};
+
+// Кадры в Serial - тот же формат, что у трассы I2C (i2c_trace.h):
+// A5 5A | тип | длина (2, LE) | данные | CRC32 (4, LE) от типа до конца данных
+enum MetricsFrameType {
+    METRICS_FRAME_SCHEMA   = 'D',   // Имена, виды и границы корзин
+    METRICS_FRAME_SNAPSHOT = 'M'    // Значения в порядке схемы
+};
+
+// Обновления - атомарные (__atomic, relaxed): метрики пишут задачи обоих ядер,
+// снимок читает loop(). Ручки копируются по значению и остаются валидными
+// все время работы; при переполнении реестра пишут в общий запасной слот
+
+class MetricCounter {
+private:
+    uint32_t* cell;
+public:
+    MetricCounter();
+    explicit MetricCounter(uint32_t* value) : cell(value) {}
+    void add(uint32_t amount = 1) { __atomic_fetch_add(cell, amount, __ATOMIC_RELAXED); }
+    void reset() { __atomic_store_n(cell, 0, __ATOMIC_RELAXED); }
+    uint32_t get() const { return __atomic_load_n(cell, __ATOMIC_RELAXED); }
+};
+
+class MetricGauge {
+private:
+    uint32_t* cell;
+public:
+    MetricGauge();
+    explicit MetricGauge(uint32_t* value) : cell(value) {}
+    void set(int32_t value) { __atomic_store_n(cell, (uint32_t)value, __ATOMIC_RELAXED); }
+    int32_t get() const { return (int32_t)__atomic_load_n(cell, __ATOMIC_RELAXED); }
+};
+
+class MetricHistogram {
+private:
+    uint32_t* sum;
+    uint32_t* buckets;
+    const uint32_t* bounds;     // Верхние границы корзин включительно, по возрастанию
+    uint8_t boundCount;         // Корзин - на одну больше (переполнение)
+public:
+    MetricHistogram();
+    MetricHistogram(uint32_t* sumCell, uint32_t* bucketCells, const uint32_t* upperBounds, uint8_t count)
+        : sum(sumCell), buckets(bucketCells), bounds(upperBounds), boundCount(count) {}
+    void observe(uint32_t value);
+    void reset();
+    uint32_t getCount() const;
+    uint32_t getSum() const { return __atomic_load_n(sum, __ATOMIC_RELAXED); }
+    uint32_t getMean() const;
+};
+
+// Реестр: модули регистрируют метрики в конструкторах. Повторная регистрация
+// того же имени (объект создан заново) возвращает тот же слот с нулем
+class MetricsRegistry {
+public:
+    static const size_t SNAPSHOT_HEADER_BYTES = 14;    // Схема (4), номер (4), millis (4), флаги, число метрик
+
+private:
+    struct Slot {
+        const char* name;           // Строковая константа модуля
+        uint8_t type;
+        int8_t histogram;           // Индекс в пуле гистограмм
+        uint32_t value;             // Счетчик, датчик; у гистограммы - сумма
+        uint32_t readValue;         // На момент прошлого чтения с приращениями
+    };
+    struct HistogramCells {
+        const uint32_t* bounds;
+        uint8_t boundCount;
+        uint32_t buckets[METRICS_HISTOGRAM_BUCKETS];
+        uint32_t readBuckets[METRICS_HISTOGRAM_BUCKETS];
+    };
+
+    Slot slots[METRICS_MAX_ENTRIES];
+    HistogramCells histograms[METRICS_MAX_HISTOGRAMS];
+    uint8_t slotCount;
+    uint8_t histogramCount;
+    uint32_t dropped;               // Регистрации сверх METRICS_MAX_ENTRIES
+
+    uint32_t schemaId;              // CRC32 схемы, меняется с составом метрик
+    uint32_t snapshotSequence;
+
+    // Поток в Serial
+    Print* output;
+    unsigned long streamIntervalMs;
+    unsigned long lastStreamTime;
+    uint32_t streamedSchemaId;      // Схема, уже отправленная в поток
+
+public:
+    MetricsRegistry();
+
+    MetricCounter counter(const char* name);
+    MetricGauge gauge(const char* name);
+    MetricHistogram histogram(const char* name, const uint32_t* upperBounds, uint8_t boundCount);
+
+    size_t getCount() const { return slotCount; }
+    uint32_t getDropped() const { return dropped; }
+    uint32_t getSchemaId() const { return schemaId; }
+    uint32_t getSnapshotSequence() const { return snapshotSequence; }
+
+    // Двоичные формы (LE). Схема: id (4), число метрик, затем на метрику вид,
+    // число границ, границы (по 4), длина имени, имя. Снимок: заголовок, затем
+    // по 4 байта на счетчик/датчик и (корзины + 1) * 4 на гистограмму.
+    // delta - счетчики и корзины как приращения с прошлого чтения с delta
+    // (сброс счетчика дает его значение целиком), датчики - как есть.
+    // Возвращают 0, если не хватает места
+    size_t writeSchema(uint8_t* out, size_t capacity) const;
+    size_t writeSnapshot(uint8_t* out, size_t capacity, bool delta);
+    size_t getSchemaBytes() const;
+    size_t getSnapshotBytes() const;
+
+    // Кадры в поток; снимку предшествует схема, если она изменилась с прошлой отправки
+    void setOutput(Print* stream) { output = stream; }
+    void setStreamInterval(unsigned long intervalMs) { streamIntervalMs = intervalMs; }
+    unsigned long getStreamInterval() const { return streamIntervalMs; }
+    bool sendSchema();
+    bool sendSnapshot(bool delta);
+    void poll();                    // Вызывается из loop()
+
+    void printAll() const;
+
+private:
+    int findSlot(const char* name) const;
+    int addSlot(const char* name, MetricType type);
+    void updateSchemaId();
+    bool sendFrame(uint8_t type, size_t payload);
+};
+
+// Глобальный реестр (src/main.cpp, до менеджеров)
+extern MetricsRegistry metrics;
+
+#endif // METRICS_H
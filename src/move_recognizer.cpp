@@ -0,0 +1,588 @@
+#include "move_recognizer.h"
+
+static int fileOf(int square) { return square % 8; }
+static int rankOf(int square) { return square / 8; }
+static bool isWhitePiece(char type) { return type >= 'A' && type <= 'Z'; }
+
+static char upperType(char type) {
+    return (type >= 'a' && type <= 'z') ? type - 'a' + 'A' : type;
+}
+
+MoveRecognizer::MoveRecognizer() {
+    callback = nullptr;
+    callbackContext = nullptr;
+    reset();
+}
+
+void MoveRecognizer::reset() {
+    active = false;
+    pieceCount = 0;
+    for (int i = 0; i < 64; i++) {
+        committed[i] = -1;
+        current[i] = -1;
+    }
+    followFrom = -1;
+    followTo = -1;
+    deferred = false;
+    deferredSince = 0;
+    deferredTo = -1;
+    whiteToMove = true;
+    lastPhysicalTime = 0;
+    ply = 0;
+    logHead = 0;
+    logCount = 0;
+    for (int i = 0; i < CHESS_EVENT_TYPE_COUNT; i++) {
+        eventCounts[i] = 0;
+    }
+    outOfOrder = 0;
+    heldMoves = 0;
+    inferredMoves = 0;
+    followUps = 0;
+    unknownTags = 0;
+    totalLatencyMs = 0;
+    maxLatencyMs = 0;
+}
+
+void MoveRecognizer::setCallback(ChessEventCallback onEvent, void* context) {
+    callback = onEvent;
+    callbackContext = context;
+}
+
+int MoveRecognizer::cellToSquare(int cellIndex) {
+    if (cellIndex < 0 || cellIndex >= MATRIX_TOTAL_CELLS) {
+        return -1;
+    }
+    int rank = cellIndex / MATRIX_COLS;
+    int file = cellIndex % MATRIX_COLS - CHESS_FILE_A_COL;
+    if (rank > 7 || file < 0 || file > 7) {
+        return -1;
+    }
+    return rank * 8 + file;
+}
+
+int MoveRecognizer::squareToCell(int square) {
+    if (square < 0 || square >= 64) {
+        return -1;
+    }
+    return rankOf(square) * MATRIX_COLS + CHESS_FILE_A_COL + fileOf(square);
+}
+
+void MoveRecognizer::squareName(int square, char* out) {
+    out[0] = 'a' + fileOf(square);
+    out[1] = '1' + rankOf(square);
+    out[2] = '\0';
+}
+
+bool MoveRecognizer::isStartPosition(const CardInfo* cardCache) {
+    for (int square = 0; square < 64; square++) {
+        int rank = rankOf(square);
+        bool expected = rank <= 1 || rank >= 6;
+        if (cardCache[squareToCell(square)].present != expected) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int MoveRecognizer::beginGame(const CardInfo* cardCache) {
+    static const char backRank[] = "RNBQKBNR";
+
+    reset();
+    int onBoard = 0;
+
+    for (int cell = 0; cell < MATRIX_TOTAL_CELLS; cell++) {
+        const CardInfo& info = cardCache[cell];
+        if (!info.present) {
+            continue;
+        }
+        int square = cellToSquare(cell);
+        char type = '?';
+        if (square >= 0) {
+            int rank = rankOf(square);
+            if (rank == 0) type = backRank[fileOf(square)];
+            else if (rank == 1) type = 'P';
+            else if (rank == 6) type = 'p';
+            else if (rank == 7) type = backRank[fileOf(square)] - 'A' + 'a';
+        }
+
+        int piece = addPiece(info.uid, info.uidLength, type);
+        if (piece < 0) {
+            break;
+        }
+        if (square >= 0) {
+            pieces[piece].square = square;
+            committed[square] = piece;
+            current[square] = piece;
+            onBoard++;
+        }
+    }
+
+    active = true;
+    DEBUG_PRINTF("MoveRecognizer: Партия начата, фигур на доске %d, меток всего %d\n", onBoard, pieceCount);
+    return onBoard;
+}
+
+bool MoveRecognizer::registerPiece(const uint8_t* uid, uint8_t uidLength, char type) {
+    int piece = findPiece(uid, uidLength);
+    if (piece < 0) {
+        piece = addPiece(uid, uidLength, type);
+    }
+    if (piece < 0) {
+        return false;
+    }
+    pieces[piece].type = type;
+    return true;
+}
+
+int MoveRecognizer::findPiece(const uint8_t* uid, uint8_t uidLength) const {
+    for (int i = 0; i < pieceCount; i++) {
+        if (pieces[i].uidLength == uidLength && memcmp(pieces[i].uid, uid, uidLength) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int MoveRecognizer::addPiece(const uint8_t* uid, uint8_t uidLength, char type) {
+    if (pieceCount >= CHESS_MAX_PIECES || uidLength > UID_BUFFER_SIZE) {
+        return -1;
+    }
+    Piece& piece = pieces[pieceCount];
+    memcpy(piece.uid, uid, uidLength);
+    piece.uidLength = uidLength;
+    piece.type = type;
+    piece.square = -1;
+    return pieceCount++;
+}
+
+void MoveRecognizer::onCellEvent(int cellIndex, CardEventKind kind, const uint8_t* uid, uint8_t uidLength,
+                                 unsigned long physicalTime) {
+    if (!active) {
+        return;
+    }
+
+    lastPhysicalTime = physicalTime;
+    int square = cellToSquare(cellIndex);
+
+    if (kind == CARD_EVENT_REMOVED || kind == CARD_EVENT_REPLACED) {
+        if (square >= 0) {
+            if (current[square] >= 0) {
+                liftFrom(square);
+            } else if (kind == CARD_EVENT_REMOVED) {
+                // Метку уже сняли неявно: ее установку проход увидел раньше
+                outOfOrder++;
+            }
+        }
+    }
+
+    if (kind == CARD_EVENT_ADDED || kind == CARD_EVENT_REPLACED) {
+        int piece = findPiece(uid, uidLength);
+        if (piece < 0) {
+            piece = addPiece(uid, uidLength, '?');
+            unknownTags++;
+        }
+        if (piece >= 0) {
+            int previous = pieces[piece].square;
+            if (previous >= 0 && previous != square) {
+                // Установка раньше снятия: прежнее поле проход еще не пересканировал
+                outOfOrder++;
+                liftFrom(previous);
+            }
+            if (square >= 0) {
+                int occupant = current[square];
+                if (occupant >= 0 && occupant != piece) {
+                    // Снятие прежней фигуры пропущено
+                    outOfOrder++;
+                    pieces[occupant].square = -1;
+                }
+                placeOn(square, piece);
+            }
+        }
+    }
+
+    classify();
+}
+
+void MoveRecognizer::liftFrom(int square) {
+    int piece = current[square];
+    current[square] = -1;
+    pieces[piece].square = -1;
+
+    char name[3];
+    squareName(square, name);
+    emit(CHESS_EVENT_LIFT, name, pieces[piece].type);
+}
+
+void MoveRecognizer::placeOn(int square, int piece) {
+    current[square] = piece;
+    pieces[piece].square = square;
+
+    char name[3];
+    squareName(square, name);
+    emit(CHESS_EVENT_PLACE, name, pieces[piece].type);
+}
+
+void MoveRecognizer::update() {
+    if (active && deferred && millis() - deferredSince >= MOVE_HOLD_MS) {
+        // Король так и не сходил (ход другой стороны так и не появился) - выдаем как есть
+        deferred = false;
+        classifySingle(deferredTo, true);
+        classify();
+    }
+}
+
+bool MoveRecognizer::applyFollowUp() {
+    if (followFrom < 0) {
+        return false;
+    }
+
+    if (followTo >= 0) {
+        // Ладья рокировки встала на место
+        int rook = committed[followFrom];
+        if (current[followFrom] == rook || current[followTo] != rook) {
+            return false;
+        }
+        commitSquare(followFrom);
+        commitSquare(followTo);
+    } else {
+        // Побитая на проходе пешка снята
+        if (current[followFrom] >= 0) {
+            return false;
+        }
+        commitSquare(followFrom);
+    }
+
+    followFrom = -1;
+    followTo = -1;
+    followUps++;
+    return true;
+}
+
+void MoveRecognizer::classify() {
+    // Разница может содержать несколько ходов (следующий начат до того, как
+    // проход увидел конец предыдущего) - разбираем, пока что-то выдается
+    while (true) {
+        applyFollowUp();
+
+        int filled[64];
+        int filledCount = 0;
+        bool changed = false;
+        for (int square = 0; square < 64; square++) {
+            if (current[square] == committed[square]) {
+                continue;
+            }
+            changed = true;
+            if (current[square] >= 0) {
+                filled[filledCount++] = square;
+            }
+        }
+
+        if (!changed) {
+            // Фигуру сняли и вернули (или мерцание) - хода нет
+            deferred = false;
+            return;
+        }
+        // Пока фигура в руке, установленных полей нет - ждем
+        if (filledCount == 0) {
+            return;
+        }
+
+        bool progress = filledCount == 2 && classifyCastlingPair(filled[0], filled[1]);
+        // Сначала фигуры стороны, чья очередь хода
+        for (int pass = 0; pass < 2 && !progress; pass++) {
+            for (int i = 0; i < filledCount && !progress; i++) {
+                char type = pieces[current[filled[i]]].type;
+                bool ownMove = type == '?' || isWhitePiece(type) == whiteToMove;
+                if (ownMove == (pass == 0)) {
+                    progress = classifySingle(filled[i], false);
+                }
+            }
+        }
+        if (!progress && deferred && filledCount > 1) {
+            // Кроме задержанного хода сходило что-то еще - ждать нечего
+            progress = classifySingle(deferredTo, true);
+        }
+        if (!progress) {
+            return;
+        }
+    }
+}
+
+bool MoveRecognizer::classifySingle(int to, bool force) {
+    int piece = current[to];
+    if (piece < 0 || committed[to] == piece) {
+        return false;
+    }
+    int captured = committed[to] >= 0 ? committed[to] : -1;
+
+    int from = -1;
+    for (int square = 0; square < 64; square++) {
+        if (square != to && committed[square] == piece && current[square] != piece) {
+            from = square;
+        }
+    }
+
+    if (from < 0) {
+        return classifyPromotionDrop(to, captured);
+    }
+
+    // Взятие своей фигуры или ход не в очередь, которого так и не дождались:
+    // между ходами проход пропустил ход другой стороны на это же поле
+    char colourType = pieces[piece].type;
+    bool ownCapture = captured >= 0 && colourType != '?' && pieces[captured].type != '?' &&
+                      isWhitePiece(pieces[captured].type) == isWhitePiece(colourType);
+    bool lateOutOfTurn = force && colourType != '?' && isWhitePiece(colourType) != whiteToMove;
+    if (ownCapture || lateOutOfTurn) {
+        int vanished = findVanished(!isWhitePiece(colourType));
+        if (vanished >= 0) {
+            int enemy = committed[vanished];
+            emitMove(captured >= 0 ? CHESS_EVENT_CAPTURE : CHESS_EVENT_MOVE, vanished, to, 0, enemy);
+            committed[to] = enemy;
+            inferredMoves++;
+            return true;
+        }
+    }
+
+    char type = upperType(pieces[piece].type);
+    int fileStep = fileOf(to) - fileOf(from);
+
+    // Рокировка: король на две вертикали, ладья может еще не сходить
+    if (type == 'K' && rankOf(from) == rankOf(to) && abs(fileStep) == 2 && captured < 0) {
+        int rookFrom = rankOf(from) * 8 + (fileStep > 0 ? 7 : 0);
+        int rookTo = rankOf(from) * 8 + (fileStep > 0 ? 5 : 3);
+        int rook = committed[rookFrom];
+        emitMove(CHESS_EVENT_CASTLING, from, to, 0, piece);
+        if (rook >= 0) {
+            // Ладья встанет следующим событием - ее ход не отдельный
+            followFrom = rookFrom;
+            followTo = rookTo;
+        }
+        return true;
+    }
+
+    // Взятие на проходе: косой ход пешки на пустое поле
+    if (type == 'P' && fileStep != 0 && captured < 0) {
+        int victimSquare = rankOf(from) * 8 + fileOf(to);
+        int victim = committed[victimSquare];
+        if (victim >= 0 && upperType(pieces[victim].type) == 'P') {
+            emitMove(CHESS_EVENT_EN_PASSANT, from, to, 0, piece);
+            followFrom = victimSquare;
+            followTo = -1;
+            applyFollowUp();
+            return true;
+        }
+    }
+
+    if (!force && shouldHold(from, to, piece)) {
+        return false;
+    }
+
+    // Пешка, дошедшая до последней горизонтали сама (метка пешки) - ферзь
+    if (type == 'P' && rankOf(to) == (isWhitePiece(pieces[piece].type) ? 7 : 0)) {
+        pieces[piece].type = isWhitePiece(pieces[piece].type) ? 'Q' : 'q';
+        emitMove(CHESS_EVENT_PROMOTION, from, to, 'q', piece);
+        return true;
+    }
+
+    emitMove(captured >= 0 ? CHESS_EVENT_CAPTURE : CHESS_EVENT_MOVE, from, to, 0, piece);
+    return true;
+}
+
+int MoveRecognizer::findVanished(bool white) const {
+    // Единственная фигура этого цвета, снятая с доски и нигде не поставленная
+    int found = -1;
+    for (int square = 0; square < 64; square++) {
+        int piece = committed[square];
+        if (piece < 0 || current[square] == piece || pieces[piece].square >= 0 || pieces[piece].type == '?' ||
+            isWhitePiece(pieces[piece].type) != white) {
+            continue;
+        }
+        if (found >= 0) {
+            return -1;
+        }
+        found = square;
+    }
+    return found;
+}
+
+bool MoveRecognizer::classifyPromotionDrop(int to, int captured) {
+    // Метка из лотка на последней горизонтали вместо снятой пешки
+    int piece = current[to];
+    for (int square = 0; square < 64; square++) {
+        int pawn = committed[square];
+        if (pawn < 0 || current[square] == pawn || upperType(pieces[pawn].type) != 'P') {
+            continue;
+        }
+        bool white = isWhitePiece(pieces[pawn].type);
+        int lastRank = white ? 7 : 0;
+        int fileStep = abs(fileOf(to) - fileOf(square));
+        if (rankOf(to) != lastRank || rankOf(square) != lastRank + (white ? -1 : 1) || fileStep > 1 ||
+            (fileStep == 1) != (captured >= 0)) {
+            continue;
+        }
+
+        if (pieces[piece].type == '?') {
+            pieces[piece].type = white ? 'Q' : 'q';
+        }
+        char promotion = pieces[piece].type;
+        if (promotion >= 'A' && promotion <= 'Z') {
+            promotion = promotion - 'A' + 'a';
+        }
+        emitMove(CHESS_EVENT_PROMOTION, square, to, promotion, piece);
+        return true;
+    }
+    return false;
+}
+
+bool MoveRecognizer::shouldHold(int from, int to, int piece) {
+    char type = pieces[piece].type;
+    bool hold = type != '?' && isWhitePiece(type) != whiteToMove;
+
+    // Ладья в позиции рокировки, король дома или в руке: ждем его, затем - обычный ход ладьи
+    if (!hold && upperType(type) == 'R' && rankOf(from) == rankOf(to) && (rankOf(from) == 0 || rankOf(from) == 7)) {
+        bool kingSide = fileOf(from) == 7 && fileOf(to) == 5;
+        bool queenSide = fileOf(from) == 0 && fileOf(to) == 3;
+        int kingSquare = rankOf(from) * 8 + 4;
+        int king = committed[kingSquare];
+        hold = (kingSide || queenSide) && king >= 0 && upperType(pieces[king].type) == 'K' &&
+               (pieces[king].square == kingSquare || pieces[king].square < 0);
+    }
+
+    if (hold && !deferred) {
+        deferred = true;
+        deferredSince = millis();
+        deferredTo = to;
+        heldMoves++;
+    }
+    return hold;
+}
+
+bool MoveRecognizer::classifyCastlingPair(int a, int b) {
+    int king = current[a];
+    int rookTo = b;
+    if (upperType(pieces[king].type) != 'K') {
+        king = current[b];
+        rookTo = a;
+    }
+    if (upperType(pieces[king].type) != 'K') {
+        return false;
+    }
+
+    int kingTo = pieces[king].square;
+    int kingFrom = -1;
+    for (int square = 0; square < 64; square++) {
+        if (committed[square] == king) {
+            kingFrom = square;
+        }
+    }
+    if (kingFrom < 0 || rankOf(kingFrom) != rankOf(kingTo) || abs(fileOf(kingTo) - fileOf(kingFrom)) != 2) {
+        return false;
+    }
+
+    int rookFrom = rankOf(kingFrom) * 8 + (kingTo > kingFrom ? 7 : 0);
+    if (rookTo != rankOf(kingFrom) * 8 + (kingTo > kingFrom ? 5 : 3) || current[rookTo] != committed[rookFrom]) {
+        return false;
+    }
+
+    emitMove(CHESS_EVENT_CASTLING, kingFrom, kingTo, 0, king);
+    commitSquare(rookFrom);
+    commitSquare(rookTo);
+    return true;
+}
+
+void MoveRecognizer::emitMove(ChessEventType type, int from, int to, char promotion, int piece) {
+    char uci[6];
+    squareName(from, uci);
+    squareName(to, uci + 2);
+    uci[4] = promotion;
+    uci[5] = '\0';
+
+    // В позицию переходят только поля хода: остальная разница - следующий ход
+    commitSquare(from);
+    commitSquare(to);
+    deferred = false;
+    if (pieces[piece].type != '?') {
+        whiteToMove = !isWhitePiece(pieces[piece].type);
+    }
+
+    ply++;
+    ChessEvent& event = moveLog[logHead];
+    event.type = type;
+    memcpy(event.uci, uci, sizeof(uci));
+    event.piece = pieces[piece].type;
+    event.ply = ply;
+    event.physicalTime = lastPhysicalTime;
+    event.timestamp = millis();
+    logHead = (logHead + 1) % MOVE_LOG_SIZE;
+    if (logCount < MOVE_LOG_SIZE) {
+        logCount++;
+    }
+
+    unsigned long latencyMs = event.timestamp - event.physicalTime;
+    totalLatencyMs += latencyMs;
+    if (latencyMs > maxLatencyMs) {
+        maxLatencyMs = latencyMs;
+    }
+    eventCounts[type]++;
+
+    DEBUG_PRINTF("MoveRecognizer: Ход %u: %s\n", ply, uci);
+    if (callback != nullptr) {
+        callback(event, callbackContext);
+    }
+}
+
+void MoveRecognizer::emit(ChessEventType type, const char* uci, char piece) {
+    eventCounts[type]++;
+    if (callback == nullptr) {
+        return;
+    }
+
+    ChessEvent event;
+    event.type = type;
+    strncpy(event.uci, uci, sizeof(event.uci) - 1);
+    event.uci[sizeof(event.uci) - 1] = '\0';
+    event.piece = piece;
+    event.ply = 0;
+    event.physicalTime = lastPhysicalTime;
+    event.timestamp = millis();
+    callback(event, callbackContext);
+}
+
+void MoveRecognizer::commitSquare(int square) {
+    committed[square] = current[square];
+}
+
+const ChessEvent& MoveRecognizer::getMove(int index) const {
+    int oldest = (logHead - logCount + MOVE_LOG_SIZE) % MOVE_LOG_SIZE;
+    return moveLog[(oldest + index) % MOVE_LOG_SIZE];
+}
+
+unsigned long MoveRecognizer::getMeanLatencyMs() const {
+    uint32_t moves = ply;
+    return moves ? totalLatencyMs / moves : 0;
+}
+
+void MoveRecognizer::printMoveLog() const {
+    DEBUG_PRINTF("Журнал ходов (%d из %u):", logCount, ply);
+    for (int i = 0; i < logCount; i++) {
+        const ChessEvent& move = getMove(i);
+        if (move.ply % 2 == 1) {
+            DEBUG_PRINTF(" %u.", (move.ply + 1) / 2);
+        }
+        DEBUG_PRINTF(" %s", move.uci);
+    }
+    DEBUG_PRINTLN("");
+}
+
+void MoveRecognizer::printStatus() const {
+    DEBUG_PRINTF("Распознавание ходов: %s, полуходов=%u (взятий=%lu, рокировок=%lu, на проходе=%lu, "
+                 "превращений=%lu)\n",
+                 active ? "партия идет" : "выкл", ply, eventCounts[CHESS_EVENT_CAPTURE],
+                 eventCounts[CHESS_EVENT_CASTLING], eventCounts[CHESS_EVENT_EN_PASSANT],
+                 eventCounts[CHESS_EVENT_PROMOTION]);
+    DEBUG_PRINTF("  снятий=%lu, установок=%lu, не по порядку=%lu, задержано=%lu, выведено=%lu, "
+                 "поглощено=%lu, чужих меток=%lu; задержка хода: среднее %lu мс, макс %lu мс\n",
+                 eventCounts[CHESS_EVENT_LIFT], eventCounts[CHESS_EVENT_PLACE], outOfOrder, heldMoves, inferredMoves,
+                 followUps,
+                 unknownTags, getMeanLatencyMs(), maxLatencyMs);
+}
@@ -0,0 +1,149 @@
+#ifndef MOVE_RECOGNIZER_H
+#define MOVE_RECOGNIZER_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "card_events.h"
+
+// События партии
+enum ChessEventType {
+    CHESS_EVENT_LIFT,           // Фигура снята с поля (uci: "e2")
+    CHESS_EVENT_PLACE,          // Фигура поставлена на поле (uci: "e4")
+    CHESS_EVENT_MOVE,           // Ход (uci: "e2e4")
+    CHESS_EVENT_CAPTURE,
+    CHESS_EVENT_CASTLING,       // uci хода короля: "e1g1"
+    CHESS_EVENT_EN_PASSANT,
+    CHESS_EVENT_PROMOTION,      // uci с фигурой превращения: "e7e8q"
+    CHESS_EVENT_TYPE_COUNT
+};
+
+struct ChessEvent {
+    ChessEventType type;
+    char uci[6];
+    char piece;                     // FEN-буква фигуры ('?' - неизвестна)
+    uint16_t ply;                   // Номер полухода (у ходов), 0 у снятия/установки
+    unsigned long physicalTime;     // millis() первого чтения последнего изменения доски
+    unsigned long timestamp;        // millis() выдачи события
+};
+
+typedef void (*ChessEventCallback)(const ChessEvent& event, void* context);
+
+// Распознавание ходов по событиям ячеек.
+// Фигура - это UID метки; тип назначается по начальной расстановке (beginGame).
+// Ход определяется не по порядку событий, а по разнице текущей доски с позицией
+// после прошлого хода: снятие и установка в любом порядке, мерцание (снятие и
+// возврат той же метки) разницы не оставляет. Установка метки, которая еще
+// числится на другом поле, - снятие, пропущенное проходом. Рокировка выдается
+// по ходу короля, ход ладьи потом поглощается; взятие на проходе - по косому
+// ходу пешки на пустое поле, снятие побитой пешки поглощается. В позицию
+// переходят только поля выданного хода: остаток разницы - начало следующего.
+// Проход видит ячейки по порядку, поэтому ход не в очередь (ответ, замеченный
+// раньше хода) задерживается до хода другой стороны, но не дольше MOVE_HOLD_MS.
+// Ход и ответное взятие на том же поле в пределах прохода видны одной установкой:
+// пропавшая фигура другой стороны выводится как сходившая на это поле
+class MoveRecognizer {
+private:
+    struct Piece {
+        uint8_t uid[UID_BUFFER_SIZE];
+        uint8_t uidLength;
+        char type;                  // FEN-буква, '?' - неизвестна
+        int8_t square;              // 0..63 (a1 = 0), -1 - вне доски
+    };
+
+    bool active;
+    Piece pieces[CHESS_MAX_PIECES];
+    int pieceCount;
+
+    int8_t committed[64];           // Позиция после последнего хода (индекс фигуры, -1 пусто)
+    int8_t current[64];             // Доска по событиям ячеек
+
+    // Ожидаемое завершение выданного хода: ладья рокировки или снятие побитой пешки
+    int8_t followFrom;
+    int8_t followTo;                // -1 - только снятие с followFrom
+
+    // Задержанный ход (не в очередь или ладья рокировки раньше короля): ждем MOVE_HOLD_MS
+    bool deferred;
+    unsigned long deferredSince;
+    int8_t deferredTo;
+
+    unsigned long lastPhysicalTime;
+    uint16_t ply;
+    bool whiteToMove;               // По цвету последней сходившей фигуры
+
+    // Ограниченный журнал ходов (кольцевой буфер)
+    ChessEvent moveLog[MOVE_LOG_SIZE];
+    int logHead;
+    int logCount;
+
+    ChessEventCallback callback;
+    void* callbackContext;
+
+    // Статистика
+    uint32_t eventCounts[CHESS_EVENT_TYPE_COUNT];
+    uint32_t outOfOrder;            // Установка раньше снятия / снятие уже снятой
+    uint32_t heldMoves;             // Ходы, задержанные до хода другой стороны или короля
+    uint32_t inferredMoves;         // Ходы на поле, где их фигуру побили до пересканирования
+    uint32_t followUps;             // Поглощено ходов ладьи и снятий на проходе
+    uint32_t unknownTags;           // Метки, не бывшие в начальной расстановке
+    unsigned long totalLatencyMs;   // От последнего изменения доски до хода
+    unsigned long maxLatencyMs;
+
+public:
+    MoveRecognizer();
+
+    void setCallback(ChessEventCallback onEvent, void* context);
+
+    // Начальная расстановка из кэша ячеек: типы фигур по полям 1, 2, 7, 8 горизонталей.
+    // Возвращает число фигур на доске (32 у полной расстановки)
+    int beginGame(const CardInfo* cardCache);
+    // На доске ровно начальная расстановка: заняты 1, 2, 7, 8 горизонтали, остальные пусты
+    static bool isStartPosition(const CardInfo* cardCache);
+    bool isActive() const { return active; }
+    // Тип метки вне доски (запасной ферзь для превращения)
+    bool registerPiece(const uint8_t* uid, uint8_t uidLength, char type);
+
+    // Подтвержденное изменение ячейки
+    void onCellEvent(int cellIndex, CardEventKind kind, const uint8_t* uid, uint8_t uidLength,
+                     unsigned long physicalTime);
+    // Истечение ожидания задержанного хода
+    void update();
+
+    // Поле шахматной доски для ячейки (-1 - лоток вне доски)
+    static int cellToSquare(int cellIndex);
+    static int squareToCell(int square);
+    static void squareName(int square, char* out);
+
+    // Журнал: 0 - самый старый из хранимых
+    int getMoveCount() const { return logCount; }
+    const ChessEvent& getMove(int index) const;
+    uint16_t getPly() const { return ply; }
+    uint32_t getEventCount(ChessEventType type) const { return eventCounts[type]; }
+    uint32_t getOutOfOrder() const { return outOfOrder; }
+    uint32_t getHeldMoves() const { return heldMoves; }
+    uint32_t getInferredMoves() const { return inferredMoves; }
+    uint32_t getFollowUps() const { return followUps; }
+    unsigned long getMeanLatencyMs() const;
+    unsigned long getMaxLatencyMs() const { return maxLatencyMs; }
+    void printMoveLog() const;
+    void printStatus() const;
+
+    void reset();
+
+private:
+    int findPiece(const uint8_t* uid, uint8_t uidLength) const;
+    int addPiece(const uint8_t* uid, uint8_t uidLength, char type);
+    void liftFrom(int square);
+    void placeOn(int square, int piece);
+    void classify();
+    bool applyFollowUp();
+    bool classifySingle(int to, bool force);
+    bool classifyPromotionDrop(int to, int captured);
+    int findVanished(bool white) const;
+    bool classifyCastlingPair(int a, int b);
+    bool shouldHold(int from, int to, int piece);
+    void emitMove(ChessEventType type, int from, int to, char promotion, int piece);
+    void emit(ChessEventType type, const char* uci, char piece);
+    void commitSquare(int square);
+};
+
+#endif // MOVE_RECOGNIZER_H
@@ -1,186 +1,160 @@
 #include "multiplexer.h"
 
 // =============================================
-// КЛАСС MULTIPLEXER
+// ОПИСАНИЕ ОСИ
 // =============================================
 
-Multiplexer::Multiplexer(int muxNum) : muxNumber(muxNum) {
-    currentAddress = 0;
-    setPinMappings();
-}
-
-void Multiplexer::setPinMappings() {
-    if (muxNumber == 1) {
-        // Мультиплексор #1 (строки 0-7, S3=GND)
-        s0Pin = MUX1_S0_PIN;
-        s1Pin = MUX1_S1_PIN;
-        s2Pin = MUX1_S2_PIN;
-        s3Pin = -1; // S3 подключен к GND, не используется
-    } else if (muxNumber == 2) {
-        // Мультиплексор #2 (столбцы 0-11)
-        s0Pin = MUX2_S0_PIN;
-        s1Pin = MUX2_S1_PIN;
-        s2Pin = MUX2_S2_PIN;
-        s3Pin = MUX2_S3_PIN;
-    } else {
-        DEBUG_PRINTF("ОШИБКА: Неверный номер мультиплексора: %d\n", muxNumber);
-    }
-}
-
-void Multiplexer::initialize() {
-    // Настройка пинов как выходы
-    pinMode(s0Pin, OUTPUT);
-    pinMode(s1Pin, OUTPUT);
-    pinMode(s2Pin, OUTPUT);
-    
-    // S3 пин только для мультиплексора #2 (столбцы)
-    if (muxNumber == 2 && s3Pin >= 0) {
-        pinMode(s3Pin, OUTPUT);
-    }
-    
-    // Начальный адрес 0
-    setAddress(0);
-}
-
-void Multiplexer::setAddress(int address) {
-    if (!isValidAddress(address)) {
-        DEBUG_PRINTF("ОШИБКА Multiplexer: Неверный адрес %d для мультиплексора #%d\n", address, muxNumber);
-        return;
-    }
-    
-    if (address != currentAddress) {
-        updatePins(address);
-        currentAddress = address;
-    }
-}
-
-void Multiplexer::updatePins(int address) {
-    // Оптимизированная установка битов адреса
-    digitalWrite(s0Pin, (address & 0x01) ? HIGH : LOW);
-    digitalWrite(s1Pin, (address & 0x02) ? HIGH : LOW);
-    digitalWrite(s2Pin, (address & 0x04) ? HIGH : LOW);
-    
-    // S3 пин только для мультиплексора #2 (столбцы), для MUX1 S3=GND
-    if (muxNumber == 2 && s3Pin >= 0) {
-        digitalWrite(s3Pin, (address & 0x08) ? HIGH : LOW);
-    }
-    
-    // Минимальная задержка стабилизации (оптимизированная до 2мкс)
-    delayMicroseconds(MUX_SETTLE_TIME_US);
-}
-
-bool Multiplexer::isValidAddress(int address) const {
-    // Мультиплексор #1 (строки): 0-7
-    if (muxNumber == 1) {
-        return (address >= 0 && address < MATRIX_ROWS);
-    }
-    // Мультиплексор #2 (столбцы): 0-11  
-    else if (muxNumber == 2) {
-        return (address >= 0 && address < MATRIX_COLS);
+void printMuxAxis(const char* label, const MuxAxis& axis) {
+    DEBUG_PRINTF("- %s: %d линий, ступеней %d\n", label, axis.lines, axis.stageCount);
+    for (int s = 0; s < axis.stageCount; s++) {
+        const MuxStage& stage = axis.stages[s];
+        char line[96];
+        int length = snprintf(line, sizeof(line), "  ступень %d:", s);
+        if (stage.bits > 0) {
+            for (int b = 0; b < MUX_SELECT_PINS; b++) {
+                if (b < stage.bits) {
+                    length += snprintf(line + length, sizeof(line) - length, " S%d=%d", b, stage.selectPins[b]);
+                } else {
+                    length += snprintf(line + length, sizeof(line) - length, " S%d=GND", b);
+                }
+            }
+        } else {
+            for (int i = 0; i < stage.inhibitCount; i++) {
+                length += snprintf(line + length, sizeof(line) - length, " INH%d=%d", i, stage.inhibitPins[i]);
+            }
+        }
+        DEBUG_PRINTLN(line);
     }
-    return false;
-}
-
-void Multiplexer::printStatus() const {
-    // Убираем лишний вывод
 }
 
 // =============================================
 // КЛАСС MULTIPLEXER MANAGER
 // =============================================
 
-MultiplexerManager::MultiplexerManager() : mux1(1), mux2(2) {
+template <typename Geometry>
+BasicMultiplexerManager<Geometry>::BasicMultiplexerManager() {
     currentRow = 0;
     currentCol = 0;
     isEnabled = false;
+
+    previousCellIndex = -1;
+    lastSwitchMicros = 0;
+    settleTimeUs = MUX_SETTLE_TIME_US;
 }
 
-void MultiplexerManager::initialize() {
-    mux1.initialize();
-    mux2.initialize();
-    
-    // Настройка общего EN пина
-    pinMode(MUX_COMMON_EN_PIN, OUTPUT);
+template <typename Geometry>
+void BasicMultiplexerManager<Geometry>::initialize() {
+    // Настройка общего EN пина - первой: пока пины адреса переходят в
+    // выходы (LOW), на ступенях INH открыты все мультиплексоры сразу
+    pinMode(Geometry::layout.enablePin, OUTPUT);
     disableAll();  // Начальное состояние - выключен
-    
+
+    // Пины адреса - выходы, начальная позиция (0, 0) выставляется явно
+    RowCodec::setOutputs();
+    ColCodec::setOutputs();
+    RowCodec::writeLine(0);
+    ColCodec::writeLine(0);
+    currentRow = 0;
+    currentCol = 0;
+    delayMicroseconds(settleTimeUs);
+
     // Устанавливаем начальную позицию
     selectCell(0, 0);
 }
 
-void MultiplexerManager::selectCell(int row, int col) {
+template <typename Geometry>
+void BasicMultiplexerManager<Geometry>::selectCell(int row, int col) {
     if (!isValidCell(row, col)) {
         DEBUG_PRINTF("ОШИБКА MultiplexerManager: Неверная ячейка (%d, %d)\n", row, col);
         return;
     }
-    
-    // Оптимизированное переключение - обновляем только если изменилось
+
+    if (row != currentRow || col != currentCol) {
+        previousCellIndex = getCurrentCellIndex();
+        lastSwitchMicros = micros();
+    }
+
+    // Переключаем только изменившуюся ось, пауза стабилизации - на каждую
     if (row != currentRow) {
-        mux1.setAddress(row);
+        RowCodec::switchLine(currentRow, row);
         currentRow = row;
+        delayMicroseconds(settleTimeUs);
     }
-    
+
     if (col != currentCol) {
-        mux2.setAddress(col);
+        ColCodec::switchLine(currentCol, col);
         currentCol = col;
+        delayMicroseconds(settleTimeUs);
     }
-    
+
     // Автоматически включаем мультиплексоры после установки адреса
     enableAll();
 }
 
-void MultiplexerManager::enableAll() {
-    digitalWrite(MUX_COMMON_EN_PIN, LOW);  // Активный LOW
+template <typename Geometry>
+void BasicMultiplexerManager<Geometry>::enableAll() {
+    digitalWrite(Geometry::layout.enablePin, LOW);  // Активный LOW
     isEnabled = true;
 }
 
-void MultiplexerManager::disableAll() {
-    digitalWrite(MUX_COMMON_EN_PIN, HIGH); // Отключение
+template <typename Geometry>
+void BasicMultiplexerManager<Geometry>::disableAll() {
+    digitalWrite(Geometry::layout.enablePin, HIGH); // Отключение
     isEnabled = false;
 }
 
-void MultiplexerManager::selectCellByIndex(int cellIndex) {
+template <typename Geometry>
+void BasicMultiplexerManager<Geometry>::waitSettled(unsigned long settleUs) const {
+    unsigned long elapsed = micros() - lastSwitchMicros;
+    if (elapsed < settleUs) {
+        delayMicroseconds(settleUs - elapsed);
+    }
+}
+
+template <typename Geometry>
+void BasicMultiplexerManager<Geometry>::selectCellByIndex(int cellIndex) {
     if (!isValidCellIndex(cellIndex)) {
         DEBUG_PRINTF("ОШИБКА MultiplexerManager: Неверный индекс ячейки %d\n", cellIndex);
         return;
     }
-    
+
     int row, col;
     indexToRowCol(cellIndex, row, col);
     selectCell(row, col);
 }
 
-int MultiplexerManager::nextCell() {
+template <typename Geometry>
+int BasicMultiplexerManager<Geometry>::nextCell() {
     int nextIndex = getCurrentCellIndex() + 1;
-    
+
     // Циклический переход к началу
-    if (nextIndex >= MATRIX_TOTAL_CELLS) {
+    if (nextIndex >= TOTAL_CELLS) {
         nextIndex = 0;
     }
-    
+
     selectCellByIndex(nextIndex);
     return nextIndex;
 }
 
-bool MultiplexerManager::isValidCell(int row, int col) const {
-    return (row >= 0 && row < MATRIX_ROWS && col >= 0 && col < MATRIX_COLS);
-}
-
-bool MultiplexerManager::isValidCellIndex(int cellIndex) const {
-    return (cellIndex >= 0 && cellIndex < MATRIX_TOTAL_CELLS);
-}
-
-void MultiplexerManager::indexToRowCol(int cellIndex, int& row, int& col) const {
-    row = cellIndex / MATRIX_COLS;
-    col = cellIndex % MATRIX_COLS;
+template <typename Geometry>
+void BasicMultiplexerManager<Geometry>::printCurrentSelection() const {
+    int cellIndex = getCurrentCellIndex();
+    DEBUG_PRINTF("MultiplexerManager: Текущая ячейка [%d,%d] (индекс %d/%d), EN=%s\n",
+                 currentRow, currentCol, cellIndex, TOTAL_CELLS - 1,
+                 isEnabled ? "ВКЛ" : "ВЫКЛ");
 }
 
-int MultiplexerManager::rowColToIndex(int row, int col) const {
-    return row * MATRIX_COLS + col;
+template <typename Geometry>
+void BasicMultiplexerManager<Geometry>::printGeometry() const {
+    DEBUG_PRINTF("- Геометрия %s: %d×%d ячеек\n", Geometry::layout.name, ROWS, COLS);
+    printMuxAxis("Строки", Geometry::layout.rowAxis);
+    printMuxAxis("Столбцы", Geometry::layout.colAxis);
+    DEBUG_PRINTF("- Общий EN: %d\n", Geometry::layout.enablePin);
 }
 
-void MultiplexerManager::printCurrentSelection() const {
-    int cellIndex = getCurrentCellIndex();
-    DEBUG_PRINTF("MultiplexerManager: Текущая ячейка [%d,%d] (индекс %d/%d), EN=%s\n", 
-                 currentRow, currentCol, cellIndex, MATRIX_TOTAL_CELLS - 1, 
-                 isEnabled ? "ВКЛ" : "ВЫКЛ");
-} 
\ No newline at end of file
+// Все геометрии config.h: прошивка берет ActiveGeometry, лишнее убирает
+// линковщик (--gc-sections); стенды на хосте переключают остальные
+template class BasicMultiplexerManager<Geometry8x12>;
+template class BasicMultiplexerManager<Geometry10x10>;
+template class BasicMultiplexerManager<Geometry16x16>;
+template class BasicMultiplexerManager<Geometry32x32>;
@@ -4,76 +4,179 @@
 #include <Arduino.h>
 #include "config.h"
 
-class Multiplexer {
-private:
-    int muxNumber;         // Номер мультиплексора (1 или 2)
-    int s0Pin, s1Pin, s2Pin, s3Pin;  // Управляющие пины
-    int currentAddress;    // Текущий адрес
-    
-public:
-    Multiplexer(int muxNum);
-    
-    // Инициализация
-    void initialize();
-    
-    // Управление адресом
-    void setAddress(int address);
-    int getCurrentAddress() const { return currentAddress; }
-    
-    // Валидация
-    bool isValidAddress(int address) const;
-    
-    // Отладка
-    void printStatus() const;
-    
-private:
-    void updatePins(int address);
-    void setPinMappings();
+// =============================================
+// ТАБЛИЦЫ ОСЕЙ
+// Для каждой линии оси - уровни всех пинов оси битовой маской (бит i -
+// уровень pins[i]). Считаются компилятором из описания геометрии
+// (include/board_geometry.h), в прошивке - только чтение из таблицы
+// =============================================
+
+enum MuxAxisId { MUX_AXIS_ROWS, MUX_AXIS_COLS };
+
+template <int Lines, int Pins>
+struct MuxAxisTable {
+    int8_t pins[Pins];
+    uint32_t levels[Lines];
 };
 
-// Глобальные функции для управления обоими мультиплексорами
-class MultiplexerManager {
+constexpr const MuxAxis& geometryAxis(const BoardGeometry& geometry, MuxAxisId axisId) {
+    return axisId == MUX_AXIS_ROWS ? geometry.rowAxis : geometry.colAxis;
+}
+
+constexpr int muxAxisPinCount(const MuxAxis& axis) {
+    int8_t pins[MUX_AXIS_MAX_PINS] = {};
+    return muxAxisPins(axis, pins);
+}
+
+// Линия - смешанная система счисления, ступень 0 - младшая цифра. Двоичная
+// ступень: цифра на S0..S(bits-1); ступень INH: LOW только на линии цифры
+template <int Lines, int Pins>
+constexpr MuxAxisTable<Lines, Pins> buildMuxAxisTable(const MuxAxis& axis) {
+    MuxAxisTable<Lines, Pins> table = {};
+    muxAxisPins(axis, table.pins);
+    for (int line = 0; line < Lines; line++) {
+        uint32_t levels = 0;
+        int bit = 0;
+        int rest = line;
+        for (int s = 0; s < axis.stageCount; s++) {
+            const MuxStage& stage = axis.stages[s];
+            int channels = muxStageChannels(stage);
+            int digit = rest % channels;
+            rest /= channels;
+            for (int b = 0; b < stage.bits; b++, bit++) {
+                if ((digit >> b) & 1) levels |= 1u << bit;
+            }
+            for (int i = 0; i < stage.inhibitCount; i++, bit++) {
+                if (i != digit) levels |= 1u << bit;
+            }
+        }
+        table.levels[line] = levels;
+    }
+    return table;
+}
+
+template <typename Geometry, MuxAxisId AxisId>
+struct MuxAxisCodec {
+    static constexpr int LINES = geometryAxis(Geometry::layout, AxisId).lines;
+    static constexpr int PINS = muxAxisPinCount(geometryAxis(Geometry::layout, AxisId));
+    static_assert(PINS > 0 && PINS <= 32, "Пины оси не помещаются в маску уровней");
+
+    static constexpr MuxAxisTable<LINES, PINS> table =
+        buildMuxAxisTable<LINES, PINS>(geometryAxis(Geometry::layout, AxisId));
+
+    static void setOutputs() {
+        for (int i = 0; i < PINS; i++) {
+            pinMode(table.pins[i], OUTPUT);
+        }
+    }
+
+    // Все пины оси - по таблице линии (инициализация)
+    static void writeLine(int line) {
+        for (int i = 0; i < PINS; i++) {
+            digitalWrite(table.pins[i], ((table.levels[line] >> i) & 1) ? HIGH : LOW);
+        }
+    }
+
+    // Только изменившиеся пины: сначала HIGH, затем LOW - на ступенях INH
+    // прежний мультиплексор отключается раньше, чем включается новый
+    static void switchLine(int from, int to) {
+        uint32_t changed = table.levels[from] ^ table.levels[to];
+        uint32_t rising = changed & table.levels[to];
+        uint32_t falling = changed & ~table.levels[to];
+        while (rising) {
+            digitalWrite(table.pins[__builtin_ctz(rising)], HIGH);
+            rising &= rising - 1;
+        }
+        while (falling) {
+            digitalWrite(table.pins[__builtin_ctz(falling)], LOW);
+            falling &= falling - 1;
+        }
+    }
+};
+
+// Описание оси в лог (строки/столбцы, пины по ступеням)
+void printMuxAxis(const char* label, const MuxAxis& axis);
+
+// =============================================
+// МЕНЕДЖЕР МУЛЬТИПЛЕКСОРОВ
+// Параметризован геометрией (config.h): размеры, ступени, пины - константы
+// компиляции. Прошивка использует MultiplexerManager (ActiveGeometry)
+// =============================================
+
+template <typename Geometry>
+class BasicMultiplexerManager {
+    static_assert(muxGeometryValid(Geometry::layout), "Геометрия доски: описание мультиплексоров или пины");
+
+public:
+    typedef MuxAxisCodec<Geometry, MUX_AXIS_ROWS> RowCodec;
+    typedef MuxAxisCodec<Geometry, MUX_AXIS_COLS> ColCodec;
+
+    static constexpr int ROWS = RowCodec::LINES;
+    static constexpr int COLS = ColCodec::LINES;
+    static constexpr int TOTAL_CELLS = ROWS * COLS;
+
 private:
-    Multiplexer mux1;  // Строки (0-7)
-    Multiplexer mux2;  // Столбцы (0-11)
-    
     int currentRow;
     int currentCol;
     bool isEnabled;    // Состояние общего EN пина
-    
+
+    // Последнее переключение (для пауз калибровки)
+    int previousCellIndex;
+    unsigned long lastSwitchMicros;
+    unsigned long settleTimeUs;
+
 public:
-    MultiplexerManager();
-    
+    BasicMultiplexerManager();
+
     // Инициализация
     void initialize();
-    
+
     // Выбор ячейки матрицы
     void selectCell(int row, int col);
-    void selectCellByIndex(int cellIndex);  // 0-95
-    
+    void selectCellByIndex(int cellIndex);  // 0..TOTAL_CELLS-1
+
     // Получение текущей позиции
     int getCurrentRow() const { return currentRow; }
     int getCurrentCol() const { return currentCol; }
-    int getCurrentCellIndex() const { return currentRow * MATRIX_COLS + currentCol; }
-    
+    int getCurrentCellIndex() const { return currentRow * COLS + currentCol; }
+
+    // Ячейка до последнего переключения и момент переключения (micros)
+    int getPreviousCellIndex() const { return previousCellIndex; }
+    unsigned long getLastSwitchMicros() const { return lastSwitchMicros; }
+    void waitSettled(unsigned long settleUs) const;  // Досыпает паузу с момента переключения
+
+    // Пауза после смены адреса каждой оси
+    void setSettleTime(unsigned long us) { settleTimeUs = us; }
+    unsigned long getSettleTime() const { return settleTimeUs; }
+
     // Переключение на следующую ячейку
     int nextCell();  // Возвращает индекс следующей ячейки
-    
+
     // Управление общим EN пином
     void enableAll();
     void disableAll();
     bool getEnabled() const { return isEnabled; }
-    
+
     // Валидация
-    bool isValidCell(int row, int col) const;
-    bool isValidCellIndex(int cellIndex) const;
-    
+    bool isValidCell(int row, int col) const {
+        return (row >= 0 && row < ROWS && col >= 0 && col < COLS);
+    }
+    bool isValidCellIndex(int cellIndex) const {
+        return (cellIndex >= 0 && cellIndex < TOTAL_CELLS);
+    }
+
     // Конвертация координат
-    void indexToRowCol(int cellIndex, int& row, int& col) const;
-    int rowColToIndex(int row, int col) const;
-    
+    void indexToRowCol(int cellIndex, int& row, int& col) const {
+        row = cellIndex / COLS;
+        col = cellIndex % COLS;
+    }
+    int rowColToIndex(int row, int col) const { return row * COLS + col; }
+
     // Отладка
     void printCurrentSelection() const;
+    void printGeometry() const;
 };
 
-#endif // MULTIPLEXER_H 
\ No newline at end of file
+typedef BasicMultiplexerManager<ActiveGeometry> MultiplexerManager;
+
+#endif // MULTIPLEXER_H
@@ -1,24 +1,96 @@
 #include "rfid_manager.h"
+#include <new>
+
+// Регистры CIU (PN532 User Manual, 8.6.22)
+static const uint16_t CIU_TX_MODE = 0x6302;
+static const uint16_t CIU_RX_MODE = 0x6303;
+static const uint16_t CIU_BIT_FRAMING = 0x633D;
+static const uint16_t CIU_RF_CFG = 0x6316;
+static const uint16_t CIU_MOD_GSP = 0x6319;
+
+// RFConfiguration, пункт 0x0A: аналоговые настройки 106 кбит/с тип A, которые
+// PN532 грузит в CIU при каждой активации (User Manual, 7.3.1). Значения по
+// умолчанию: RFCfg, GsNOn, CWGsP, ModGsP, DemodOwnRF, RxThreshold, ...
+static const uint8_t RF_CFG_ANALOG_TYPE_A = 0x0A;
+static const uint8_t ANALOG_TYPE_A_DEFAULT[11] = {
+    0x59, 0xF4, 0x3F, 0x11, 0x4D, 0x85, 0x61, 0x6F, 0x26, 0x62, 0x87};
+
+// Профили аналогового тракта: RxGain - биты 6:4 CIU_RFCfg (5 = 38 дБ, 7 = 48 дБ),
+// ModGsP - проводимость при модуляции (меньше - глубже модуляция)
+struct RfProfile {
+    const char* name;
+    uint8_t rfCfg;
+    uint8_t modGsP;
+};
+
+static const RfProfile RF_PROFILES[RF_PROFILE_COUNT] = {
+    {"штатный",      0x59, 0x11},
+    {"усиленный",    0x69, 0x11},
+    {"максимальный", 0x79, 0x08},
+};
+
+// Команда метки ISO14443-3: пробуждение из IDLE и HALT
+static const uint8_t TAG_CMD_WUPA = 0x52;
+
+// Корзины ожидания ответа PN532: от ответа в первом опросе до таймаута
+static const uint32_t READ_LATENCY_BOUNDS_US[] = {1000, 2000, 5000, 10000, 20000, 50000, 100000};
 
 RFIDManager::RFIDManager() {
     nfc = nullptr;
     isInitialized = false;
     isConnected = false;
     
-    totalReads = 0;
-    successfulReads = 0;
-    errors = 0;
-    timeouts = 0;
+    totalReads = metrics.counter("rfid.reads");
+    successfulReads = metrics.counter("rfid.reads_ok");
+    errors = metrics.counter("rfid.errors");
+    timeouts = metrics.counter("rfid.timeouts");
+    readLatency = metrics.histogram("rfid.read_latency_us", READ_LATENCY_BOUNDS_US,
+                                    sizeof(READ_LATENCY_BOUNDS_US) / sizeof(READ_LATENCY_BOUNDS_US[0]));
     
     lastReadAttempt = 0;
     lastInitAttempt = 0;
+    lastTransactionFailed = false;
+    thruFraming = false;
+    shortRetryTimeout = false;
+    watching = false;
+    lastWatchPoll = 0;
+    irqWait = PN532_USE_IRQ;
+    currentRfProfile = -1;
+    ciuRfProfile = -1;
+    rfProfileSwitches = 0;
+    rfFieldOn = false;
+    fieldOnMicros = 0;
+    
+    readTimeoutMs = PN532_TIMEOUT_MS;
+    readIntervalMs = SCAN_DELAY_MS;
+    transactionRetries = RECOVERY_TRANSACTION_RETRIES;
+    lastReadLatencyUs = 0;
+    maxTargets = 1;
+    
+    for (int i = 0; i < RECOVERY_LEVEL_COUNT; i++) {
+        recoveriesByLevel[i] = 0;
+    }
+    recoveryFailures = 0;
+    lastRecoveryTimeUs = 0;
+    maxRecoveryTimeUs = 0;
+    totalRecoveryTimeUs = 0;
+    lastRecoveryFailed = false;
+    
+    lastTrafficTime = 0;
+    consecutiveFailures = 0;
+    livenessProbes = 0;
     
     resetLastRead();
 }
 
 RFIDManager::~RFIDManager() {
+    destroyDriver();
+}
+
+void RFIDManager::destroyDriver() {
     if (nfc != nullptr) {
-        delete nfc;
+        nfc->enableIrq(false);
+        nfc->~Adafruit_PN532();
         nfc = nullptr;
     }
 }
@@ -26,14 +98,26 @@ RFIDManager::~RFIDManager() {
 bool RFIDManager::initialize() {
     DEBUG_PRINTLN("RFIDManager: Инициализация PN532...");
     
-    // Создаем объект PN532 для I2C
-    if (nfc != nullptr) {
-        delete nfc;
+    // Создаем объект PN532 для I2C на месте прежнего (без кучи)
+    destroyDriver();
+    nfc = new (nfcStorage) Adafruit_PN532(PN532_IRQ_PIN, PN532_RESET_PIN);
+    shortRetryTimeout = false;
+    thruFraming = false;
+    watching = false;
+    nfc->enableIrq(irqWait);
+    
+    bool hardwareReady = initializeHardware();
+    if (!hardwareReady && nfc->irqEnabled()) {
+        // Линия IRQ не распаяна или не работает - пробуем опросом RDY
+        nfc->enableIrq(false);
+        hardwareReady = initializeHardware();
+        if (hardwareReady) {
+            DEBUG_PRINTLN("RFIDManager: IRQ PN532 не отвечает - переход на опрос RDY");
+            irqWait = false;
+        }
     }
     
-    nfc = new Adafruit_PN532(PN532_IRQ_DUMMY, PN532_RESET_DUMMY);
-    
-    if (!initializeHardware()) {
+    if (!hardwareReady) {
         handleError("Не удалось инициализировать PN532 аппаратуру");
         return false;
     }
@@ -46,6 +130,7 @@ bool RFIDManager::initialize() {
     isInitialized = true;
     isConnected = true;
     lastInitAttempt = millis();
+    noteTraffic();
     
     DEBUG_PRINTLN("RFIDManager: PN532 успешно инициализирован");
     return true;
@@ -94,10 +179,77 @@ bool RFIDManager::configurePN532() {
     // Быстрая конфигурация для максимальной производительности
     nfc->SAMConfig();
     
+    // Аналоговый тракт одним кадром ReadRegister: штатный профиль или неизвестно
+    static const uint16_t analogRegs[2] = {CIU_RF_CFG, CIU_MOD_GSP};
+    uint8_t analog[2];
+    currentRfProfile = -1;
+    if (nfc->readRegisters(analogRegs, analog, 2)) {
+        DEBUG_PRINTF("RFIDManager: CIU_RFCfg=0x%02X, CIU_ModGsP=0x%02X\n", analog[0], analog[1]);
+        if (analog[0] == RF_PROFILES[0].rfCfg && analog[1] == RF_PROFILES[0].modGsP) {
+            currentRfProfile = 0;
+        }
+    }
+    ciuRfProfile = currentRfProfile;
+    
     DEBUG_PRINTLN("RFIDManager: PN532 сконфигурирован для ISO14443A карт");
     return true;
 }
 
+bool RFIDManager::setRfProfile(uint8_t index) {
+    if (index >= RF_PROFILE_COUNT || nfc == nullptr) {
+        return false;
+    }
+    if (currentRfProfile == index) {
+        return true;
+    }
+    
+    // Пункт 0x0A: InListPassiveTarget перезагрузит CIU из него. Быстрой проверке
+    // без активации регистры CIU допишет verifyCard() своим кадром WriteRegister
+    uint8_t analog[sizeof(ANALOG_TYPE_A_DEFAULT)];
+    memcpy(analog, ANALOG_TYPE_A_DEFAULT, sizeof(analog));
+    analog[0] = RF_PROFILES[index].rfCfg;
+    analog[3] = RF_PROFILES[index].modGsP;
+    if (!nfc->setRFConfiguration(RF_CFG_ANALOG_TYPE_A, analog, sizeof(analog))) {
+        currentRfProfile = -1;
+        noteFailedTransaction();
+        return false;
+    }
+    noteTraffic();
+    currentRfProfile = index;
+    rfProfileSwitches++;
+    return true;
+}
+
+bool RFIDManager::setRfField(bool on) {
+    if (nfc == nullptr || watching) {
+        return false;
+    }
+    
+    // Бит 0 - поле, бит 1 (AutoRFCA) не используется
+    uint8_t field = on ? 0x01 : 0x00;
+    if (!nfc->setRFConfiguration(0x01, &field, 1)) {
+        noteFailedTransaction();
+        return false;
+    }
+    noteTraffic();
+    if (on && !rfFieldOn) {
+        fieldOnMicros = micros();
+    }
+    rfFieldOn = on;
+    return true;
+}
+
+void RFIDManager::waitFieldGuard(unsigned long guardUs) const {
+    unsigned long elapsed = micros() - fieldOnMicros;
+    if (elapsed < guardUs) {
+        delayMicroseconds(guardUs - elapsed);
+    }
+}
+
+const char* RFIDManager::getRfProfileName(uint8_t index) {
+    return index < RF_PROFILE_COUNT ? RF_PROFILES[index].name : "?";
+}
+
 ScanResult RFIDManager::scanCard() {
     // Убираем дублирование - счетчик ведется в scanCardFast()
     
@@ -118,7 +270,7 @@ ScanResult RFIDManager::scanCard() {
 }
 
 ScanResult RFIDManager::scanCardFast() {
-    totalReads++;
+    totalReads.add();
     
     // КРИТИЧЕСКАЯ ПРОВЕРКА: если PN532 не инициализирован
     if (nfc == nullptr) {
@@ -126,12 +278,7 @@ ScanResult RFIDManager::scanCardFast() {
         return SCAN_ERROR;
     }
     
-    // Проверяем таймаут для неблокирующей работы
-    if (!isTimeForRead()) {
-        return SCAN_NO_CARD;
-    }
-    
-    lastReadAttempt = millis();
+    waitReadInterval();
     
     // Проверяем подключение
     if (!isConnected && !reconnect()) {
@@ -139,6 +286,10 @@ ScanResult RFIDManager::scanCardFast() {
         return SCAN_ERROR;
     }
     
+    return readCard();
+}
+
+ScanResult RFIDManager::readCard() {
     uint8_t uid[UID_BUFFER_SIZE];
     uint8_t uidLength;
     
@@ -146,11 +297,17 @@ ScanResult RFIDManager::scanCardFast() {
     bool cardFound = readPassiveTarget(uid, uidLength);
     
     if (!cardFound) {
+        if (lastTransactionFailed) {
+            // Команда не дошла до PN532 - это не "нет карты", кэш не трогаем.
+            // Решение о потере связи принимает checkConnection() по пробе
+            incrementError();
+            return SCAN_ERROR;
+        }
         resetLastRead();
         return SCAN_NO_CARD;
     }
     
-    successfulReads++;
+    successfulReads.add();
     
     // Проверяем, изменилась ли карта
     bool cardChanged = false;
@@ -176,14 +333,270 @@ ScanResult RFIDManager::scanCardFast() {
     return cardChanged ? SCAN_CARD_CHANGED : SCAN_CARD_FOUND;
 }
 
+void RFIDManager::waitReadInterval() {
+    // Выдерживаем интервал между чтениями. Раньше здесь возвращался SCAN_NO_CARD
+    // без обращения к PN532, и занятая ячейка могла ложно считаться пустой
+    if (!isTimeForRead()) {
+        delay(readIntervalMs - (millis() - lastReadAttempt));
+    }
+    
+    lastReadAttempt = millis();
+}
+
+VerifyResult RFIDManager::verifyCard(const uint8_t* uid, uint8_t uidLength) {
+    if (nfc == nullptr || !isConnected || (uidLength != 4 && uidLength != 7)) {
+        return VERIFY_ERROR;
+    }
+    
+    totalReads.add();
+    waitReadInterval();
+    
+    // Метка, не ответившая за fRetryTimeout, считается отсутствующей -
+    // 51 мс по умолчанию превратили бы снятую фигуру в самое дорогое место
+    if (!setRetryTimeout(true)) {
+        noteFailedTransaction();
+        return VERIFY_ERROR;
+    }
+    
+    // WUPA - короткий кадр 7 бит без CRC, ATQA тоже без CRC. Активация
+    // (InListPassiveTarget, InAutoPoll) возвращает CIU к кадрам с CRC.
+    // Аналоговый профиль CIU грузит из пункта 0x0A только при активации - если
+    // профиль с тех пор сменился, RFCfg и ModGsP уходят тем же кадром WriteRegister
+    bool profileStale = currentRfProfile >= 0 && ciuRfProfile != currentRfProfile;
+    if (!thruFraming || profileStale) {
+        uint16_t regs[5] = {CIU_TX_MODE, CIU_RX_MODE, CIU_BIT_FRAMING, CIU_RF_CFG, CIU_MOD_GSP};
+        uint8_t values[5] = {0x00, 0x00, 0x07, 0, 0};
+        if (profileStale) {
+            values[3] = RF_PROFILES[currentRfProfile].rfCfg;
+            values[4] = RF_PROFILES[currentRfProfile].modGsP;
+        }
+        uint8_t first = thruFraming ? 3 : 0;
+        uint8_t last = profileStale ? 5 : 3;
+        if (!nfc->writeRegisters(&regs[first], &values[first], last - first)) {
+            ciuRfProfile = -1;              // Неизвестно, что из кадра дошло до CIU
+            noteFailedTransaction();
+            return VERIFY_ERROR;
+        }
+        thruFraming = true;
+        ciuRfProfile = currentRfProfile;
+    }
+    
+    // Кадр укладывается в ~0.5 мс - шаг опроса RDY 10 мс удвоил бы проверку
+    uint8_t wupa = TAG_CMD_WUPA;
+    uint8_t atqa[2];
+    uint8_t atqaLength = sizeof(atqa);
+    nfc->setReadyPollInterval(1);
+    bool answered = nfc->inCommunicateThru(&wupa, 1, atqa, &atqaLength, readTimeoutMs);
+    nfc->setReadyPollInterval(10);
+    
+    if (!nfc->lastCommandAcked() || nfc->lastFrameError()) {
+        noteFailedTransaction();
+        return VERIFY_ERROR;
+    }
+    noteTraffic();
+    if (!answered) {
+        // 0x01 - тишина; коллизия и прочие ошибки - разбирается антиколлизия
+        return nfc->lastThruStatus() == 0x01 ? VERIFY_ABSENT : VERIFY_OTHER;
+    }
+    
+    // Биты 7:6 ATQA - размер UID: 00 одинарный (4 байта), 01 двойной (7 байт).
+    // Подмену картой того же типа ATQA не отличит - ее ловят чтения задержки на карте
+    uint8_t uidSize = (atqa[0] >> 6) & 0x03;
+    if (atqaLength != 2 || uidSize != (uidLength == 7 ? 1 : 0)) {
+        return VERIFY_OTHER;
+    }
+    
+    successfulReads.add();
+    memcpy(lastUID, uid, uidLength);
+    lastUIDLength = uidLength;
+    lastReadValid = true;
+    lastTargetCount = 1;
+    memcpy(targetUIDs[0], uid, uidLength);
+    targetUIDLengths[0] = uidLength;
+    return VERIFY_PRESENT;
+}
+
+bool RFIDManager::setRetryTimeout(bool shortTimeout) {
+    if (shortRetryTimeout == shortTimeout) {
+        return true;
+    }
+    
+    // RFU, fATR_RES_Timeout (по умолчанию), fRetryTimeout
+    uint8_t timings[3] = {0x00, 0x0B,
+                           (uint8_t)(shortTimeout ? FAST_VERIFY_RETRY_TIMEOUT : PN532_RETRY_TIMEOUT_DEFAULT)};
+    if (!nfc->setRFConfiguration(0x02, timings, sizeof(timings))) {
+        return false;
+    }
+    shortRetryTimeout = shortTimeout;
+    return true;
+}
+
+bool RFIDManager::submitCommand(const PN532Command& command, unsigned long deadlineMs) {
+    PN532Command queued = command;
+    queued.enqueuedAt = millis();
+    queued.deadline = (deadlineMs > 0) ? queued.enqueuedAt + deadlineMs : 0;
+    queued.success = false;
+    queued.deadlineMissed = false;
+    queued.scanResult = SCAN_ERROR;
+    
+    if (!commandQueue.push(queued)) {
+        DEBUG_PRINTF("RFIDManager: Очередь команд заполнена, команда %d отклонена\n", command.type);
+        return false;
+    }
+    return true;
+}
+
+bool RFIDManager::nextCommand(PN532Command& command, unsigned long backgroundSlackMs) {
+    commandQueue.expire();
+    
+    if (!isConnected || commandQueue.isEmpty()) {
+        return false;
+    }
+    return commandQueue.pop(command, backgroundSlackMs);
+}
+
+void RFIDManager::executeCommand(PN532Command& command) {
+    // Остаток до дедлайна ограничивает ожидание ответа вместо фиксированных 1000мс
+    uint16_t timeoutMs = 1000;
+    if (command.deadline != 0) {
+        long remaining = (long)(command.deadline - millis());
+        timeoutMs = (uint16_t)constrain(remaining, 1L, 1000L);
+    }
+    
+    command.success = false;
+    
+    if (nfc == nullptr) {
+        commandQueue.recordCompletion(command);
+        return;
+    }
+    
+    switch (command.type) {
+        case CMD_SCAN_CELL:
+            totalReads.add();
+            lastReadAttempt = millis();
+            command.scanResult = readCard();
+            command.success = (command.scanResult != SCAN_ERROR);
+            break;
+            
+        case CMD_GET_FIRMWARE_VERSION: {
+            uint32_t version = nfc->getFirmwareVersion();
+            command.success = (version != 0);
+            for (int i = 0; i < 4; i++) {
+                command.data[i] = (version >> (24 - 8 * i)) & 0xFF;
+            }
+            command.dataLength = 4;
+            break;
+        }
+            
+        case CMD_GET_GENERAL_STATUS:
+            command.success = nfc->getGeneralStatus(&command.data[0]);
+            command.dataLength = 1;
+            break;
+            
+        case CMD_NTAG_READ_PAGES: {
+            uint8_t request[2] = {MIFARE_CMD_READ, command.page};
+            uint8_t length = sizeof(command.data);
+            command.success = exchangeWithTag(request, sizeof(request), command.data, length, timeoutMs);
+            command.dataLength = command.success ? length : 0;
+            break;
+        }
+            
+        case CMD_NTAG_WRITE_PAGE: {
+            uint8_t request[6] = {MIFARE_ULTRALIGHT_CMD_WRITE, command.page,
+                                  command.data[0], command.data[1], command.data[2], command.data[3]};
+            uint8_t response[4];
+            uint8_t length = sizeof(response);
+            command.success = exchangeWithTag(request, sizeof(request), response, length, timeoutMs);
+            break;
+        }
+            
+        default:
+            break;
+    }
+    
+    if (nfc->lastCommandAcked()) {
+        noteTraffic();
+    }
+    
+    command.deadlineMissed = (command.deadline != 0 && (long)(millis() - command.deadline) > 0);
+    commandQueue.recordCompletion(command);
+    
+    if (command.onComplete != nullptr) {
+        command.onComplete(command, command.context);
+    }
+}
+
+bool RFIDManager::exchangeWithTag(uint8_t* request, uint8_t requestLength,
+                                  uint8_t* response, uint8_t& responseLength, uint16_t timeoutMs) {
+    // Активация метки на выбранной антенне, затем обмен с ней
+    uint8_t uid[UID_BUFFER_SIZE];
+    uint8_t uidLength;
+    
+    // Запись NTAG подтверждается через ~4 мс - короткий таймаут проверки мал
+    if (!setRetryTimeout(false) || !readPassiveTarget(uid, uidLength)) {
+        return false;
+    }
+    
+    return nfc->inDataExchange(request, requestLength, response, &responseLength, timeoutMs);
+}
+
 bool RFIDManager::readPassiveTarget(uint8_t* uid, uint8_t& uidLength) {
     // КРИТИЧЕСКАЯ ПРОВЕРКА: nfc должен существовать
     if (nfc == nullptr) {
         return false;
     }
     
-    // Оптимизированное чтение с коротким таймаутом
-    return nfc->readPassiveTargetID(PN532_MIFARE_ISO14443A, uid, &uidLength, PN532_TIMEOUT_MS);
+    lastTransactionFailed = false;
+    unsigned long firstFailureUs = 0;
+    
+    // Уровень 1 восстановления: повтор транзакции, не дошедшей до PN532
+    for (int attempt = 0; attempt <= transactionRetries; attempt++) {
+        // Шаг опроса RDY - доля таймаута: короткий таймаут калибровки не
+        // округляется до 10 мс, а длинный не тратит шину на лишние опросы
+        nfc->setReadyPollInterval(constrain(readTimeoutMs / PN532_POLLS_PER_TIMEOUT, 1, 10));
+        bool found = nfc->readPassiveTargetIDs(PN532_MIFARE_ISO14443A, maxTargets, targetUIDs,
+                                               targetUIDLengths, &lastTargetCount, readTimeoutMs);
+        nfc->setReadyPollInterval(10);
+        if (found) {
+            // Ожидание ответа на InListPassiveTarget - то, что ограничивает таймаут
+            lastReadLatencyUs = nfc->lastReadyWaitMicros();
+            readLatency.observe(lastReadLatencyUs);
+            memcpy(uid, targetUIDs[0], targetUIDLengths[0]);
+            uidLength = targetUIDLengths[0];
+        }
+        
+        // Кадр ответа искажен на шине (LCS/DCS, заголовок) - не "карты нет", а повтор
+        if (nfc->lastCommandAcked() && !nfc->lastFrameError()) {
+            noteTraffic();
+            thruFraming = false;                // Активация перенастроила кадры CIU
+            ciuRfProfile = currentRfProfile;    // ...и перезагрузила профиль из 0x0A
+            if (!rfFieldOn) {
+                rfFieldOn = true;               // ...и включила поле
+                fieldOnMicros = micros();
+            }
+            if (attempt > 0) {
+                unsigned long elapsedUs = micros() - firstFailureUs;
+                recoveriesByLevel[RECOVERY_RETRY]++;
+                lastRecoveryTimeUs = elapsedUs;
+                totalRecoveryTimeUs += elapsedUs;
+                if (elapsedUs > maxRecoveryTimeUs) {
+                    maxRecoveryTimeUs = elapsedUs;
+                }
+            }
+            return found;  // PN532 ответил: карта есть или поле пустое
+        }
+        
+        noteFailedTransaction();
+        if (!nfc->lastBusError() && !nfc->lastFrameError()) {
+            incrementTimeout();         // Шина в порядке, PN532 не ответил ACK вовремя
+        }
+        if (attempt == 0) {
+            firstFailureUs = micros();
+        }
+    }
+    
+    lastTransactionFailed = true;
+    return false;
 }
 
 bool RFIDManager::reconnect() {
@@ -191,34 +604,150 @@ bool RFIDManager::reconnect() {
         return false;
     }
     
-    DEBUG_PRINTLN("RFIDManager: Попытка переподключения к PN532...");
+    return recover();
+}
+
+bool RFIDManager::recover() {
+    if (nfc == nullptr) {
+        return false;
+    }
     
+    DEBUG_PRINTLN("RFIDManager: Восстановление связи с PN532...");
+    
+    unsigned long startUs = micros();
     lastInitAttempt = millis();
     
-    if (getFirmwareVersion()) {
-        isConnected = true;
-        DEBUG_PRINTLN("RFIDManager: Переподключение успешно");
-        return true;
+    // Уровень 1: повтор. При SDA, прижатом к земле, повторять бесполезно
+    RecoveryLevel level = RECOVERY_RETRY;
+    bool restored = (digitalRead(PN532_SDA_PIN) == HIGH) && probeConnection();
+    
+    // Уровень 2: очистка зависшей шины
+    if (!restored) {
+        level = RECOVERY_BUS_CLEAR;
+        clearI2CBus();
+        restored = probeConnection();
     }
     
-    isConnected = false;
-    incrementError();
-    return false;
+    // Уровень 3: аппаратный сброс PN532
+    if (!restored) {
+        level = RECOVERY_HARD_RESET;
+        restored = hardResetPN532();
+    }
+    
+    unsigned long elapsedUs = micros() - startUs;
+    
+    if (!restored) {
+        recoveryFailures++;
+        lastRecoveryFailed = true;
+        isConnected = false;
+        incrementError();
+        DEBUG_PRINTF("RFIDManager: Восстановление не удалось (%lu мкс), повтор через %d мс\n",
+                     elapsedUs, RECOVERY_BACKOFF_MS);
+        return false;
+    }
+    
+    recoveriesByLevel[level]++;
+    lastRecoveryTimeUs = elapsedUs;
+    totalRecoveryTimeUs += elapsedUs;
+    if (elapsedUs > maxRecoveryTimeUs) {
+        maxRecoveryTimeUs = elapsedUs;
+    }
+    
+    lastRecoveryFailed = false;
+    isConnected = true;
+    DEBUG_PRINTF("RFIDManager: Связь восстановлена (уровень %d) за %lu мкс\n", level, elapsedUs);
+    return true;
+}
+
+bool RFIDManager::probeConnection() {
+    // Самая дешевая команда с ответом; без диагностического вывода getFirmwareVersion().
+    // Любая новая команда прерывает InAutoPoll
+    watching = false;
+    if (!nfc->getGeneralStatus()) {
+        noteFailedTransaction();
+        return false;
+    }
+    noteTraffic();
+    return true;
+}
+
+void RFIDManager::noteTraffic() {
+    lastTrafficTime = millis();
+    consecutiveFailures = 0;
+}
+
+void RFIDManager::noteFailedTransaction() {
+    if (consecutiveFailures < 255) {
+        consecutiveFailures++;
+    }
+}
+
+void RFIDManager::clearI2CBus() {
+    // Отключаем I2C периферию и вручную тактируем SCL: ведомый, застрявший
+    // посреди байта, дотактирует его и отпустит SDA
+    Wire.end();
+    
+    pinMode(PN532_SDA_PIN, INPUT_PULLUP);
+    pinMode(PN532_SCL_PIN, OUTPUT_OPEN_DRAIN);
+    digitalWrite(PN532_SCL_PIN, HIGH);
+    
+    for (int i = 0; i < I2C_BUS_CLEAR_PULSES; i++) {
+        digitalWrite(PN532_SCL_PIN, LOW);
+        delayMicroseconds(I2C_BUS_CLEAR_HALF_PERIOD_US);
+        digitalWrite(PN532_SCL_PIN, HIGH);
+        delayMicroseconds(I2C_BUS_CLEAR_HALF_PERIOD_US);
+    }
+    
+    // STOP: SDA LOW -> HIGH при SCL в HIGH
+    pinMode(PN532_SDA_PIN, OUTPUT_OPEN_DRAIN);
+    digitalWrite(PN532_SDA_PIN, LOW);
+    delayMicroseconds(I2C_BUS_CLEAR_HALF_PERIOD_US);
+    digitalWrite(PN532_SDA_PIN, HIGH);
+    delayMicroseconds(I2C_BUS_CLEAR_HALF_PERIOD_US);
+    pinMode(PN532_SDA_PIN, INPUT_PULLUP);
+    
+    initializeBus();
+}
+
+void RFIDManager::initializeBus() {
+    Wire.begin(PN532_SDA_PIN, PN532_SCL_PIN);
+    Wire.setClock(I2C_FREQUENCY);
+    Wire.setTimeOut(I2C_TIMEOUT_MS);
+}
+
+bool RFIDManager::hardResetPN532() {
+    // RSTPD_N LOW/HIGH (~3 мс) и SAMConfig сразу, без INIT_RETRY_DELAY.
+    // Объект nfc не пересоздается - кэш и позиция сканирования не затрагиваются
+    nfc->reset();
+    nfc->wakeup();
+    shortRetryTimeout = false;      // RFConfiguration сброшена вместе с PN532
+    currentRfProfile = 0;
+    ciuRfProfile = 0;
+    rfFieldOn = false;
+    thruFraming = false;
+    watching = false;               // ...и InAutoPoll
+    return probeConnection();
 }
 
 void RFIDManager::checkConnection() {
-    // Периодическая проверка подключения
-    static unsigned long lastCheck = 0;
+    // Успешный трафик сканирования уже доказывает, что PN532 жив -
+    // отдельная команда нужна только при тишине или серии неудач
+    if (!isConnected || nfc == nullptr || !isLivenessProbeDue()) {
+        return;
+    }
     
-    if (millis() - lastCheck > 10000) {  // Каждые 10 секунд
-        if (!testConnection()) {
-            isConnected = false;
-            handleError("Потеряно соединение с PN532");
-        }
-        lastCheck = millis();
+    livenessProbes++;
+    
+    if (!probeConnection()) {
+        handleError("Потеряно соединение с PN532");
     }
 }
 
+bool RFIDManager::isLivenessProbeDue() const {
+    return consecutiveFailures >= LIVENESS_FAILURE_THRESHOLD ||
+           (millis() - lastTrafficTime) >= LIVENESS_SILENT_PERIOD_MS;
+}
+
 bool RFIDManager::testConnection() {
     return getFirmwareVersion();
 }
@@ -234,15 +763,16 @@ bool RFIDManager::getLastUID(uint8_t* uid, uint8_t& uidLength) const {
 }
 
 float RFIDManager::getSuccessRate() const {
-    if (totalReads == 0) return 0.0;
-    return (float)successfulReads / totalReads * 100.0;
+    if (totalReads.get() == 0) return 0.0;
+    return (float)successfulReads.get() / totalReads.get() * 100.0;
 }
 
 void RFIDManager::resetStatistics() {
-    totalReads = 0;
-    successfulReads = 0;
-    errors = 0;
-    timeouts = 0;
+    totalReads.reset();
+    successfulReads.reset();
+    errors.reset();
+    timeouts.reset();
+    readLatency.reset();
     
     DEBUG_PRINTLN("RFIDManager: Статистика сброшена");
 }
@@ -251,21 +781,153 @@ void RFIDManager::resetLastRead() {
     memset(lastUID, 0, sizeof(lastUID));
     lastUIDLength = 0;
     lastReadValid = false;
+    lastTargetCount = 0;
+}
+
+void RFIDManager::setIrqWait(bool enabled) {
+    irqWait = enabled;
+    if (nfc != nullptr) {
+        nfc->enableIrq(enabled);
+    }
+}
+
+bool RFIDManager::getIrqWait() const {
+    return (nfc != nullptr) ? nfc->irqEnabled() : irqWait;
+}
+
+void RFIDManager::setReadTiming(uint16_t timeoutMs, unsigned long intervalMs) {
+    readTimeoutMs = timeoutMs;
+    readIntervalMs = intervalMs;
+}
+
+bool RFIDManager::startWatch() {
+    if (nfc == nullptr || !isConnected || watching) {
+        return false;
+    }
+    
+    const uint8_t types[] = {PN532_AUTOPOLL_MIFARE};
+    if (!nfc->startAutoPoll(0xFF, WATCH_AUTOPOLL_PERIOD, types, sizeof(types))) {
+        noteFailedTransaction();
+        return false;
+    }
+    
+    noteTraffic();
+    resetLastRead();
+    thruFraming = false;
+    watching = true;
+    if (!rfFieldOn) {
+        rfFieldOn = true;               // InAutoPoll включает поле сам
+        fieldOnMicros = micros();
+    }
+    lastWatchPoll = millis();
+    return true;
+}
+
+ScanResult RFIDManager::pollWatch() {
+    if (!watching) {
+        return SCAN_ERROR;
+    }
+    
+    // С IRQ проверка - уровень пина без обмена по шине, шаг не нужен
+    bool irq = nfc->irqEnabled();
+    if (!irq && millis() - lastWatchPoll < WATCH_RDY_POLL_MS) {
+        return SCAN_NO_CARD;
+    }
+    lastWatchPoll = millis();
+    
+    if (!nfc->responseReady()) {
+        if (nfc->lastBusError()) {
+            // PN532 не отвечает по шине - решение принимает проба живости
+            watching = false;
+            noteFailedTransaction();
+            return SCAN_ERROR;
+        }
+        // Чтение RDY прошло - PN532 жив, проба GetGeneralStatus прервала бы опрос
+        if (!irq) {
+            noteTraffic();
+        }
+        return SCAN_NO_CARD;
+    }
+    
+    watching = false;
+    noteTraffic();
+    totalReads.add();
+    
+    uint8_t uid[UID_BUFFER_SIZE];
+    uint8_t uidLength;
+    if (!nfc->readAutoPollTarget(uid, &uidLength)) {
+        return SCAN_ERROR;
+    }
+    
+    successfulReads.add();
+    memcpy(lastUID, uid, uidLength);
+    lastUIDLength = uidLength;
+    lastReadValid = true;
+    lastTargetCount = 1;
+    memcpy(targetUIDs[0], uid, uidLength);
+    targetUIDLengths[0] = uidLength;
+    return SCAN_CARD_FOUND;
+}
+
+void RFIDManager::stopWatch() {
+    if (!watching) {
+        return;
+    }
+    
+    // ACK от хоста прерывает InAutoPoll
+    nfc->abortCommand();
+    watching = false;
+}
+
+void RFIDManager::setMaxTargets(uint8_t count) {
+    maxTargets = constrain(count, 1, 2);
+}
+
+bool RFIDManager::getLastTarget(uint8_t index, uint8_t* uid, uint8_t& uidLength) const {
+    if (!lastReadValid || index >= lastTargetCount) {
+        return false;
+    }
+    
+    memcpy(uid, targetUIDs[index], targetUIDLengths[index]);
+    uidLength = targetUIDLengths[index];
+    return true;
+}
+
+bool RFIDManager::selectTarget(uint8_t index) {
+    if (!lastReadValid || index >= lastTargetCount) {
+        return false;
+    }
+    
+    // Обмен с меткой (InDataExchange) тоже идет с выбранной
+    memcpy(lastUID, targetUIDs[index], targetUIDLengths[index]);
+    lastUIDLength = targetUIDLengths[index];
+    nfc->selectListedTarget(index);
+    return true;
 }
 
 bool RFIDManager::isTimeForRead() const {
-    return (millis() - lastReadAttempt) >= SCAN_DELAY_MS;
+    return (millis() - lastReadAttempt) >= readIntervalMs;
 }
 
 bool RFIDManager::isTimeForReconnect() const {
-    return (millis() - lastInitAttempt) >= 5000;  // Попытка переподключения каждые 5 сек
+    // Первая попытка сразу, пауза только после неудачи всех уровней
+    return !lastRecoveryFailed || (millis() - lastInitAttempt) >= RECOVERY_BACKOFF_MS;
+}
+
+unsigned long RFIDManager::getMeanRecoveryTimeUs() const {
+    uint32_t recoveries = 0;
+    for (int i = RECOVERY_RETRY; i < RECOVERY_LEVEL_COUNT; i++) {
+        recoveries += recoveriesByLevel[i];
+    }
+    if (recoveries == 0) return 0;
+    return (unsigned long)(totalRecoveryTimeUs / recoveries);
 }
 
 void RFIDManager::handleError(const char* errorMessage) {
-    errors++;
+    errors.add();
     
     if (LOG_ERROR_EVENTS) {
-        DEBUG_PRINTF("RFIDManager: ОШИБКА #%lu: %s\n", errors, errorMessage);
+        DEBUG_PRINTF("RFIDManager: ОШИБКА #%lu: %s\n", errors.get(), errorMessage);
     }
     
     isConnected = false;
@@ -277,11 +939,24 @@ void RFIDManager::printDiagnostics() const {
     DEBUG_PRINTLN("========================================");
     DEBUG_PRINTF("Инициализирован: %s\n", isInitialized ? "ДА" : "НЕТ");
     DEBUG_PRINTF("Подключен: %s\n", isConnected ? "ДА" : "НЕТ");
-    DEBUG_PRINTF("Общее количество чтений: %lu\n", totalReads);
-    DEBUG_PRINTF("Успешные чтения: %lu\n", successfulReads);
-    DEBUG_PRINTF("Ошибки: %lu\n", errors);
-    DEBUG_PRINTF("Таймауты: %lu\n", timeouts);
+    DEBUG_PRINTF("Ожидание ответа: %s\n", getIrqWait() ? "IRQ" : "опрос RDY");
+    DEBUG_PRINTF("Профиль RF: %s, переключений: %lu\n",
+                 currentRfProfile >= 0 ? getRfProfileName(currentRfProfile) : "неизвестен",
+                 rfProfileSwitches);
+    DEBUG_PRINTF("Общее количество чтений: %lu\n", totalReads.get());
+    DEBUG_PRINTF("Успешные чтения: %lu\n", successfulReads.get());
+    DEBUG_PRINTF("Ошибки: %lu\n", errors.get());
+    DEBUG_PRINTF("Таймауты: %lu\n", timeouts.get());
+    DEBUG_PRINTF("Задержка ответа на чтение: среднее=%lu мкс (%lu чтений)\n", readLatency.getMean(), readLatency.getCount());
     DEBUG_PRINTF("Успешность: %.1f%%\n", getSuccessRate());
+    DEBUG_PRINTF("Восстановления: повтор=%lu, очистка шины=%lu, сброс=%lu, неудачи=%lu\n",
+                 recoveriesByLevel[RECOVERY_RETRY], recoveriesByLevel[RECOVERY_BUS_CLEAR],
+                 recoveriesByLevel[RECOVERY_HARD_RESET], recoveryFailures);
+    DEBUG_PRINTF("Время восстановления: последнее=%lu мкс, среднее=%lu мкс, макс=%lu мкс\n",
+                 lastRecoveryTimeUs, getMeanRecoveryTimeUs(), maxRecoveryTimeUs);
+    DEBUG_PRINTF("Живость: последний обмен %lu мс назад, проб=%lu\n",
+                 getTimeSinceTraffic(), livenessProbes);
+    commandQueue.printMetrics();
     DEBUG_PRINTF("Последнее чтение валидно: %s\n", lastReadValid ? "ДА" : "НЕТ");
     
     if (lastReadValid) {
@@ -5,27 +5,102 @@
 #include <Wire.h>
 #include <Adafruit_PN532.h>
 #include "config.h"
+#include "command_queue.h"
+#include "metrics.h"
+
+// Уровни восстановления связи с PN532 (по возрастанию стоимости)
+enum RecoveryLevel {
+    RECOVERY_NONE,        // Восстановление не потребовалось
+    RECOVERY_RETRY,       // Повтор транзакции
+    RECOVERY_BUS_CLEAR,   // 9 импульсов SCL + STOP, переинициализация Wire
+    RECOVERY_HARD_RESET,  // Сброс PN532 через RSTPD_N + быстрый SAMConfig
+    RECOVERY_LEVEL_COUNT
+};
+
+// Исход быстрой проверки известной карты
+enum VerifyResult {
+    VERIFY_PRESENT,       // Карта на месте (ATQA с тем же размером UID)
+    VERIFY_ABSENT,        // Никто не ответил на WUPA
+    VERIFY_OTHER,         // ATQA другого типа карты или коллизия
+    VERIFY_ERROR,         // Команда не дошла до PN532
+    VERIFY_RESULT_COUNT
+};
 
 class RFIDManager {
 private:
+    // Драйвер PN532 создается на месте в nfcStorage: повторная инициализация
+    // пересоздает его без кучи (nfc - nullptr или адрес nfcStorage)
     Adafruit_PN532* nfc;
+    alignas(Adafruit_PN532) uint8_t nfcStorage[sizeof(Adafruit_PN532)];
     bool isInitialized;
     bool isConnected;
     
-    // Статистика
-    uint32_t totalReads;
-    uint32_t successfulReads;
-    uint32_t errors;
-    uint32_t timeouts;
+    // Статистика (реестр метрик)
+    MetricCounter totalReads;
+    MetricCounter successfulReads;
+    MetricCounter errors;
+    MetricCounter timeouts;             // PN532 не ответил ACK вовремя (без NACK на шине)
+    MetricHistogram readLatency;        // Ожидание ответа на InListPassiveTarget, мкс
     
     // Тайминги для неблокирующей работы
     unsigned long lastReadAttempt;
     unsigned long lastInitAttempt;
     
+    // Тайминги чтения текущей ячейки (профиль калибровки)
+    uint16_t readTimeoutMs;
+    unsigned long readIntervalMs;
+    uint8_t transactionRetries;         // Повторы уровня 1 (RECOVERY_TRANSACTION_RETRIES)
+    unsigned long lastReadLatencyUs;    // Ожидание ответа последнего успешного чтения
+    
     // Последние данные чтения
     uint8_t lastUID[UID_BUFFER_SIZE];
     uint8_t lastUIDLength;
     bool lastReadValid;
+    bool lastTransactionFailed;     // Команда не дошла до PN532 (нет ACK)
+    
+    // Метки последнего чтения с MaxTg=2 (lastUID - выбранная из них)
+    uint8_t maxTargets;
+    uint8_t targetUIDs[2][UID_BUFFER_SIZE];
+    uint8_t targetUIDLengths[2];
+    uint8_t lastTargetCount;
+    
+    // Быстрая проверка: CIU настроен на WUPA (7 бит, без CRC). Сбрасывается
+    // активацией - InListPassiveTarget и InAutoPoll возвращают кадры с CRC
+    bool thruFraming;
+    bool shortRetryTimeout;         // fRetryTimeout PN532 уменьшен под проверку
+    
+    // Наблюдение (InAutoPoll): PN532 занят опросом, другие команды только после stopWatch()
+    bool watching;
+    unsigned long lastWatchPoll;
+    
+    // Ожидание ответов по линии IRQ (иначе опрос байта RDY)
+    bool irqWait;
+    
+    // Профиль аналогового тракта: записанный в PN532 (RFConfiguration 0x0A,
+    // -1 = неизвестен) и загруженный в CIU (активацией или WriteRegister)
+    int8_t currentRfProfile;
+    int8_t ciuRfProfile;
+    uint32_t rfProfileSwitches;
+    
+    // Поле RF: InListPassiveTarget включает его сам
+    bool rfFieldOn;
+    unsigned long fieldOnMicros;
+    
+    // Статистика восстановления
+    uint32_t recoveriesByLevel[RECOVERY_LEVEL_COUNT];
+    uint32_t recoveryFailures;
+    unsigned long lastRecoveryTimeUs;
+    unsigned long maxRecoveryTimeUs;
+    uint64_t totalRecoveryTimeUs;
+    bool lastRecoveryFailed;
+    
+    // Живость по трафику
+    unsigned long lastTrafficTime;  // Последний ACK/ответ от PN532
+    uint8_t consecutiveFailures;    // Транзакций без ACK подряд
+    uint32_t livenessProbes;
+    
+    // Очередь несканирующих команд
+    CommandQueue commandQueue;
     
 public:
     RFIDManager();
@@ -34,12 +109,63 @@ public:
     // Инициализация и подключение
     bool initialize();
     bool reconnect();
-    void checkConnection();
+    bool recover();             // Многоуровневое восстановление без backoff
+    void checkConnection();     // Проба GetGeneralStatus только при тишине/неудачах
+    bool isLivenessProbeDue() const;
     
     // Основные операции чтения (неблокирующие)
     ScanResult scanCard();
     ScanResult scanCardFast();  // Оптимизированная версия
     
+    // Быстрая проверка занятой ячейки: WUPA и ATQA вместо антиколлизии.
+    // Только для только что запитанной метки - из READY она на WUPA молчит
+    VerifyResult verifyCard(const uint8_t* uid, uint8_t uidLength);
+    
+    // Наблюдение за выбранной ячейкой: PN532 сам опрашивает поле (InAutoPoll),
+    // хост только читает байт RDY. pollWatch(): SCAN_NO_CARD - пока пусто,
+    // SCAN_CARD_FOUND - метка появилась (lastUID), SCAN_ERROR - наблюдение прервано
+    bool startWatch();
+    ScanResult pollWatch();
+    void stopWatch();
+    bool isWatching() const { return watching; }
+    
+    // Ожидание ответа PN532: линия IRQ или опрос RDY. getIrqWait() - фактический
+    // режим (false после отката, если линия не ответила при инициализации)
+    void setIrqWait(bool enabled);
+    bool getIrqWait() const;
+    
+    // Профиль аналогового тракта для следующих чтений (0..RF_PROFILE_COUNT-1).
+    // Пишется в PN532 только при отличии от текущего
+    bool setRfProfile(uint8_t index);
+    int8_t getRfProfile() const { return currentRfProfile; }
+    uint32_t getRfProfileSwitches() const { return rfProfileSwitches; }
+    static const char* getRfProfileName(uint8_t index);
+    
+    // Поле RF (RFConfiguration, пункт 1). waitFieldGuard() досыпает запитку
+    // метки с момента включения
+    bool setRfField(bool on);
+    bool getRfField() const { return rfFieldOn; }
+    void waitFieldGuard(unsigned long guardUs) const;
+    
+    // Тайминги следующих чтений: таймаут PN532 и минимальный интервал между ними
+    void setReadTiming(uint16_t timeoutMs, unsigned long intervalMs);
+    void setTransactionRetries(uint8_t retries) { transactionRetries = retries; }
+    uint8_t getTransactionRetries() const { return transactionRetries; }
+    unsigned long getLastReadLatencyUs() const { return lastReadLatencyUs; }
+    
+    // Сколько меток запрашивать у InListPassiveTarget (1..2). Из двух прочитанных
+    // lastUID - первая, пока selectTarget() не выберет владельца ячейки
+    void setMaxTargets(uint8_t count);
+    uint8_t getLastTargetCount() const { return lastTargetCount; }
+    bool getLastTarget(uint8_t index, uint8_t* uid, uint8_t& uidLength) const;
+    bool selectTarget(uint8_t index);
+    
+    // Очередь команд: исполняются по одной между шагами сканирования
+    bool submitCommand(const PN532Command& command, unsigned long deadlineMs = 0);
+    bool nextCommand(PN532Command& command, unsigned long backgroundSlackMs);
+    void executeCommand(PN532Command& command);
+    const CommandQueue& getCommandQueue() const { return commandQueue; }
+    
     // Получение данных последнего чтения
     bool getLastUID(uint8_t* uid, uint8_t& uidLength) const;
     bool isLastReadValid() const { return lastReadValid; }
@@ -49,12 +175,23 @@ public:
     bool getConnected() const { return isConnected; }
     
     // Статистика и метрики
-    uint32_t getTotalReads() const { return totalReads; }
-    uint32_t getSuccessfulReads() const { return successfulReads; }
-    uint32_t getErrors() const { return errors; }
-    uint32_t getTimeouts() const { return timeouts; }
+    uint32_t getTotalReads() const { return totalReads.get(); }
+    uint32_t getSuccessfulReads() const { return successfulReads.get(); }
+    uint32_t getErrors() const { return errors.get(); }
+    uint32_t getTimeouts() const { return timeouts.get(); }
     float getSuccessRate() const;
     
+    // Метрики восстановления
+    uint32_t getRecoveryCount(RecoveryLevel level) const { return recoveriesByLevel[level]; }
+    uint32_t getRecoveryFailures() const { return recoveryFailures; }
+    unsigned long getLastRecoveryTimeUs() const { return lastRecoveryTimeUs; }
+    unsigned long getMaxRecoveryTimeUs() const { return maxRecoveryTimeUs; }
+    unsigned long getMeanRecoveryTimeUs() const;
+    
+    // Метрики живости
+    uint32_t getLivenessProbes() const { return livenessProbes; }
+    unsigned long getTimeSinceTraffic() const { return millis() - lastTrafficTime; }
+    
     // Сброс статистики
     void resetStatistics();
     
@@ -65,15 +202,29 @@ public:
     
     // Обработка ошибок
     void handleError(const char* errorMessage);
-    void incrementError() { errors++; }
-    void incrementTimeout() { timeouts++; }
+    void incrementError() { errors.add(); }
+    void incrementTimeout() { timeouts.add(); }
     
 private:
     // Внутренние методы
+    void destroyDriver();
     bool initializeHardware();
     bool configurePN532();
     void resetLastRead();
     bool readPassiveTarget(uint8_t* uid, uint8_t& uidLength);
+    void waitReadInterval();
+    bool setRetryTimeout(bool shortTimeout);
+    ScanResult readCard();
+    bool exchangeWithTag(uint8_t* request, uint8_t requestLength,
+                         uint8_t* response, uint8_t& responseLength, uint16_t timeoutMs);
+    void noteTraffic();
+    void noteFailedTransaction();
+    
+    // Уровни восстановления
+    bool probeConnection();
+    void clearI2CBus();
+    void initializeBus();
+    bool hardResetPN532();
     
     // Тайминги и таймауты
     bool isTimeForRead() const;
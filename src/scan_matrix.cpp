@@ -1,18 +1,84 @@
 #include "scan_matrix.h"
 
+// Корзины времени прохода: консервативные тайминги дают 10-12 с, калибровка - меньше
+static const uint32_t CYCLE_TIME_BOUNDS_MS[] = {2000, 4000, 6000, 8000, 10000, 12000, 15000};
+
 ScanMatrix::ScanMatrix(MultiplexerManager* mux, RFIDManager* rfid) {
     muxManager = mux;
     rfidManager = rfid;
     
-    currentCellIndex = 0;
+    scanOrder = nullptr;
+    passOrder = nullptr;
+    setScanPosition(0);
     scanInProgress = false;
     
     cycleStartTime = 0;
+    lastCycleTime = 0;
+    for (int i = 0; i < MATRIX_TOTAL_CELLS; i++) {
+        passOffsetMs[i] = 0;
+        lastPassOffsetMs[i] = 0;
+    }
     // currentFPS убран - используем событийное сканирование вместо FPS
     
-    cardsDetected = 0;
-    cardsRemoved = 0;
-    cardChanges = 0;
+    cardsDetected = metrics.counter("scan.cards_added");
+    cardsRemoved = metrics.counter("scan.cards_removed");
+    cardChanges = metrics.counter("scan.cards_replaced");
+    cycleTimeMs = metrics.histogram("scan.cycle_ms", CYCLE_TIME_BOUNDS_MS,
+                                    sizeof(CYCLE_TIME_BOUNDS_MS) / sizeof(CYCLE_TIME_BOUNDS_MS[0]));
+    cardsPresent = metrics.gauge("scan.cards_present");
+    
+    restoredFromSnapshot = false;
+    restoredCards = 0;
+    verifyCount = 0;
+    verifyPos = 0;
+    
+    for (int i = 0; i < MATRIX_TOTAL_CELLS; i++) {
+        observedSinceBoot[i] = false;
+    }
+    observedCount = 0;
+    
+    assumedBoardTime = 0;
+    restoredVerifiedTime = 0;
+    firstValidBoardTime = 0;
+    
+    scanDelayMs = SCAN_DELAY_MS;
+    defaultTimeoutMs = PN532_TIMEOUT_MS;
+    lastScanSwitchMicros = 0;
+    confirmReads = 0;
+    
+    gatedSwitchMicros = 0;
+    gateCommandUs = 0;
+    pendingSwitchCell = -1;
+    pendingSwitchGated = false;
+    pendingSwitchCostUs = 0;
+    
+    fastVerifyEnabled = ENABLE_FAST_VERIFY;
+    moveRecognizerEnabled = ENABLE_MOVE_RECOGNIZER;
+    for (int i = 0; i < VERIFY_RESULT_COUNT; i++) {
+        verifyCounts[i] = 0;
+    }
+    
+    multiTargetMode = MULTI_TARGET_MODE;
+    for (int i = 0; i < MATRIX_TOTAL_CELLS; i++) {
+        multiTargetCell[i] = (multiTargetMode == MULTI_TARGET_ALWAYS);
+        singleTargetStreak[i] = 0;
+    }
+    multiTargetPromotions = 0;
+    multiTargetReads = 0;
+    ownerByNeighbour = 0;
+    ownerAmbiguous = 0;
+    flickerEvents = 0;
+    
+    watchAfterRemoval = ENABLE_WATCH_AFTER_REMOVAL;
+    watchCellIndex = -1;
+    watchStartTime = 0;
+    watchDurationMs = 0;
+    watchSessions = 0;
+    watchHits = 0;
+    watchTimeouts = 0;
+    watchPreempted = 0;
+    watchTotalMs = 0;
+    watchHitDelayMs = 0;
     
     // Инициализация кэша карт
     clearCardCache();
@@ -26,10 +92,15 @@ void ScanMatrix::initialize() {
         return;
     }
     
-    clearCardCache();
-    currentCellIndex = 0;
+    // Восстановленную из снимка доску не стираем - ее проверит первый проход
+    if (!restoredFromSnapshot) {
+        clearCardCache();
+    }
+    setScanPosition(0);
     scanInProgress = false;
     
+    calibrator.begin();
+    
     DEBUG_PRINTF("ScanMatrix: Инициализирована матрица %dx%d (%d ячеек)\n", 
                  MATRIX_ROWS, MATRIX_COLS, MATRIX_TOTAL_CELLS);
     DEBUG_PRINTF("ScanMatrix: Ожидаемое время полного цикла: %.1f сек (ЭТАП 1 оптимизация)\n", 
@@ -42,10 +113,45 @@ void ScanMatrix::update() {
         startNewCycle();
     }
     
+    // Наблюдение за ячейкой: PN532 опрашивает поле сам, здесь только байт RDY
+    if (runWatchStep()) {
+        return;
+    }
+    
+    // Команды из очереди RFIDManager - по одной за вызов, между шагами сканирования
+    if (serviceCommandQueue()) {
+        return;
+    }
+    
+    // Теплый старт: сначала подтверждаем ячейки, восстановленные из снимка
+    if (runVerificationStep()) {
+        return;
+    }
+    
+    // Отложенная запись снимка (только подтвержденной доски)
+    if (isBoardValid()) {
+        snapshotStore.update(cardCache);
+    }
+    calibrator.update();
+    
+    // Партия: начало по начальной расстановке, истечение ожидания рокировки
+    if (moveRecognizerEnabled) {
+        if (!moveRecognizer.isActive() && isBoardValid() && MoveRecognizer::isStartPosition(cardCache)) {
+            moveRecognizer.beginGame(cardCache);
+        }
+        moveRecognizer.update();
+    }
+    
+    // Фоновая проверка ячейки в карантине - редко, между шагами прохода
+    if (runQuarantineProbe()) {
+        return;
+    }
+    
     // СОБЫТИЙНОЕ СКАНИРОВАНИЕ - НЕ ЦИКЛИЧЕСКОЕ!
     // Сканируем текущую ячейку и ОСТАЕМСЯ на ней если есть карта
     
     ScanResult result = scanCurrentCell();
+    bool wasPresent = cardCache[currentCellIndex].present;
     
     // Обновляем кэш
     updateCardCache(currentCellIndex, result);
@@ -66,8 +172,8 @@ void ScanMatrix::update() {
                 // Убираем постоянный вывод карт - выводим только матрицу в конце прохода
             }
             
-            // Задерживаемся на карте 1000мс для стабильного чтения (ЭТАП A: стабилизация)
-            if (millis() - cardFoundTime < 1000) {
+            // Задерживаемся на карте CARD_DWELL_MS для стабильного чтения (ЭТАП A: стабилизация)
+            if (millis() - cardFoundTime < CARD_DWELL_MS) {
                 return; // НЕ переходим к следующей ячейке
             }
             
@@ -76,14 +182,26 @@ void ScanMatrix::update() {
             break;
             
         case SCAN_NO_CARD:
+            // Фигуру только что сняли - ее часто ставят обратно: ждем на ячейке,
+            // проход продолжится после наблюдения
+            if (watchAfterRemoval && wasPresent && isBoardValid() &&
+                watchCell(currentCellIndex, WATCH_AFTER_REMOVAL_MS)) {
+                break;
+            }
             // Нет карты - быстро переходим к следующей ячейке
             moveToNextCell();
             break;
             
         case SCAN_ERROR:
-            // Ошибка - пропускаем ячейку и идем дальше
             DEBUG_PRINTF("ОШИБКА сканирования ячейки %d\n", currentCellIndex);
-            moveToNextCell();
+            // Потеря связи с PN532 (или ждем пробу живости) - остаемся на ячейке,
+            // после восстановления проход продолжится с нее. Иначе пропускаем ячейку.
+            // Повторная ошибка после пробы - неисправность ячейки, а не связи
+            if (rfidManager->getConnected() &&
+                (!rfidManager->isLivenessProbeDue() || quarantine.getFailures(currentCellIndex) > 1 ||
+                 quarantine.isQuarantined(currentCellIndex))) {
+                moveToNextCell();
+            }
             break;
     }
     
@@ -93,25 +211,28 @@ void ScanMatrix::update() {
         
         // Измеряем время полного прохода
         unsigned long cycleTime = millis() - cycleStartTime;
+        lastCycleTime = cycleTime;
+        cycleTimeMs.observe(cycleTime);
+        memcpy(lastPassOffsetMs, passOffsetMs, sizeof(passOffsetMs));
         
         // Находим карты и выводим матрицу
         int cardsFound = findCardsInMatrix();
+        cardsPresent.set(cardsFound);
         
         DEBUG_PRINTF("\n=== СКАНИРОВАНИЕ ЗАВЕРШЕНО за %lu мс ===\n", cycleTime);
         DEBUG_PRINTF("Найдено карт: %d\n", cardsFound);
         
         if (cardsFound > 0) {
-            // Простой список карт вместо сложной матрицы (избегаем crash)
+            // Список карт: строка в буфере фиксированного размера, один вывод на карту
             DEBUG_PRINTLN("Список найденных карт:");
+            char line[16 + UID_BUFFER_SIZE * 2];
             for (int i = 0; i < MATRIX_TOTAL_CELLS; i++) {
                 if (cardCache[i].present) {
-                    int row = i / MATRIX_COLS;
-                    int col = i % MATRIX_COLS;
-                    DEBUG_PRINTF("[%d,%d]: ", row, col);
-                    for (uint8_t j = 0; j < cardCache[i].uidLength; j++) {
-                        DEBUG_PRINTF("%02X", cardCache[i].uid[j]);
+                    int length = snprintf(line, sizeof(line), "[%d,%d]: ", i / MATRIX_COLS, i % MATRIX_COLS);
+                    for (uint8_t j = 0; j < cardCache[i].uidLength && j < UID_BUFFER_SIZE; j++) {
+                        length += snprintf(line + length, sizeof(line) - length, "%02X", cardCache[i].uid[j]);
                     }
-                    DEBUG_PRINTLN("");
+                    DEBUG_PRINTLN(line);
                 }
             }
         } else {
@@ -126,11 +247,175 @@ void ScanMatrix::update() {
 
 void ScanMatrix::startNewCycle() {
     cycleStartTime = millis();
-    currentCellIndex = 0;
+    passOrder = scanOrder;
+    setScanPosition(0);
     scanInProgress = true;
     
+    for (int i = 0; i < MATRIX_TOTAL_CELLS; i++) {
+        passOffsetMs[i] = 0;
+    }
+    skipCellsOutsidePass();
+    notePassOffset();
+    
     // Выбираем первую ячейку
-    muxManager->selectCellByIndex(currentCellIndex);
+    if (!isCycleComplete()) {
+        selectCell(currentCellIndex);
+    }
+}
+
+bool ScanMatrix::restoreSnapshot() {
+    BoardSnapshot snapshot;
+    
+    if (!snapshotStore.load(snapshot)) {
+        DEBUG_PRINTLN("ScanMatrix: Снимка доски нет - холодный старт");
+        return false;
+    }
+    
+    clearCardCache();
+    restoredCards = 0;
+    verifyCount = 0;
+    verifyPos = 0;
+    
+    for (int i = 0; i < MATRIX_TOTAL_CELLS; i++) {
+        uint8_t length = snapshot.uidLength[i];
+        if (length == 0 || length > UID_BUFFER_SIZE) {
+            continue;
+        }
+        
+        cardCache[i].present = true;
+        cardCache[i].assumed = true;
+        cardCache[i].uidLength = length;
+        memcpy(cardCache[i].uid, snapshot.uid[i], length);
+        
+        // Занятые ячейки проверяются первыми
+        verifyCells[verifyCount++] = i;
+        restoredCards++;
+    }
+    
+    restoredFromSnapshot = true;
+    assumedBoardTime = millis();
+    
+    DEBUG_PRINTF("ScanMatrix: Доска восстановлена из снимка #%lu: %d карт (предположительно)\n",
+                 snapshot.sequence, restoredCards);
+    return true;
+}
+
+bool ScanMatrix::flushSnapshot() {
+    return snapshotStore.flush(cardCache);
+}
+
+bool ScanMatrix::runVerificationStep() {
+    if (verifyPos >= verifyCount) {
+        return false;
+    }
+    
+    int cellIndex = verifyCells[verifyPos];
+    ScanResult result = scanCell(cellIndex);
+    
+    // Без связи с PN532 повторим ту же ячейку после восстановления.
+    // Ошибка при живой связи - ячейку проверит обычный проход
+    if (result == SCAN_ERROR && !rfidManager->getConnected()) {
+        return true;
+    }
+    
+    updateCardCache(cellIndex, result);
+    verifyPos++;
+    
+    if (verifyPos >= verifyCount) {
+        restoredVerifiedTime = millis();
+        DEBUG_PRINTF("ScanMatrix: Восстановленные ячейки проверены (%d) за %lu мс после включения\n",
+                     verifyCount, restoredVerifiedTime);
+    }
+    
+    // Антенна возвращается на ячейку прохода
+    if (!isCycleComplete()) {
+        selectCell(currentCellIndex);
+    }
+    return true;
+}
+
+void ScanMatrix::setScanPosition(int position) {
+    scanPosition = position;
+    // За концом прохода ячейки нет (индекс вне матрицы, как прежде)
+    if (position >= MATRIX_TOTAL_CELLS) {
+        currentCellIndex = MATRIX_TOTAL_CELLS;
+    } else {
+        currentCellIndex = (passOrder != nullptr) ? passOrder[position] : position;
+    }
+}
+
+void ScanMatrix::skipCellsOutsidePass() {
+    // Первый проход после теплого старта не повторяет уже подтвержденные ячейки.
+    // Ячейки в карантине проверяет runQuarantineProbe()
+    bool skipObserved = restoredFromSnapshot && !isBoardValid();
+    
+    while (!isCycleComplete() &&
+           ((skipObserved && observedSinceBoot[currentCellIndex]) ||
+            quarantine.isQuarantined(currentCellIndex))) {
+        setScanPosition(scanPosition + 1);
+    }
+}
+
+bool ScanMatrix::runQuarantineProbe() {
+    int cellIndex = quarantine.nextProbeCell();
+    if (cellIndex < 0) {
+        return false;
+    }
+    
+    // Чтения подряд, пока ячейка в карантине: ошибка обрывает проверку до
+    // следующего интервала, серия чистых чтений возвращает ячейку в проход
+    while (quarantine.isQuarantined(cellIndex)) {
+        ScanResult result = scanCell(cellIndex);
+        updateCardCache(cellIndex, result);
+        if (result == SCAN_ERROR) {
+            break;
+        }
+    }
+    
+    // Антенна возвращается на ячейку прохода
+    if (!isCycleComplete()) {
+        selectCell(currentCellIndex);
+    }
+    return true;
+}
+
+void ScanMatrix::noteCellHealth(int cellIndex, ScanResult result) {
+    if (result != SCAN_ERROR) {
+        quarantine.recordSuccess(cellIndex);
+        return;
+    }
+    
+    // Без связи с PN532 ошибки у всех ячеек - ячейка не виновата
+    if (!rfidManager->getConnected()) {
+        return;
+    }
+    if (quarantine.recordFailure(cellIndex)) {
+        // Состояние ячейки больше не проверяется проходом - последнее известное
+        // не должно задерживать достоверность доски
+        markObserved(cellIndex);
+    }
+}
+
+void ScanMatrix::notePassOffset() {
+    if (!isCycleComplete()) {
+        passOffsetMs[currentCellIndex] = millis() - cycleStartTime;
+    }
+}
+
+void ScanMatrix::markObserved(int cellIndex) {
+    if (observedSinceBoot[cellIndex]) {
+        return;
+    }
+    
+    observedSinceBoot[cellIndex] = true;
+    observedCount++;
+    
+    if (isBoardValid()) {
+        firstValidBoardTime = millis();
+        snapshotStore.markDirty();
+        DEBUG_PRINTF("ScanMatrix: Первая достоверная доска через %lu мс после включения\n",
+                     firstValidBoardTime);
+    }
 }
 
 ScanResult ScanMatrix::scanCurrentCell() {
@@ -144,25 +429,448 @@ ScanResult ScanMatrix::scanCell(int cellIndex) {
     }
     
     // Убеждаемся, что выбрана правильная ячейка
-    muxManager->selectCellByIndex(cellIndex);
+    selectCell(cellIndex);
+    bool fieldSwitched = muxManager->getLastSwitchMicros() != lastScanSwitchMicros;
+    bool fromOccupiedCell = applyCellTiming(cellIndex);
+    
+    // Известная карта: WUPA и ATQA вместо антиколлизии. Отвечает только метка,
+    // запитанная переключением антенны - после ATQA она в READY и молчит на WUPA.
+    // Подмену картой того же типа ATQA не отличит: ее ловят чтения задержки на карте
+    const CardInfo& cached = cardCache[cellIndex];
+    if (fastVerifyEnabled && cached.present && fieldSwitched) {
+        VerifyResult verify = rfidManager->verifyCard(cached.uid, cached.uidLength);
+        verifyCounts[verify]++;
+        if (verify == VERIFY_PRESENT) {
+            noteSwitchCost(cellIndex);
+            return SCAN_CARD_FOUND;
+        }
+        // Нет ответа, другая карта или сбой - решает полная антиколлизия
+    }
     
     // Сканируем карту через RFID менеджер
-    ScanResult result = rfidManager->scanCardFast();
+    ScanResult result = readCell(cellIndex);
+    result = checkCalibratedRead(cellIndex, result, fromOccupiedCell);
+    noteSwitchCost(cellIndex);
     
+    return checkNeighbourTag(cellIndex, result);
+}
+
+void ScanMatrix::selectCell(int cellIndex) {
+    int previous = muxManager->getCurrentCellIndex();
+    
+    // Выключать поле есть смысл только уходя с занятой ячейки на откалиброванную:
+    // у неоткалиброванной и так полный интервал между чтениями
+    bool gate = cellIndex != previous && isValidCellIndex(cellIndex) && isValidCellIndex(previous) &&
+                cardCache[previous].present &&
+                calibrator.getProfile(cellIndex).calibrated &&
+                rfidManager->getConnected() && !rfidManager->isWatching() &&
+                fieldGate.shouldGate(cellIndex);
+    if (!gate) {
+        muxManager->selectCellByIndex(cellIndex);
+        return;
+    }
+    
+    unsigned long start = micros();
+    bool fieldOff = rfidManager->setRfField(false);
+    muxManager->selectCellByIndex(cellIndex);
+    if (!fieldOff || !rfidManager->setRfField(true)) {
+        // Поле включит InListPassiveTarget; переключение считаем обычным
+        fieldGate.recordGateFailure();
+        return;
+    }
+    gatedSwitchMicros = muxManager->getLastSwitchMicros();
+    gateCommandUs = micros() - start;
+}
+
+void ScanMatrix::noteSwitchCost(int cellIndex) {
+    if (pendingSwitchCell != cellIndex) {
+        return;
+    }
+    fieldGate.recordSwitch(cellIndex, pendingSwitchGated, pendingSwitchCostUs);
+    pendingSwitchCell = -1;
+}
+
+bool ScanMatrix::applyCellTiming(int cellIndex) {
+    const CellTimingProfile& profile = calibrator.getProfile(cellIndex);
+    
+    // Первое чтение после переключения с занятой ячейки - только оно может
+    // поймать ее метку, пока мультиплексор и поле не успокоились
+    unsigned long switchUs = muxManager->getLastSwitchMicros();
+    int previous = muxManager->getPreviousCellIndex();
+    bool fromOccupiedCell = switchUs != lastScanSwitchMicros &&
+                            isValidCellIndex(previous) && previous != cellIndex &&
+                            cardCache[previous].present;
+    bool gated = fromOccupiedCell && switchUs == gatedSwitchMicros;
+    lastScanSwitchMicros = switchUs;
+    pendingSwitchCell = -1;
+    
+    rfidManager->setMaxTargets(multiTargetCell[cellIndex] ? 2 : 1);
+    rfidManager->setRfProfile(calibrator.getRfProfile(cellIndex));
+    
+    if (!profile.calibrated) {
+        // Консервативный профиль: прежний интервал между чтениями
+        rfidManager->setReadTiming(defaultTimeoutMs, scanDelayMs);
+        return fromOccupiedCell;
+    }
+    
+    rfidManager->setReadTiming(profile.timeoutMs, 0);
+    if (fromOccupiedCell) {
+        unsigned long waitStart = micros();
+        if (gated) {
+            // Поле включено уже на новой антенне - ждем только запитки метки
+            rfidManager->waitFieldGuard(RF_FIELD_GUARD_US);
+        } else {
+            muxManager->waitSettled(profile.settleUs);
+        }
+        // Цена паузы идет в сравнение с выключением поля только после ее
+        // обучения: стартовая пауза завышена, и режим AUTO выключал бы поле
+        // всегда, оставляя обучение паузы без образцов
+        if (gated || calibrator.isSettleLearned(cellIndex)) {
+            pendingSwitchCell = cellIndex;
+            pendingSwitchGated = gated;
+            pendingSwitchCostUs = (micros() - waitStart) + (gated ? gateCommandUs : 0);
+        }
+    }
+    return fromOccupiedCell;
+}
+
+ScanResult ScanMatrix::checkCalibratedRead(int cellIndex, ScanResult result, bool fromOccupiedCell) {
+    const CellTimingProfile& profile = calibrator.getProfile(cellIndex);
+    const CardInfo& cached = cardCache[cellIndex];
+    bool cardRead = (result == SCAN_CARD_FOUND || result == SCAN_CARD_CHANGED);
+    
+    if (!profile.calibrated) {
+        // Профиль по умолчанию - эталон, проверять его нечем
+        if (cardRead) {
+            calibrator.recordRead(cellIndex, READ_OUTCOME_OK, rfidManager->getLastReadLatencyUs());
+        }
+        return result;
+    }
+    
+    if (cardRead && fromOccupiedCell) {
+        // UID предыдущей ячейки, которого здесь не было - возможно перекрестное чтение
+        const CardInfo& previous = cardCache[muxManager->getPreviousCellIndex()];
+        bool suspect = lastUidMatches(previous) && !(cached.present && lastUidMatches(cached));
+        bool crosstalk = false;
+        
+        bool gated = pendingSwitchCell == cellIndex && pendingSwitchGated;
+        
+        if (suspect) {
+            noteProvisionalRead(cellIndex, cached);
+            unsigned long confirmStart = micros();
+            result = confirmRead(cellIndex);
+            cardRead = (result == SCAN_CARD_FOUND || result == SCAN_CARD_CHANGED);
+            // Фигуру действительно переставили - контрольное чтение вернет тот же UID
+            crosstalk = !cardRead || !lastUidMatches(previous);
+            if (pendingSwitchCell == cellIndex) {
+                pendingSwitchCostUs += micros() - confirmStart;
+            }
+        }
+        // Переключение без поля паузу не проверяет
+        if (!gated) {
+            calibrator.recordSettle(cellIndex, crosstalk);
+        }
+    }
+    
+    if (result == SCAN_NO_CARD && cached.present) {
+        // Возможный пропуск: повторы по профилю, затем контрольное чтение
+        cardEvents.provisional(cellIndex, CARD_EVENT_REMOVED, cached.uid, cached.uidLength);
+        for (int i = 0; i < profile.retries && result == SCAN_NO_CARD; i++) {
+            result = readCell(cellIndex);
+        }
+        if (result == SCAN_NO_CARD) {
+            result = confirmRead(cellIndex);
+        }
+        if (result == SCAN_CARD_FOUND || result == SCAN_CARD_CHANGED) {
+            calibrator.recordRead(cellIndex, READ_OUTCOME_MISSED, rfidManager->getLastReadLatencyUs());
+        }
+        return result;
+    }
+    
+    if (cardRead) {
+        calibrator.recordRead(cellIndex, READ_OUTCOME_OK, rfidManager->getLastReadLatencyUs());
+    }
     return result;
 }
 
+void ScanMatrix::noteProvisionalRead(int cellIndex, const CardInfo& cached) {
+    uint8_t uid[UID_BUFFER_SIZE];
+    uint8_t uidLength;
+    if (rfidManager->getLastUID(uid, uidLength)) {
+        cardEvents.provisional(cellIndex, cached.present ? CARD_EVENT_REPLACED : CARD_EVENT_ADDED,
+                               uid, uidLength);
+    }
+}
+
+ScanResult ScanMatrix::confirmRead(int cellIndex) {
+    // Консервативный профиль: полная пауза переключения и таймаут по умолчанию
+    confirmReads++;
+    muxManager->waitSettled(CALIBRATION_MAX_SETTLE_US);
+    rfidManager->setReadTiming(defaultTimeoutMs, 0);
+    return readCell(cellIndex);
+}
+
+ScanResult ScanMatrix::readCell(int cellIndex) {
+    return resolveTargets(cellIndex, rfidManager->scanCardFast());
+}
+
+ScanResult ScanMatrix::resolveTargets(int cellIndex, ScanResult result) {
+    if (result == SCAN_ERROR) {
+        return result;
+    }
+    
+    if (result == SCAN_NO_CARD || rfidManager->getLastTargetCount() < 2) {
+        // Вторая метка давно не появлялась - возвращаем дешевое чтение с MaxTg=1
+        if (multiTargetMode == MULTI_TARGET_ADAPTIVE && multiTargetCell[cellIndex] &&
+            ++singleTargetStreak[cellIndex] >= MULTI_TARGET_RELEASE_READS) {
+            multiTargetCell[cellIndex] = false;
+            singleTargetStreak[cellIndex] = 0;
+        }
+        return result;
+    }
+    
+    multiTargetReads++;
+    singleTargetStreak[cellIndex] = 0;
+    
+    uint8_t uids[2][UID_BUFFER_SIZE];
+    uint8_t uidLengths[2];
+    rfidManager->getLastTarget(0, uids[0], uidLengths[0]);
+    rfidManager->getLastTarget(1, uids[1], uidLengths[1]);
+    
+    // Метка, которая уже числится за соседней ячейкой, - ее, а не наша
+    bool neighbour0 = findNeighbourWithUid(cellIndex, uids[0], uidLengths[0]) >= 0;
+    bool neighbour1 = findNeighbourWithUid(cellIndex, uids[1], uidLengths[1]) >= 0;
+    uint8_t owner;
+    
+    if (neighbour0 != neighbour1) {
+        owner = neighbour0 ? 1 : 0;
+        ownerByNeighbour++;
+    } else {
+        // Обе чужие или обе неизвестны: не меняем то, что уже в кэше
+        const CardInfo& cached = cardCache[cellIndex];
+        owner = (cached.present && cached.uidLength == uidLengths[1] &&
+                 memcmp(cached.uid, uids[1], uidLengths[1]) == 0) ? 1 : 0;
+        ownerAmbiguous++;
+    }
+    
+    rfidManager->selectTarget(owner);
+    return result;
+}
+
+ScanResult ScanMatrix::checkNeighbourTag(int cellIndex, ScanResult result) {
+    bool cardRead = (result == SCAN_CARD_FOUND || result == SCAN_CARD_CHANGED);
+    
+    if (multiTargetMode != MULTI_TARGET_ADAPTIVE || multiTargetCell[cellIndex] || !cardRead) {
+        return result;
+    }
+    
+    uint8_t uid[UID_BUFFER_SIZE];
+    uint8_t uidLength;
+    if (!rfidManager->getLastUID(uid, uidLength) ||
+        findNeighbourWithUid(cellIndex, uid, uidLength) < 0) {
+        return result;
+    }
+    
+    // UID соседней ячейки: его метка в поле нашей антенны или фигуру переставили.
+    // Повтор с MaxTg=2 покажет обе метки, если они есть
+    multiTargetCell[cellIndex] = true;
+    singleTargetStreak[cellIndex] = 0;
+    multiTargetPromotions++;
+    DEBUG_PRINTF("ScanMatrix: Ячейка %d - UID соседа, чтение двух меток\n", cellIndex);
+    
+    rfidManager->setMaxTargets(2);
+    return readCell(cellIndex);
+}
+
+int ScanMatrix::findNeighbourWithUid(int cellIndex, const uint8_t* uid, uint8_t uidLength) const {
+    int row = cellIndex / MATRIX_COLS;
+    int col = cellIndex % MATRIX_COLS;
+    
+    for (int dr = -1; dr <= 1; dr++) {
+        for (int dc = -1; dc <= 1; dc++) {
+            int r = row + dr;
+            int c = col + dc;
+            if ((dr == 0 && dc == 0) || r < 0 || r >= MATRIX_ROWS || c < 0 || c >= MATRIX_COLS) {
+                continue;
+            }
+            const CardInfo& info = cardCache[r * MATRIX_COLS + c];
+            if (info.present && info.uidLength == uidLength && memcmp(info.uid, uid, uidLength) == 0) {
+                return r * MATRIX_COLS + c;
+            }
+        }
+    }
+    return -1;
+}
+
+void ScanMatrix::setMultiTargetMode(MultiTargetMode mode) {
+    multiTargetMode = mode;
+    for (int i = 0; i < MATRIX_TOTAL_CELLS; i++) {
+        multiTargetCell[i] = (mode == MULTI_TARGET_ALWAYS);
+        singleTargetStreak[i] = 0;
+    }
+}
+
+int ScanMatrix::getMultiTargetCellCount() const {
+    int count = 0;
+    for (int i = 0; i < MATRIX_TOTAL_CELLS; i++) {
+        if (multiTargetCell[i]) {
+            count++;
+        }
+    }
+    return count;
+}
+
+bool ScanMatrix::lastUidMatches(const CardInfo& info) const {
+    uint8_t uid[UID_BUFFER_SIZE];
+    uint8_t uidLength;
+    
+    if (!info.present || !rfidManager->getLastUID(uid, uidLength)) {
+        return false;
+    }
+    return uidLength == info.uidLength && memcmp(uid, info.uid, uidLength) == 0;
+}
+
+bool ScanMatrix::watchCell(int cellIndex, unsigned long durationMs) {
+    if (!isValidCellIndex(cellIndex) || isWatching() || !rfidManager->getCommandQueue().isEmpty()) {
+        return false;
+    }
+    
+    selectCell(cellIndex);
+    if (!rfidManager->startWatch()) {
+        if (cellIndex != currentCellIndex && !isCycleComplete()) {
+            selectCell(currentCellIndex);
+        }
+        return false;
+    }
+    
+    watchCellIndex = cellIndex;
+    watchStartTime = millis();
+    watchDurationMs = durationMs;
+    watchSessions++;
+    return true;
+}
+
+void ScanMatrix::stopWatch() {
+    if (!isWatching()) {
+        return;
+    }
+    rfidManager->stopWatch();
+    watchPreempted++;
+    endWatch();
+}
+
+bool ScanMatrix::runWatchStep() {
+    if (!isWatching()) {
+        return false;
+    }
+    
+    unsigned long elapsed = millis() - watchStartTime;
+    
+    // Очередь команд и остальные ячейки важнее: PN532 нужен им
+    if (!rfidManager->getCommandQueue().isEmpty() || !rfidManager->isWatching()) {
+        stopWatch();
+        return false;
+    }
+    if (elapsed >= watchDurationMs || getStalenessSlackMs() == 0) {
+        rfidManager->stopWatch();
+        watchTimeouts++;
+        endWatch();
+        return false;
+    }
+    
+    ScanResult result = rfidManager->pollWatch();
+    if (result == SCAN_NO_CARD) {
+        return true;
+    }
+    
+    int cellIndex = watchCellIndex;
+    if (result == SCAN_CARD_FOUND) {
+        watchHits++;
+        watchHitDelayMs += elapsed;
+        updateCardCache(cellIndex, result);
+    } else {
+        watchPreempted++;
+    }
+    endWatch();
+    return false;
+}
+
+void ScanMatrix::endWatch() {
+    watchTotalMs += millis() - watchStartTime;
+    
+    // Возвращаем антенну текущей ячейки прохода
+    if (watchCellIndex != currentCellIndex && !isCycleComplete()) {
+        selectCell(currentCellIndex);
+    }
+    watchCellIndex = -1;
+}
+
+bool ScanMatrix::serviceCommandQueue() {
+    PN532Command command;
+    
+    if (!rfidManager->nextCommand(command, getStalenessSlackMs())) {
+        return false;
+    }
+    
+    bool switchCell = isValidCellIndex(command.cellIndex) && command.cellIndex != currentCellIndex;
+    if (switchCell) {
+        selectCell(command.cellIndex);
+    }
+    applyCellTiming(muxManager->getCurrentCellIndex());
+    
+    rfidManager->executeCommand(command);
+    
+    // Внеочередное сканирование обновляет кэш так же, как обычный проход
+    if (command.type == CMD_SCAN_CELL) {
+        command.scanResult = resolveTargets(command.cellIndex, command.scanResult);
+        updateCardCache(command.cellIndex, command.scanResult);
+    }
+    
+    // Возвращаем антенну текущей ячейки прохода
+    if (switchCell && !isCycleComplete()) {
+        selectCell(currentCellIndex);
+    }
+    
+    return true;
+}
+
+unsigned long ScanMatrix::getStalenessSlackMs() const {
+    // Устаревание ячейки ~ длительность прохода: прошедшая часть + остаток прошлого
+    // прохода от этой же ячейки (занятые ячейки дороже пустых). Без прошлого прохода -
+    // оставшиеся ячейки по средней стоимости
+    unsigned long elapsed = scanInProgress ? millis() - cycleStartTime : 0;
+    int remainingCells = MATRIX_TOTAL_CELLS - scanPosition;
+    if (remainingCells < 0) remainingCells = 0;
+    
+    unsigned long remainingMs;
+    if (remainingCells == 0) {
+        remainingMs = 0;
+    } else if (lastCycleTime > 0 && (scanPosition == 0 || lastPassOffsetMs[currentCellIndex] > 0) &&
+               lastPassOffsetMs[currentCellIndex] <= lastCycleTime) {
+        // Запас 1/32 прохода на разброс таймингов между проходами
+        remainingMs = lastCycleTime - lastPassOffsetMs[currentCellIndex] + lastCycleTime / 32;
+    } else {
+        unsigned long perCellMs = (lastCycleTime > 0) ? lastCycleTime / MATRIX_TOTAL_CELLS : scanDelayMs;
+        remainingMs = remainingCells * perCellMs;
+    }
+    
+    unsigned long projected = elapsed + remainingMs;
+    return (projected >= SCAN_STALENESS_BUDGET_MS) ? 0 : SCAN_STALENESS_BUDGET_MS - projected;
+}
+
 void ScanMatrix::moveToNextCell() {
-    currentCellIndex++;
+    setScanPosition(scanPosition + 1);
+    skipCellsOutsidePass();
+    notePassOffset();
     
-    if (currentCellIndex < MATRIX_TOTAL_CELLS) {
+    if (!isCycleComplete()) {
         // Переключаемся на следующую ячейку
-        muxManager->selectCellByIndex(currentCellIndex);
+        selectCell(currentCellIndex);
     }
 }
 
 bool ScanMatrix::isCycleComplete() const {
-    return currentCellIndex >= MATRIX_TOTAL_CELLS;
+    return scanPosition >= MATRIX_TOTAL_CELLS;
 }
 
 void ScanMatrix::updateCardCache(int cellIndex, const ScanResult& result) {
@@ -173,6 +881,12 @@ void ScanMatrix::updateCardCache(int cellIndex, const ScanResult& result) {
     CardInfo& cache = cardCache[cellIndex];
     CardInfo oldInfo = cache;  // Сохраняем старое состояние
     
+    if (result != SCAN_ERROR) {
+        cache.assumed = false;
+        markObserved(cellIndex);
+    }
+    noteCellHealth(cellIndex, result);
+    
     unsigned long currentTime = millis();
     
     switch (result) {
@@ -184,7 +898,10 @@ void ScanMatrix::updateCardCache(int cellIndex, const ScanResult& result) {
                 cache.lastSeen = currentTime;
                 cache.changed = (result == SCAN_CARD_CHANGED);
                 
-                if (result == SCAN_CARD_CHANGED || !oldInfo.present) {
+                // SCAN_CARD_CHANGED сравнивает с прошлым чтением (другой ячейки), поэтому
+                // замену фигуры на этой ячейке проверяем по кэшу
+                if (result == SCAN_CARD_CHANGED || !oldInfo.present || oldInfo.uidLength != cache.uidLength ||
+                    memcmp(oldInfo.uid, cache.uid, cache.uidLength) != 0) {
                     processCardEvent(cellIndex, oldInfo, cache);
                 }
             }
@@ -206,17 +923,42 @@ void ScanMatrix::updateCardCache(int cellIndex, const ScanResult& result) {
             // Не изменяем кэш при ошибке
             break;
     }
+    
+    // Предварительное событие, не ставшее изменением кэша, - отзыв
+    cardEvents.settle(cellIndex);
 }
 
 void ScanMatrix::processCardEvent(int cellIndex, const CardInfo& oldInfo, const CardInfo& newInfo) {
+    // SCAN_CARD_CHANGED приходит и при том же UID (сравнение с предыдущей ячейкой),
+    // поэтому снимок помечаем только при реальном изменении содержимого
+    if (oldInfo.present != newInfo.present || oldInfo.uidLength != newInfo.uidLength ||
+        memcmp(oldInfo.uid, newInfo.uid, newInfo.uidLength) != 0) {
+        snapshotStore.markDirty();
+    }
+    
+    // Мерцание: событие с UID, который числится за соседней ячейкой
+    // (сюда же попадает перестановка фигуры на соседнее поле до его пересканирования)
+    if ((oldInfo.present && findNeighbourWithUid(cellIndex, oldInfo.uid, oldInfo.uidLength) >= 0) ||
+        (newInfo.present && findNeighbourWithUid(cellIndex, newInfo.uid, newInfo.uidLength) >= 0)) {
+        flickerEvents++;
+    }
+    
     if (!oldInfo.present && newInfo.present) {
         // Карта добавлена
-        cardsDetected++;
+        cardsDetected.add();
+        unsigned long firstSeen = cardEvents.commit(cellIndex, CARD_EVENT_ADDED, newInfo.uid, newInfo.uidLength);
+        if (moveRecognizerEnabled) {
+            moveRecognizer.onCellEvent(cellIndex, CARD_EVENT_ADDED, newInfo.uid, newInfo.uidLength, firstSeen);
+        }
         logCardEvent(cellIndex, "ДОБАВЛЕНА", newInfo);
         
     } else if (oldInfo.present && !newInfo.present) {
         // Карта удалена
-        cardsRemoved++;
+        cardsRemoved.add();
+        unsigned long firstSeen = cardEvents.commit(cellIndex, CARD_EVENT_REMOVED, oldInfo.uid, oldInfo.uidLength);
+        if (moveRecognizerEnabled) {
+            moveRecognizer.onCellEvent(cellIndex, CARD_EVENT_REMOVED, oldInfo.uid, oldInfo.uidLength, firstSeen);
+        }
         logCardEvent(cellIndex, "УДАЛЕНА", oldInfo);
         
     } else if (oldInfo.present && newInfo.present) {
@@ -232,7 +974,11 @@ void ScanMatrix::processCardEvent(int cellIndex, const CardInfo& oldInfo, const
         }
         
         if (uidChanged) {
-            cardChanges++;
+            cardChanges.add();
+            unsigned long firstSeen = cardEvents.commit(cellIndex, CARD_EVENT_REPLACED, newInfo.uid, newInfo.uidLength);
+            if (moveRecognizerEnabled) {
+                moveRecognizer.onCellEvent(cellIndex, CARD_EVENT_REPLACED, newInfo.uid, newInfo.uidLength, firstSeen);
+            }
             logCardEvent(cellIndex, "ИЗМЕНЕНА", newInfo);
         }
     }
@@ -247,7 +993,7 @@ void ScanMatrix::logCardEvent(int cellIndex, const char* event, const CardInfo&
 // Метод удален - больше не нужен
 
 const CardInfo& ScanMatrix::getCardInfo(int cellIndex) const {
-    static CardInfo emptyCard = {false, {0}, 0, 0, false};
+    static CardInfo emptyCard = {false, {0}, 0, 0, false, false};
     
     if (!isValidCellIndex(cellIndex)) {
         return emptyCard;
@@ -290,6 +1036,7 @@ void ScanMatrix::clearCardCache() {
         cardCache[i].changed = false;
         cardCache[i].uidLength = 0;
         cardCache[i].lastSeen = 0;
+        cardCache[i].assumed = false;
         memset(cardCache[i].uid, 0, sizeof(cardCache[i].uid));
     }
     
@@ -297,9 +1044,12 @@ void ScanMatrix::clearCardCache() {
 }
 
 void ScanMatrix::resetStatistics() {
-    cardsDetected = 0;
-    cardsRemoved = 0;
-    cardChanges = 0;
+    cardsDetected.reset();
+    cardsRemoved.reset();
+    cardChanges.reset();
+    cycleTimeMs.reset();
+    flickerEvents = 0;
+    cardEvents.resetStatistics();
     
     DEBUG_PRINTLN("ScanMatrix: Статистика сброшена");
 }
@@ -312,7 +1062,7 @@ void ScanMatrix::printPerformanceMetrics() const {
     DEBUG_PRINTLN("========================================");
     DEBUG_PRINTLN("СТАТИСТИКА СКАНИРОВАНИЯ");
     DEBUG_PRINTLN("========================================");
-    DEBUG_PRINTF("Текущая ячейка: %d/%d\n", currentCellIndex, MATRIX_TOTAL_CELLS - 1);
+    DEBUG_PRINTF("Текущая ячейка: %d (позиция %d/%d в проходе)\n", currentCellIndex, scanPosition, MATRIX_TOTAL_CELLS - 1);
     DEBUG_PRINTF("Сканирование активно: %s\n", scanInProgress ? "ДА" : "НЕТ");
     
     int cardsInMatrix = findCardsInMatrix();
@@ -320,7 +1070,36 @@ void ScanMatrix::printPerformanceMetrics() const {
     
     // События карт
     DEBUG_PRINTF("События: обнаружено=%lu, удалено=%lu, изменено=%lu\n", 
-                 cardsDetected, cardsRemoved, cardChanges);
+                 cardsDetected.get(), cardsRemoved.get(), cardChanges.get());
+    DEBUG_PRINTF("Проход: среднее=%lu мс (%lu проходов)\n", cycleTimeMs.getMean(), cycleTimeMs.getCount());
+    
+    // Теплый старт
+    DEBUG_PRINTF("Старт: %s, восстановлено карт=%d\n",
+                 restoredFromSnapshot ? "теплый" : "холодный", restoredCards);
+    DEBUG_PRINTF("Время от включения: доска опубликована=%lu мс, восстановленные проверены=%lu мс, "
+                 "первая достоверная доска=%lu мс\n",
+                 assumedBoardTime, restoredVerifiedTime, firstValidBoardTime);
+    DEBUG_PRINTF("Снимок NVS: записей=%lu, пропущено без изменений=%lu, ошибок=%lu\n",
+                 snapshotStore.getWrites(), snapshotStore.getSkippedUnchanged(),
+                 snapshotStore.getWriteFailures());
+    
+    calibrator.printStatus();
+    fieldGate.printStatus();
+    quarantine.printStatus();
+    cardEvents.printStatus();
+    moveRecognizer.printStatus();
+    DEBUG_PRINTF("Контрольных чтений: %lu\n", confirmReads);
+    DEBUG_PRINTF("Быстрая проверка: %s, на месте=%lu, нет ответа=%lu, другая=%lu, сбой=%lu\n",
+                 fastVerifyEnabled ? "ВКЛ" : "ВЫКЛ",
+                 verifyCounts[VERIFY_PRESENT], verifyCounts[VERIFY_ABSENT],
+                 verifyCounts[VERIFY_OTHER], verifyCounts[VERIFY_ERROR]);
+    DEBUG_PRINTF("Две метки в поле: ячеек с MaxTg=2=%d (переводов=%lu), чтений=%lu, "
+                 "владелец по соседу=%lu, неоднозначно=%lu; мерцаний=%lu\n",
+                 getMultiTargetCellCount(), multiTargetPromotions, multiTargetReads,
+                 ownerByNeighbour, ownerAmbiguous, flickerEvents);
+    DEBUG_PRINTF("Наблюдение (InAutoPoll): сеансов=%lu, метка появилась=%lu (в среднем через %lu мс), "
+                 "истекло=%lu, прервано=%lu, всего %lu мс\n",
+                 watchSessions, watchHits, getMeanWatchHitMs(), watchTimeouts, watchPreempted, watchTotalMs);
     
     DEBUG_PRINTLN("========================================");
 }
@@ -329,10 +1108,10 @@ void ScanMatrix::printCardEvents() const {
     DEBUG_PRINTLN("========================================");
     DEBUG_PRINTLN("СОБЫТИЯ КАРТ");
     DEBUG_PRINTLN("========================================");
-    DEBUG_PRINTF("Карт обнаружено: %lu\n", cardsDetected);
-    DEBUG_PRINTF("Карт удалено: %lu\n", cardsRemoved);
-    DEBUG_PRINTF("Карт изменено: %lu\n", cardChanges);
-    DEBUG_PRINTF("Общее количество событий: %lu\n", cardsDetected + cardsRemoved + cardChanges);
+    DEBUG_PRINTF("Карт обнаружено: %lu\n", cardsDetected.get());
+    DEBUG_PRINTF("Карт удалено: %lu\n", cardsRemoved.get());
+    DEBUG_PRINTF("Карт изменено: %lu\n", cardChanges.get());
+    DEBUG_PRINTF("Общее количество событий: %lu\n", cardsDetected.get() + cardsRemoved.get() + cardChanges.get());
     DEBUG_PRINTLN("========================================");
 }
 
@@ -341,7 +1120,11 @@ void ScanMatrix::printMatrixState() const {
     DEBUG_PRINTLN("СОСТОЯНИЕ МАТРИЦЫ");
     DEBUG_PRINTLN("========================================");
     
-    DEBUG_PRINTLN("   0  1  2  3  4  5  6  7  8  9 10 11");
+    DEBUG_PRINTF("  ");
+    for (int col = 0; col < MATRIX_COLS; col++) {
+        DEBUG_PRINTF("%3d", col);
+    }
+    DEBUG_PRINTLN("");
     
     for (int row = 0; row < MATRIX_ROWS; row++) {
         DEBUG_PRINTF("%d: ", row);
@@ -350,7 +1133,9 @@ void ScanMatrix::printMatrixState() const {
             int cellIndex = row * MATRIX_COLS + col;
             const CardInfo& card = cardCache[cellIndex];
             
-            if (card.present) {
+            if (quarantine.isQuarantined(cellIndex)) {
+                DEBUG_PRINTF("[!]");
+            } else if (card.present) {
                 DEBUG_PRINTF("[X]");
             } else {
                 DEBUG_PRINTF("[ ]");
@@ -362,19 +1147,34 @@ void ScanMatrix::printMatrixState() const {
     DEBUG_PRINTLN("========================================");
 }
 
+// Горизонтальная линия таблицы карт: по клетке на столбец матрицы
+static void printCardMatrixRule(const char* left, const char* middle, const char* right) {
+    DEBUG_PRINTF("%s─────", left);
+    for (int col = 0; col < MATRIX_COLS; col++) {
+        DEBUG_PRINTF("%s───", middle);
+    }
+    DEBUG_PRINTLN(right);
+}
+
 void ScanMatrix::printCardMatrix() const {
-    DEBUG_PRINTLN("┌─────┬───┬───┬───┬───┬───┬───┬───┬───┬───┬───┬───┬───┐");
-    DEBUG_PRINTLN("│  \\ │ 0 │ 1 │ 2 │ 3 │ 4 │ 5 │ 6 │ 7 │ 8 │ 9 │10 │11 │");
-    DEBUG_PRINTLN("├─────┼───┼───┼───┼───┼───┼───┼───┼───┼───┼───┼───┼───┤");
+    printCardMatrixRule("┌", "┬", "┐");
+    DEBUG_PRINTF("│  \\ │");
+    for (int col = 0; col < MATRIX_COLS; col++) {
+        DEBUG_PRINTF("%2d │", col);
+    }
+    DEBUG_PRINTLN("");
+    printCardMatrixRule("├", "┼", "┤");
     
     for (int row = 0; row < MATRIX_ROWS; row++) {
-        DEBUG_PRINTF("│  %d  │", row);
+        DEBUG_PRINTF("│ %2d  │", row);
         
         for (int col = 0; col < MATRIX_COLS; col++) {
             int cellIndex = row * MATRIX_COLS + col;
             const CardInfo& card = cardCache[cellIndex];
             
-            if (card.present) {
+            if (quarantine.isQuarantined(cellIndex)) {
+                DEBUG_PRINTF(" ! ");
+            } else if (card.present) {
                 // Показываем последние 2 байта UID для краткости
                 if (card.uidLength >= 2) {
                     DEBUG_PRINTF("%02X%02X", card.uid[card.uidLength-2], card.uid[card.uidLength-1]);
@@ -389,11 +1189,11 @@ void ScanMatrix::printCardMatrix() const {
         DEBUG_PRINTLN("");
         
         if (row < MATRIX_ROWS - 1) {
-            DEBUG_PRINTLN("├─────┼───┼───┼───┼───┼───┼───┼───┼───┼───┼───┼───┼───┤");
+            printCardMatrixRule("├", "┼", "┤");
         }
     }
     
-    DEBUG_PRINTLN("└─────┴───┴───┴───┴───┴───┴───┴───┴───┴───┴───┴───┴───┘");
+    printCardMatrixRule("└", "┴", "┘");
     
     // Выводим список найденных карт с полными UID
     DEBUG_PRINTLN("\nСписок карт:");
@@ -5,8 +5,18 @@
 #include "config.h"
 #include "multiplexer.h"
 #include "rfid_manager.h"
+#include "board_snapshot.h"
+#include "cell_calibration.h"
+#include "field_gating.h"
+#include "cell_quarantine.h"
+#include "card_events.h"
+#include "move_recognizer.h"
+#include "metrics.h"
 
 class ScanMatrix {
+#ifdef HOST_BUILD
+    friend class HostKernelAccess;      // Микробенчмарки ядер прохода (host/bench)
+#endif
 private:
     MultiplexerManager* muxManager;
     RFIDManager* rfidManager;
@@ -14,17 +24,100 @@ private:
     // Кэш состояний карт для всех ячеек
     CardInfo cardCache[MATRIX_TOTAL_CELLS];
     
-    // Текущее сканирование
+    // Текущее сканирование: позиция в порядке прохода и ее ячейка
     int currentCellIndex;
+    int scanPosition;
     bool scanInProgress;
     
+    // Порядок прохода: таблица ячеек или nullptr (построчно); смена - со следующего прохода
+    const uint16_t* scanOrder;
+    const uint16_t* passOrder;
+    
     // Метрики времени
     unsigned long cycleStartTime;
+    unsigned long lastCycleTime;
+    
+    // Момент прихода прохода на ячейку (от начала прохода): текущий и прошлый проход.
+    // Занятые ячейки стоят дороже пустых - прогноз остатка идет по форме прошлого прохода
+    unsigned long passOffsetMs[MATRIX_TOTAL_CELLS];
+    unsigned long lastPassOffsetMs[MATRIX_TOTAL_CELLS];
+    
+    // События карт (основные метрики для событийной режима, реестр метрик)
+    MetricCounter cardsDetected;
+    MetricCounter cardsRemoved;
+    MetricCounter cardChanges;
+    MetricHistogram cycleTimeMs;        // Время полного прохода
+    MetricGauge cardsPresent;           // Карт на доске после прохода
+    
+    // Предварительные события и их подтверждение/отзыв для потребителей
+    CardEventTracker cardEvents;
+    
+    // Ходы партии по подтвержденным событиям ячеек
+    MoveRecognizer moveRecognizer;
+    bool moveRecognizerEnabled;
+    
+    // Теплый старт: снимок доски и проверка восстановленных ячеек
+    BoardSnapshotStore snapshotStore;
+    bool restoredFromSnapshot;
+    int restoredCards;
+    int verifyCells[MATRIX_TOTAL_CELLS];
+    int verifyCount;
+    int verifyPos;
+    
+    // Ячейки, просканированные с момента включения
+    bool observedSinceBoot[MATRIX_TOTAL_CELLS];
+    int observedCount;
+    
+    // Время от включения (millis), 0 = еще не достигнуто
+    unsigned long assumedBoardTime;
+    unsigned long restoredVerifiedTime;
+    unsigned long firstValidBoardTime;
+    
+    // Тайминги ячеек без калибровки (консоль меняет на ходу)
+    unsigned long scanDelayMs;           // Интервал между чтениями
+    uint16_t defaultTimeoutMs;           // Таймаут PN532, и для контрольных чтений
+    
+    // Самокалибровка таймингов по ячейкам
+    CellCalibrator calibrator;
+    unsigned long lastScanSwitchMicros;  // Переключение, после которого уже читали
+    uint32_t confirmReads;               // Контрольных чтений с консервативным профилем
+    
+    // Поле PN532 на переключении с занятой ячейки: пауза или выключение поля
+    FieldGatePlanner fieldGate;
+    unsigned long gatedSwitchMicros;     // Переключение, сделанное при выключенном поле
+    unsigned long gateCommandUs;         // ...время команд поля
+    int pendingSwitchCell;               // Переключение, цена которого еще копится (-1 нет)
+    bool pendingSwitchGated;
+    unsigned long pendingSwitchCostUs;
+    
+    // Ячейки с ошибками подряд выпадают из прохода до фоновой проверки
+    CellQuarantine quarantine;
+    
+    // Быстрая проверка занятых ячеек по UID из кэша
+    bool fastVerifyEnabled;
+    uint32_t verifyCounts[VERIFY_RESULT_COUNT];
     
-    // События карт (основные метрики для событийной режима)
-    uint32_t cardsDetected;
-    uint32_t cardsRemoved;
-    uint32_t cardChanges;
+    // Две метки в поле антенны: MaxTg=2 и владелец по кэшу соседних ячеек
+    MultiTargetMode multiTargetMode;
+    bool multiTargetCell[MATRIX_TOTAL_CELLS];        // Ячейка читается с MaxTg=2
+    uint8_t singleTargetStreak[MATRIX_TOTAL_CELLS];  // Чтений подряд без второй метки
+    uint32_t multiTargetPromotions;     // Ячеек, переведенных на MaxTg=2
+    uint32_t multiTargetReads;          // Чтений, вернувших две метки
+    uint32_t ownerByNeighbour;          // ...владелец определен по кэшу соседа
+    uint32_t ownerAmbiguous;            // ...соседи не помогли, оставлена прежняя
+    uint32_t flickerEvents;             // События с UID, который числится за соседом
+    
+    // Наблюдение за ячейкой (InAutoPoll)
+    bool watchAfterRemoval;
+    int watchCellIndex;                 // -1 = наблюдения нет
+    unsigned long watchStartTime;
+    unsigned long watchDurationMs;
+    uint32_t watchSessions;
+    uint32_t watchHits;                 // Метка появилась во время наблюдения
+    uint32_t watchTimeouts;
+    uint32_t watchPreempted;            // Прервано очередью команд или сбоем
+    unsigned long watchTotalMs;         // Время прохода, отданное наблюдению
+    unsigned long watchHitDelayMs;      // Сумма от начала наблюдения до метки
     
 public:
     ScanMatrix(MultiplexerManager* mux, RFIDManager* rfid);
@@ -32,6 +125,71 @@ public:
     // Инициализация
     void initialize();
     
+    // Теплый старт: публикует доску из NVS до первого прохода
+    bool restoreSnapshot();
+    bool flushSnapshot();
+    bool isBoardValid() const { return observedCount >= MATRIX_TOTAL_CELLS; }
+    bool isBoardAssumed() const { return restoredFromSnapshot && !isBoardValid(); }
+    int getRestoredCards() const { return restoredCards; }
+    unsigned long getAssumedBoardTime() const { return assumedBoardTime; }
+    unsigned long getRestoredVerifiedTime() const { return restoredVerifiedTime; }
+    unsigned long getFirstValidBoardTime() const { return firstValidBoardTime; }
+    const BoardSnapshotStore& getSnapshotStore() const { return snapshotStore; }
+    
+    // Консервативные тайминги (SCAN_DELAY_MS, PN532_TIMEOUT_MS по умолчанию):
+    // ячейки без калибровки и контрольные чтения
+    void setScanDelay(unsigned long delayMs) { scanDelayMs = delayMs; }
+    unsigned long getScanDelay() const { return scanDelayMs; }
+    void setDefaultTimeout(uint16_t timeoutMs) { defaultTimeoutMs = timeoutMs; }
+    uint16_t getDefaultTimeout() const { return defaultTimeoutMs; }
+    
+    // Калибровка таймингов
+    CellCalibrator& getCalibrator() { return calibrator; }
+    uint32_t getConfirmReads() const { return confirmReads; }
+    
+    // Порядок ячеек в проходе: перестановка 0..MATRIX_TOTAL_CELLS-1 (таблица
+    // живет дольше прохода, обычно во flash) или nullptr - построчно
+    void setScanOrder(const uint16_t* cells) { scanOrder = cells; }
+    const uint16_t* getScanOrder() const { return scanOrder; }
+    
+    // Стратегия переключения с занятой ячейки
+    FieldGatePlanner& getFieldGate() { return fieldGate; }
+    
+    // Карантин неисправных ячеек
+    CellQuarantine& getQuarantine() { return quarantine; }
+    const CellQuarantine& getQuarantine() const { return quarantine; }
+    
+    // Быстрая проверка карт (полная антиколлизия - при выключенной или несовпадении)
+    void setFastVerify(bool enabled) { fastVerifyEnabled = enabled; }
+    bool getFastVerify() const { return fastVerifyEnabled; }
+    uint32_t getVerifyCount(VerifyResult result) const { return verifyCounts[result]; }
+    
+    // Чтение двух меток в поле антенны
+    void setMultiTargetMode(MultiTargetMode mode);
+    MultiTargetMode getMultiTargetMode() const { return multiTargetMode; }
+    int getMultiTargetCellCount() const;
+    uint32_t getMultiTargetPromotions() const { return multiTargetPromotions; }
+    uint32_t getMultiTargetReads() const { return multiTargetReads; }
+    uint32_t getOwnerByNeighbour() const { return ownerByNeighbour; }
+    uint32_t getOwnerAmbiguous() const { return ownerAmbiguous; }
+    uint32_t getFlickerEvents() const { return flickerEvents; }
+    
+    // Наблюдение за ячейкой: мультиплексор стоит на ней, PN532 опрашивает поле сам.
+    // Заканчивается появлением метки, истечением durationMs или запасом устаревания,
+    // командой в очереди. После снятия фигуры включается автоматически
+    bool watchCell(int cellIndex, unsigned long durationMs);
+    void setWatchAfterRemoval(bool enabled) { watchAfterRemoval = enabled; }
+    bool getWatchAfterRemoval() const { return watchAfterRemoval; }
+    void stopWatch();
+    bool isWatching() const { return watchCellIndex >= 0; }
+    int getWatchCell() const { return watchCellIndex; }
+    uint32_t getWatchSessions() const { return watchSessions; }
+    uint32_t getWatchHits() const { return watchHits; }
+    uint32_t getWatchTimeouts() const { return watchTimeouts; }
+    uint32_t getWatchPreempted() const { return watchPreempted; }
+    unsigned long getWatchTotalMs() const { return watchTotalMs; }
+    unsigned long getMeanWatchHitMs() const { return watchHits ? watchHitDelayMs / watchHits : 0; }
+    
     // Основной цикл сканирования (событийный, не циклический)
     void update();
     
@@ -43,6 +201,7 @@ public:
     void startNewCycle();
     bool isCycleComplete() const;
     int getCurrentCellIndex() const { return currentCellIndex; }
+    int getScanPosition() const { return scanPosition; }
     
     // Переход к следующей ячейке
     void moveToNextCell();
@@ -60,11 +219,25 @@ public:
     
     // Метрики времени
     unsigned long getCycleStartTime() const { return cycleStartTime; }
+    unsigned long getLastCycleTime() const { return lastCycleTime; }
+    
+    // Запас до SCAN_STALENESS_BUDGET_MS с учетом прогноза текущего прохода
+    unsigned long getStalenessSlackMs() const;
     
     // События карт (основные метрики)
-    uint32_t getCardsDetected() const { return cardsDetected; }
-    uint32_t getCardsRemoved() const { return cardsRemoved; }
-    uint32_t getCardChanges() const { return cardChanges; }
+    uint32_t getCardsDetected() const { return cardsDetected.get(); }
+    uint32_t getCardsRemoved() const { return cardsRemoved.get(); }
+    uint32_t getCardChanges() const { return cardChanges.get(); }
+    
+    // Поток событий: предварительное, затем подтверждение или отзыв
+    CardEventTracker& getCardEvents() { return cardEvents; }
+    
+    // Распознавание ходов: партия начинается сама, когда проход видит начальную
+    // расстановку, или явно с текущей доски
+    void setMoveRecognition(bool enabled) { moveRecognizerEnabled = enabled; }
+    bool getMoveRecognition() const { return moveRecognizerEnabled; }
+    int startGame() { return moveRecognizer.beginGame(cardCache); }
+    MoveRecognizer& getMoveRecognizer() { return moveRecognizer; }
     
     // Сброс статистики
     void resetStatistics();
@@ -75,6 +248,27 @@ public:
     
 private:
     // Внутренние методы
+    bool serviceCommandQueue();
+    bool runWatchStep();
+    void endWatch();
+    bool runVerificationStep();
+    bool runQuarantineProbe();
+    void setScanPosition(int position);
+    void skipCellsOutsidePass();
+    void noteCellHealth(int cellIndex, ScanResult result);
+    void notePassOffset();
+    void markObserved(int cellIndex);
+    void selectCell(int cellIndex);
+    void noteSwitchCost(int cellIndex);
+    bool applyCellTiming(int cellIndex);
+    ScanResult checkCalibratedRead(int cellIndex, ScanResult result, bool fromOccupiedCell);
+    ScanResult confirmRead(int cellIndex);
+    ScanResult readCell(int cellIndex);
+    ScanResult resolveTargets(int cellIndex, ScanResult result);
+    ScanResult checkNeighbourTag(int cellIndex, ScanResult result);
+    int findNeighbourWithUid(int cellIndex, const uint8_t* uid, uint8_t uidLength) const;
+    bool lastUidMatches(const CardInfo& info) const;
+    void noteProvisionalRead(int cellIndex, const CardInfo& cached);
     void updateCardCache(int cellIndex, const ScanResult& result);
     void processCardEvent(int cellIndex, const CardInfo& oldInfo, const CardInfo& newInfo);
     void logCardEvent(int cellIndex, const char* event, const CardInfo& cardInfo) const;
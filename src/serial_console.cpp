@@ -0,0 +1,831 @@
+#include "serial_console.h"
+#include "state_manager.h"
+#include "rfid_manager.h"
+#include "multiplexer.h"
+#include "scan_matrix.h"
+#include "display_manager.h"
+#include "i2c_trace.h"
+#include "memory_monitor.h"
+#include "crc32.h"
+#include <stddef.h>
+
+#ifdef I2C_TRACE
+extern I2CTraceRecorder i2cTrace;       // src/main.cpp
+#endif
+
+#if ENABLE_SERIAL_DEBUG
+bool serialDebugEnabled = true;
+#endif
+
+static const uint8_t FRAME_SYNC_0 = 0xA5;
+static const uint8_t FRAME_SYNC_1 = 0x5A;
+static const size_t FRAME_OVERHEAD = 9;
+
+static const uint32_t SETTINGS_MAGIC = 0x53434652;  // "RFCS"
+static const uint16_t SETTINGS_VERSION = 4;
+static const char* SETTINGS_NAMESPACE = "rfid_console";
+static const char* SETTINGS_KEY = "settings";
+
+static const int MAX_ARGS = 4;
+
+// Отчеты модулей идут через лог - на время запроса он включен
+struct ForcedLog {
+#if ENABLE_SERIAL_DEBUG
+    bool wasEnabled;
+    ForcedLog() : wasEnabled(serialDebugEnabled) { serialDebugEnabled = true; }
+    ~ForcedLog() { serialDebugEnabled = wasEnabled; }
+#endif
+};
+
+static void putLe32(uint8_t* out, uint32_t value) {
+    out[0] = value & 0xFF;
+    out[1] = (value >> 8) & 0xFF;
+    out[2] = (value >> 16) & 0xFF;
+    out[3] = value >> 24;
+}
+
+static uint32_t getLe32(const uint8_t* in) {
+    return (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+// =============================================
+// ПАРАМЕТРЫ КОМАНДЫ set
+// =============================================
+
+enum ConsoleParam {
+    PARAM_DELAY,            // Интервал чтений ячеек без калибровки, мс
+    PARAM_TIMEOUT,          // Таймаут PN532 без калибровки и для контрольных чтений, мс
+    PARAM_RETRIES,          // Повторы транзакции (уровень 1 восстановления)
+    PARAM_SETTLE,           // Пауза мультиплексора после смены адреса, мкс
+    PARAM_MULTITARGET,
+    PARAM_RFGATE,
+    PARAM_FASTVERIFY,       // Дальше - переключатели on/off (биты ConsoleSettings::flags)
+    PARAM_WATCH,
+    PARAM_QUARANTINE,
+    PARAM_PROVISIONAL,
+    PARAM_MOVES,
+    PARAM_RFPROFILES,
+    PARAM_IRQ,
+    PARAM_LOG,
+    PARAM_REPORT,           // Период отчета о состоянии, мс (0 - только по status)
+    PARAM_MSTREAM,          // Период кадров метрик, мс (0 - выкл.)
+    PARAM_COUNT
+};
+
+static const char* const ON_OFF_NAMES[] = {"off", "on", nullptr};
+static const char* const MULTI_TARGET_NAMES[] = {"off", "adaptive", "always", nullptr};
+static const char* const RF_GATING_NAMES[] = {"off", "auto", "always", nullptr};
+
+struct ConsoleParamInfo {
+    const char* name;
+    long minValue;
+    long maxValue;
+    const char* const* valueNames;  // nullptr - число
+    const char* unit;
+};
+
+static const ConsoleParamInfo PARAMS[PARAM_COUNT] = {
+    {"delay",       0, 1000,    nullptr,            "мс"},
+    {"timeout",     CALIBRATION_MIN_TIMEOUT_MS, 255, nullptr, "мс"},
+    {"retries",     0, 5,       nullptr,            ""},
+    {"settle",      0, 10000,   nullptr,            "мкс"},
+    {"multitarget", 0, 2,       MULTI_TARGET_NAMES, ""},
+    {"rfgate",      0, 2,       RF_GATING_NAMES,    ""},
+    {"fastverify",  0, 1,       ON_OFF_NAMES,       ""},
+    {"watch",       0, 1,       ON_OFF_NAMES,       ""},
+    {"quarantine",  0, 1,       ON_OFF_NAMES,       ""},
+    {"provisional", 0, 1,       ON_OFF_NAMES,       ""},
+    {"moves",       0, 1,       ON_OFF_NAMES,       ""},
+    {"rfprofiles",  0, 1,       ON_OFF_NAMES,       ""},
+    {"irq",         0, 1,       ON_OFF_NAMES,       ""},
+    {"log",         0, 1,       ON_OFF_NAMES,       ""},
+    {"report",      0, 3600000, nullptr,            "мс"},
+    {"mstream",     0, 3600000, nullptr,            "мс"},
+};
+
+static int findParam(const char* name) {
+    for (int i = 0; i < PARAM_COUNT; i++) {
+        if (strcmp(PARAMS[i].name, name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static bool parseParamValue(const ConsoleParamInfo& param, const char* text, long& value) {
+    if (param.valueNames != nullptr) {
+        for (int i = 0; param.valueNames[i] != nullptr; i++) {
+            if (strcmp(param.valueNames[i], text) == 0) {
+                value = i;
+                return true;
+            }
+        }
+    }
+    char* end = nullptr;
+    value = strtol(text, &end, 10);
+    return end != text && *end == '\0' && value >= param.minValue && value <= param.maxValue;
+}
+
+// =============================================
+// ОТВЕТ КАДРАМИ 'A'
+// =============================================
+
+ConsoleReplyFrames::ConsoleReplyFrames() : port(nullptr), requestId(0), flags(0), length(0) {}
+
+void ConsoleReplyFrames::begin(Print* output, uint8_t id) {
+    port = output;
+    requestId = id;
+    flags = 0;
+    length = 0;
+}
+
+size_t ConsoleReplyFrames::write(uint8_t c) {
+    if (length >= CONSOLE_REPLY_CHUNK_BYTES) {
+        sendChunk(false);
+    }
+    frame[5 + 2 + length++] = c;
+    return 1;
+}
+
+size_t ConsoleReplyFrames::write(const uint8_t* buffer, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        write(buffer[i]);
+    }
+    return size;
+}
+
+void ConsoleReplyFrames::finish() {
+    sendChunk(true);
+}
+
+void ConsoleReplyFrames::sendChunk(bool last) {
+    if (port == nullptr) {
+        length = 0;
+        return;
+    }
+    size_t payload = 2 + length;
+    frame[0] = FRAME_SYNC_0;
+    frame[1] = FRAME_SYNC_1;
+    frame[2] = CONSOLE_FRAME_REPLY;
+    frame[3] = payload & 0xFF;
+    frame[4] = payload >> 8;
+    frame[5] = requestId;
+    frame[6] = flags | (last ? CONSOLE_REPLY_LAST : 0);
+    putLe32(frame + 5 + payload, ~crc32Update(0xFFFFFFFF, frame + 2, 3 + payload));
+    port->write(frame, FRAME_OVERHEAD + payload);
+    length = 0;
+}
+
+// =============================================
+// КОНСОЛЬ
+// =============================================
+
+const SerialConsole::Command SerialConsole::COMMANDS[] = {
+    {"help",     &SerialConsole::cmdHelp,     "help - список команд"},
+    {"status",   &SerialConsole::cmdStatus,   "status - состояние системы"},
+    {"board",    &SerialConsole::cmdBoard,    "board - доска (2 последних байта UID)"},
+    {"cell",     &SerialConsole::cmdCell,     "cell <индекс> | cell <ряд> <столбец> - ячейка"},
+    {"cells",    &SerialConsole::cmdCells,    "cells - профили и ошибки всех ячеек"},
+    {"states",   &SerialConsole::cmdStates,   "states [reset] - время в состояниях, переходы"},
+    {"metrics",  &SerialConsole::cmdMetrics,  "metrics [snap|delta|schema|stream <мс>] - метрики"},
+    {"mem",      &SerialConsole::cmdMem,      "mem - куча и запас стека задач"},
+    {"get",      &SerialConsole::cmdGet,      "get [параметр] - настройки"},
+    {"set",      &SerialConsole::cmdSet,      "set <параметр> <значение> - изменить на ходу"},
+    {"trace",    &SerialConsole::cmdTrace,    "trace on|off|stream on|off|spill|erase|status - трасса I2C"},
+    {"save",     &SerialConsole::cmdSave,     "save - сохранить настройки в NVS"},
+    {"load",     &SerialConsole::cmdLoad,     "load - настройки из NVS"},
+    {"defaults", &SerialConsole::cmdDefaults, "defaults - настройки config.h (save - сохранить)"},
+};
+
+const int SerialConsole::COMMAND_COUNT = sizeof(COMMANDS) / sizeof(COMMANDS[0]);
+
+SerialConsole::SerialConsole(StateManager* state, RFIDManager* rfid, MultiplexerManager* mux,
+                             ScanMatrix* matrix, DisplayManager* display) {
+    stateManager = state;
+    rfidManager = rfid;
+    muxManager = mux;
+    scanMatrix = matrix;
+    displayManager = display;
+
+    port = &Serial;
+    out = port;
+    commandFailed = false;
+
+    lineLength = 0;
+    lineOverflow = false;
+    frameLength = 0;
+    frameStartTime = 0;
+
+    reportRow = -1;
+    reportFramed = false;
+    reportIntervalMs = STATUS_REPORT_INTERVAL_MS;
+
+    storageOpen = false;
+
+    commands = metrics.counter("console.commands");
+    errors = metrics.counter("console.errors");
+    badFrames = 0;
+    lastExecUs = 0;
+    maxExecUs = 0;
+}
+
+void SerialConsole::begin() {
+    if (loadSettings()) {
+        DEBUG_PRINTLN("Console: настройки из NVS применены");
+    }
+    DEBUG_PRINTLN("Console: готова (help - список команд)");
+}
+
+void SerialConsole::poll() {
+    // Недоведенная таблица - строка за проход, ввод ждет в буфере UART
+    if (reportRow >= 0) {
+        continueReport();
+        return;
+    }
+
+    if (frameLength > 0 && millis() - frameStartTime > CONSOLE_FRAME_TIMEOUT_MS) {
+        frameLength = 0;
+        badFrames++;
+    }
+
+    for (int n = 0; n < CONSOLE_RX_BYTES_PER_LOOP && port->available() > 0; n++) {
+        if (acceptByte((uint8_t)port->read())) {
+            break;  // Одна команда за проход
+        }
+    }
+}
+
+void SerialConsole::execute(const char* text) {
+    strncpy(line, text, CONSOLE_LINE_BYTES - 1);
+    line[CONSOLE_LINE_BYTES - 1] = '\0';
+    out = port;
+    dispatch(line);
+}
+
+bool SerialConsole::acceptByte(uint8_t c) {
+    if (frameLength > 0 || (lineLength == 0 && !lineOverflow && c == FRAME_SYNC_0)) {
+        return acceptFrameByte(c);
+    }
+
+    if (c == '\r' || c == '\n') {
+        if (lineOverflow) {
+            lineOverflow = false;
+            lineLength = 0;
+            port->printf("ОШИБКА: строка длиннее %d символов\n", CONSOLE_LINE_BYTES - 1);
+            errors.add();
+            return true;
+        }
+        if (lineLength == 0) {
+            return false;
+        }
+        line[lineLength] = '\0';
+        lineLength = 0;
+        out = port;
+        dispatch(line);
+        return true;
+    }
+
+    if (lineLength + 1 < CONSOLE_LINE_BYTES) {
+        line[lineLength++] = (char)c;
+    } else {
+        lineOverflow = true;
+    }
+    return false;
+}
+
+bool SerialConsole::acceptFrameByte(uint8_t c) {
+    if (frameLength == 0) {
+        frameStartTime = millis();
+    }
+    frame[frameLength++] = c;
+
+    if (frameLength == 2 && c != FRAME_SYNC_1) {
+        frameLength = 0;
+        badFrames++;
+        return false;
+    }
+    if (frameLength < 5) {
+        return false;
+    }
+
+    size_t payload = frame[3] | (frame[4] << 8);
+    if (frame[2] != CONSOLE_FRAME_COMMAND || payload < 1 || payload > CONSOLE_LINE_BYTES) {
+        frameLength = 0;
+        badFrames++;
+        return false;
+    }
+    if (frameLength < FRAME_OVERHEAD + payload) {
+        return false;
+    }
+    frameLength = 0;
+
+    if (~crc32Update(0xFFFFFFFF, frame + 2, 3 + payload) != getLe32(frame + 5 + payload)) {
+        badFrames++;
+        return false;
+    }
+
+    // Текст без завершающего нуля: номер запроса + до CONSOLE_LINE_BYTES - 1 символов
+    memcpy(line, frame + 6, payload - 1);
+    line[payload - 1] = '\0';
+    replyFrames.begin(port, frame[5]);
+    out = &replyFrames;
+    dispatch(line);
+    if (reportRow < 0) {
+        replyFrames.finish();
+    }
+    out = port;
+    return true;
+}
+
+void SerialConsole::dispatch(char* text) {
+    unsigned long startUs = micros();
+    commandFailed = false;
+
+    char* argv[MAX_ARGS + 1];
+    int argc = 0;
+    char* token = strtok(text, " \t");
+    while (token != nullptr && argc <= MAX_ARGS) {
+        argv[argc++] = token;
+        token = strtok(nullptr, " \t");
+    }
+
+    const Command* command = nullptr;
+    for (int i = 0; argc > 0 && i < COMMAND_COUNT; i++) {
+        if (strcmp(COMMANDS[i].name, argv[0]) == 0) {
+            command = &COMMANDS[i];
+            break;
+        }
+    }
+
+    if (command == nullptr) {
+        fail(argc > 0 ? "неизвестная команда (help - список)" : "пустая команда");
+    } else if (argc > MAX_ARGS) {
+        fail(command->usage);
+    } else {
+        (this->*command->handler)(argc, argv);
+    }
+
+    commands.add();
+    if (commandFailed) {
+        errors.add();
+        if (out == &replyFrames) {
+            replyFrames.setError();
+        }
+    }
+
+    lastExecUs = micros() - startUs;
+    if (lastExecUs > maxExecUs) {
+        maxExecUs = lastExecUs;
+    }
+}
+
+void SerialConsole::fail(const char* message) {
+    out->printf("ОШИБКА: %s\n", message);
+    commandFailed = true;
+}
+
+void SerialConsole::continueReport() {
+    out = reportFramed ? (Print*)&replyFrames : (Print*)port;
+    printCellRow(reportRow++);
+    if (reportRow >= MATRIX_ROWS) {
+        reportRow = -1;
+        if (reportFramed) {
+            replyFrames.finish();
+        }
+    }
+    out = port;
+}
+
+// =============================================
+// КОМАНДЫ
+// =============================================
+
+void SerialConsole::cmdHelp(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    for (int i = 0; i < COMMAND_COUNT; i++) {
+        out->printf("  %s\n", COMMANDS[i].usage);
+    }
+    out->print("  параметры set:");
+    for (int i = 0; i < PARAM_COUNT; i++) {
+        out->printf(" %s", PARAMS[i].name);
+    }
+    out->println();
+}
+
+void SerialConsole::cmdStatus(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    {
+        ForcedLog log;
+        displayManager->printSystemStatus();
+    }
+    out->printf("Состояние: %s, проход %lu мс, карт %d, доска %s\n",
+                stateManager->getStateName(stateManager->getCurrentState()),
+                scanMatrix->getLastCycleTime(), scanMatrix->findCardsInMatrix(),
+                scanMatrix->isBoardValid() ? "подтверждена" : (scanMatrix->isBoardAssumed() ? "из снимка" : "неполная"));
+    out->printf("Консоль: команд %lu, ошибок %lu, плохих кадров %lu, исполнение до %lu мкс\n",
+                (unsigned long)commands.get(), (unsigned long)errors.get(),
+                (unsigned long)badFrames, maxExecUs);
+}
+
+void SerialConsole::cmdBoard(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    out->print("   ");
+    for (int col = 0; col < MATRIX_COLS; col++) {
+        out->printf("%5d", col);
+    }
+    out->println();
+    for (int row = 0; row < MATRIX_ROWS; row++) {
+        out->printf("%2d ", row);
+        for (int col = 0; col < MATRIX_COLS; col++) {
+            int cellIndex = row * MATRIX_COLS + col;
+            const CardInfo& info = scanMatrix->getCardInfo(cellIndex);
+            if (scanMatrix->getQuarantine().isQuarantined(cellIndex)) {
+                out->print("    Q");
+            } else if (info.present && info.uidLength >= 2) {
+                // '~' - метка из снимка NVS, проходом еще не подтверждена
+                out->printf(" %c%02X%02X", info.assumed ? '~' : ' ',
+                            info.uid[info.uidLength - 2], info.uid[info.uidLength - 1]);
+            } else {
+                out->print("    .");
+            }
+        }
+        out->println();
+    }
+}
+
+void SerialConsole::cmdCell(int argc, char** argv) {
+    int cellIndex = -1;
+    if (argc == 2) {
+        cellIndex = atoi(argv[1]);
+    } else if (argc == 3 && muxManager->isValidCell(atoi(argv[1]), atoi(argv[2]))) {
+        cellIndex = muxManager->rowColToIndex(atoi(argv[1]), atoi(argv[2]));
+    }
+    if (argc < 2 || argc > 3 || !muxManager->isValidCellIndex(cellIndex)) {
+        fail("cell <индекс ячейки> | cell <ряд> <столбец>");
+        return;
+    }
+
+    int row, col;
+    muxManager->indexToRowCol(cellIndex, row, col);
+    const CardInfo& info = scanMatrix->getCardInfo(cellIndex);
+    out->printf("Ячейка %d (%d,%d): ", cellIndex, row, col);
+    if (info.present) {
+        for (uint8_t i = 0; i < info.uidLength; i++) {
+            out->printf(i ? ":%02X" : "%02X", info.uid[i]);
+        }
+        out->printf(", видна %lu мс назад%s\n", millis() - info.lastSeen,
+                    info.assumed ? ", из снимка NVS" : "");
+    } else {
+        out->println("пусто");
+    }
+
+    const CellTimingProfile& profile = scanMatrix->getCalibrator().getProfile(cellIndex);
+    out->printf("  профиль: таймаут %u мс, пауза %u мкс, повторов %u, RF %s, %s\n",
+                profile.timeoutMs, profile.settleUs, profile.retries,
+                RFIDManager::getRfProfileName(profile.rfProfile),
+                profile.calibrated ? "откалиброван" : "консервативный");
+    const CellQuarantine& quarantine = scanMatrix->getQuarantine();
+    out->printf("  ошибок подряд %u%s\n", quarantine.getFailures(cellIndex),
+                quarantine.isQuarantined(cellIndex) ? ", в карантине" : "");
+}
+
+void SerialConsole::cmdCells(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    // Таблица - по ряду за проход loop(), первый ряд сразу
+    out->println("Ячейки: таймаут мс/пауза мкс/ошибок подряд (* - откалибрована, Q - карантин)");
+    reportFramed = (out == &replyFrames);
+    reportRow = 0;
+    printCellRow(reportRow++);
+}
+
+void SerialConsole::printCellRow(int row) const {
+    out->printf("%2d", row);
+    for (int col = 0; col < MATRIX_COLS; col++) {
+        int cellIndex = row * MATRIX_COLS + col;
+        const CellTimingProfile& profile = scanMatrix->getCalibrator().getProfile(cellIndex);
+        const CellQuarantine& quarantine = scanMatrix->getQuarantine();
+        char mark = quarantine.isQuarantined(cellIndex) ? 'Q' : (profile.calibrated ? '*' : ' ');
+        out->printf(" %2u/%-5u/%u%c", profile.timeoutMs, profile.settleUs,
+                    quarantine.getFailures(cellIndex), mark);
+    }
+    out->println();
+}
+
+void SerialConsole::cmdStates(int argc, char** argv) {
+    if (argc == 2 && strcmp(argv[1], "reset") == 0) {
+        stateManager->resetProfile();
+        out->println("OK, профиль состояний сброшен");
+        return;
+    }
+    if (argc != 1) {
+        fail("states [reset]");
+        return;
+    }
+    ForcedLog log;
+    stateManager->printProfile();
+}
+
+void SerialConsole::cmdMem(int argc, char**) {
+    if (argc != 1) {
+        fail("mem");
+        return;
+    }
+    memoryMonitor.sample();
+    ForcedLog log;
+    memoryMonitor.printReport();
+}
+
+void SerialConsole::cmdMetrics(int argc, char** argv) {
+    if (argc == 1) {
+        ForcedLog log;
+        metrics.printAll();
+        return;
+    }
+
+    // Двоичные кадры уходят в поток метрик (Serial), ответ - подтверждение
+    bool ok;
+    if (argc == 2 && strcmp(argv[1], "snap") == 0) {
+        ok = metrics.sendSnapshot(false);
+    } else if (argc == 2 && strcmp(argv[1], "delta") == 0) {
+        // Приращения общие с потоком mstream: читает кто-то один
+        ok = metrics.sendSnapshot(true);
+    } else if (argc == 2 && strcmp(argv[1], "schema") == 0) {
+        ok = metrics.sendSchema();
+    } else if (argc == 3 && strcmp(argv[1], "stream") == 0) {
+        long value;
+        ok = parseParamValue(PARAMS[PARAM_MSTREAM], argv[2], value);
+        if (ok) {
+            setParam(PARAM_MSTREAM, (int)value);
+        }
+    } else {
+        fail("metrics [snap|delta|schema|stream <мс>]");
+        return;
+    }
+
+    if (!ok) {
+        fail("кадр метрик не отправлен");
+        return;
+    }
+    out->printf("OK, снимок %lu\n", (unsigned long)metrics.getSnapshotSequence());
+}
+
+void SerialConsole::cmdGet(int argc, char** argv) {
+    if (argc == 2) {
+        int index = findParam(argv[1]);
+        if (index < 0) {
+            fail("неизвестный параметр");
+            return;
+        }
+        printParam(index);
+        return;
+    }
+    for (int i = 0; i < PARAM_COUNT; i++) {
+        printParam(i);
+    }
+}
+
+void SerialConsole::cmdSet(int argc, char** argv) {
+    if (argc != 3) {
+        fail("set <параметр> <значение>");
+        return;
+    }
+    int index = findParam(argv[1]);
+    if (index < 0) {
+        fail("неизвестный параметр (help - список)");
+        return;
+    }
+    long value;
+    if (!parseParamValue(PARAMS[index], argv[2], value)) {
+        out->printf("ОШИБКА: %s: %ld..%ld", PARAMS[index].name, PARAMS[index].minValue, PARAMS[index].maxValue);
+        if (PARAMS[index].valueNames != nullptr) {
+            for (int i = 0; PARAMS[index].valueNames[i] != nullptr; i++) {
+                out->printf(i ? "|%s" : " или %s", PARAMS[index].valueNames[i]);
+            }
+        }
+        out->println();
+        commandFailed = true;
+        return;
+    }
+    setParam(index, (int)value);
+    printParam(index);
+}
+
+void SerialConsole::cmdTrace(int argc, char** argv) {
+#ifdef I2C_TRACE
+    bool on = argc == 3 && strcmp(argv[2], "on") == 0;
+    if (argc == 2 && strcmp(argv[1], "on") == 0) {
+        i2cTrace.setEnabled(true);
+    } else if (argc == 2 && strcmp(argv[1], "off") == 0) {
+        i2cTrace.setEnabled(false);
+    } else if (argc == 3 && strcmp(argv[1], "stream") == 0 && (on || strcmp(argv[2], "off") == 0)) {
+        i2cTrace.setStreaming(on);
+    } else if (argc == 2 && strcmp(argv[1], "spill") == 0) {
+        if (!i2cTrace.spill(true)) {
+            fail("кольцо не сохранено в SPIFFS");
+            return;
+        }
+    } else if (argc == 2 && strcmp(argv[1], "erase") == 0) {
+        i2cTrace.eraseSaved();
+    } else if (!(argc == 2 && strcmp(argv[1], "status") == 0)) {
+        fail("trace on|off|stream on|off|spill|erase|status");
+        return;
+    }
+    out->printf("Трасса I2C: запись %s, поток %s, записей в кольце %lu, сохранений %lu\n",
+                i2cTrace.isEnabled() ? "вкл" : "выкл", i2cTrace.isStreaming() ? "вкл" : "выкл",
+                (unsigned long)i2cTrace.getRecordsInRing(), (unsigned long)i2cTrace.getSpills());
+#else
+    (void)argc;
+    (void)argv;
+    fail("сборка без -DI2C_TRACE");
+#endif
+}
+
+void SerialConsole::cmdSave(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    if (!saveSettings()) {
+        fail("NVS недоступна");
+        return;
+    }
+    out->println("OK, настройки сохранены");
+}
+
+void SerialConsole::cmdLoad(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    if (!loadSettings()) {
+        fail("в NVS нет сохраненных настроек");
+        return;
+    }
+    out->println("OK, настройки из NVS применены");
+}
+
+void SerialConsole::cmdDefaults(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    ConsoleSettings settings;
+    defaultSettings(settings);
+    applySettings(settings);
+    out->println("OK, настройки config.h (save - сохранить)");
+}
+
+// =============================================
+// ЗНАЧЕНИЯ ПАРАМЕТРОВ
+// =============================================
+
+int SerialConsole::getParam(int index) const {
+    switch (index) {
+        case PARAM_DELAY:       return (int)scanMatrix->getScanDelay();
+        case PARAM_TIMEOUT:     return scanMatrix->getDefaultTimeout();
+        case PARAM_RETRIES:     return rfidManager->getTransactionRetries();
+        case PARAM_SETTLE:      return (int)muxManager->getSettleTime();
+        case PARAM_MULTITARGET: return scanMatrix->getMultiTargetMode();
+        case PARAM_RFGATE:      return scanMatrix->getFieldGate().getMode();
+        case PARAM_FASTVERIFY:  return scanMatrix->getFastVerify();
+        case PARAM_WATCH:       return scanMatrix->getWatchAfterRemoval();
+        case PARAM_QUARANTINE:  return scanMatrix->getQuarantine().isEnabled();
+        case PARAM_PROVISIONAL: return scanMatrix->getCardEvents().getProvisionalEnabled();
+        case PARAM_MOVES:       return scanMatrix->getMoveRecognition();
+        case PARAM_RFPROFILES:  return scanMatrix->getCalibrator().getRfProfilesEnabled();
+        case PARAM_IRQ:         return rfidManager->getIrqWait();
+#if ENABLE_SERIAL_DEBUG
+        case PARAM_LOG:         return serialDebugEnabled;
+#endif
+        case PARAM_REPORT:      return (int)reportIntervalMs;
+        case PARAM_MSTREAM:     return (int)metrics.getStreamInterval();
+        default:                return 0;
+    }
+}
+
+void SerialConsole::setParam(int index, int value) {
+    switch (index) {
+        case PARAM_DELAY:       scanMatrix->setScanDelay(value); break;
+        case PARAM_TIMEOUT:     scanMatrix->setDefaultTimeout(value); break;
+        case PARAM_RETRIES:     rfidManager->setTransactionRetries(value); break;
+        case PARAM_SETTLE:      muxManager->setSettleTime(value); break;
+        case PARAM_MULTITARGET: scanMatrix->setMultiTargetMode((MultiTargetMode)value); break;
+        case PARAM_RFGATE:      scanMatrix->getFieldGate().setMode((RfGatingMode)value); break;
+        case PARAM_FASTVERIFY:  scanMatrix->setFastVerify(value != 0); break;
+        case PARAM_WATCH:       scanMatrix->setWatchAfterRemoval(value != 0); break;
+        case PARAM_QUARANTINE:  scanMatrix->getQuarantine().setEnabled(value != 0); break;
+        case PARAM_PROVISIONAL: scanMatrix->getCardEvents().setProvisionalEnabled(value != 0); break;
+        case PARAM_MOVES:       scanMatrix->setMoveRecognition(value != 0); break;
+        case PARAM_RFPROFILES:  scanMatrix->getCalibrator().setRfProfilesEnabled(value != 0); break;
+        case PARAM_IRQ:         rfidManager->setIrqWait(value != 0); break;
+#if ENABLE_SERIAL_DEBUG
+        case PARAM_LOG:         serialDebugEnabled = value != 0; break;
+#endif
+        case PARAM_REPORT:      reportIntervalMs = value; break;
+        case PARAM_MSTREAM:     metrics.setStreamInterval(value); break;
+        default:                break;
+    }
+}
+
+void SerialConsole::printParam(int index) const {
+    const ConsoleParamInfo& param = PARAMS[index];
+    int value = getParam(index);
+    if (param.valueNames != nullptr) {
+        out->printf("%s=%s\n", param.name, param.valueNames[value]);
+    } else {
+        out->printf("%s=%d %s\n", param.name, value, param.unit);
+    }
+}
+
+// =============================================
+// НАСТРОЙКИ В NVS
+// =============================================
+
+void SerialConsole::captureSettings(ConsoleSettings& settings) const {
+    memset(&settings, 0, sizeof(settings));
+    settings.magic = SETTINGS_MAGIC;
+    settings.version = SETTINGS_VERSION;
+    settings.scanDelayMs = getParam(PARAM_DELAY);
+    settings.defaultTimeoutMs = getParam(PARAM_TIMEOUT);
+    settings.muxSettleUs = getParam(PARAM_SETTLE);
+    settings.transactionRetries = getParam(PARAM_RETRIES);
+    settings.multiTargetMode = getParam(PARAM_MULTITARGET);
+    settings.rfGatingMode = getParam(PARAM_RFGATE);
+    for (int i = PARAM_FASTVERIFY; i <= PARAM_LOG; i++) {
+        if (getParam(i)) {
+            settings.flags |= 1 << (i - PARAM_FASTVERIFY);
+        }
+    }
+    settings.reportIntervalMs = getParam(PARAM_REPORT);
+    settings.metricsIntervalMs = getParam(PARAM_MSTREAM);
+    settings.crc = computeCrc(settings);
+}
+
+void SerialConsole::applySettings(const ConsoleSettings& settings) {
+    setParam(PARAM_DELAY, settings.scanDelayMs);
+    setParam(PARAM_TIMEOUT, settings.defaultTimeoutMs);
+    setParam(PARAM_SETTLE, settings.muxSettleUs);
+    setParam(PARAM_RETRIES, settings.transactionRetries);
+    setParam(PARAM_MULTITARGET, settings.multiTargetMode);
+    setParam(PARAM_RFGATE, settings.rfGatingMode);
+    for (int i = PARAM_FASTVERIFY; i <= PARAM_LOG; i++) {
+        setParam(i, (settings.flags >> (i - PARAM_FASTVERIFY)) & 1);
+    }
+    setParam(PARAM_REPORT, settings.reportIntervalMs);
+    setParam(PARAM_MSTREAM, settings.metricsIntervalMs);
+}
+
+void SerialConsole::defaultSettings(ConsoleSettings& settings) const {
+    memset(&settings, 0, sizeof(settings));
+    settings.magic = SETTINGS_MAGIC;
+    settings.version = SETTINGS_VERSION;
+    settings.scanDelayMs = SCAN_DELAY_MS;
+    settings.defaultTimeoutMs = PN532_TIMEOUT_MS;
+    settings.muxSettleUs = MUX_SETTLE_TIME_US;
+    settings.transactionRetries = RECOVERY_TRANSACTION_RETRIES;
+    settings.multiTargetMode = MULTI_TARGET_MODE;
+    settings.rfGatingMode = RF_GATING_MODE;
+    const bool defaults[] = {ENABLE_FAST_VERIFY, ENABLE_WATCH_AFTER_REMOVAL, ENABLE_CELL_QUARANTINE,
+                             ENABLE_PROVISIONAL_EVENTS, ENABLE_MOVE_RECOGNIZER, ENABLE_RF_PROFILES,
+                             PN532_USE_IRQ, ENABLE_SERIAL_DEBUG};
+    for (int i = PARAM_FASTVERIFY; i <= PARAM_LOG; i++) {
+        if (defaults[i - PARAM_FASTVERIFY]) {
+            settings.flags |= 1 << (i - PARAM_FASTVERIFY);
+        }
+    }
+    settings.reportIntervalMs = STATUS_REPORT_INTERVAL_MS;
+    settings.metricsIntervalMs = METRICS_STREAM_INTERVAL_MS;
+    settings.crc = computeCrc(settings);
+}
+
+bool SerialConsole::saveSettings() {
+    if (!storageOpen) {
+        storageOpen = preferences.begin(SETTINGS_NAMESPACE, false);
+    }
+    if (!storageOpen) {
+        return false;
+    }
+    ConsoleSettings settings;
+    captureSettings(settings);
+    return preferences.putBytes(SETTINGS_KEY, &settings, sizeof(settings)) == sizeof(settings);
+}
+
+bool SerialConsole::loadSettings() {
+    if (!storageOpen) {
+        storageOpen = preferences.begin(SETTINGS_NAMESPACE, false);
+    }
+    if (!storageOpen || preferences.getBytesLength(SETTINGS_KEY) != sizeof(ConsoleSettings)) {
+        return false;
+    }
+    ConsoleSettings settings;
+    preferences.getBytes(SETTINGS_KEY, &settings, sizeof(settings));
+    if (settings.magic != SETTINGS_MAGIC || settings.version != SETTINGS_VERSION ||
+        computeCrc(settings) != settings.crc) {
+        DEBUG_PRINTLN("Console: настройки в NVS другого формата или повреждены - игнорируем");
+        return false;
+    }
+    applySettings(settings);
+    return true;
+}
+
+uint32_t SerialConsole::computeCrc(const ConsoleSettings& settings) {
+    return ~crc32Update(0xFFFFFFFF, (const uint8_t*)&settings, offsetof(ConsoleSettings, crc));
+}
@@ -0,0 +1,175 @@
+#ifndef SERIAL_CONSOLE_H
+#define SERIAL_CONSOLE_H
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include "config.h"
+#include "metrics.h"
+#include "multiplexer.h"
+
+class StateManager;
+class RFIDManager;
+class ScanMatrix;
+class DisplayManager;
+
+// Кадры консоли - тот же формат, что у трассы I2C и метрик:
+// A5 5A | тип | длина (2, LE) | данные | CRC32 (4, LE) от типа до конца данных
+enum ConsoleFrameType {
+    CONSOLE_FRAME_COMMAND = 'C',    // Номер запроса (1) + текст команды
+    CONSOLE_FRAME_REPLY   = 'A'     // Номер запроса (1) + флаги + часть текста ответа
+};
+
+enum ConsoleReplyFlags {
+    CONSOLE_REPLY_LAST  = 0x01,     // Последняя часть ответа
+    CONSOLE_REPLY_ERROR = 0x02      // Команда не выполнена
+};
+
+// Настройки консоли в NVS: то, что меняется командой set
+struct ConsoleSettings {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t scanDelayMs;
+    uint16_t defaultTimeoutMs;
+    uint16_t muxSettleUs;
+    uint8_t transactionRetries;
+    uint8_t multiTargetMode;
+    uint8_t rfGatingMode;
+    uint8_t flags;                  // Переключатели on/off, бит на параметр
+    uint32_t reportIntervalMs;
+    uint32_t metricsIntervalMs;
+    uint32_t crc;
+};
+
+// Ответ на кадр 'C': текст режется на кадры 'A' по CONSOLE_REPLY_CHUNK_BYTES
+class ConsoleReplyFrames : public Print {
+private:
+    Print* port;
+    uint8_t requestId;
+    uint8_t flags;
+    uint8_t frame[9 + 2 + CONSOLE_REPLY_CHUNK_BYTES];
+    size_t length;
+
+public:
+    ConsoleReplyFrames();
+    void begin(Print* output, uint8_t id);
+    void setError() { flags |= CONSOLE_REPLY_ERROR; }
+    void finish();                  // Последняя часть (возможно пустая)
+
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+
+private:
+    void sendChunk(bool last);
+};
+
+// Консоль Serial: запросы (доска, ячейка, метрики) и настройки сканирования
+// на ходу. poll() из loop() читает ввод по бюджету и исполняет не больше
+// одной команды за проход; ответы текстом или кадрами 'A' - как пришла команда
+class SerialConsole {
+private:
+    StateManager* stateManager;
+    RFIDManager* rfidManager;
+    MultiplexerManager* muxManager;
+    ScanMatrix* scanMatrix;
+    DisplayManager* displayManager;
+
+    Stream* port;
+    Print* out;                     // Текущий ответ: port или replyFrames
+    ConsoleReplyFrames replyFrames;
+    bool commandFailed;
+
+    // Строка текстовой команды
+    char line[CONSOLE_LINE_BYTES];
+    size_t lineLength;
+    bool lineOverflow;
+
+    // Кадр команды: синхрослово в начале строки переключает прием на кадр
+    uint8_t frame[9 + CONSOLE_LINE_BYTES + 1];
+    size_t frameLength;
+    unsigned long frameStartTime;
+
+    // Длинный вывод по строке за проход (таблица ячеек)
+    int reportRow;                  // -1 = нет
+    bool reportFramed;
+
+    unsigned long reportIntervalMs; // Периодический отчет о состоянии (main.cpp)
+
+    Preferences preferences;
+    bool storageOpen;
+
+    MetricCounter commands;
+    MetricCounter errors;
+    uint32_t badFrames;
+    unsigned long lastExecUs;
+    unsigned long maxExecUs;
+
+public:
+    SerialConsole(StateManager* state, RFIDManager* rfid, MultiplexerManager* mux,
+                  ScanMatrix* matrix, DisplayManager* display);
+
+    // Поток ввода-вывода (Serial по умолчанию; на хосте - стенд)
+    void setPort(Stream* stream) { port = stream; }
+
+    // После инициализации модулей: применяет настройки из NVS
+    void begin();
+    void poll();                    // Вызывается из loop()
+
+    // Исполнение одной строки (без бюджета, для стендов)
+    void execute(const char* text);
+
+    unsigned long getReportInterval() const { return reportIntervalMs; }
+    uint32_t getCommandCount() const { return commands.get(); }
+    uint32_t getErrorCount() const { return errors.get(); }
+    uint32_t getBadFrames() const { return badFrames; }
+    unsigned long getLastExecUs() const { return lastExecUs; }
+    unsigned long getMaxExecUs() const { return maxExecUs; }
+    bool isReportPending() const { return reportRow >= 0; }
+
+    // Настройки: текущие значения модулей, значения config.h, запись/чтение NVS
+    void captureSettings(ConsoleSettings& settings) const;
+    void applySettings(const ConsoleSettings& settings);
+    void defaultSettings(ConsoleSettings& settings) const;
+    bool saveSettings();
+    bool loadSettings();
+
+private:
+    bool acceptByte(uint8_t c);     // true - команда исполнена
+    bool acceptFrameByte(uint8_t c);
+    void dispatch(char* text);
+    void continueReport();
+    void fail(const char* message);
+
+    // Команды
+    void cmdHelp(int argc, char** argv);
+    void cmdStatus(int argc, char** argv);
+    void cmdBoard(int argc, char** argv);
+    void cmdCell(int argc, char** argv);
+    void cmdCells(int argc, char** argv);
+    void cmdStates(int argc, char** argv);
+    void cmdMetrics(int argc, char** argv);
+    void cmdMem(int argc, char** argv);
+    void cmdGet(int argc, char** argv);
+    void cmdSet(int argc, char** argv);
+    void cmdTrace(int argc, char** argv);
+    void cmdSave(int argc, char** argv);
+    void cmdLoad(int argc, char** argv);
+    void cmdDefaults(int argc, char** argv);
+
+    int getParam(int index) const;
+    void setParam(int index, int value);
+    void printParam(int index) const;
+    void printCellRow(int row) const;
+
+    static uint32_t computeCrc(const ConsoleSettings& settings);
+
+    typedef void (SerialConsole::*Handler)(int argc, char** argv);
+    struct Command {
+        const char* name;
+        Handler handler;
+        const char* usage;
+    };
+    static const Command COMMANDS[];
+    static const int COMMAND_COUNT;
+};
+
+#endif // SERIAL_CONSOLE_H
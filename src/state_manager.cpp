@@ -1,12 +1,27 @@
 #include "state_manager.h"
 
+// Длительность визита в состояние, мс (последняя корзина - длиннее)
+static const uint32_t STATE_VISIT_BOUNDS_MS[STATE_VISIT_BUCKETS - 1] = {100, 1000, 5000, 30000, 300000};
+// Восстановление: от ошибки до выхода из ERROR, мс
+static const uint32_t RECOVERY_TIME_BOUNDS_MS[] = {100, 300, 1000, 3000, 10000, 30000, 60000};
+
 StateManager::StateManager() {
     currentState = STATE_INIT;
     previousState = STATE_INIT;
     stateStartTime = 0;
     lastStateUpdate = 0;
-    stateTransitions = 0;
-    errorCount = 0;
+    stateTransitions = metrics.counter("state.transitions");
+    errorCount = metrics.counter("state.errors");
+    stateGauge = metrics.gauge("state.current");
+    stateGauge.set(currentState);
+    scanningMs = metrics.counter("state.scanning_ms");
+    errorMs = metrics.counter("state.error_ms");
+    recoveryTime = metrics.histogram("state.recovery_ms", RECOVERY_TIME_BOUNDS_MS,
+                                     sizeof(RECOVERY_TIME_BOUNDS_MS) / sizeof(RECOVERY_TIME_BOUNDS_MS[0]));
+    
+    memset(&profile, 0, sizeof(profile));
+    profile.visits[currentState] = 1;
+    lastAccountTime = 0;
 }
 
 void StateManager::initialize() {
@@ -16,8 +31,13 @@ void StateManager::initialize() {
     previousState = STATE_INIT;
     stateStartTime = millis();
     lastStateUpdate = millis();
-    stateTransitions = 0;
-    errorCount = 0;
+    stateTransitions.reset();
+    errorCount.reset();
+    stateGauge.set(currentState);
+    scanningMs.reset();
+    errorMs.reset();
+    recoveryTime.reset();
+    resetProfile();
     
     DEBUG_PRINTF("StateManager: Состояние установлено в %s\n", getStateName(currentState));
 }
@@ -25,6 +45,7 @@ void StateManager::initialize() {
 void StateManager::updateState() {
     unsigned long currentTime = millis();
     lastStateUpdate = currentTime;
+    accountResidency(currentTime);
     
     // ПРИМЕЧАНИЕ: Основная логика переходов управляется из main.cpp
     // StateManager используется для трекинга и статистики состояний
@@ -65,19 +86,29 @@ void StateManager::updateState() {
         case STATE_ERROR:
             // Состояние ошибки - управляется из main.cpp через handleErrorRecovery()
             break;
+            
+        default:
+            break;
     }
 }
 
 void StateManager::setState(SystemState newState) {
+    if (newState >= SYSTEM_STATE_COUNT) {
+        newState = STATE_ERROR;
+    }
     if (newState != currentState) {
+        unsigned long now = millis();
+        accountResidency(now);
+        recordTransition(currentState, newState, now);
+        
         previousState = currentState;
         currentState = newState;
         stateStartTime = millis();
-        stateTransitions++;
+        stateTransitions.add();
+        stateGauge.set(currentState);
         
         // ФИЛЬТРАЦИЯ DEBUG СООБЩЕНИЙ - печатаем только важные переходы
         static unsigned long lastDebugOutput = 0;
-        static uint32_t lastTransitionCount = 0;
         unsigned long currentTime = millis();
         
         bool shouldPrintDebug = false;
@@ -93,7 +124,6 @@ void StateManager::setState(SystemState newState) {
         } else if ((currentTime - lastDebugOutput) >= 5000) {  // Раз в 5 секунд
             // Убираем спам статистики
             lastDebugOutput = currentTime;
-            lastTransitionCount = stateTransitions;
             shouldPrintDebug = false;
         }
         
@@ -101,7 +131,7 @@ void StateManager::setState(SystemState newState) {
             DEBUG_PRINTF("StateManager: %s -> %s (переход #%lu)\n", 
                         getStateName(previousState), 
                         getStateName(currentState),
-                        stateTransitions);
+                        stateTransitions.get());
         }
     }
 }
@@ -145,6 +175,11 @@ bool StateManager::isTimeForStateUpdate() const {
 void StateManager::reset() {
     DEBUG_PRINTLN("StateManager: Сброс состояния");
     
+    if (currentState != STATE_INIT) {
+        unsigned long now = millis();
+        accountResidency(now);
+        recordTransition(currentState, STATE_INIT, now);
+    }
     currentState = STATE_INIT;
     previousState = STATE_INIT;
     stateStartTime = millis();
@@ -154,9 +189,9 @@ void StateManager::reset() {
 }
 
 void StateManager::handleError(const char* errorMessage) {
-    errorCount++;
+    errorCount.add();
     
-    DEBUG_PRINTF("StateManager: ОШИБКА #%lu: %s\n", errorCount, errorMessage);
+    DEBUG_PRINTF("StateManager: ОШИБКА #%lu: %s\n", errorCount.get(), errorMessage);
     
     setState(STATE_ERROR);
 }
@@ -166,6 +201,131 @@ void StateManager::printCurrentState() const {
                 getStateName(currentState), getStateRunTime());
 }
 
+// =============================================
+// ПРОФИЛЬ СОСТОЯНИЙ
+// =============================================
+
+void StateManager::accountResidency(unsigned long now) {
+    uint32_t elapsed = now - lastAccountTime;
+    lastAccountTime = now;
+    profile.residencyMs[currentState] += elapsed;
+    if (currentState == STATE_SCANNING) {
+        scanningMs.add(elapsed);
+    } else if (currentState == STATE_ERROR) {
+        errorMs.add(elapsed);
+    }
+}
+
+void StateManager::recordTransition(SystemState from, SystemState to, unsigned long now) {
+    uint32_t durationMs = now - stateStartTime;
+    int bucket = 0;
+    while (bucket < STATE_VISIT_BUCKETS - 1 && durationMs > STATE_VISIT_BOUNDS_MS[bucket]) {
+        bucket++;
+    }
+    profile.visitBuckets[from][bucket]++;
+    if (durationMs > profile.maxVisitMs[from]) {
+        profile.maxVisitMs[from] = durationMs;
+    }
+    if (from == STATE_ERROR) {
+        recoveryTime.observe(durationMs);
+    }
+    
+    profile.transitions[from][to]++;
+    profile.visits[to]++;
+    
+    StateTransitionRecord& record = profile.history[profile.historyHead];
+    record.timeMs = now;
+    record.from = from;
+    record.to = to;
+    profile.historyHead = (profile.historyHead + 1) % STATE_HISTORY_SIZE;
+    if (profile.historyCount < STATE_HISTORY_SIZE) {
+        profile.historyCount++;
+    }
+}
+
+void StateManager::resetProfile() {
+    unsigned long now = millis();
+    memset(&profile, 0, sizeof(profile));
+    profile.sinceMs = now;
+    profile.visits[currentState] = 1;
+    lastAccountTime = now;
+}
+
+uint32_t StateManager::getResidencyMs(SystemState state) const {
+    if (state >= SYSTEM_STATE_COUNT) {
+        return 0;
+    }
+    uint32_t residency = profile.residencyMs[state];
+    if (state == currentState) {
+        residency += millis() - lastAccountTime;
+    }
+    return residency;
+}
+
+uint32_t StateManager::getAvailabilityPermille() const {
+    uint32_t total = getProfiledMs();
+    if (total == 0) {
+        return 0;
+    }
+    return (uint32_t)((uint64_t)getResidencyMs(STATE_SCANNING) * 1000 / total);
+}
+
+bool StateManager::getRecentTransition(int age, StateTransitionRecord& record) const {
+    if (age < 0 || age >= profile.historyCount) {
+        return false;
+    }
+    record = profile.history[(profile.historyHead + STATE_HISTORY_SIZE - 1 - age) % STATE_HISTORY_SIZE];
+    return true;
+}
+
+uint32_t StateManager::getVisitBucketBound(int bucket) {
+    return (bucket < STATE_VISIT_BUCKETS - 1) ? STATE_VISIT_BOUNDS_MS[bucket] : UINT32_MAX;
+}
+
+void StateManager::printProfile() const {
+    uint32_t total = getProfiledMs();
+    uint32_t availability = getAvailabilityPermille();
+    DEBUG_PRINTF("StateManager: профиль за %lu мс, доступность (SCANNING) %lu.%lu%%\n",
+                 (unsigned long)total, (unsigned long)availability / 10, (unsigned long)availability % 10);
+    
+    for (int s = 0; s < SYSTEM_STATE_COUNT; s++) {
+        if (profile.visits[s] == 0) {
+            continue;
+        }
+        uint32_t residency = getResidencyMs((SystemState)s);
+        DEBUG_PRINTF("  %-14s %lu мс (%lu%%), визитов %lu, самый долгий %lu мс:",
+                     getStateName((SystemState)s), (unsigned long)residency,
+                     total ? (unsigned long)((uint64_t)residency * 100 / total) : 0UL,
+                     (unsigned long)profile.visits[s], (unsigned long)profile.maxVisitMs[s]);
+        for (int b = 0; b < STATE_VISIT_BUCKETS; b++) {
+            if (b < STATE_VISIT_BUCKETS - 1) {
+                DEBUG_PRINTF(" <=%lu:%lu", (unsigned long)STATE_VISIT_BOUNDS_MS[b],
+                             (unsigned long)profile.visitBuckets[s][b]);
+            } else {
+                DEBUG_PRINTF(" >:%lu", (unsigned long)profile.visitBuckets[s][b]);
+            }
+        }
+        DEBUG_PRINTLN("");
+    }
+    
+    DEBUG_PRINT("  переходы:");
+    for (int from = 0; from < SYSTEM_STATE_COUNT; from++) {
+        for (int to = 0; to < SYSTEM_STATE_COUNT; to++) {
+            if (profile.transitions[from][to] > 0) {
+                DEBUG_PRINTF(" %s->%s:%lu", getStateName((SystemState)from), getStateName((SystemState)to),
+                             (unsigned long)profile.transitions[from][to]);
+            }
+        }
+    }
+    DEBUG_PRINTLN("");
+    
+    StateTransitionRecord record;
+    for (int age = 0; getRecentTransition(age, record); age++) {
+        DEBUG_PRINTF("  %lu мс назад: %s -> %s\n", (unsigned long)(millis() - record.timeMs),
+                     getStateName((SystemState)record.from), getStateName((SystemState)record.to));
+    }
+}
+
 const char* StateManager::getStateName(SystemState state) const {
     switch (state) {
         case STATE_INIT:           return "INIT";
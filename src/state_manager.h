@@ -3,6 +3,29 @@
 
 #include <Arduino.h>
 #include "config.h"
+#include "metrics.h"
+
+static const int STATE_VISIT_BUCKETS = 6;      // Границы - STATE_VISIT_BOUNDS_MS (state_manager.cpp)
+
+// Переход из истории (кольцо STATE_HISTORY_SIZE)
+struct StateTransitionRecord {
+    uint32_t timeMs;            // millis() перехода
+    uint8_t from;               // SystemState
+    uint8_t to;
+};
+
+// Профиль состояний с initialize(): копия - снимок для отчета или сравнения
+struct StateProfile {
+    uint32_t sinceMs;                                           // millis() начала учета
+    uint32_t residencyMs[SYSTEM_STATE_COUNT];                   // До последнего учета (loop/переход)
+    uint32_t visits[SYSTEM_STATE_COUNT];                        // Входов, включая текущий
+    uint32_t maxVisitMs[SYSTEM_STATE_COUNT];                    // Среди завершенных
+    uint32_t visitBuckets[SYSTEM_STATE_COUNT][STATE_VISIT_BUCKETS];
+    uint32_t transitions[SYSTEM_STATE_COUNT][SYSTEM_STATE_COUNT];   // [откуда][куда]
+    StateTransitionRecord history[STATE_HISTORY_SIZE];
+    uint8_t historyHead;                                        // Следующая запись
+    uint8_t historyCount;
+};
 
 class StateManager {
 private:
@@ -11,9 +34,17 @@ private:
     unsigned long stateStartTime;
     unsigned long lastStateUpdate;
     
-    // Счетчики и статистика
-    uint32_t stateTransitions;
-    uint32_t errorCount;
+    // Счетчики и статистика (реестр метрик)
+    MetricCounter stateTransitions;
+    MetricCounter errorCount;
+    MetricGauge stateGauge;             // Текущее состояние (SystemState)
+    MetricCounter scanningMs;           // Время в SCANNING и ERROR - доступность по приращениям
+    MetricCounter errorMs;
+    MetricHistogram recoveryTime;       // Длительность визитов в ERROR, мс
+    
+    // Профиль состояний
+    StateProfile profile;
+    unsigned long lastAccountTime;      // Время до этого момента уже разнесено по состояниям
     
 public:
     StateManager();
@@ -38,9 +69,19 @@ public:
     bool isTimeForStateUpdate() const;
     
     // Статистика и диагностика
-    uint32_t getStateTransitions() const { return stateTransitions; }
-    uint32_t getErrorCount() const { return errorCount; }
-    void incrementErrorCount() { errorCount++; }
+    uint32_t getStateTransitions() const { return stateTransitions.get(); }
+    uint32_t getErrorCount() const { return errorCount.get(); }
+    void incrementErrorCount() { errorCount.add(); }
+    
+    // Профиль: время в состоянии с начала учета (текущий визит - по millis()),
+    // доля SCANNING в промилле, i-й с конца переход истории
+    const StateProfile& getProfile() const { return profile; }
+    uint32_t getResidencyMs(SystemState state) const;
+    uint32_t getProfiledMs() const { return millis() - profile.sinceMs; }
+    uint32_t getAvailabilityPermille() const;
+    bool getRecentTransition(int age, StateTransitionRecord& record) const;
+    static uint32_t getVisitBucketBound(int bucket);    // UINT32_MAX - переполнение
+    void resetProfile();
     
     // Сброс и перезапуск
     void reset();
@@ -48,7 +89,12 @@ public:
     
     // Отладка
     void printCurrentState() const;
+    void printProfile() const;
     const char* getStateName(SystemState state) const;
+    
+private:
+    void accountResidency(unsigned long now);
+    void recordTransition(SystemState from, SystemState to, unsigned long now);
 };
 
 #endif // STATE_MANAGER_H 
\ No newline at end of file